@@ -0,0 +1,464 @@
+/**
+ * @file compress_bench.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Benchmark of the [compress] stage: each codec and level over a corpus of frames, then the adaptive worker pool
+ * fed at a given ingest rate.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The corpora are captured frames (-r, e.g. 'rxdata*.bin', one frame per file) or, by default, made-up ones: the
+ * simulated modem's pattern, telemetry-like records, and random bytes standing in for encrypted payloads. For each
+ * corpus, codec and level, reports the ratio (bytes sent over bytes received, frames that did not save min_saving
+ * counted as sent uncompressed), compression and decompression MB/s on one thread, and the fraction of frames that
+ * would have been bypassed. Every frame is round-tripped and checked.
+ *
+ * Then, for each codec and ingest rate, frames are fed to the worker pool through gs_compress_submit(...) and
+ * gs_compress_reap(...), as a forwarding stage does, for -t seconds. Reports the rate achieved against the rate
+ * offered, the ratio, the bypass rate, the worker CPU time per MB, and the level the workers settled at. A rate of 0
+ * feeds frames as fast as the pool takes them.
+ * Output is one JSON object per line.
+ *
+ * Usage: compress_bench.out [-r 'glob'] [-z frame size] [-n frames] [-w workers] [-m min_saving] [-i MB/s,MB/s,...]
+ * [-t seconds]
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <glob.h>
+#include <string>
+#include <vector>
+#include "gs_compress.hpp"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+typedef struct
+{
+    std::string name;
+    std::vector<std::vector<uint8_t>> frames;
+    uint64_t bytes;
+} corpus_t;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_versions(const void *a, const void *b)
+{
+    return strverscmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// One frame per file, as the simulated modem replays them.
+static int load_corpus(const char *pattern, corpus_t *corpus)
+{
+    glob_t files;
+    if (glob(pattern, 0, NULL, &files) != 0 || files.gl_pathc == 0)
+    {
+        fprintf(stderr, "No files match '%s'.\n", pattern);
+        globfree(&files);
+        return -1;
+    }
+    qsort(files.gl_pathv, files.gl_pathc, sizeof(char *), compare_versions);
+
+    corpus->name = pattern;
+    corpus->bytes = 0;
+    for (size_t i = 0; i < files.gl_pathc; i++)
+    {
+        FILE *fp = fopen(files.gl_pathv[i], "rb");
+        if (fp == NULL)
+        {
+            continue;
+        }
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        if (size > 0)
+        {
+            std::vector<uint8_t> frame(size);
+            frame.resize(fread(frame.data(), 1, size, fp));
+            corpus->bytes += frame.size();
+            corpus->frames.push_back(std::move(frame));
+        }
+        fclose(fp);
+    }
+    globfree(&files);
+    return corpus->frames.empty() ? -1 : 1;
+}
+
+// Frames as the simulated modem generates them: sequence number and time, then a ramp.
+static void make_pattern(corpus_t *corpus, uint32_t size, uint32_t count)
+{
+    corpus->name = "pattern";
+    for (uint32_t n = 0; n < count; n++)
+    {
+        std::vector<uint8_t> frame(size);
+        for (uint32_t i = 0; i < size; i++)
+        {
+            frame[i] = (uint8_t)(n + i);
+        }
+        uint64_t header[2] = {n, 1000000000ULL + n * 125000ULL};
+        memcpy(frame.data(), header, size < sizeof(header) ? size : sizeof(header));
+        corpus->frames.push_back(std::move(frame));
+    }
+}
+
+// Fixed-size records of slowly moving sensor values with noisy low bits, as a spacecraft telemetry downlink carries.
+static void make_telemetry(corpus_t *corpus, uint32_t size, uint32_t count)
+{
+    corpus->name = "telemetry";
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    uint32_t record = 0;
+    int16_t values[12] = {0};
+    for (uint32_t n = 0; n < count; n++)
+    {
+        std::vector<uint8_t> frame(size);
+        for (uint32_t at = 0; at + 32 <= size; at += 32)
+        {
+            uint32_t stamp = 1000 * record++;
+            memcpy(&frame[at], &record, sizeof(record));
+            memcpy(&frame[at + 4], &stamp, sizeof(stamp));
+            for (int v = 0; v < 12; v++)
+            {
+                values[v] += (int16_t)(xorshift(&state) % 5) - 2;
+                memcpy(&frame[at + 8 + 2 * v], &values[v], sizeof(int16_t));
+            }
+        }
+        corpus->frames.push_back(std::move(frame));
+    }
+}
+
+// Incompressible, as encrypted or already compressed payloads are.
+static void make_random(corpus_t *corpus, uint32_t size, uint32_t count)
+{
+    corpus->name = "random";
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    for (uint32_t n = 0; n < count; n++)
+    {
+        std::vector<uint8_t> frame(size);
+        for (uint32_t i = 0; i < size; i += sizeof(uint64_t))
+        {
+            uint64_t word = xorshift(&state);
+            memcpy(&frame[i], &word, size - i < sizeof(word) ? size - i : sizeof(word));
+        }
+        corpus->frames.push_back(std::move(frame));
+    }
+}
+
+static int run_level(const corpus_t *corpus, compress_codec codec, int level, uint32_t min_saving)
+{
+    size_t largest = 0;
+    for (const std::vector<uint8_t> &frame : corpus->frames)
+    {
+        largest = frame.size() > largest ? frame.size() : largest;
+    }
+    size_t cap = largest + sizeof(gs_compress_hdr_t) + 1024;
+    uint32_t count = corpus->frames.size();
+    std::vector<uint8_t> packed((size_t)count * cap);
+    std::vector<ssize_t> sizes(count);
+    std::vector<uint8_t> unpacked(largest);
+
+    void *scratch = gs_compress_scratch(codec);
+    if (scratch == NULL)
+    {
+        fprintf(stderr, "Could not allocate %s state.\n", gs_compress_codec_name(codec));
+        return -1;
+    }
+
+    // The whole of each frame's output is measured, whether or not it would have been sent.
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sizes[i] = gs_compress_frame(codec, level, scratch, corpus->frames[i].data(), corpus->frames[i].size(), &packed[(size_t)i * cap], cap);
+    }
+    uint64_t compress_ns = now_ns() - start;
+    gs_compress_scratch_free(codec, scratch);
+
+    uint64_t sent = 0;
+    uint32_t bypassed = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        size_t size = corpus->frames[i].size();
+        if (sizes[i] <= 0 || (size_t)sizes[i] > size - size * min_saving / 100)
+        {
+            sent += size;
+            bypassed++;
+        }
+        else
+        {
+            sent += sizes[i];
+        }
+    }
+
+    start = now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (sizes[i] <= 0)
+        {
+            continue;
+        }
+        ssize_t got = gs_compress_unpack(&packed[(size_t)i * cap], sizes[i], unpacked.data(), unpacked.size());
+        if (got != (ssize_t)corpus->frames[i].size() || memcmp(unpacked.data(), corpus->frames[i].data(), got) != 0)
+        {
+            fprintf(stderr, "Frame %u of %s does not round-trip through %s level %d (%zd).\n", i, corpus->name.c_str(), gs_compress_codec_name(codec), level, got);
+            return -1;
+        }
+    }
+    uint64_t decompress_ns = now_ns() - start;
+
+    printf("{\"version\": \"%s\", \"corpus\": \"%s\", \"codec\": \"%s\", \"level\": %d, \"frames\": %u, \"raw_bytes\": %lu, "
+           "\"ratio\": %.4f, \"compress_mb_s\": %.1f, \"decompress_mb_s\": %.1f, \"bypass_fraction\": %.4f}\n",
+           BENCH_VERSION, corpus->name.c_str(), gs_compress_codec_name(codec), level, count, (unsigned long)corpus->bytes,
+           (double)sent / corpus->bytes, corpus->bytes * 1e3 / compress_ns, corpus->bytes * 1e3 / (decompress_ns > 0 ? decompress_ns : 1),
+           (double)bypassed / count);
+    fflush(stdout);
+    return 1;
+}
+
+// Checks a frame the pool returned against the one submitted, and forgets it.
+static int check_frame(const corpus_t *corpus, PoolBuffer &frame, const gs_seq_hdr_t *seq, std::vector<uint8_t> &unpacked)
+{
+    const std::vector<uint8_t> &original = corpus->frames[seq->seq % corpus->frames.size()];
+    const uint8_t *data = frame->data;
+    ssize_t size = frame->size;
+    if (seq->flags & GS_SEQ_COMPRESSED)
+    {
+        size = gs_compress_unpack(frame->data, frame->size, unpacked.data(), unpacked.size());
+        data = unpacked.data();
+    }
+    frame.reset();
+    if (size != (ssize_t)original.size() || memcmp(data, original.data(), size) != 0)
+    {
+        fprintf(stderr, "Frame %lu of %s came back from the workers altered.\n", (unsigned long)seq->seq, corpus->name.c_str());
+        return -1;
+    }
+    return 1;
+}
+
+static int run_pool(const corpus_t *corpus, compress_codec codec, uint32_t workers, uint32_t min_saving, double rate_mb_s, double seconds)
+{
+    size_t largest = 0;
+    for (const std::vector<uint8_t> &frame : corpus->frames)
+    {
+        largest = frame.size() > largest ? frame.size() : largest;
+    }
+
+    buffer_pool_t pool[1];
+    if (buffer_pool_init(pool, COMPRESS_WINDOW * 2 + workers, largest) < 0)
+    {
+        fprintf(stderr, "Could not allocate the buffer pool.\n");
+        return -1;
+    }
+
+    gs_compress_t *comp = new gs_compress_t;
+    gs_compress_init(comp, pool, codec, workers, 0, true, min_saving, COMPRESS_PROBE_EVERY_DEFAULT);
+    gs_compress_start(comp, NULL);
+    gs_compress_stream_t *stream = &comp->streams[0];
+
+    std::vector<uint8_t> unpacked(largest);
+    uint64_t next = 0;
+    uint64_t reaped = 0;
+    uint64_t offered = 0;
+    int retval = 1;
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    uint64_t now = start;
+    while (now < end && retval > 0)
+    {
+        // Submits a frame once it is due at the offered rate, as the receive ring would hand it over.
+        bool due = rate_mb_s <= 0 || offered * 1e3 / rate_mb_s <= now - start;
+        if (due && gs_compress_room(stream))
+        {
+            const std::vector<uint8_t> &source = corpus->frames[next % corpus->frames.size()];
+            PoolBuffer frame = buffer_pool_acquire(pool);
+            if (frame.valid())
+            {
+                memcpy(frame->data, source.data(), source.size());
+                frame->size = source.size();
+                frame->timestamp = now;
+                frame->chain = 0;
+                gs_seq_hdr_t seq = {0};
+                seq.magic = GS_SEQ_MAGIC;
+                seq.header_size = sizeof(gs_seq_hdr_t);
+                seq.seq = next++;
+                gs_compress_submit(comp, stream, frame, &seq);
+                offered += source.size();
+            }
+        }
+
+        // With no frame due, or no room for it, waits for the workers rather than spinning.
+        PoolBuffer frame;
+        gs_seq_hdr_t seq;
+        due = rate_mb_s <= 0 || offered * 1e3 / rate_mb_s <= now_ns() - start;
+        uint64_t wait_us = due && gs_compress_room(stream) ? 0 : 100;
+        while (retval > 0 && gs_compress_reap(comp, stream, &frame, &seq, wait_us) > 0)
+        {
+            retval = check_frame(corpus, frame, &seq, unpacked);
+            reaped++;
+            wait_us = 0;
+        }
+        now = now_ns();
+    }
+    uint64_t elapsed = now - start;
+
+    while (retval > 0 && gs_compress_in_flight(stream) > 0)
+    {
+        PoolBuffer frame;
+        gs_seq_hdr_t seq;
+        if (gs_compress_reap(comp, stream, &frame, &seq, 1000000) > 0)
+        {
+            retval = check_frame(corpus, frame, &seq, unpacked);
+            reaped++;
+        }
+    }
+    int level = gs_compress_level(comp);
+    gs_compress_stop(comp);
+
+    if (retval > 0)
+    {
+        uint64_t bytes_in = stream->bytes_in.load();
+        uint64_t frames = stream->frames.load() + stream->bypassed.load();
+        printf("{\"version\": \"%s\", \"corpus\": \"%s\", \"codec\": \"%s\", \"mode\": \"adaptive\", \"workers\": %u, "
+               "\"offered_mb_s\": %.1f, \"achieved_mb_s\": %.1f, \"frames\": %lu, \"ratio\": %.4f, \"bypass_rate\": %.4f, "
+               "\"cpu_ms_per_mb\": %.3f, \"settled_level\": %d}\n",
+               BENCH_VERSION, corpus->name.c_str(), gs_compress_codec_name(codec), workers, rate_mb_s, bytes_in * 1e3 / elapsed,
+               (unsigned long)reaped, bytes_in > 0 ? (double)stream->bytes_out.load() / bytes_in : 1.0,
+               frames > 0 ? (double)stream->bypassed.load() / frames : 0.0, bytes_in > 0 ? stream->busy_ns.load() / 1e6 / (bytes_in / 1e6) : 0.0, level);
+        fflush(stdout);
+    }
+
+    gs_compress_destroy(comp);
+    delete comp;
+    buffer_pool_destroy(pool);
+    return retval;
+}
+
+int main(int argc, char **argv)
+{
+    const char *pattern = NULL;
+    uint32_t size = 8192;
+    uint32_t count = 256;
+    uint32_t workers = COMPRESS_WORKERS_DEFAULT;
+    uint32_t min_saving = COMPRESS_MIN_SAVING_DEFAULT;
+    double seconds = 1;
+    std::vector<double> rates;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:z:n:w:m:i:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            pattern = optarg;
+            break;
+        case 'z':
+            size = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            workers = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            min_saving = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            for (char *tok = strtok(optarg, ","); tok != NULL; tok = strtok(NULL, ","))
+            {
+                rates.push_back(strtod(tok, NULL));
+            }
+            break;
+        case 't':
+            seconds = strtod(optarg, NULL);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-r 'glob'] [-z frame size] [-n frames] [-w workers] [-m min_saving] [-i MB/s,MB/s,...] [-t seconds]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (rates.empty())
+    {
+        rates = {0, 50};
+    }
+    size = size < 1 ? 1 : size;
+    count = count < 1 ? 1 : count;
+    workers = workers < 1 ? 1 : (workers > COMPRESS_WORKERS_MAX ? COMPRESS_WORKERS_MAX : workers);
+    min_saving = min_saving > 99 ? 99 : min_saving;
+
+    std::vector<corpus_t> corpora;
+    if (pattern != NULL)
+    {
+        corpora.resize(1);
+        if (load_corpus(pattern, &corpora[0]) < 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        corpora.resize(3);
+        make_pattern(&corpora[0], size, count);
+        make_telemetry(&corpora[1], size, count);
+        make_random(&corpora[2], size, count);
+        for (corpus_t &corpus : corpora)
+        {
+            corpus.bytes = (uint64_t)size * count;
+        }
+    }
+
+    // A few rungs of each ladder, fastest first.
+    const int lz4_levels[] = {64, 16, 4, 1};
+    const int zstd_levels[] = {-5, -1, 1, 3, 6, 10};
+    for (const corpus_t &corpus : corpora)
+    {
+        for (int level : lz4_levels)
+        {
+            if (run_level(&corpus, COMPRESS_LZ4, level, min_saving) < 0)
+            {
+                return -1;
+            }
+        }
+        for (int level : zstd_levels)
+        {
+            if (run_level(&corpus, COMPRESS_ZSTD, level, min_saving) < 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    for (const corpus_t &corpus : corpora)
+    {
+        for (compress_codec codec : {COMPRESS_LZ4, COMPRESS_ZSTD})
+        {
+            for (double rate : rates)
+            {
+                if (run_pool(&corpus, codec, workers, min_saving, rate, seconds) < 0)
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
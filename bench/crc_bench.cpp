@@ -0,0 +1,194 @@
+/**
+ * @file crc_bench.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Micro-benchmark of the [validate] kernels: CRC-32C by CPU instructions against the slicing-by-8 table, CRC-16,
+ * and the whole per-frame check with the duplicate filter.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Each kernel runs over a set of distinct frames of each size, larger than the L1 cache in total, as the forwarding
+ * stage would see them. Reports ns per frame and MB/s. The kernels are first checked against the standard check
+ * values, and against each other on every frame size; a mismatch fails the run.
+ * Output is one JSON object per line.
+ *
+ * Usage: crc_bench.out [-n frames] [-z size,size,...] [-w dedupe_window]
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "gs_validate.hpp"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+#define BENCH_SET_BYTES (4 << 20) // Frames cycled through, so that they do not all stay in cache.
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Keeps the compiler from dropping a result nobody reads.
+static volatile uint32_t bench_sink;
+
+typedef uint32_t (*kernel_fn)(const uint8_t *data, size_t len);
+
+static uint32_t k_crc32c_table(const uint8_t *data, size_t len)
+{
+    return gs_crc32c_table(0, data, len);
+}
+
+static uint32_t k_crc32c_hw(const uint8_t *data, size_t len)
+{
+    return gs_crc32c_hw(0, data, len);
+}
+
+static uint32_t k_crc16(const uint8_t *data, size_t len)
+{
+    return gs_crc16(0xFFFF, data, len);
+}
+
+static void run(const char *kernel, kernel_fn fn, const std::vector<uint8_t *> &frames, uint32_t size, uint32_t count)
+{
+    uint32_t acc = 0;
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        acc ^= fn(frames[i % frames.size()], size);
+    }
+    uint64_t elapsed = now_ns() - start;
+    bench_sink = acc;
+
+    printf("{\"version\": \"%s\", \"kernel\": \"%s\", \"frame_size\": %u, \"frames\": %u, \"ns_per_frame\": %.1f, \"MBps\": %.1f}\n",
+           BENCH_VERSION, kernel, size, count, (double)elapsed / count, (double)size * count / (elapsed / 1e9) / 1e6);
+    fflush(stdout);
+}
+
+// The whole forwarding-stage check, CRC-32C trailer and duplicate filter, on frames that all pass.
+static void run_validate(const std::vector<uint8_t *> &frames, uint32_t size, uint32_t count, uint32_t window)
+{
+    gs_validate_t val[1];
+    gs_validate_init(val, CRC_32C, window);
+
+    uint32_t passed = 0;
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        passed += gs_validate_frame(val, frames[i % frames.size()], size);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    // Frames repeat once the set wraps; inside the window they are duplicates.
+    printf("{\"version\": \"%s\", \"kernel\": \"validate_crc32c_%s\", \"frame_size\": %u, \"frames\": %u, \"dedupe_window\": %u, "
+           "\"ns_per_frame\": %.1f, \"MBps\": %.1f, \"passed\": %u, \"crc_errors\": %u, \"duplicates\": %u}\n",
+           BENCH_VERSION, gs_crc32c_impl(), size, count, window, (double)elapsed / count, (double)size * count / (elapsed / 1e9) / 1e6,
+           passed, val->crc_errors.load(), val->duplicates.load());
+    fflush(stdout);
+
+    gs_validate_destroy(val);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 200000;
+    uint32_t window = 64;
+    std::vector<uint32_t> sizes;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:z:w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'z':
+            for (char *tok = strtok(optarg, ","); tok != NULL; tok = strtok(NULL, ","))
+            {
+                sizes.push_back(strtoul(tok, NULL, 0));
+            }
+            break;
+        case 'w':
+            window = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n frames] [-z size,size,...] [-w dedupe_window]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (sizes.empty())
+    {
+        sizes = {64, 256, 1024, 8192};
+    }
+    if (count < 1)
+    {
+        count = 1;
+    }
+
+    gs_crc_init();
+    bool hw = strcmp(gs_crc32c_impl(), "table") != 0;
+
+    const uint8_t *check = (const uint8_t *)"123456789";
+    if (gs_crc32c_table(0, check, 9) != 0xE3069283 || (hw && gs_crc32c_hw(0, check, 9) != 0xE3069283) || gs_crc16(0xFFFF, check, 9) != 0x29B1)
+    {
+        fprintf(stderr, "A CRC kernel gives the wrong check value.\n");
+        return -1;
+    }
+
+    srand(1);
+    for (uint32_t size : sizes)
+    {
+        if (size < sizeof(uint32_t))
+        {
+            continue;
+        }
+
+        // Random bodies, each with its CRC-32C trailer, so that the validation run passes them all.
+        uint32_t set = BENCH_SET_BYTES / size < 16 ? 16 : BENCH_SET_BYTES / size;
+        std::vector<uint8_t *> frames(set);
+        for (uint8_t *&frame : frames)
+        {
+            frame = (uint8_t *)malloc(size);
+            for (uint32_t i = 0; i < size; i++)
+            {
+                frame[i] = (uint8_t)rand();
+            }
+            uint32_t crc = gs_crc32c_table(0, frame, size - sizeof(uint32_t));
+            for (int i = 0; i < 4; i++)
+            {
+                frame[size - sizeof(uint32_t) + i] = (uint8_t)(crc >> (8 * i));
+            }
+            if (hw && gs_crc32c_hw(0, frame, size) != gs_crc32c_table(0, frame, size))
+            {
+                fprintf(stderr, "The CRC-32C kernels disagree on a %u byte frame.\n", size);
+                return -1;
+            }
+        }
+
+        run("crc32c_table", k_crc32c_table, frames, size, count);
+        if (hw)
+        {
+            run(strcmp(gs_crc32c_impl(), "sse4.2") == 0 ? "crc32c_sse4.2" : "crc32c_armv8", k_crc32c_hw, frames, size, count);
+        }
+        run("crc16_table", k_crc16, frames, size, count);
+        run_validate(frames, size, count, window);
+
+        for (uint8_t *frame : frames)
+        {
+            free(frame);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,754 @@
+/**
+ * @file haystack_bench.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief End-to-end throughput and latency benchmark of the X-Band RX -> network path.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Runs the real capture (gs_xband_rx_thread) and forwarding (gs_xband_fwd_thread) stages against the simulated modem,
+ * with the NetDataClient connected to an in-process stand-in for the GS server on the loopback interface.
+ *
+ * For each frame size, reports frames/s, MB/s, per-frame latency (from the simulated modem making the frame ready to
+ * the stand-in server receiving it) at p50/p99/p99.9, haystack CPU time per frame, heap allocations per frame, and
+ * user-space payload copies per frame (-Z sends through the zero-copy uplink, gs_uplink.hpp). -b batches up to that many
+ * frames per DATA frame, waiting at most -l microseconds; the stand-in server unpacks the batches.
+ * The capture stage is armed for each run and disarmed after it, as the GS server would. -A then arms and disarms it
+ * that many more times, holding it armed for -H microseconds each, and reports the arm latency (command to the capture
+ * stage receiving) and disarm latency (command to the capture stage idle, as the command handler waits for it).
+ * -S also runs a stand-in network loop that builds a status frame every that many microseconds throughout, checks
+ * that the capture stage's published counters never go backwards, and reports how often its reads had to retry.
+ * Built with 'make tsan', this is the race check for the state the threads share.
+ * -C runs that many receive chains, each with its own simulated modem at the same rate and its own capture and
+ * forwarding stages, sharing the uplink; comparing fps across -C 1, 2, 4 on a machine with a core per stage measures
+ * how throughput scales with chains.
+ * -D keeps that many buffers posted to each modem's DMA engine ([rx] dma_depth; 0 receives one frame at a time) and
+ * -L gives every simulated DMA transfer that many microseconds of latency; comparing -D 0 and -D 2 with -L set
+ * measures what overlapping the transfers with the capture stage's work gains.
+ * -M enables metrics (gs_metrics.hpp) and the metrics thread for every run, then times the instrumentation a frame
+ * goes through on its own and reports it as a share of the CPU time per frame of the smallest frame size, the worst
+ * case; comparing cpu_us_per_frame with and without -M measures the same thing end to end.
+ * -k compresses frames on the forwarding path with that codec ([compress] codec; gs_compress.hpp), at its default level
+ * and adaptive, and reports the ratio and bypass rate; the stand-in server decompresses every frame before measuring
+ * it, so that fps, MB/s and latency stay comparable with runs without -k. The simulated modem's frames are highly
+ * compressible, so this is the best case; compress_bench.out covers captured and incompressible data.
+ * Results are printed as one JSON object per line so that runs of different builds can be compared mechanically.
+ *
+ * Usage: haystack_bench.out [-s seconds] [-r rate_fps] [-z size,size,...] [-Z] [-b batch_frames] [-l batch_latency_us]
+ *                            [-A arm_cycles] [-H armed_us] [-S status_us] [-C chains] [-D dma_depth]
+ *                            [-L dma_latency_us] [-M] [-k codec] [-o results.jsonl] [-v]
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+#include "sim_backend.h"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+#define BENCH_MAX_SAMPLES (1 << 22)
+
+// Heap allocations made by haystack's own threads. The stand-in server opts out, since it is not part of haystack.
+static std::atomic<uint64_t> bench_allocs(0);
+static __thread bool bench_uncounted = false;
+
+// ThreadSanitizer brings its own allocator; allocations are not counted under it.
+#ifndef __SANITIZE_THREAD__
+extern "C" void *__libc_malloc(size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    if (!bench_uncounted)
+    {
+        bench_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return __libc_malloc(size);
+}
+#endif
+
+typedef struct
+{
+    int listen_fd;
+    int port;
+    bool batched; // Expect batched DATA (gs_uplink.hpp).
+    std::atomic<bool> done;
+    std::atomic<uint64_t> bad_batches;
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> bytes;      // Of the frames, decompressed.
+    std::atomic<uint64_t> bad_frames; // Compressed frames that did not decompress.
+    std::atomic<uint64_t> cpu_ns; // Server thread CPU time, excluded from haystack's.
+    pthread_mutex_t lock;
+    std::vector<uint64_t> latencies; // ns, guarded by lock.
+} bench_server_t;
+
+static uint64_t thread_cpu_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t process_cpu_ns()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL + ((uint64_t)usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+// Stand-in for the GS server: accepts haystack's connection and receives NetFrames until told to stop.
+static void *bench_server_thread(void *args)
+{
+    bench_server_t *server = (bench_server_t *)args;
+    bench_uncounted = true;
+
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    NetDataClient *conn = new NetDataClient(NetPort::HAYSTACK, 1);
+    conn->socket = fd;
+    conn->connection_ready = true;
+    conn->recv_active = true;
+    conn->thread_status = 1;
+
+    while (!server->done.load(std::memory_order_relaxed))
+    {
+        NetFrame frame[1];
+        if (frame->recvFrame(conn) < 0)
+        {
+            break;
+        }
+        uint64_t now = gs_monotonic_ns();
+
+        if (frame->getType() != NetType::DATA)
+        {
+            continue;
+        }
+
+        static uint8_t payload[1 << 20];
+        int size = frame->getPayloadSize();
+        if (size > (int)sizeof(payload) || frame->retrievePayload(payload, size) < 0)
+        {
+            continue;
+        }
+
+        // One received frame, or a batch of them, each behind a sequence header with several chains.
+        ssize_t offset = 0;
+        const uint8_t *item = payload;
+        uint32_t item_size = size;
+        int items = server->batched ? gs_batch_next(payload, size, &offset, &item, &item_size) : 1;
+
+        pthread_mutex_lock(&server->lock);
+        while (items > 0)
+        {
+            const uint8_t *frame_data = item;
+            uint32_t frame_size = item_size;
+            gs_seq_hdr_t seq;
+            if (frame_size >= sizeof(seq))
+            {
+                memcpy(&seq, frame_data, sizeof(seq));
+                if (seq.magic == GS_SEQ_MAGIC && seq.header_size <= frame_size)
+                {
+                    frame_data += seq.header_size;
+                    frame_size -= seq.header_size;
+                }
+                if (seq.magic == GS_SEQ_MAGIC && (seq.flags & GS_SEQ_COMPRESSED))
+                {
+                    static uint8_t unpacked[1 << 20];
+                    ssize_t unpacked_size = gs_compress_unpack(frame_data, frame_size, unpacked, sizeof(unpacked));
+                    if (unpacked_size < 0)
+                    {
+                        server->bad_frames.fetch_add(1, std::memory_order_relaxed);
+                        unpacked_size = 0;
+                    }
+                    frame_data = unpacked;
+                    frame_size = unpacked_size;
+                }
+            }
+
+            uint64_t header[2] = {0, 0};
+            if (frame_size >= sizeof(header))
+            {
+                memcpy(header, frame_data, sizeof(header));
+            }
+            if (header[1] > 0 && now > header[1] && server->latencies.size() < BENCH_MAX_SAMPLES)
+            {
+                server->latencies.push_back(now - header[1]);
+            }
+
+            server->frames.fetch_add(1, std::memory_order_relaxed);
+            server->bytes.fetch_add(frame_size, std::memory_order_relaxed);
+            items = server->batched ? gs_batch_next(payload, size, &offset, &item, &item_size) : 0;
+        }
+        pthread_mutex_unlock(&server->lock);
+
+        if (items < 0)
+        {
+            server->bad_batches.fetch_add(1, std::memory_order_relaxed);
+        }
+        server->cpu_ns = thread_cpu_ns();
+    }
+
+    close(fd);
+    delete conn;
+    return NULL;
+}
+
+typedef struct
+{
+    global_data_t *global;
+    uint32_t interval_us;
+    std::atomic<bool> done;
+    uint64_t reads;        // Snapshots taken.
+    uint64_t inconsistent; // Snapshots with a counter lower than in the one before.
+} bench_status_t;
+
+// Stand-in for the network loop's status frames, as often as asked, while the capture stage runs.
+static void *bench_status_thread(void *args)
+{
+    bench_status_t *stress = (bench_status_t *)args;
+    global_data_t *global = stress->global;
+    rx_snapshot_t prev[1];
+    memset(prev, 0x0, sizeof(rx_snapshot_t));
+
+    while (!stress->done.load(std::memory_order_acquire))
+    {
+        rx_snapshot_t snap[1];
+        gs_seqlock_read(global->chains[0].rx_stats, snap);
+        if (snap->frames < prev->frames || snap->bytes < prev->bytes || snap->rx_errors < prev->rx_errors || snap->read_errors < prev->read_errors || snap->last_frame_ns < prev->last_frame_ns)
+        {
+            stress->inconsistent++;
+        }
+        *prev = *snap;
+        stress->reads++;
+
+        for (uint32_t i = 0; i < global->chain_count; i++)
+        {
+            gs_xband_send_status(&global->chains[i], STATUS_EVENT_HEARTBEAT);
+        }
+        usleep(stress->interval_us);
+    }
+    return NULL;
+}
+
+// Times the instrumentation one frame passes through: the read in the capture stage, the ring wait in the forwarding
+// stage, and the send, at the default sampling. The clock reads the stages make anyway are not counted. Returns ns per
+// frame.
+static double bench_metrics_cost()
+{
+    gs_metrics_t metrics[1];
+    gs_metrics_init(metrics, true, METRICS_INTERVAL_MS_DEFAULT, METRICS_SAMPLE_EVERY_DEFAULT, 0, NULL);
+    gs_metrics_register(metrics, "bench");
+
+    const uint32_t frames = 1000000;
+    uint64_t start = gs_monotonic_ns();
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        uint64_t now = start + i * 1000ULL; // Stands in for the capture stage's timestamp.
+        uint64_t read_begin = gs_metrics_begin();
+        gs_metrics_end_at(METRIC_RX_READ_NS, read_begin, now);
+        gs_metrics_record(METRIC_RX_QUEUE_NS, i);
+        uint64_t send_begin = gs_metrics_begin();
+        gs_metrics_end(METRIC_UPLINK_SEND_NS, send_begin);
+        gs_metrics_count(METRIC_UPLINK_BYTES, i);
+    }
+    double ns = (double)(gs_monotonic_ns() - start) / frames;
+
+    gs_metrics_local = NULL;
+    gs_metrics_destroy(metrics);
+    return ns;
+}
+
+static int bench_connect(global_data_t *global, bench_server_t *server)
+{
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0x0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addr_len = sizeof(addr);
+
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server->listen_fd, 1) < 0 || getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0)
+    {
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        return -1;
+    }
+
+    gs_uplink_attach(global->uplink, global->network_data, fd);
+    return 1;
+}
+
+static uint32_t bench_ring_drops(global_data_t *global)
+{
+    uint32_t drops = 0;
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        drops += global->chains[i].rx_ring->dropped_oldest + global->chains[i].rx_ring->dropped_newest;
+    }
+    return drops;
+}
+
+static uint32_t bench_overruns(global_data_t *global)
+{
+    uint32_t overruns = 0;
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        overruns += global->chains[i].rx_deadline->missed.load(std::memory_order_relaxed);
+    }
+    return overruns;
+}
+
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct)
+{
+    if (samples.empty())
+    {
+        return 0;
+    }
+    size_t idx = (size_t)(pct / 100.0 * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 3;
+    double rate_fps = 0;
+    bool verbose = false;
+    bool zero_copy = false;
+    uint32_t batch_frames = 0;
+    uint32_t batch_latency_us = UPLINK_BATCH_LATENCY_US_DEFAULT;
+    uint32_t arm_cycles = 0;
+    uint32_t armed_us = 2000;
+    uint32_t status_us = 0;
+    uint32_t chains = 1;
+    uint32_t dma_depth = RX_DMA_DEPTH_DEFAULT;
+    uint32_t dma_latency_us = 0;
+    bool metrics_on = false;
+    compress_codec codec = COMPRESS_OFF;
+    const char *out_path = NULL;
+    std::vector<uint32_t> sizes;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:z:Zb:l:A:H:S:C:D:L:Mk:o:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            seconds = atof(optarg);
+            break;
+        case 'r':
+            rate_fps = atof(optarg);
+            break;
+        case 'z':
+            for (char *tok = strtok(optarg, ","); tok != NULL; tok = strtok(NULL, ","))
+            {
+                sizes.push_back(strtoul(tok, NULL, 0));
+            }
+            break;
+        case 'Z':
+            zero_copy = true;
+            break;
+        case 'b':
+            batch_frames = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            batch_latency_us = strtoul(optarg, NULL, 0);
+            break;
+        case 'A':
+            arm_cycles = strtoul(optarg, NULL, 0);
+            break;
+        case 'H':
+            armed_us = strtoul(optarg, NULL, 0);
+            break;
+        case 'S':
+            status_us = strtoul(optarg, NULL, 0);
+            break;
+        case 'C':
+            chains = strtoul(optarg, NULL, 0);
+            break;
+        case 'D':
+            dma_depth = strtoul(optarg, NULL, 0);
+            break;
+        case 'L':
+            dma_latency_us = strtoul(optarg, NULL, 0);
+            break;
+        case 'M':
+            metrics_on = true;
+            break;
+        case 'k':
+            if (gs_compress_codec_from_string(optarg, &codec) < 0)
+            {
+                fprintf(stderr, "Codec must be off, lz4 or zstd.\n");
+                return -1;
+            }
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-s seconds] [-r rate_fps, 0 = unthrottled] [-z size,size,...] [-Z] [-b batch_frames] [-l batch_latency_us] [-A arm_cycles] [-H armed_us] [-S status_us] [-C chains] [-D dma_depth] [-L dma_latency_us] [-M] [-k codec] [-o results.jsonl] [-v]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (chains < 1 || chains > CHAINS_MAX)
+    {
+        fprintf(stderr, "Chains must be 1 to %d.\n", CHAINS_MAX);
+        return -1;
+    }
+    if (dma_depth > RXMODEM_QUEUE_MAX)
+    {
+        fprintf(stderr, "DMA depth must be 0 to %d.\n", RXMODEM_QUEUE_MAX);
+        return -1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    global_data_t global[1] = {0};
+    gs_config_defaults(global->config);
+    global->config->rec_enabled = false;
+    global->config->rx_chains = chains;
+    global->config->rx_dma_depth = dma_depth;
+    global->config->net_batch_frames = batch_frames;
+    global->config->compress_method = codec;
+    global->config->pool_buffers = gs_config_pool_needed(global->config);
+
+    if (sizes.empty())
+    {
+        for (uint32_t size = 64; size < global->config->rx_mtu; size *= 4)
+        {
+            sizes.push_back(size);
+        }
+        sizes.push_back(global->config->rx_mtu);
+    }
+
+    // Results go to the file or the real stdout; haystack's own console output goes to /dev/null unless -v.
+    FILE *out = out_path != NULL ? fopen(out_path, "a") : fdopen(dup(STDOUT_FILENO), "w");
+    if (out == NULL)
+    {
+        perror("Opening results");
+        return -1;
+    }
+    if (!verbose)
+    {
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        close(devnull);
+    }
+
+    if (global->config->log_async)
+    {
+        gs_log_start();
+    }
+
+    buffer_pool_init(global->pool, global->config->pool_buffers, global->config->rx_mtu);
+    global->chain_count = chains;
+    for (uint32_t i = 0; i < chains; i++)
+    {
+        gs_chain_init(global, i);
+    }
+    gs_recorder_init(global->recorder, global->pool, global->config->rec_ring_slots, "/tmp", 1 << 20, 0, 1, 1, FSYNC_NONE, 0, chains);
+
+    gs_uplink_init(global->uplink, zero_copy, batch_frames, UPLINK_BATCH_BYTES_DEFAULT, batch_latency_us);
+    gs_metrics_init(global->metrics, metrics_on, METRICS_INTERVAL_MS_DEFAULT, METRICS_SAMPLE_EVERY_DEFAULT, 0, NULL);
+    gs_compress_init(global->compress, global->pool, codec, global->config->compress_workers, global->config->compress_level, global->config->compress_adaptive, global->config->compress_min_saving, global->config->compress_probe_every);
+    gs_compress_start(global->compress, global->metrics);
+
+    global->network_data = new NetDataClient(NetPort::HAYSTACK, SERVER_POLL_RATE);
+    global->thread_status.store(1, std::memory_order_release);
+    global->network_data->recv_active = true;
+
+    bench_server_t server[1];
+    server->batched = gs_uplink_batching(global->uplink);
+    server->done = false;
+    server->bad_batches = 0;
+    server->frames = 0;
+    server->bytes = 0;
+    server->bad_frames = 0;
+    server->cpu_ns = 0;
+    pthread_mutex_init(&server->lock, NULL);
+    server->latencies.reserve(BENCH_MAX_SAMPLES);
+
+    if (bench_connect(global, server) < 0)
+    {
+        fprintf(out, "{\"error\": \"could not set up the loopback connection\"}\n");
+        return -1;
+    }
+
+    pthread_t server_tid;
+    pthread_create(&server_tid, NULL, bench_server_thread, server);
+
+    sim_config_t sim[1];
+    sim_config_defaults(sim);
+    sim->dma_latency_us = dma_latency_us;
+    sim_configure(sim);
+    for (uint32_t i = 0; i < chains; i++)
+    {
+        if (gs_xband_init(&global->chains[i]) < 0)
+        {
+            fprintf(out, "{\"error\": \"simulated radio of chain %u failed to initialize\"}\n", i);
+            return -1;
+        }
+        global->chains[i].PLL_ready.store(true, std::memory_order_release);
+    }
+
+    // The capture stages live for the whole benchmark, armed for each run.
+    pthread_t rx_tid[CHAINS_MAX], fwd_tid[CHAINS_MAX];
+    for (uint32_t i = 0; i < chains; i++)
+    {
+        pthread_create(&rx_tid[i], NULL, gs_xband_rx_thread, &global->chains[i]);
+    }
+
+    bench_status_t stress[1];
+    stress->global = global;
+    stress->interval_us = status_us;
+    stress->done = false;
+    stress->reads = 0;
+    stress->inconsistent = 0;
+    pthread_t status_tid;
+    if (status_us > 0)
+    {
+        pthread_create(&status_tid, NULL, bench_status_thread, stress);
+    }
+
+    pthread_t metrics_tid;
+    if (metrics_on)
+    {
+        pthread_create(&metrics_tid, NULL, gs_metrics_thread, global);
+    }
+    double cpu_ns_per_frame_min = 0;
+
+    for (uint32_t size : sizes)
+    {
+        sim_config_defaults(sim);
+        sim->rate_fps = rate_fps;
+        sim->size_min = size;
+        sim->size_max = size;
+        sim->dma_latency_us = dma_latency_us;
+        sim_configure(sim);
+
+        sim_stats_t sim_before, sim_after;
+        sim_get_stats(&sim_before);
+        uint32_t drops_before = bench_ring_drops(global);
+        uint32_t overruns_before = bench_overruns(global);
+        uint64_t frames_before = server->frames;
+        uint64_t bytes_before = server->bytes;
+        uint64_t server_cpu_before = server->cpu_ns;
+        pthread_mutex_lock(&server->lock);
+        server->latencies.clear();
+        pthread_mutex_unlock(&server->lock);
+
+        uint64_t cpu_before = process_cpu_ns();
+        uint64_t allocs_before = bench_allocs;
+        uint32_t uplink_frames_before = global->uplink->frames;
+        uint32_t copies_before = global->uplink->copies;
+        uint32_t batches_before = global->uplink->batches;
+        uint64_t cmp_in_before = 0, cmp_out_before = 0, cmp_bypassed_before = 0, cmp_frames_before = 0;
+        for (uint32_t i = 0; i < chains; i++)
+        {
+            gs_compress_stream_t *stream = &global->compress->streams[i];
+            cmp_in_before += stream->bytes_in;
+            cmp_out_before += stream->bytes_out;
+            cmp_bypassed_before += stream->bypassed;
+            cmp_frames_before += stream->frames + stream->bypassed;
+        }
+        uint64_t start = gs_monotonic_ns();
+
+        global->thread_status.store(1, std::memory_order_release);
+        for (uint32_t i = 0; i < chains; i++)
+        {
+            pthread_create(&fwd_tid[i], NULL, gs_xband_fwd_thread, &global->chains[i]);
+            gs_xband_arm(&global->chains[i]);
+        }
+
+        usleep((useconds_t)(seconds * 1e6));
+
+        for (uint32_t i = 0; i < chains; i++)
+        {
+            gs_xband_disarm(&global->chains[i]);
+        }
+        global->thread_status.store(0, std::memory_order_release);
+        for (uint32_t i = 0; i < chains; i++)
+        {
+            pthread_join(fwd_tid[i], NULL);
+        }
+
+        // Let the frames already on the socket arrive.
+        uint64_t last = 0;
+        while (last != server->frames)
+        {
+            last = server->frames;
+            usleep(100000);
+        }
+
+        uint64_t elapsed = gs_monotonic_ns() - start;
+        uint64_t cpu = process_cpu_ns() - cpu_before - (server->cpu_ns - server_cpu_before);
+        uint64_t allocs = bench_allocs - allocs_before;
+        sim_get_stats(&sim_after);
+        uint32_t uplink_frames = global->uplink->frames - uplink_frames_before;
+        uint32_t copies = global->uplink->copies - copies_before;
+        uint32_t batches = global->uplink->batches - batches_before;
+
+        uint64_t frames = server->frames - frames_before;
+        uint64_t bytes = server->bytes - bytes_before;
+
+        uint64_t cmp_in = 0, cmp_out = 0, cmp_bypassed = 0, cmp_frames = 0;
+        for (uint32_t i = 0; i < chains; i++)
+        {
+            gs_compress_stream_t *stream = &global->compress->streams[i];
+            cmp_in += stream->bytes_in;
+            cmp_out += stream->bytes_out;
+            cmp_bypassed += stream->bypassed;
+            cmp_frames += stream->frames + stream->bypassed;
+        }
+        cmp_in -= cmp_in_before;
+        cmp_out -= cmp_out_before;
+        cmp_bypassed -= cmp_bypassed_before;
+        cmp_frames -= cmp_frames_before;
+
+        pthread_mutex_lock(&server->lock);
+        uint64_t p50 = percentile(server->latencies, 50);
+        uint64_t p99 = percentile(server->latencies, 99);
+        uint64_t p999 = percentile(server->latencies, 99.9);
+        pthread_mutex_unlock(&server->lock);
+
+        double secs = elapsed / 1e9;
+        if (frames > 0 && (cpu_ns_per_frame_min == 0 || (double)cpu / frames < cpu_ns_per_frame_min))
+        {
+            cpu_ns_per_frame_min = (double)cpu / frames;
+        }
+        fprintf(out, "{\"version\": \"%s\", \"chains\": %u, \"frame_size\": %u, \"rate_fps\": %.0f, \"seconds\": %.3f, \"frames\": %lu, "
+                     "\"fps\": %.1f, \"MBps\": %.3f, \"lat_p50_us\": %.1f, \"lat_p99_us\": %.1f, \"lat_p999_us\": %.1f, "
+                     "\"cpu_us_per_frame\": %.2f, \"allocs_per_frame\": %.2f, \"zero_copy\": %s, \"copies_per_frame\": %.2f, "
+                     "\"batch_frames\": %u, \"batch_latency_us\": %u, \"mean_batch\": %.1f, \"bad_batches\": %lu, \"modem_overflows\": %lu, \"ring_drops\": %u, \"rx_overruns\": %u, \"dma_depth\": %u, "
+                     "\"dma_latency_us\": %u, \"metrics\": %s, \"codec\": \"%s\", \"compress_ratio\": %.4f, \"compress_bypass\": %.4f, "
+                     "\"compress_level\": %d, \"bad_frames\": %lu}\n",
+                BENCH_VERSION, chains, size, rate_fps, secs, (unsigned long)frames,
+                frames / secs, bytes / secs / 1e6, p50 / 1e3, p99 / 1e3, p999 / 1e3,
+                frames ? cpu / 1e3 / frames : 0.0, frames ? (double)allocs / frames : 0.0,
+                global->uplink->zero_copy ? "true" : "false", uplink_frames ? (double)copies / uplink_frames : 0.0,
+                global->uplink->batch_frames, batch_latency_us, batches ? (double)uplink_frames / batches : 1.0, (unsigned long)server->bad_batches.load(),
+                (unsigned long)(sim_after.overflows - sim_before.overflows),
+                bench_ring_drops(global) - drops_before, bench_overruns(global) - overruns_before,
+                global->chains[0].rx_dma->active_depth.load(), dma_latency_us, metrics_on ? "true" : "false",
+                gs_compress_codec_name(codec), cmp_in ? (double)cmp_out / cmp_in : 1.0, cmp_frames ? (double)cmp_bypassed / cmp_frames : 0.0,
+                gs_compress_level(global->compress), (unsigned long)server->bad_frames.load());
+        fflush(out);
+    }
+
+    if (arm_cycles > 0)
+    {
+        sim_config_defaults(sim);
+        sim->rate_fps = rate_fps;
+        sim->dma_latency_us = dma_latency_us;
+        sim_configure(sim);
+
+        // Cycles the first chain; any others stay disarmed.
+        gs_chain_t *chain = &global->chains[0];
+        global->thread_status.store(1, std::memory_order_release);
+        pthread_create(&fwd_tid[0], NULL, gs_xband_fwd_thread, chain);
+
+        std::vector<uint64_t> arm_lat, disarm_lat;
+        uint32_t slow_before = chain->rx_worker->slow_disarms;
+        for (uint32_t i = 0; i < arm_cycles; i++)
+        {
+            // arm_us is written by the capture stage once it is receiving again.
+            chain->rx_worker->arm_us = UINT32_MAX;
+            gs_xband_arm(chain);
+            uint64_t armed_at = gs_monotonic_ns();
+            while (chain->rx_worker->arm_us == UINT32_MAX && gs_monotonic_ns() - armed_at < 1000000000ULL)
+            {
+                usleep(10);
+            }
+            arm_lat.push_back(chain->rx_worker->arm_us);
+
+            usleep(armed_us);
+
+            uint64_t start = gs_monotonic_ns();
+            gs_xband_disarm(chain);
+            disarm_lat.push_back((gs_monotonic_ns() - start) / 1000);
+        }
+
+        global->thread_status.store(0, std::memory_order_release);
+        pthread_join(fwd_tid[0], NULL);
+
+        fprintf(out, "{\"version\": \"%s\", \"arm_cycles\": %u, \"rate_fps\": %.0f, \"armed_us\": %u, "
+                     "\"arm_p50_us\": %lu, \"arm_p99_us\": %lu, \"arm_max_us\": %lu, "
+                     "\"disarm_p50_us\": %lu, \"disarm_p99_us\": %lu, \"disarm_max_us\": %lu, \"slow_disarms\": %u}\n",
+                BENCH_VERSION, arm_cycles, rate_fps, armed_us,
+                (unsigned long)percentile(arm_lat, 50), (unsigned long)percentile(arm_lat, 99), (unsigned long)percentile(arm_lat, 100),
+                (unsigned long)percentile(disarm_lat, 50), (unsigned long)percentile(disarm_lat, 99), (unsigned long)percentile(disarm_lat, 100),
+                (uint32_t)chain->rx_worker->slow_disarms - slow_before);
+        fflush(out);
+    }
+
+    if (status_us > 0)
+    {
+        stress->done = true;
+        pthread_join(status_tid, NULL);
+
+        fprintf(out, "{\"version\": \"%s\", \"status_us\": %u, \"status_reads\": %lu, \"seqlock_retries\": %u, \"status_inconsistent\": %lu, \"status_frames\": %u}\n",
+                BENCH_VERSION, status_us, (unsigned long)stress->reads, global->chains[0].rx_stats->retries.load(), (unsigned long)stress->inconsistent,
+                global->chains[0].status->frames_sent.load());
+        fflush(out);
+    }
+
+    if (metrics_on)
+    {
+        global->thread_status.store(-1, std::memory_order_release);
+        pthread_join(metrics_tid, NULL);
+
+        double metrics_ns = bench_metrics_cost();
+        fprintf(out, "{\"version\": \"%s\", \"metrics_ns_per_frame\": %.1f, \"cpu_ns_per_frame_min\": %.1f, \"metrics_overhead_pct\": %.3f}\n",
+                BENCH_VERSION, metrics_ns, cpu_ns_per_frame_min, cpu_ns_per_frame_min > 0 ? 100.0 * metrics_ns / cpu_ns_per_frame_min : 0.0);
+        fflush(out);
+    }
+
+    gs_compress_stop(global->compress);
+
+    for (uint32_t i = 0; i < chains; i++)
+    {
+        gs_rxworker_stop(global->chains[i].rx_worker);
+        rxmodem_stop(global->chains[i].rx_modem);
+        pthread_join(rx_tid[i], NULL);
+    }
+
+    server->done = true;
+    shutdown(global->network_data->socket, SHUT_RDWR);
+    close(global->network_data->socket);
+    pthread_join(server_tid, NULL);
+    close(server->listen_fd);
+
+    fclose(out);
+    return 0;
+}
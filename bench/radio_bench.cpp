@@ -0,0 +1,127 @@
+/**
+ * @file radio_bench.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Micro-benchmark of radio status snapshots: one adradio_get_*(...) per attribute against batched libiio reads.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Both paths run against the simulated radio and its mock libiio context, which charge a configurable latency per
+ * libiio operation (a sysfs read locally, an iiod round trip remotely). For each latency, reports the time per
+ * snapshot, the libiio operations per snapshot, and the spread between the first and last attribute read.
+ * Output is one JSON object per line.
+ *
+ * Usage: radio_bench.out [-n snapshots] [-l latency_us,latency_us,...]
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "gs_radio.hpp"
+#include "gs_haystack.hpp"
+#include "sim_backend.h"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+static void run(const char *path, gs_radio_reader_t *reader, adradio_t *radio, uint32_t latency_us, uint32_t count)
+{
+    sim_config_t sim[1];
+    sim_config_defaults(sim);
+    sim->iio_latency_us = latency_us;
+    sim_configure(sim);
+
+    uint64_t calls_before = sim_iio_calls();
+    uint64_t spread = 0;
+    uint32_t incomplete = 0;
+    uint64_t start = gs_monotonic_ns();
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        radio_snapshot_t snap[1];
+        if (gs_radio_snapshot(reader, radio, snap) < 0)
+        {
+            incomplete++;
+        }
+        spread += snap->read_ns;
+    }
+
+    uint64_t elapsed = gs_monotonic_ns() - start;
+    uint64_t calls = sim_iio_calls() - calls_before;
+
+    printf("{\"version\": \"%s\", \"path\": \"%s\", \"iio_latency_us\": %u, \"snapshots\": %u, \"us_per_snapshot\": %.2f, "
+           "\"iio_ops_per_snapshot\": %.2f, \"mean_spread_us\": %.2f, \"incomplete\": %u}\n",
+           BENCH_VERSION, path, latency_us, count, elapsed / 1e3 / count, (double)calls / count, spread / 1e3 / count, incomplete);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 1000;
+    std::vector<uint32_t> latencies;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            for (char *tok = strtok(optarg, ","); tok != NULL; tok = strtok(NULL, ","))
+            {
+                latencies.push_back(strtoul(tok, NULL, 0));
+            }
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n snapshots] [-l latency_us,latency_us,...]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (latencies.empty())
+    {
+        latencies = {0, 20, 100, 500};
+    }
+    if (count < 1)
+    {
+        count = 1;
+    }
+
+    adradio_t radio[1];
+    memset(radio, 0x0, sizeof(adradio_t));
+    if (adradio_init(radio) < 0)
+    {
+        fprintf(stderr, "Simulated radio failed to initialize.\n");
+        return -1;
+    }
+
+    gs_radio_reader_t each[1];
+    memset(each, 0x0, sizeof(gs_radio_reader_t));
+    gs_radio_reader_t batched[1];
+    if (gs_radio_reader_init(batched) < 0)
+    {
+        fprintf(stderr, "Mock libiio context failed to open.\n");
+        return -1;
+    }
+
+    for (uint32_t latency : latencies)
+    {
+        // Fewer rounds at high latency, so that a run stays short.
+        uint32_t rounds = latency > 0 ? count * 20 / latency : count;
+        rounds = rounds < 10 ? 10 : (rounds > count ? count : rounds);
+
+        run("per_attribute", each, radio, latency, rounds);
+        run("batched", batched, radio, latency, rounds);
+    }
+
+    gs_radio_reader_destroy(batched);
+    adradio_destroy(radio);
+    return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file wire_bench.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Micro-benchmark of the status frame encodings: the raw phy_status_t copy against the compact encoding, with
+ * every frame full and as deltas.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * A stream of status frames is made up first, as a busy chain would send them: a few counters advancing every frame,
+ * the RSSI moving, and now and then a retune. Each encoding then encodes the whole stream and decodes it again.
+ * Reports ns per frame each way and bytes per frame. Every decoded frame is checked against the one encoded, and a
+ * configuration frame is round-tripped as well; a mismatch fails the run.
+ * Output is one JSON object per line.
+ *
+ * Usage: wire_bench.out [-n frames] [-k keyframe_every] [-c counters changed per frame]
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include "gs_wire.hpp"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// A status stream, frame i depending on frame i - 1.
+static std::vector<phy_status_t> make_stream(uint32_t count, uint32_t changes)
+{
+    phy_status_t s;
+    memset(&s, 0x0, sizeof(phy_status_t));
+    s.mode = 1;
+    s.pll_freq = 2450;
+    s.LO = 8400000000LL;
+    s.samp = 10000000;
+    s.bw = 8000000;
+    snprintf(s.ftr_name, sizeof(s.ftr_name), "%s", "LTE10_MHz");
+    s.temp = 41000;
+    s.rssi = -72.25;
+    s.gain = -85;
+    snprintf(s.curr_gainmode, sizeof(s.curr_gainmode), "%s", "slow_attack");
+    s.pll_lock = 1;
+    s.modem_ready = 1;
+    s.PLL_ready = 1;
+    s.radio_ready = 1;
+    s.rx_armed = 1;
+    s.MTU = 8192;
+    s.pool_in_use = 12;
+    s.pool_high_water = 40;
+    s.rx_dma_depth = 8;
+
+    // The counters a busy chain advances; packed, so reached by offset.
+    size_t counters[] = {offsetof(phy_status_t, rx_frames), offsetof(phy_status_t, uplink_frames), offsetof(phy_status_t, rec_records),
+                         offsetof(phy_status_t, uplink_batches), offsetof(phy_status_t, uplink_copies), offsetof(phy_status_t, rx_ring_depth),
+                         offsetof(phy_status_t, pool_in_use), offsetof(phy_status_t, sched_applied)};
+    uint32_t counter_count = sizeof(counters) / sizeof(counters[0]);
+
+    std::vector<phy_status_t> stream(count);
+    srand(1);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        s.events = 1u << (rand() % 8);
+        s.changed = rand() & 0x0F;
+        for (uint32_t c = 0; c < changes && c < counter_count; c++)
+        {
+            uint32_t value;
+            memcpy(&value, (uint8_t *)&s + counters[c], sizeof(value));
+            value += 1 + rand() % 200;
+            memcpy((uint8_t *)&s + counters[c], &value, sizeof(value));
+        }
+        s.rssi = -72.25 + (rand() % 400) / 100.0;
+        if (rand() % 64 == 0)
+        {
+            s.LO += 1000;
+            s.sched_last_error_us = rand() % 2000 - 1000;
+        }
+        stream[i] = s;
+    }
+    return stream;
+}
+
+static void report(const char *encoding, uint32_t keyframe_every, uint32_t count, uint64_t encode_ns, uint64_t decode_ns, uint64_t bytes)
+{
+    printf("{\"version\": \"%s\", \"encoding\": \"%s\", \"keyframe_every\": %u, \"frames\": %u, \"encode_ns_per_frame\": %.1f, "
+           "\"decode_ns_per_frame\": %.1f, \"bytes_per_frame\": %.1f, \"raw_bytes_per_frame\": %zu}\n",
+           BENCH_VERSION, encoding, keyframe_every, count, (double)encode_ns / count, (double)decode_ns / count, (double)bytes / count,
+           sizeof(phy_status_t));
+    fflush(stdout);
+}
+
+// The status frame as sent before the compact encoding: the struct, copied in and out.
+static int run_raw(const std::vector<phy_status_t> &stream)
+{
+    uint32_t count = stream.size();
+    std::vector<uint8_t> wire((size_t)count * sizeof(phy_status_t));
+    std::vector<phy_status_t> decoded(count);
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        memcpy(&wire[(size_t)i * sizeof(phy_status_t)], &stream[i], sizeof(phy_status_t));
+    }
+    uint64_t encode_ns = now_ns() - start;
+
+    start = now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        memcpy(&decoded[i], &wire[(size_t)i * sizeof(phy_status_t)], sizeof(phy_status_t));
+    }
+    uint64_t decode_ns = now_ns() - start;
+
+    if (memcmp(decoded.data(), stream.data(), (size_t)count * sizeof(phy_status_t)) != 0)
+    {
+        fprintf(stderr, "Raw status frames do not round-trip.\n");
+        return -1;
+    }
+    report("raw", 0, count, encode_ns, decode_ns, (uint64_t)count * sizeof(phy_status_t));
+    return 1;
+}
+
+static int run_compact(const std::vector<phy_status_t> &stream, uint32_t keyframe_every)
+{
+    uint32_t count = stream.size();
+    // Frames are packed back to back, as they would be sent; only the space used is ever touched.
+    std::vector<uint8_t> wire((size_t)count * GS_WIRE_STATUS_MAX);
+    std::vector<size_t> at(count + 1);
+    std::vector<phy_status_t> decoded(count);
+
+    gs_wire_encoder_t *enc = new gs_wire_encoder_t;
+    gs_wire_encoder_init(enc, keyframe_every);
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ssize_t len = gs_wire_encode_status(enc, &stream[i], &wire[at[i]], GS_WIRE_STATUS_MAX);
+        if (len < 0)
+        {
+            fprintf(stderr, "Frame %u did not fit in GS_WIRE_STATUS_MAX.\n", i);
+            delete enc;
+            return -1;
+        }
+        at[i + 1] = at[i] + len;
+    }
+    uint64_t encode_ns = now_ns() - start;
+    delete enc;
+
+    gs_wire_decoder_t *dec = new gs_wire_decoder_t;
+    gs_wire_decoder_init(dec);
+    int retval = 1;
+    start = now_ns();
+    for (uint32_t i = 0; i < count && retval > 0; i++)
+    {
+        size_t used = 0;
+        retval = gs_wire_decode_status(dec, &wire[at[i]], at[i + 1] - at[i], &decoded[i], &used);
+        retval = retval > 0 && used != at[i + 1] - at[i] ? -1 : retval;
+    }
+    uint64_t decode_ns = now_ns() - start;
+    delete dec;
+
+    if (retval < 0 || memcmp(decoded.data(), stream.data(), (size_t)count * sizeof(phy_status_t)) != 0)
+    {
+        fprintf(stderr, "Compact status frames (keyframe_every %u) do not round-trip (%d).\n", keyframe_every, retval);
+        return -1;
+    }
+    report(keyframe_every <= 1 ? "compact_full" : "compact_delta", keyframe_every, count, encode_ns, decode_ns, at[count]);
+    return 1;
+}
+
+static int check_config()
+{
+    phy_config_t config, decoded;
+    memset(&config, 0x0, sizeof(phy_config_t));
+    config.mode = 1;
+    config.LO = 8400000000LL;
+    config.samp = 10000000;
+    config.bw = 8000000;
+    snprintf(config.ftr_name, sizeof(config.ftr_name), "%s", "LTE10_MHz");
+    config.gain = -85;
+    snprintf(config.curr_gainmode, sizeof(config.curr_gainmode), "%s", "manual");
+    config.MTU = 8192;
+    config.chain = 1;
+
+    uint8_t wire[512];
+    ssize_t len = gs_wire_encode_config(&config, wire, sizeof(wire));
+    if (len < 0 || gs_wire_decode_config(wire, len, &decoded) < 0 || memcmp(&config, &decoded, sizeof(phy_config_t)) != 0)
+    {
+        fprintf(stderr, "Configuration frames do not round-trip.\n");
+        return -1;
+    }
+
+    // Cut short, it must be refused rather than half applied.
+    if (gs_wire_decode_config(wire, len - 1, &decoded) >= 0)
+    {
+        fprintf(stderr, "A truncated configuration frame was accepted.\n");
+        return -1;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 100000;
+    uint32_t keyframe_every = GS_WIRE_KEYFRAME_EVERY_DEFAULT;
+    uint32_t changes = 4;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:c:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            keyframe_every = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            changes = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n frames] [-k keyframe_every] [-c counters changed per frame]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (count < 1)
+    {
+        count = 1;
+    }
+
+    if (check_config() < 0)
+    {
+        return -1;
+    }
+
+    std::vector<phy_status_t> stream = make_stream(count, changes);
+    if (run_raw(stream) < 0 || run_compact(stream, 1) < 0 || run_compact(stream, keyframe_every) < 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
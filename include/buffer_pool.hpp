@@ -0,0 +1,147 @@
+/**
+ * @file buffer_pool.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Fixed-capacity pool of preallocated frame buffers with RAII handles.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Every buffer is allocated (and prefaulted) once at startup, sized from the modem MTU. Free buffers sit on a
+ * lock-free stack, so any thread may acquire or release without taking a lock or touching the heap.
+ *
+ * A buffer can be shared between stages (e.g. forwarding and recording) without copying; it returns to the pool when
+ * the last handle lets go. Shared buffers must be treated as read-only.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#define POOL_INDEX_NONE 0xFFFFFFFF
+
+/**
+ * @brief A single pool buffer and the metadata of the frame it holds.
+ *
+ */
+typedef struct
+{
+    uint8_t *data;      // Buffer storage, 'capacity' bytes.
+    uint32_t capacity;  // Size of the buffer storage.
+    ssize_t size;       // Number of valid bytes in data.
+    uint64_t timestamp; // CLOCK_MONOTONIC time of capture, in nanoseconds.
+    uint8_t chain;      // Receive chain that captured it.
+} rx_frame_t;
+
+typedef struct
+{
+    // Top of the free stack: low 32 bits are the buffer index, high 32 bits a tag that defeats ABA.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> top;
+
+    // Counters, read by the network loop for status frames.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> in_use;
+    std::atomic<uint32_t> high_water; // Most buffers ever in use at once.
+    std::atomic<uint32_t> exhausted;  // Acquires that found the pool empty.
+
+    alignas(CACHE_LINE_SIZE) uint32_t count;
+    std::atomic<uint32_t> *next; // Free-stack links, one per buffer.
+    std::atomic<uint32_t> *refs; // Handles referring to each buffer.
+    rx_frame_t *frames;
+    uint8_t *storage;
+} buffer_pool_t;
+
+class PoolBuffer;
+
+/**
+ * @brief Allocates and prefaults every buffer in the pool.
+ *
+ * @param pool
+ * @param count Number of buffers.
+ * @param buffer_size Size of each buffer in bytes, normally the modem MTU.
+ * @return int 1 on success, negative on failure.
+ */
+int buffer_pool_init(buffer_pool_t *pool, uint32_t count, uint32_t buffer_size);
+
+/**
+ * @brief Frees the memory of a pool. No PoolBuffer may outlive this call.
+ *
+ * @param pool
+ */
+void buffer_pool_destroy(buffer_pool_t *pool);
+
+/**
+ * @brief Takes a free buffer from the pool.
+ *
+ * @param pool
+ * @return PoolBuffer An empty handle if the pool is exhausted.
+ */
+PoolBuffer buffer_pool_acquire(buffer_pool_t *pool);
+
+/**
+ * @brief Drops one reference to a buffer, returning it to the pool if it was the last. Normally called by PoolBuffer, not directly.
+ *
+ * @param pool
+ * @param index
+ */
+void buffer_pool_release(buffer_pool_t *pool, uint32_t index);
+
+/**
+ * @brief Owning handle to a pool buffer. Move-only; returns the buffer to its pool when destroyed.
+ *
+ */
+class PoolBuffer
+{
+public:
+    PoolBuffer() : pool(nullptr), index(POOL_INDEX_NONE){};
+    PoolBuffer(buffer_pool_t *pool, uint32_t index) : pool(pool), index(index){};
+    PoolBuffer(PoolBuffer &&other) : pool(other.pool), index(other.index) { other.index = POOL_INDEX_NONE; };
+    PoolBuffer(const PoolBuffer &) = delete;
+    PoolBuffer &operator=(const PoolBuffer &) = delete;
+    PoolBuffer &operator=(PoolBuffer &&other);
+    ~PoolBuffer() { reset(); };
+
+    /**
+     * @brief Whether this handle owns a buffer.
+     *
+     */
+    bool valid() const { return index != POOL_INDEX_NONE; };
+
+    /**
+     * @brief Returns the owned buffer to the pool, leaving the handle empty.
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Gives up ownership without returning the buffer to the pool.
+     *
+     * @return uint32_t The buffer index, to be re-adopted later with PoolBuffer(pool, index).
+     */
+    uint32_t detach();
+
+    /**
+     * @brief Creates a second handle to the same buffer. The buffer must not be written to while shared.
+     *
+     * @return PoolBuffer Empty if this handle is empty.
+     */
+    PoolBuffer share() const;
+
+    uint32_t getIndex() const { return index; };
+
+    rx_frame_t *operator->() const { return &pool->frames[index]; };
+    rx_frame_t &operator*() const { return pool->frames[index]; };
+
+private:
+    buffer_pool_t *pool;
+    uint32_t index;
+};
+
+#endif // BUFFER_POOL_HPP
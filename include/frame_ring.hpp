@@ -0,0 +1,133 @@
+/**
+ * @file frame_ring.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Bounded lock-free single-producer/single-consumer ring of buffer pool indices.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Joins the X-Band capture stage (producer) to the forwarding stage (consumer) so that a slow network send never
+ * stops the modem from being drained.
+ *
+ * Frames live in buffer_pool_t buffers; the ring only carries their indices. Ownership moves into the ring on commit
+ * and back out as a PoolBuffer on pop, so a frame is returned to the pool however it leaves the pipeline.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef FRAME_RING_HPP
+#define FRAME_RING_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <semaphore.h>
+#include <atomic>
+#include "buffer_pool.hpp"
+
+/**
+ * @brief What the producer does when it commits a frame into a full ring.
+ *
+ */
+typedef enum
+{
+    RING_DROP_OLDEST = 0, // Discard the oldest queued frame to make room.
+    RING_DROP_NEWEST = 1, // Discard the frame being committed.
+    RING_BLOCK = 2,       // Wait for the consumer to make room.
+} ring_policy;
+
+typedef struct
+{
+    // Producer-owned.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head;
+
+    // Consumer-owned, except that the producer also advances tail when dropping the oldest frame.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail;
+
+    // Counters, read by the network loop for status frames.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> dropped_oldest;
+    std::atomic<uint32_t> dropped_newest;
+    std::atomic<uint32_t> blocked;
+
+    alignas(CACHE_LINE_SIZE) uint32_t capacity; // Power of two.
+    ring_policy policy;
+    std::atomic<bool> closed;
+    buffer_pool_t *pool;          // Pool the queued buffers belong to.
+    std::atomic<uint32_t> *ready; // Pool indices of queued frames, 'capacity' entries.
+    sem_t items;                  // Wakes the consumer; posted by a commit only while consumer_waiting is set.
+    sem_t space;                  // Wakes the producer; posted by a pop only while producer_waiting is set (RING_BLOCK).
+    std::atomic<bool> consumer_waiting;
+    std::atomic<bool> producer_waiting;
+} frame_ring_t;
+
+/**
+ * @brief Allocates a ring.
+ *
+ * @param ring
+ * @param pool Pool that every committed buffer comes from.
+ * @param capacity Number of frames the ring can queue, rounded up to a power of two.
+ * @param policy
+ * @return int 1 on success, negative on failure.
+ */
+int frame_ring_init(frame_ring_t *ring, buffer_pool_t *pool, uint32_t capacity, ring_policy policy);
+
+/**
+ * @brief Returns any queued frames to the pool and frees the ring. Neither stage may be using it.
+ *
+ * @param ring
+ */
+void frame_ring_destroy(frame_ring_t *ring);
+
+/**
+ * @brief Producer: queues a frame for the consumer, applying the overflow policy if the ring is full.
+ *
+ * The ring takes the buffer either way; frame is left empty.
+ *
+ * @param ring
+ * @param frame
+ * @return int 1 if queued, 0 if the frame was dropped (RING_DROP_NEWEST, or RING_BLOCK and the ring was closed).
+ */
+int frame_ring_commit(frame_ring_t *ring, PoolBuffer &frame);
+
+/**
+ * @brief Consumer: takes the oldest queued frame, waiting up to timeout_ms for one to arrive.
+ *
+ * @param ring
+ * @param timeout_ms
+ * @return PoolBuffer Empty on timeout or if the ring was closed.
+ */
+PoolBuffer frame_ring_pop(frame_ring_t *ring, int timeout_ms);
+
+/**
+ * @brief Consumer: as frame_ring_pop(...), for waits shorter than a millisecond.
+ *
+ * @param ring
+ * @param timeout_us
+ * @return PoolBuffer Empty on timeout or if the ring was closed.
+ */
+PoolBuffer frame_ring_pop_us(frame_ring_t *ring, uint64_t timeout_us);
+
+/**
+ * @brief Number of frames currently queued. Approximate while either stage is running.
+ *
+ * @param ring
+ * @return uint32_t
+ */
+uint32_t frame_ring_depth(frame_ring_t *ring);
+
+/**
+ * @brief Wakes any stage blocked on the ring and makes further blocking calls return immediately.
+ *
+ * @param ring
+ */
+void frame_ring_close(frame_ring_t *ring);
+
+/**
+ * @brief Parses "drop_oldest", "drop_newest" or "block".
+ *
+ * @param name
+ * @param policy Set on success.
+ * @return int 1 on success, -1 if the name is not recognized.
+ */
+int frame_ring_policy_from_string(const char *name, ring_policy *policy);
+
+#endif // FRAME_RING_HPP
@@ -0,0 +1,296 @@
+/**
+ * @file gs_compress.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Optional LZ4 or zstd compression of received frames on their way to the server, on a pool of worker threads.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * During high-rate passes the backhaul to the server can be slower than the downlink. With [compress] codec set, each
+ * forwarding stage hands its frames to the compression workers and sends what comes back. Every chain has a window of
+ * COMPRESS_WINDOW frames out at once; they come back in the order they went, so the server still sees each chain's
+ * frames in sequence order, and a frame waits behind an older one only for as long as that one takes to compress.
+ *
+ * A frame is sent compressed only if that saves at least min_saving percent of it, header included; otherwise it goes
+ * as it came. A chain whose frame did not compress stops trying for its next probe_every frames, then probes again
+ * with the one after, so that incompressible data (already compressed or encrypted payloads, noise) costs one attempt
+ * in probe_every + 1 rather than one per frame. A frame is also sent as it came if no pool buffer is free to compress
+ * it into.
+ *
+ * The workers' level follows a ladder from the fastest setting up to [compress] level, starting at the top. With
+ * adaptive on, it moves a rung every COMPRESS_ADAPT_MS: down while the workers are busy more than COMPRESS_BUSY_HIGH
+ * percent of the time or frames queue up behind them, up while they are busy less than COMPRESS_BUSY_LOW percent, so
+ * that compression keeps up with whatever rate the frames arrive at. With it off, every frame is compressed at
+ * [compress] level.
+ *
+ * Compression needs the sequence header: with a codec set, every DATA item has one (gs_spool.hpp), and a compressed
+ * item has GS_SEQ_COMPRESSED in its flags and a gs_compress_hdr_t in front of the compressed bytes.
+ * gs_compress_unpack(...) undoes it. Spooled frames are spooled as they would have been sent, compressed or not.
+ *
+ * The codecs, and with them liblz4 and libzstd, are only built with HAYSTACK_COMPRESS (make COMPRESS=1). Without it,
+ * gs_compress_init(...) accepts only COMPRESS_OFF.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+// CHAINS_MAX. Outside the guard, since gs_config.hpp includes this header in turn and must get to define it first.
+#include "gs_config.hpp"
+
+#ifndef GS_COMPRESS_HPP
+#define GS_COMPRESS_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <atomic>
+#include "buffer_pool.hpp"
+#include "gs_spool.hpp"
+#include "gs_metrics.hpp"
+
+#define COMPRESS_WORKERS_DEFAULT 2
+#define COMPRESS_WORKERS_MAX 8
+#define COMPRESS_WINDOW 16 // Frames per chain out at the workers at once.
+#define COMPRESS_QUEUE (COMPRESS_WINDOW * CHAINS_MAX)
+#define COMPRESS_MIN_SAVING_DEFAULT 10  // Percent.
+#define COMPRESS_PROBE_EVERY_DEFAULT 64
+#define COMPRESS_LEVELS_MAX 16
+#define COMPRESS_ADAPT_MS 200
+#define COMPRESS_BUSY_HIGH 75 // Percent of the workers' time spent compressing.
+#define COMPRESS_BUSY_LOW 40
+
+typedef enum
+{
+    COMPRESS_OFF = 0,
+    COMPRESS_LZ4 = 1,  // LZ4 block format; the level is the acceleration, 1 the strongest.
+    COMPRESS_ZSTD = 2, // zstd frame format; the level is zstd's, negative ones the fastest.
+} compress_codec;
+
+/**
+ * @brief Precedes the compressed bytes of a DATA item whose sequence header has GS_SEQ_COMPRESSED. Little-endian.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t codec;     // compress_codec
+    int8_t level;      // It was compressed at.
+    uint16_t reserved;
+    uint32_t raw_size; // The frame's size before compression.
+} gs_compress_hdr_t;
+
+typedef struct
+{
+    PoolBuffer frame;   // As received; replaced by the compressed item if compression paid.
+    gs_seq_hdr_t seq;   // GS_SEQ_COMPRESSED is set if it did.
+    bool probe;         // Try to compress it; otherwise it only keeps its place in the order.
+    bool compressed;
+    uint32_t raw_size;
+    uint64_t busy_ns;   // Spent compressing it, whether that paid or not.
+    std::atomic<bool> done;
+} compress_job_t;
+
+/**
+ * @brief One chain's frames. Everything but the counters belongs to its forwarding stage; jobs in flight belong to the
+ * workers until done.
+ *
+ */
+typedef struct gs_compress_stream
+{
+    compress_job_t jobs[COMPRESS_WINDOW];
+    uint32_t head;        // Oldest job in flight.
+    uint32_t tail;        // Next job to submit.
+    uint32_t bypass_left; // Frames still to send as they are before probing again.
+
+    // Counters, read by the metrics thread.
+    std::atomic<uint64_t> frames;    // Frames sent compressed.
+    std::atomic<uint64_t> bypassed;  // Frames sent as they came.
+    std::atomic<uint64_t> bytes_in;  // Size of every frame, as received.
+    std::atomic<uint64_t> bytes_out; // Size of every frame as sent; bytes_out / bytes_in is the ratio.
+    std::atomic<uint64_t> busy_ns;   // Worker time spent compressing.
+} gs_compress_stream_t;
+
+typedef struct
+{
+    pthread_t tid;
+    struct gs_compress *comp;
+    uint32_t id;
+} compress_worker_t;
+
+typedef struct gs_compress
+{
+    bool enabled; // codec is not COMPRESS_OFF.
+    compress_codec codec;
+    bool adaptive;
+    uint32_t min_saving;  // Percent.
+    uint32_t probe_every;
+    int levels[COMPRESS_LEVELS_MAX]; // Fastest first, up to [compress] level.
+    uint32_t level_count;
+    std::atomic<uint32_t> level_index; // Into levels.
+    buffer_pool_t *pool;               // Compressed items are written into its buffers.
+
+    compress_worker_t workers[COMPRESS_WORKERS_MAX];
+    uint32_t worker_count;
+    uint32_t started;      // Workers running.
+    gs_metrics_t *metrics; // Each worker registers as cmp<N>.
+
+    pthread_mutex_t lock;     // Over the queue, stopping and the adaptation state.
+    pthread_cond_t queued;    // Workers wait on it for jobs.
+    pthread_cond_t finished;  // CLOCK_MONOTONIC; forwarding stages wait on it for their oldest job.
+    compress_job_t *queue[COMPRESS_QUEUE];
+    uint32_t queue_head;
+    uint32_t queue_count;
+    bool stopping;
+    uint64_t adapt_at;      // CLOCK_MONOTONIC of the next level adjustment.
+    uint64_t adapt_busy_ns; // Worker time spent compressing since the previous one.
+
+    gs_compress_stream_t streams[CHAINS_MAX];
+} gs_compress_t;
+
+/**
+ * @brief Sets up compression. With COMPRESS_OFF, nothing else is set up and enabled is false.
+ *
+ * @param comp
+ * @param pool
+ * @param codec
+ * @param workers 1 to COMPRESS_WORKERS_MAX.
+ * @param level The strongest level to use; 0 for the codec's default (LZ4 acceleration 1, zstd level 3).
+ * @param adaptive Move between the fastest level and 'level' to keep up; otherwise always use 'level'.
+ * @param min_saving Percent a frame must shrink by to be sent compressed.
+ * @param probe_every Frames sent uncompressed after one that did not compress.
+ * @return int 1 on success, -1 if the codec has no such level.
+ */
+int gs_compress_init(gs_compress_t *comp, buffer_pool_t *pool, compress_codec codec, uint32_t workers, int level, bool adaptive, uint32_t min_saving, uint32_t probe_every);
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param comp
+ * @param metrics
+ * @return int 1 on success, negative on failure.
+ */
+int gs_compress_start(gs_compress_t *comp, gs_metrics_t *metrics);
+
+/**
+ * @brief Stops and joins the worker threads. The forwarding stages must have returned.
+ *
+ * @param comp
+ */
+void gs_compress_stop(gs_compress_t *comp);
+
+/**
+ * @brief Frees what gs_compress_init(...) set up, and any frame left in a window.
+ *
+ * @param comp
+ */
+void gs_compress_destroy(gs_compress_t *comp);
+
+/**
+ * @brief Whether the chain's window has room for another frame.
+ *
+ * @param stream
+ * @return bool
+ */
+static inline bool gs_compress_room(const gs_compress_stream_t *stream)
+{
+    return stream->tail - stream->head < COMPRESS_WINDOW;
+}
+
+/**
+ * @brief Frames of the chain not yet collected with gs_compress_reap(...).
+ *
+ * @param stream
+ * @return uint32_t
+ */
+static inline uint32_t gs_compress_in_flight(const gs_compress_stream_t *stream)
+{
+    return stream->tail - stream->head;
+}
+
+/**
+ * @brief Forwarding stage: hands a frame to the workers. The window must have room.
+ *
+ * @param comp
+ * @param stream
+ * @param frame Taken over.
+ * @param seq Its sequence header.
+ */
+void gs_compress_submit(gs_compress_t *comp, gs_compress_stream_t *stream, PoolBuffer &frame, const gs_seq_hdr_t *seq);
+
+/**
+ * @brief Forwarding stage: takes back the chain's oldest frame, once the workers are done with it.
+ *
+ * @param comp
+ * @param stream
+ * @param frame Set to the frame, compressed or not.
+ * @param seq Set to its sequence header.
+ * @param timeout_us Longest to wait for it.
+ * @return int 1 if a frame was returned; 0 if none is in flight, or the oldest was not done in time.
+ */
+int gs_compress_reap(gs_compress_t *comp, gs_compress_stream_t *stream, PoolBuffer *frame, gs_seq_hdr_t *seq, uint64_t timeout_us);
+
+/**
+ * @brief The level the workers compress at now.
+ *
+ * @param comp
+ * @return int
+ */
+int gs_compress_level(const gs_compress_t *comp);
+
+/**
+ * @brief Compresses one frame, as a worker does: the gs_compress_hdr_t, then the compressed bytes.
+ *
+ * @param codec
+ * @param level
+ * @param scratch From gs_compress_scratch(...), for the calling thread only.
+ * @param in
+ * @param size
+ * @param out
+ * @param cap Room at out; a frame that does not fit is not compressed.
+ * @return ssize_t Bytes written to out, or 0 if it did not fit, or negative on failure.
+ */
+ssize_t gs_compress_frame(compress_codec codec, int level, void *scratch, const uint8_t *in, size_t size, uint8_t *out, size_t cap);
+
+/**
+ * @brief Allocates the state one thread needs to compress with a codec.
+ *
+ * @param codec
+ * @return void* NULL on failure; freed with gs_compress_scratch_free(...).
+ */
+void *gs_compress_scratch(compress_codec codec);
+
+/**
+ * @brief Frees what gs_compress_scratch(...) allocated.
+ *
+ * @param codec
+ * @param scratch
+ */
+void gs_compress_scratch_free(compress_codec codec, void *scratch);
+
+/**
+ * @brief Server side: decompresses a DATA item that had GS_SEQ_COMPRESSED, from its gs_compress_hdr_t on.
+ *
+ * @param item
+ * @param size
+ * @param out
+ * @param cap
+ * @return ssize_t The frame's size, or negative if the item is malformed (-1) or the frame is larger than cap (-2).
+ */
+ssize_t gs_compress_unpack(const uint8_t *item, size_t size, uint8_t *out, size_t cap);
+
+/**
+ * @brief Parses a codec name: off, lz4 or zstd.
+ *
+ * @param name
+ * @param codec
+ * @return int 1 on success, -1 if the name is not known.
+ */
+int gs_compress_codec_from_string(const char *name, compress_codec *codec);
+
+/**
+ * @brief The codec's name, as in the configuration.
+ *
+ * @param codec
+ * @return const char*
+ */
+const char *gs_compress_codec_name(compress_codec codec);
+
+#endif // GS_COMPRESS_HPP
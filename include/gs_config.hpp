@@ -0,0 +1,214 @@
+/**
+ * @file gs_config.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Runtime configuration for haystack, loaded from an INI-style file.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_CONFIG_HPP
+#define GS_CONFIG_HPP
+
+// Ahead of the includes: the module headers below size their per-chain arrays by it.
+#define CHAINS_MAX 4 // X-Band receive chains one haystack can run.
+
+#include <stdint.h>
+#include "frame_ring.hpp"
+#include "gs_recorder.hpp"
+#include "gs_status.hpp"
+#include "gs_uplink.hpp"
+#include "gs_netloop.hpp"
+#include "gs_spool.hpp"
+#include "gs_rxworker.hpp"
+#include "gs_metrics.hpp"
+#include "gs_sched.hpp"
+#include "gs_rxdma.hpp"
+#include "gs_validate.hpp"
+#include "gs_radiocfg.hpp"
+#include "gs_schedule.hpp"
+#include "gs_wire.hpp"
+#include "gs_compress.hpp"
+#include "gs_replay.hpp"
+#ifdef HAYSTACK_SIM
+#include "sim_backend.h"
+#endif
+
+#define GS_CONFIG_DEFAULT_PATH "haystack.conf"
+
+#define RX_RING_SLOTS_DEFAULT 64
+#define RX_MTU_DEFAULT 0x2000
+#define POOL_BUFFERS_DEFAULT 0 // Sized to the rest of the configuration (gs_config_pool_needed(...)).
+#define RECORDER_RING_SLOTS_DEFAULT 64
+#define RECORDER_SEGMENT_MB_DEFAULT 256
+#define RECORDER_MAX_SEGMENTS_DEFAULT 16
+#define RECORDER_BATCH_FRAMES_DEFAULT 64
+#define RECORDER_BATCH_MS_DEFAULT 50
+#define RECORDER_FSYNC_INTERVAL_MS_DEFAULT 1000
+#define LOG_HEXDUMP_BYTES_DEFAULT 64
+
+/**
+ * @brief One receive chain's hardware and cores, from its [chainN] section.
+ *
+ */
+typedef struct
+{
+    char ipcore[32];      // UIO device name of the modem IP core.
+    char dma[32];         // UIO device name of its DMA engine.
+    uint32_t pll_spi_bus; // ADF4355 SPI bus and chip select.
+    uint32_t pll_spi_cs;
+    int rx_cpu;           // Core the capture stage is pinned to, -1 for none.
+    int fwd_cpu;          // Core the forwarding stage is pinned to, -1 for none.
+} gs_chain_config_t;
+
+/**
+ * @brief Runtime configuration.
+ *
+ * Every field has a compiled-in default (see gs_config_defaults); a configuration file only needs to list the keys it changes.
+ *
+ */
+typedef struct
+{
+    // [rx]
+    uint32_t rx_chains;            // Receive chains, 1 to CHAINS_MAX; each has its own modem, PLL, radio, ring and stages.
+    uint32_t rx_ring_slots;        // Frames buffered between the capture and forwarding stages.
+    ring_policy rx_ring_policy;    // What the capture stage does when the ring is full.
+    uint32_t rx_mtu;               // Largest frame the modem will hand us, in bytes.
+    uint32_t rx_disarm_timeout_ms; // Longest a disarm waits for the frame in progress.
+    uint32_t rx_dma_depth;         // Pool buffers kept posted to each modem; 0 or 1 to receive one frame at a time.
+
+    // [chain0] to [chain3]
+    gs_chain_config_t chain[CHAINS_MAX];
+
+    // [pool]
+    uint32_t pool_buffers; // MTU-sized buffers shared by the RX, forwarding, recording and network-RX paths; 0 for as many as needed.
+
+    // [recorder]
+    bool rec_enabled;
+    char rec_directory[256];
+    uint32_t rec_ring_slots;      // Frames the recorder may fall behind by.
+    uint32_t rec_segment_mb;      // Segment size cap, in MiB.
+    uint32_t rec_max_segments;    // Segments kept in the directory; 0 for all.
+    uint32_t rec_batch_frames;    // Frames per write.
+    uint32_t rec_batch_ms;        // Longest a frame waits to be written.
+    fsync_policy rec_fsync;
+    uint32_t rec_fsync_interval_ms;
+
+    // [log]
+    bool log_async;               // Buffer log lines per thread and write them from a log thread.
+    uint32_t log_hexdump_per_sec; // Received frames hexdumped per second; 0 for none.
+    uint32_t log_hexdump_bytes;   // Bytes of each frame dumped.
+
+    // [status]
+    uint32_t status_refresh_ms;   // How often the radio is re-read from libiio.
+    uint32_t status_coalesce_ms;  // Events this close together share a status frame.
+    uint32_t status_heartbeat_ms; // Longest time between status frames.
+    wire_encoding status_encoding; // Raw phy_status_t structs, or the compact encoding (gs_wire.hpp).
+    uint32_t status_keyframe_every; // Compact: frames from one full frame to the next; the rest are deltas.
+
+    // [net]
+    bool net_zero_copy; // Send DATA frames straight out of their pool buffers (gs_uplink.hpp).
+    uint32_t net_batch_frames;     // Most received frames per DATA frame; 0 or 1 sends each on its own.
+    uint32_t net_batch_bytes;      // Batch payload size at which it is sent without waiting.
+    uint32_t net_batch_latency_us; // Longest a frame waits for others to join its batch.
+    uint32_t net_poll_ms;          // Keepalive POLL interval.
+    uint32_t net_timeout_ms;       // Server silence after which the connection is re-established.
+    uint32_t net_backoff_min_ms;   // First reconnect delay; doubles on each failure.
+    uint32_t net_backoff_max_ms;   // Reconnect delay cap.
+
+    // [spool]
+    bool spool_enabled;                 // Hold received frames while the server is unreachable, and sequence every DATA item.
+    uint32_t spool_ram_mb;              // Spooled in memory first, in MiB.
+    uint32_t spool_disk_mb;             // Then in <spool_directory>/haystack_spool.bin, in MiB; 0 for none.
+    char spool_directory[256];
+    uint32_t spool_drain_bytes_per_sec; // Rate spooled frames are sent at once reconnected; 0 for as fast as possible.
+    spool_drain_order spool_order;      // Whether live frames wait behind spooled ones.
+
+    // [validate]
+    crc_kind val_crc;              // Trailer each received frame is checked against before it is forwarded.
+    uint32_t val_dedupe_window;    // Forwarded frames per chain a new one is compared against; 0 for none.
+
+    // [compress]
+    compress_codec compress_method; // Compress frames on their way to the server, or not (gs_compress.hpp).
+    uint32_t compress_workers;      // Compression threads, shared by every chain.
+    int compress_level;             // Strongest level; 0 for the codec's default.
+    bool compress_adaptive;         // Use faster levels while the workers cannot keep up.
+    uint32_t compress_min_saving;   // Percent a frame must shrink by to be sent compressed.
+    uint32_t compress_probe_every;  // Frames sent as they are after one that did not compress.
+
+    // [radio]
+    char radio_filter_dir[128]; // Where the <ftr_name>.ftr files configuration frames name are.
+    uint32_t radio_fir_cache;   // Filter files kept parsed per chain.
+
+    // [schedule]
+    uint32_t schedule_max_entries; // Entries a chain's schedule can hold.
+
+    // [replay]
+    char replay_files[256];        // Glob of captures to replay instead of running the capture stages; empty for none.
+    double replay_speed;           // 1 as captured, N times faster, 0 as fast as possible.
+    uint32_t replay_rate_fps;      // Pace of files that carry no time (rxdata*.bin).
+    uint32_t replay_max_gap_ms;    // Longest pause between two frames.
+    uint32_t replay_jitter_us;     // Random shift of every release, either way.
+    uint32_t replay_burst_frames;  // Frames released back to back at once; 0 or 1 for none.
+    uint32_t replay_loops;         // Passes over the files; 0 for as long as haystack runs.
+    uint32_t replay_seed;
+
+    // [metrics]
+    bool metrics_enabled;        // Record latency histograms and run the metrics thread.
+    uint32_t metrics_port;       // Loopback TCP port for the text exposition; 0 for none.
+    char metrics_socket[108];    // Unix socket for the text exposition; empty for none.
+    uint32_t metrics_interval_ms; // How often histograms are summed; quantiles cover this long.
+    uint32_t metrics_sample_every; // Each thread times one in this many of its intervals.
+    bool metrics_status_summary; // Append a gs_metrics_summary_t to status frames.
+
+    // [sched]
+    bool sched_lock_memory;            // mlock(...) the receive path's memory once it is allocated.
+    bool sched_prefault;               // Touch every page of the spool and scratch buffers before the threads start.
+    int sched_capture_priority;        // SCHED_FIFO priority of each role, 1 to 99; 0 for SCHED_OTHER.
+    int sched_forward_priority;
+    int sched_network_priority;
+    int sched_recorder_priority;
+    int sched_schedule_priority;
+    int sched_network_cpu;             // Core the network loop is pinned to, -1 for none.
+    int sched_recorder_cpu;            // Core the recorder is pinned to, -1 for none.
+    int sched_schedule_cpu;            // Core the schedule thread is pinned to, -1 for none.
+    uint32_t sched_capture_deadline_us; // Longest the capture stage may take to turn a frame around; 0 for no deadline.
+
+#ifdef HAYSTACK_SIM
+    // [sim], only used by haystack_sim.out
+    sim_config_t sim;
+#endif
+} gs_config_t;
+
+/**
+ * @brief Fills a configuration with the compiled-in defaults.
+ *
+ * @param config
+ */
+void gs_config_defaults(gs_config_t *config);
+
+/**
+ * @brief Overlays the keys found in an INI-style file onto config.
+ *
+ * Lines are 'key = value' pairs grouped under '[section]' headers. '#' and ';' begin comments. Unknown keys are reported and ignored.
+ *
+ * @param config Configuration to update, should already hold defaults.
+ * @param path
+ * @return int 1 on success, -1 if the file could not be opened, -2 if any line failed to parse.
+ */
+int gs_config_load(gs_config_t *config, const char *path);
+
+/**
+ * @brief The most pool buffers the configuration can have in use at once: every receive ring full, every modem's
+ * buffers posted, every stage holding a frame, every batch and compression window open, the recorder behind by its
+ * whole ring, and every chain's command queue full. A smaller pool can run dry under load, and the capture stages
+ * then lose frames.
+ *
+ * @param config
+ * @return uint32_t
+ */
+uint32_t gs_config_pool_needed(const gs_config_t *config);
+
+#endif // GS_CONFIG_HPP
@@ -17,12 +17,52 @@
 #include "adf4355.h"
 #include "network.hpp"
 #include "libiio.h"
+#include "gs_config.hpp"
+#include "buffer_pool.hpp"
+#include "frame_ring.hpp"
+#include "gs_recorder.hpp"
+#include "gs_status.hpp"
+#include "gs_uplink.hpp"
+#include "gs_netloop.hpp"
+#include "gs_spool.hpp"
+#include "gs_rxworker.hpp"
+#include "gs_seqlock.hpp"
+#include "gs_metrics.hpp"
+#include "gs_rxdma.hpp"
+#include "gs_radiocfg.hpp"
+#include "gs_schedule.hpp"
+#include "gs_wire.hpp"
+#include "gs_compress.hpp"
+#include "gs_hwexec.hpp"
+#include "gs_replay.hpp"
 
 #define SERVER_POLL_RATE 5 // Once per this many seconds
 #define SEC *1000000
 #define RECV_TIMEOUT 15
 #define SERVER_PORT 54230
 
+/**
+ * @brief What the capture stage has seen, published after every receive for status frames.
+ *
+ */
+typedef struct
+{
+    int32_t last_rx_status;   // Latest rxmodem_receive(...) return, held at the failure after a success.
+    int32_t last_read_status; // Latest rxmodem_read(...) return.
+    uint32_t frames;          // Frames read in full.
+    uint32_t rx_errors;       // Receives that returned no frame.
+    uint32_t read_errors;     // Reads that came up short.
+    uint64_t bytes;           // Bytes read in full frames.
+    uint64_t last_frame_ns;   // gs_monotonic_ns() of the latest frame, 0 if none.
+} rx_snapshot_t;
+
+struct global_data;
+
+/**
+ * @brief One X-Band receive chain: a radio, and the capture and forwarding stages that drain it. Chains share the
+ * buffer pool, the recorder, the uplink, the spool and the network loop, and nothing else.
+ *
+ */
 typedef struct
 {
     // Three separate objects for a single x-band radio.
@@ -30,12 +70,48 @@ typedef struct
     adf4355 PLL[1]; // from adf4355.h, aka pll
     adradio_t radio[1];// from libiio.h
 
-    bool rx_modem_ready;
-    bool rx_armed;
-    bool PLL_ready;
-    bool radio_ready;
-    int last_rx_status;
-    int last_read_status;
+    uint8_t id; // Index in global->chains; sent in its status and DATA frames.
+    struct global_data *global;
+
+    // Shared between threads, apart from the radio objects the capture stage works on. Set with release, read with
+    // acquire, so that whatever the setter initialized before is visible to the reader.
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> rx_modem_ready;
+    std::atomic<bool> PLL_ready;
+    std::atomic<bool> radio_ready;
+    bool rx_modem_stopped; // By a disarm; restarted by the next arm. Hardware executor only.
+
+    // Written by the capture stage only, read by the network loop without holding it up.
+    gs_seqlock<rx_snapshot_t> rx_stats[1];
+
+    frame_ring_t rx_ring[1]; // Capture stage -> forwarding stage.
+    uint8_t *rx_drain;       // MTU-sized scratch the capture stage reads into when the pool is exhausted.
+    gs_rxdma_t rx_dma[1];    // Buffers posted to the modem ahead of the capture stage.
+    gs_validate_t validate[1]; // CRC check and duplicate filter, in the forwarding stage.
+    gs_rxworker_t rx_worker[1]; // Arms and disarms the capture stage.
+    gs_status_t status[1];   // Cached radio state; decides when status frames go out.
+    gs_wire_encoder_t status_wire[1]; // Status frames sent as deltas, with [status] encoding = compact. Network loop only.
+    gs_radiocfg_t radio_config[1]; // What was last applied to the radio; the hardware executor and the schedule thread share it.
+    gs_deadline_t rx_deadline[1]; // Capture stage turnarounds against [sched] capture_deadline_us.
+} gs_chain_t;
+
+typedef struct global_data
+{
+    gs_chain_t chains[CHAINS_MAX];
+    uint32_t chain_count; // config->rx_chains
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int> thread_status; // 1 running, 0 stopping, -1 unrecoverable: every thread returns.
+
+    gs_config_t config[1];
+    buffer_pool_t pool[1];   // Every frame buffer in the RX and network-RX paths, of every chain.
+    gs_recorder_t recorder[1];
+    gs_uplink_t uplink[1];   // Sends received frames to the server.
+    gs_netloop_t netloop[1]; // Server connection, keepalive and status frames.
+    gs_spool_t spool[1];     // Received frames held while the server is unreachable.
+    gs_metrics_t metrics[1]; // Latency histograms, and the text exposition of everything counted.
+    gs_schedule_t schedule[1]; // LO and gain retunes, applied at their times by the schedule thread.
+    gs_compress_t compress[1]; // Compression workers, shared by every chain's forwarding stage.
+    gs_hwexec_t hwexec[1];     // Each chain's queue of configurations and commands, run by its hardware executor.
+    gs_replay_t replay[1];     // Captured frames fed to the chains in place of the capture stages.
 
     NetDataClient *network_data;
     uint8_t netstat;
@@ -69,33 +145,127 @@ enum XBAND_COMMAND
     XBC_DISABLE_PLL = 1,
     XBC_ARM_RX = 2,
     XBC_DISARM_RX = 3,
+    XBC_SCHEDULE_LOAD = 4,  // xband_schedule_t (gs_schedule.hpp)
+    XBC_SCHEDULE_CLEAR = 5,
 };
 
 /**
- * @brief Initializes radio.
+ * @brief XBAND_COMMAND payload. A 4-byte payload, the command alone, is for chain 0.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    int32_t command; // XBAND_COMMAND
+    uint8_t chain;
+} xband_command_t;
+
+/**
+ * @brief Sent back for XBC_INIT_PLL, XBC_DISABLE_PLL, XBC_ARM_RX and XBC_DISARM_RX, in an ACK if done (or there was
+ * nothing to do) and in a NACK if not.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    int32_t command;   // XBC_*
+    uint8_t chain;
+    int8_t result;     // 1 done, 0 already so; on a NACK: -1 failed, -6 not a command known, -7 superseded by a later
+                       // command before it ran, -8 the chain's queue was full.
+    uint16_t reserved;
+    uint32_t queue_us; // Time spent queued for the hardware executor.
+    uint32_t exec_us;  // Time the command took.
+} xband_command_ack_t;
+
+/**
+ * @brief Sets up a receive chain's ring and state, and its PLL settings, from its [chainN] section. Does not touch
+ * the hardware.
+ * 
+ * @param global Its config and pool are used.
+ * @param id
+ * @return int 1 on success, negative on failure.
+ */
+int gs_chain_init(global_data_t *global, uint8_t id);
+
+/**
+ * @brief Frees what gs_chain_init(...) set up. Its threads must have returned.
+ * 
+ * @param chain 
+ */
+void gs_chain_destroy(gs_chain_t *chain);
+
+/**
+ * @brief Initializes a chain's modem and radio.
  * 
- * Called from X-Band RX thread if necessary.
+ * Called from the chain's hardware executor if necessary.
  * 
- * @param global_data 
+ * @param chain 
  * @return int 
  */
-int gs_xband_init(global_data_t *global_data);
+int gs_xband_init(gs_chain_t *chain);
 
 /**
  * @brief Listens for X-Band packets from SPACE-HAUC.
  * 
- * @param args 
+ * Capture stage of one chain, pinned to its rx_cpu: drains the modem into the chain's rx_ring as fast as it can and
+ * does nothing else. Started once; parks while disarmed, and returns after gs_rxworker_stop(...).
+ * 
+ * @param args gs_chain_t
  * @return void* 
  */
 void *gs_xband_rx_thread(void *args);
 
 /**
- * @brief Listens for NetworkFrames from the Ground Station Network.
+ * @brief Arms a chain's capture stage, restarting the modem if a disarm stopped it.
+ * 
+ * @param chain 
+ * @return int 1 if armed, 0 if it already was, negative on failure.
+ */
+int gs_xband_arm(gs_chain_t *chain);
+
+/**
+ * @brief Disarms a chain's capture stage: stops the modem, and waits (up to config->rx_disarm_timeout_ms) for the
+ * frame in progress to be handed on.
+ * 
+ * @param chain 
+ * @return int 1 once disarmed, 0 if the capture stage is still finishing a frame, negative if it was not armed.
+ */
+int gs_xband_disarm(gs_chain_t *chain);
+
+/**
+ * @brief Forwards received X-Band packets to the Ground Station Network.
  * 
- * @param args 
+ * Forwarding stage of one chain, pinned to its fwd_cpu: consumes the chain's rx_ring, logs and sends each frame. The
+ * chains' forwarding stages share the uplink and the spool.
+ * 
+ * @param args gs_chain_t
  * @return void* 
  */
-void *gs_network_rx_thread(void *args);
+void *gs_xband_fwd_thread(void *args);
+
+/**
+ * @brief Acts on a NetworkFrame received from the Ground Station Network.
+ * 
+ * Called by the network loop for every complete frame. Configurations and commands are checked and queued for the
+ * hardware executor of the chain they name, and answered once run.
+ * 
+ * @param global 
+ * @param type 
+ * @param destination 
+ * @param payload_buffer Payload; taken over if queued, otherwise returned to the pool by the caller.
+ */
+void gs_network_handle(global_data_t *global, NetType type, NetVertex destination, PoolBuffer &payload_buffer);
+
+/**
+ * @brief Runs a queued configuration or command on its chain's hardware, and answers it with an ACK or a NACK.
+ * 
+ * Called by the chain's hardware executor only.
+ * 
+ * @param chain 
+ * @param cmd 
+ * @param queue_us Time it spent queued, reported in the answer.
+ * @param exec_us Set to the time it took.
+ * @return int The result sent back.
+ */
+int gs_xband_execute(gs_chain_t *chain, hwexec_cmd_t *cmd, uint32_t queue_us, uint32_t *exec_us);
 
 /**
  * @brief 
@@ -105,10 +275,28 @@ void *gs_network_rx_thread(void *args);
 int gs_xband_apply_config();
 
 /**
- * @brief 
+ * @brief Tags subsequent capture records and the chain's status with a configuration just applied to its radio.
  * 
- * @return void* 
+ * @param chain 
+ * @param applied 
+ */
+void gs_xband_config_applied(gs_chain_t *chain, const radiocfg_settings_t *applied);
+
+/**
+ * @brief Sends a chain's X-Band status frame, if the events call for one.
+ * 
+ * Called by the network loop with what gs_status_due(...) returned for the chain.
+ * 
+ * @param chain 
+ * @param events STATUS_EVENT_*
+ */
+void gs_xband_send_status(gs_chain_t *chain, uint32_t events);
+
+/**
+ * @brief Current CLOCK_MONOTONIC time.
+ * 
+ * @return uint64_t Nanoseconds.
  */
-void *xband_status_thread(void *);
+uint64_t gs_monotonic_ns();
 
 #endif // GS_HAYSTACK_HPP
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+ * @file gs_hwexec.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Per-chain queues and executor threads for the commands that drive the PLL, the radio and the modem.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Initializing the PLL is a slow SPI sequence with lock waits, a configuration is several libiio writes, and a disarm
+ * waits for the capture stage; none of it may hold up the network loop, which would then stop reading the socket and
+ * miss the server's polls. The network loop checks an XBAND_CONFIG or XBAND_COMMAND frame, queues it on its chain
+ * with gs_hwexec_submit(...) and goes back to the socket. Each chain's executor thread takes the commands in the order
+ * they came, runs them (gs_xband_execute(...)), and answers each with an ACK or a NACK carrying the time it spent
+ * queued and the time it took. Only the executor touches its chain's adf4355, adradio_t and modem, apart from the
+ * schedule thread's retunes, which go through gs_radiocfg_t's lock, and the capture stage's receives. It also
+ * initializes the modem and radio, and retries every HWEXEC_INIT_RETRY_MS until they are up, and between commands
+ * re-reads the radio for the status frames every [status] refresh_ms (gs_status_refresh(...)).
+ *
+ * A command that sets the same thing as the one queued last on the chain replaces it: a configuration replaces a
+ * configuration, an arm or disarm an arm or disarm, a PLL initialize or disable the other, since only the latest
+ * state asked for would be left anyway. The command replaced is answered as superseded. Schedule loads and clears are
+ * never merged; they are only queued, so that they keep their place after the configurations they depend on. A
+ * command that finds its chain's queue full is refused.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+// CHAINS_MAX. Outside the guard, since gs_config.hpp includes this header in turn and must get to define it first.
+#include "gs_config.hpp"
+
+#ifndef GS_HWEXEC_HPP
+#define GS_HWEXEC_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "network.hpp"
+#include "buffer_pool.hpp"
+#include "phy.hpp"
+
+#define HWEXEC_QUEUE_DEPTH 16     // Commands waiting per chain.
+#define HWEXEC_INIT_RETRY_MS 5000 // Between attempts to initialize a chain's modem and radio.
+#define HWEXEC_IDLE_MS 1000       // Longest an executor waits, so that it notices thread_status.
+
+#define HWEXEC_SUPERSEDED -7 // Result of a command replaced by a later one before it ran.
+#define HWEXEC_QUEUE_FULL -8 // Result of a command refused because its chain's queue was full.
+
+typedef struct
+{
+    NetType type;        // XBAND_CONFIG or XBAND_COMMAND.
+    int32_t command;     // XBC_* of an XBAND_COMMAND.
+    phy_config_t config; // XBAND_CONFIG, decoded.
+    PoolBuffer payload;  // XBAND_COMMAND, as received.
+    uint64_t queued_ns;  // gs_monotonic_ns() at gs_hwexec_submit(...).
+} hwexec_cmd_t;
+
+/**
+ * @brief One chain's commands. Everything but the counters is under lock.
+ *
+ */
+typedef struct
+{
+    hwexec_cmd_t cmds[HWEXEC_QUEUE_DEPTH];
+    uint32_t head;  // Oldest command.
+    uint32_t count; // Waiting.
+    bool stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t queued; // CLOCK_MONOTONIC; signalled by every submit and by gs_hwexec_stop(...).
+
+    // Counters, read by the metrics thread.
+    std::atomic<uint64_t> executed;       // Commands run.
+    std::atomic<uint64_t> coalesced;      // Commands replaced by a later one before they ran.
+    std::atomic<uint64_t> refused;        // Commands that found the queue full.
+    std::atomic<uint32_t> depth;          // count
+    std::atomic<uint32_t> last_exec_us;   // Time the latest command took.
+    std::atomic<uint32_t> worst_queue_us; // Longest a command waited to run.
+} gs_hwexec_queue_t;
+
+typedef struct
+{
+    gs_hwexec_queue_t queues[CHAINS_MAX];
+    uint32_t chain_count;
+} gs_hwexec_t;
+
+/**
+ * @brief Sets up each chain's queue.
+ *
+ * @param exec
+ * @param chain_count
+ */
+void gs_hwexec_init(gs_hwexec_t *exec, uint32_t chain_count);
+
+/**
+ * @brief Wakes the executors and has them return once the command in hand is done. Commands still queued are dropped
+ * unanswered.
+ *
+ * @param exec
+ */
+void gs_hwexec_stop(gs_hwexec_t *exec);
+
+/**
+ * @brief Frees any command left queued. The executors must have returned.
+ *
+ * @param exec
+ */
+void gs_hwexec_destroy(gs_hwexec_t *exec);
+
+/**
+ * @brief Network loop: queues a command for a chain's executor, merging it with the last one queued if that sets the
+ * same thing.
+ *
+ * @param exec
+ * @param chain
+ * @param cmd Its payload is taken over if the command is queued.
+ * @param replaced Set to the command replaced, if the return is 2; to be answered as superseded.
+ * @return int 1 if queued, 2 if it replaced the last command queued, -1 if the queue is full.
+ */
+int gs_hwexec_submit(gs_hwexec_t *exec, uint8_t chain, hwexec_cmd_t *cmd, hwexec_cmd_t *replaced);
+
+/**
+ * @brief Runs a chain's commands as they are queued, and brings up its modem and radio. Returns once thread_status
+ * is -1 or after gs_hwexec_stop(...).
+ *
+ * @param args gs_chain_t
+ * @return void*
+ */
+void *gs_hwexec_thread(void *args);
+
+#endif // GS_HWEXEC_HPP
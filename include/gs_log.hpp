@@ -0,0 +1,69 @@
+/**
+ * @file gs_log.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Log sink behind the meb_debug.hpp macros: synchronous, or buffered per thread and written by a log thread.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Until gs_log_start(...) is called (and after gs_log_stop()), every line is written to stderr immediately, as before.
+ *
+ * In asynchronous mode each thread formats its lines into a buffer of its own, a single-producer single-consumer ring
+ * that the log thread empties to stderr with one writev(...) per pass. Logging never blocks and never takes a lock; if
+ * a thread's buffer is full its lines are dropped, and the count is reported once there is room again. Lines from one
+ * thread stay in order; lines from different threads may interleave differently than they were logged.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_LOG_HPP
+#define GS_LOG_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LOG_LINE_MAX 256     // Longer lines are truncated.
+#define LOG_THREAD_LINES 256 // Lines each thread may have waiting for the log thread.
+#define LOG_FLUSH_MS 10      // How often the log thread looks for new lines.
+
+/**
+ * @brief Writes one formatted line. Called through the meb_debug.hpp macros, which add the location prefix.
+ *
+ * @param format
+ * @param ...
+ */
+void gs_log_write(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief Starts the log thread; from here on, logging only formats into the calling thread's buffer. gs_log_stop() is
+ * registered with atexit(...), so buffered lines are written even if the program exits early.
+ *
+ * @return int 1 on success, negative if the log thread could not be started (logging stays synchronous).
+ */
+int gs_log_start();
+
+/**
+ * @brief Writes out everything still buffered, stops the log thread and returns to synchronous logging.
+ *
+ */
+void gs_log_stop();
+
+/**
+ * @brief Sets the hexdump rate limit. gs_log_hexdump(...) does nothing until this is called with a non-zero rate.
+ *
+ * @param per_second Most dumps written per second, across all threads; 0 disables hexdumps.
+ * @param max_bytes Bytes of each frame dumped; the rest is summarized.
+ */
+void gs_log_hexdump_config(uint32_t per_second, uint32_t max_bytes);
+
+/**
+ * @brief Logs a frame as hex and ASCII, if hexdumps are enabled and the rate limit allows. Dumps refused by the rate
+ * limit are counted and reported with the next dump that is written.
+ *
+ * @param tag Printed before the dump.
+ * @param data
+ * @param size
+ */
+void gs_log_hexdump(const char *tag, const uint8_t *data, ssize_t size);
+
+#endif // GS_LOG_HPP
@@ -0,0 +1,331 @@
+/**
+ * @file gs_metrics.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Per-thread latency histograms and counters, aggregated in the background and served as text.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Every thread that records metrics registers once, by name, and is given its own shard: a cache-line-aligned block
+ * of counters and histograms that only it writes. Recording is therefore a relaxed load and store to memory no other
+ * thread writes, with no lock, no read-modify-write and no shared cache line. In a thread that has not registered
+ * (or with metrics disabled) recording does nothing, and gs_metrics_begin(...) does not even read the clock.
+ *
+ * A clock read costs more than the rest of recording put together (tens of ns with a vDSO, a system call without), so
+ * intervals timed with gs_metrics_begin(...) are sampled: each thread times one in every sample_every of them, which
+ * leaves the quantiles unbiased. Their histogram counts (and the exposition's _count and _sum) are of samples. Values
+ * recorded with gs_metrics_record(...) from clock reads the caller made anyway are all kept.
+ *
+ * Histograms are log-linear, as in HdrHistogram: values below METRICS_SUB_BUCKETS have a bucket each, and every
+ * power of two above that is split into METRICS_SUB_BUCKETS buckets, so any value is known to within 1 part in
+ * METRICS_SUB_BUCKETS (6%) up to 2^METRICS_MAX_BITS ns (18 minutes); larger values land in the last bucket.
+ *
+ * The metrics thread (gs_metrics_thread(...)), at low priority, sums the shards every interval_ms. It keeps what the
+ * capture stage, the ring, the pool, the uplink and the network loop already count alongside, and serves all of it in
+ * the Prometheus text format on a loopback TCP port and/or a Unix socket: one response per connection, with HTTP
+ * headers if the client sent a GET, as bare text otherwise. Histogram quantiles are over the latest interval; sums
+ * and counts are totals since startup. It also publishes a gs_metrics_summary_t of the latest interval, which can be
+ * appended to status frames.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_METRICS_HPP
+#define GS_METRICS_HPP
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <atomic>
+#include "buffer_pool.hpp"
+#include "gs_seqlock.hpp"
+
+#define METRICS_SUB_BITS 4
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BITS)
+#define METRICS_MAX_BITS 40
+#define METRICS_BUCKETS ((METRICS_MAX_BITS - METRICS_SUB_BITS + 1) * METRICS_SUB_BUCKETS)
+#define METRICS_SHARDS_MAX 24 // A capture and a forwarding stage and a hardware executor per chain, the network loop,
+                              // the schedule, the compression workers, and room to spare.
+#define METRICS_NAME_LEN 16
+#define METRICS_NICE 10 // Added to the metrics thread's nice value.
+
+#define METRICS_PORT_DEFAULT 0 // None.
+#define METRICS_INTERVAL_MS_DEFAULT 1000
+#define METRICS_SAMPLE_EVERY_DEFAULT 16
+
+#define GS_METRICS_SUMMARY_MAGIC 0x5254454D // "METR"
+#define GS_METRICS_SUMMARY_VERSION 1
+
+/**
+ * @brief Latency histograms, in nanoseconds.
+ *
+ */
+typedef enum
+{
+    METRIC_RX_READ_NS = 0,     // rxmodem_read(...) of a received frame.
+    METRIC_RX_QUEUE_NS = 1,    // A frame's wait in rx_ring, from capture to the forwarding stage.
+    METRIC_UPLINK_SEND_NS = 2, // Sending one DATA frame (a frame or a batch) to the server.
+    METRIC_IIO_READ_NS = 3,    // Reading the radio's status over libiio.
+    METRIC_IIO_CONFIG_NS = 4,  // Applying a configuration to the radio over libiio.
+    METRIC_SCHEDULE_ERROR_NS = 5, // Difference between a scheduled retune's completion and its time, either way.
+    METRIC_COMPRESS_NS = 6,       // Compressing one frame, whether that paid or not.
+    METRIC_HISTOGRAMS
+} gs_metric_hist;
+
+/**
+ * @brief Counters kept nowhere else.
+ *
+ */
+typedef enum
+{
+    METRIC_UPLINK_BYTES = 0, // DATA payload bytes sent to the server.
+    METRIC_IIO_ERRORS = 1,   // libiio reads or writes that failed.
+    METRIC_COUNTERS
+} gs_metric_counter;
+
+/**
+ * @brief One thread's metrics. Written by that thread only.
+ *
+ */
+typedef struct
+{
+    alignas(CACHE_LINE_SIZE) char name[METRICS_NAME_LEN];
+    uint32_t sample_every; // Set before the shard is handed out.
+    std::atomic<uint64_t> counters[METRIC_COUNTERS];
+    std::atomic<uint64_t> sums[METRIC_HISTOGRAMS]; // ns
+    std::atomic<uint32_t> buckets[METRIC_HISTOGRAMS][METRICS_BUCKETS];
+} gs_metrics_shard_t;
+
+/**
+ * @brief One histogram over the latest interval, in a status frame.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t id;       // gs_metric_hist
+    uint16_t reserved;
+    uint32_t count;    // Values recorded in the interval.
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;   // Upper bound of the highest bucket used.
+} gs_metrics_hist_summary_t;
+
+/**
+ * @brief Appended to the XBAND_DATA status frame, after the phy_status_t, with [metrics] status_summary. Little-endian.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;       // GS_METRICS_SUMMARY_MAGIC
+    uint16_t version;     // GS_METRICS_SUMMARY_VERSION
+    uint16_t count;       // Entries in hist.
+    uint32_t interval_ms; // What the counts and quantiles cover.
+    gs_metrics_hist_summary_t hist[METRIC_HISTOGRAMS];
+} gs_metrics_summary_t;
+
+typedef struct
+{
+    bool enabled;
+    uint32_t interval_ms;
+    uint32_t sample_every; // Timed intervals per sample, 1 to time every one.
+    gs_metrics_shard_t *shards; // METRICS_SHARDS_MAX of them.
+    std::atomic<uint32_t> registered; // Shards handed out; each is named before this counts it.
+    pthread_mutex_t register_lock;
+
+    int tcp_fd;  // Listening on the loopback interface, -1 for none.
+    int unix_fd; // -1 for none.
+    char unix_path[108];
+
+    gs_seqlock<gs_metrics_summary_t> summary[1]; // Latest interval, published by the metrics thread.
+    std::atomic<uint32_t> scrapes;               // Responses served.
+} gs_metrics_t;
+
+/**
+ * @brief The calling thread's shard, NULL if it has not registered.
+ *
+ */
+extern __thread gs_metrics_shard_t *gs_metrics_local;
+
+/**
+ * @brief Timed intervals the calling thread skips before it samples the next one.
+ *
+ */
+extern __thread uint32_t gs_metrics_skip;
+
+/**
+ * @brief Allocates the shards and opens the listening sockets.
+ *
+ * @param metrics
+ * @param enabled If false, nothing is allocated and every thread records nothing.
+ * @param interval_ms How often the shards are summed.
+ * @param sample_every Time one in this many intervals passed to gs_metrics_begin(...); 1 times them all.
+ * @param port Loopback TCP port to serve the text exposition on, 0 for none.
+ * @param unix_path Unix socket to serve it on, NULL or empty for none.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_metrics_init(gs_metrics_t *metrics, bool enabled, uint32_t interval_ms, uint32_t sample_every, uint16_t port, const char *unix_path);
+
+/**
+ * @brief Closes the sockets and frees the shards. Every registered thread must have returned.
+ *
+ * @param metrics
+ */
+void gs_metrics_destroy(gs_metrics_t *metrics);
+
+/**
+ * @brief Gives the calling thread its shard: the one already carrying this name, if any, so that a thread restarted
+ * under the same name carries on its predecessor's counts. Only one live thread may use a name at a time.
+ *
+ * @param metrics
+ * @param name Label in the exposition, e.g. "rx".
+ * @return int 1 on success, 0 if metrics are disabled, negative if the shards are used up.
+ */
+int gs_metrics_register(gs_metrics_t *metrics, const char *name);
+
+/**
+ * @brief Histogram bucket for a value.
+ *
+ * @param value
+ * @return uint32_t
+ */
+static inline uint32_t gs_metrics_bucket(uint64_t value)
+{
+    if (value < METRICS_SUB_BUCKETS)
+    {
+        return (uint32_t)value;
+    }
+    uint32_t msb = 63 - __builtin_clzll(value);
+    if (msb >= METRICS_MAX_BITS)
+    {
+        return METRICS_BUCKETS - 1;
+    }
+    return (msb - METRICS_SUB_BITS + 1) * METRICS_SUB_BUCKETS + (uint32_t)((value >> (msb - METRICS_SUB_BITS)) & (METRICS_SUB_BUCKETS - 1));
+}
+
+/**
+ * @brief Largest value that lands in a bucket.
+ *
+ * @param bucket
+ * @return uint64_t
+ */
+static inline uint64_t gs_metrics_bucket_max(uint32_t bucket)
+{
+    if (bucket < METRICS_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    uint32_t shift = bucket / METRICS_SUB_BUCKETS - 1;
+    return (((uint64_t)(METRICS_SUB_BUCKETS + bucket % METRICS_SUB_BUCKETS + 1)) << shift) - 1;
+}
+
+/**
+ * @brief Records a value in the calling thread's histogram.
+ *
+ * @param hist
+ * @param value_ns
+ */
+static inline void gs_metrics_record(gs_metric_hist hist, uint64_t value_ns)
+{
+    gs_metrics_shard_t *shard = gs_metrics_local;
+    if (shard == NULL)
+    {
+        return;
+    }
+    // Only this thread writes the shard: a plain load and store, not an atomic increment.
+    std::atomic<uint32_t> *bucket = &shard->buckets[hist][gs_metrics_bucket(value_ns)];
+    bucket->store(bucket->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    shard->sums[hist].store(shard->sums[hist].load(std::memory_order_relaxed) + value_ns, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Adds to one of the calling thread's counters.
+ *
+ * @param counter
+ * @param n
+ */
+static inline void gs_metrics_count(gs_metric_counter counter, uint64_t n)
+{
+    gs_metrics_shard_t *shard = gs_metrics_local;
+    if (shard == NULL)
+    {
+        return;
+    }
+    shard->counters[counter].store(shard->counters[counter].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Start of an interval to be timed with gs_metrics_end(...), if this one is sampled.
+ *
+ * @return uint64_t CLOCK_MONOTONIC ns, or 0 without reading the clock if this thread records nothing or the interval is
+ * not sampled.
+ */
+static inline uint64_t gs_metrics_begin()
+{
+    gs_metrics_shard_t *shard = gs_metrics_local;
+    if (shard == NULL)
+    {
+        return 0;
+    }
+    if (gs_metrics_skip > 0)
+    {
+        gs_metrics_skip--;
+        return 0;
+    }
+    gs_metrics_skip = shard->sample_every - 1;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Records a sampled interval that ended at a time the caller read anyway.
+ *
+ * @param hist
+ * @param begin From gs_metrics_begin(...); nothing is recorded if 0.
+ * @param end_ns CLOCK_MONOTONIC ns.
+ */
+static inline void gs_metrics_end_at(gs_metric_hist hist, uint64_t begin, uint64_t end_ns)
+{
+    if (begin == 0)
+    {
+        return;
+    }
+    gs_metrics_record(hist, end_ns > begin ? end_ns - begin : 0);
+}
+
+/**
+ * @brief Records the time since gs_metrics_begin(...), if the interval was sampled.
+ *
+ * @param hist
+ * @param begin
+ */
+static inline void gs_metrics_end(gs_metric_hist hist, uint64_t begin)
+{
+    if (begin == 0)
+    {
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    gs_metrics_end_at(hist, begin, (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+/**
+ * @brief Metrics thread: sums the shards every interval_ms and serves the exposition, at low priority. Returns once
+ * thread_status goes negative, like the network loop.
+ *
+ * @param args global_data_t
+ * @return void*
+ */
+void *gs_metrics_thread(void *args);
+
+/**
+ * @brief The latest interval's summary, for status frames.
+ *
+ * @param metrics
+ * @param summary
+ * @return bool false if no interval has been summed yet.
+ */
+bool gs_metrics_summary(gs_metrics_t *metrics, gs_metrics_summary_t *summary);
+
+#endif // GS_METRICS_HPP
@@ -0,0 +1,113 @@
+/**
+ * @file gs_netloop.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Single epoll-driven thread for everything haystack does with the GS server except sending received data.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * One thread waits on the server socket, a timerfd armed for the earliest deadline (reconnect, keepalive poll, server
+ * silence, status frame due), and each receive chain's status engine eventfd, which gs_status_notify(...) writes from
+ * the capture stage, the command handlers and anywhere else. It replaces the polling, network-receive and
+ * status threads and the supervisor in main(), which tore all of them down and waited 5 seconds whenever any one of
+ * them gave up.
+ *
+ * A lost connection (the server closing it, a receive error, or nothing heard for timeout_ms) is re-established in
+ * place: the socket is closed, and a non-blocking connect is retried after backoff_min_ms, doubling to
+ * backoff_max_ms. The capture, forwarding and recording stages keep running throughout; frames forwarded while
+ * disconnected are spooled (gs_spool.hpp) if the spool is enabled, and lost otherwise.
+ *
+ * Configurations and commands from the server are queued for each chain's hardware executor (gs_hwexec.hpp), which
+ * also brings up the radios, so that the loop never waits on the hardware.
+ *
+ * Incoming frames are decoded without blocking when NetFrame's encoding is the one gs_uplink.hpp mirrors; otherwise
+ * the loop falls back to NetFrame::recvFrame(...) on the (blocking, receive-timeout) socket once it is readable.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+// CHAINS_MAX. Outside the guard, since gs_config.hpp includes this header in turn and must get to define it first.
+#include "gs_config.hpp"
+
+#ifndef GS_NETLOOP_HPP
+#define GS_NETLOOP_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include "buffer_pool.hpp"
+
+#define NETLOOP_POLL_MS_DEFAULT 5000
+#define NETLOOP_TIMEOUT_MS_DEFAULT 15000
+#define NETLOOP_BACKOFF_MIN_MS_DEFAULT 10
+#define NETLOOP_BACKOFF_MAX_MS_DEFAULT 5000
+
+typedef enum
+{
+    NET_DISCONNECTED = 0, // Waiting to reconnect.
+    NET_CONNECTING = 1,   // Non-blocking connect in progress.
+    NET_CONNECTED = 2,
+} net_state;
+
+typedef struct
+{
+    // Settings, fixed after gs_netloop_init(...).
+    uint32_t poll_ms;        // Keepalive POLL interval.
+    uint32_t timeout_ms;     // Server silence, or connect time, after which the connection is abandoned.
+    uint32_t backoff_min_ms; // First reconnect delay.
+    uint32_t backoff_max_ms; // Reconnect delay cap.
+
+    // Owned by the loop thread.
+    int epfd;
+    int timer_fd; // timerfd, CLOCK_MONOTONIC, armed for the earliest deadline.
+    int fd;       // Socket being connected or connected, -1 if none.
+    net_state state;
+    uint32_t backoff_ms;
+    uint64_t reconnect_at;    // NET_DISCONNECTED: when to try again.
+    uint64_t connect_by;      // NET_CONNECTING: when to give up.
+    uint64_t poll_at;         // NET_CONNECTED: next keepalive.
+    uint64_t last_heard;      // NET_CONNECTED: last time anything arrived from the server.
+    uint64_t disconnected_at; // Start of the current outage.
+    uint64_t status_at[CHAINS_MAX]; // Next time each chain's status engine wants to be asked.
+    uint8_t *rx_buf; // Partial frame being decoded.
+    size_t rx_len;
+    size_t rx_cap;
+    size_t rx_skip; // Bytes of an oversized frame still to discard.
+
+    // Counters, read for status frames.
+    std::atomic<uint32_t> reconnects;     // Connections established after the first.
+    std::atomic<uint32_t> last_outage_ms; // Disconnected time before the latest reconnect.
+    std::atomic<uint32_t> bad_frames;     // Received frames discarded as malformed or too large.
+} gs_netloop_t;
+
+/**
+ * @brief Sets up the loop's descriptors. Does not connect.
+ *
+ * @param loop
+ * @param status_fds Status engine eventfd (gs_status_t::wake_fd) of each receive chain, to watch.
+ * @param status_count 1 to CHAINS_MAX.
+ * @param max_payload Largest payload that will be accepted from the server, normally the pool buffer size.
+ * @param poll_ms
+ * @param timeout_ms
+ * @param backoff_min_ms
+ * @param backoff_max_ms
+ * @return int 1 on success, negative on failure.
+ */
+int gs_netloop_init(gs_netloop_t *loop, const int *status_fds, uint32_t status_count, uint32_t max_payload, uint32_t poll_ms, uint32_t timeout_ms, uint32_t backoff_min_ms, uint32_t backoff_max_ms);
+
+/**
+ * @brief Closes the loop's descriptors. The loop thread must have exited.
+ *
+ * @param loop
+ */
+void gs_netloop_destroy(gs_netloop_t *loop);
+
+/**
+ * @brief Runs the network loop until network_data->thread_status goes negative.
+ *
+ * @param args global_data_t
+ * @return void*
+ */
+void *gs_netloop_thread(void *args);
+
+#endif // GS_NETLOOP_HPP
@@ -0,0 +1,101 @@
+/**
+ * @file gs_radio.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Timestamped snapshots of the radio's status attributes, read in as few libiio operations as possible.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Reading the status one adradio_get_*(...) at a time costs eight attribute accesses, each a sysfs read (or an iiod
+ * round trip when the context is remote), and the values come from eight different instants. The batched reader
+ * opens its own libiio context on the AD9361 and fetches each channel's attributes with a single
+ * iio_*_attr_read_all(...): four operations for the whole snapshot. If no context can be opened, snapshots fall back
+ * to the per-attribute adradio_* path, so callers need not care which one is in use.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_RADIO_HPP
+#define GS_RADIO_HPP
+
+#include <stdint.h>
+#include "libiio.h"
+
+// radio_snapshot_t::valid
+#define RADIO_ATTR_MODE 0x01
+#define RADIO_ATTR_LO 0x02
+#define RADIO_ATTR_SAMP 0x04
+#define RADIO_ATTR_BW 0x08
+#define RADIO_ATTR_GAIN 0x10
+#define RADIO_ATTR_GAINMODE 0x20
+#define RADIO_ATTR_RSSI 0x40
+#define RADIO_ATTR_TEMP 0x80
+#define RADIO_ATTR_ALL 0xFF
+
+/**
+ * @brief The radio's status attributes at one moment.
+ *
+ */
+typedef struct
+{
+    uint64_t timestamp; // CLOCK_MONOTONIC ns, halfway through the read.
+    uint32_t read_ns;   // How long the read took: the most the values' instants can differ by.
+    uint32_t valid;     // RADIO_ATTR_* read successfully; the others are zero.
+    int mode;           // ensm_mode, -1 if unknown.
+    int64_t LO;         // Hz
+    int64_t samp;       // Samples per second
+    int64_t bw;         // Hz
+    double gain;        // dB
+    char gainmode[16];  // "slow_attack", "fast_attack", ...
+    double rssi;        // dB
+    int64_t temp;       // millidegrees C
+} radio_snapshot_t;
+
+struct iio_context;
+struct iio_device;
+struct iio_channel;
+
+typedef struct
+{
+    struct iio_context *ctx; // NULL: snapshots use the per-attribute path.
+    struct iio_device *phy;
+    struct iio_channel *rx;   // voltage0, input
+    struct iio_channel *lo;   // altvoltage0, output
+    struct iio_channel *temp; // temp0, input
+} gs_radio_reader_t;
+
+/**
+ * @brief Opens a libiio context for batched reads.
+ *
+ * @param reader
+ * @return int 1 if batched reads are available, -1 if snapshots will use the per-attribute path.
+ */
+int gs_radio_reader_init(gs_radio_reader_t *reader);
+
+/**
+ * @brief Closes the reader's libiio context, if any.
+ *
+ * @param reader
+ */
+void gs_radio_reader_destroy(gs_radio_reader_t *reader);
+
+/**
+ * @brief Takes a snapshot, batched if the reader has a context, one adradio_get_*(...) per attribute otherwise.
+ *
+ * @param reader
+ * @param radio Used by the per-attribute path.
+ * @param snap
+ * @return int 1 if every attribute was read, -1 if some were not (see snap->valid).
+ */
+int gs_radio_snapshot(gs_radio_reader_t *reader, adradio_t *radio, radio_snapshot_t *snap);
+
+/**
+ * @brief Takes a snapshot one adradio_get_*(...) per attribute.
+ *
+ * @param radio
+ * @param snap
+ * @return int 1 if every attribute was read, -1 if some were not (see snap->valid).
+ */
+int gs_radio_snapshot_each(adradio_t *radio, radio_snapshot_t *snap);
+
+#endif // GS_RADIO_HPP
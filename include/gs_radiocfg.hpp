@@ -0,0 +1,192 @@
+/**
+ * @file gs_radiocfg.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Applies XBAND_CONFIG frames to a chain's radio: only what changed, in a fixed order, undone on failure.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Each chain keeps the configuration last applied to its radio. A new one is compared against it setting by setting,
+ * and only the settings that differ are written; a frame that changes nothing touches no hardware. Retuning the LO
+ * or changing the sample rate makes the AD9361 recalibrate, which stalls reception for tens of milliseconds, so a
+ * frame resent unchanged, or changing only the gain mode, no longer costs that.
+ *
+ * Changed settings are written in this order:
+ *
+ *  1. the ENSM mode, if it is going to sleep: nothing after it then disturbs a live receiver.
+ *  2. the gain control mode, or a manual RX gain, and the TX gain: register writes, no calibration.
+ *  3. the FIR filter, before the sample rate whose decimation it sets.
+ *  4. the sample rate.
+ *  5. the RF bandwidth, whose calibration runs against the baseband clocks the rate sets.
+ *  6. the RX LO, whose calibrations then run once, against the final clocks.
+ *  7. the ENSM mode, if it is not going to sleep: the receiver comes up already tuned.
+ *
+ * If a write fails, the ones already made are undone in reverse order, back to the previous configuration. If that
+ * fails too, or there was no previous configuration, the radio's state is unknown, and the next frame writes
+ * everything.
+ *
+ * Configuration frames come from the network loop, and LO and gain retunes from the schedule thread (gs_schedule.hpp);
+ * the engine applies one at a time.
+ *
+ * Filters are <filter_dir>/<ftr_name>.ftr files, in the AD9361 filter wizard's format. Each is parsed and checked
+ * once, before any hardware is touched, and kept in memory until the file changes; loading it is then a single write
+ * of the cached text to the driver's filter_fir_config attribute, over a libiio context of the engine's own. Without a
+ * context, filters are loaded by file name through adradio_load_fir(...).
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_RADIOCFG_HPP
+#define GS_RADIOCFG_HPP
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <atomic>
+#include "libiio.h"
+#include "phy.hpp"
+
+#define RADIOCFG_FILTER_DIR_DEFAULT "/home/sunip"
+#define RADIOCFG_FIR_CACHE_DEFAULT 4
+#define RADIOCFG_FIR_CACHE_MAX 16
+#define RADIOCFG_TX_GAIN_DB -85 // haystack only receives.
+
+// Settings, for phy_config_ack_t::changed, ::applied and ::failed.
+#define RADIOCFG_MODE 0x01
+#define RADIOCFG_GAINMODE 0x02
+#define RADIOCFG_TXGAIN 0x04
+#define RADIOCFG_FIR 0x08
+#define RADIOCFG_SAMP 0x10
+#define RADIOCFG_BW 0x20
+#define RADIOCFG_LO 0x40
+#define RADIOCFG_RXGAIN 0x80
+#define RADIOCFG_ALL 0xFF
+
+/**
+ * @brief A radio's configuration, as the engine applies it.
+ *
+ */
+typedef struct
+{
+    int mode;          // ensm_mode
+    gain_mode gainmode; // Unless manual_gain.
+    bool manual_gain;   // Hold the RX gain at rx_gain, rather than let the AGC set it.
+    double rx_gain;     // dB
+    char ftr_name[64]; // Empty: no filter.
+    int64_t samp;      // Samples per second
+    int64_t bw;        // Hz
+    int64_t LO;        // Hz
+} radiocfg_settings_t;
+
+/**
+ * @brief A parsed and checked filter file.
+ *
+ */
+typedef struct
+{
+    char name[64];      // ftr_name; empty if the entry is unused.
+    dev_t dev;          // The file parsed, and its state then; a change to any of them means parsing it again.
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    char *text;         // The whole file, as written to filter_fir_config.
+    size_t len;
+    uint32_t taps;
+    int decimation;     // RX decimation, 1, 2 or 4.
+    uint64_t gen;       // Distinct for every file parsed, so that a filter changed on disk is loaded again.
+    uint64_t last_used; // For eviction, least recently used first.
+} radiocfg_fir_t;
+
+struct iio_context;
+struct iio_device;
+
+typedef struct
+{
+    adradio_t *radio;
+    char filter_dir[128];
+    pthread_mutex_t lock; // Held for each configuration or retune, and everything below but the counters.
+
+    radiocfg_settings_t applied[1];
+    bool applied_valid; // False until the first configuration succeeds, and after a failed rollback.
+    uint64_t applied_fir; // radiocfg_fir_t::gen of the filter loaded, 0 if none.
+
+    radiocfg_fir_t *fir; // fir_count entries.
+    uint32_t fir_count;
+    uint64_t fir_clock; // Advanced by every lookup and every parse.
+
+    struct iio_context *ctx; // Opened on the first filter load or manual gain; NULL: filters load through
+                             // adradio_load_fir(...), and manual gain is unavailable.
+    struct iio_device *phy;
+    struct iio_channel *rx; // voltage0, input
+    bool ctx_opened;
+
+    // Counters, read by the network loop for status frames.
+    std::atomic<uint32_t> applies;    // Configurations and retunes fully applied.
+    std::atomic<uint32_t> unchanged;  // Configurations that changed nothing.
+    std::atomic<uint32_t> failures;   // Configurations refused or failed.
+    std::atomic<uint32_t> rollbacks;  // Failed configurations undone.
+    std::atomic<uint32_t> fir_hits;   // Filters found parsed in the cache.
+    std::atomic<uint32_t> fir_parses; // Filter files parsed.
+    std::atomic<uint32_t> last_apply_us; // Latest configuration, including any rollback.
+} gs_radiocfg_t;
+
+/**
+ * @brief Sets up a chain's configuration engine. Nothing is known to be applied yet.
+ *
+ * @param cfg
+ * @param radio
+ * @param filter_dir Where <ftr_name>.ftr files are.
+ * @param fir_cache Filters kept parsed, 1 to RADIOCFG_FIR_CACHE_MAX.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_radiocfg_init(gs_radiocfg_t *cfg, adradio_t *radio, const char *filter_dir, uint32_t fir_cache);
+
+/**
+ * @brief Frees the filter cache and closes the engine's libiio context.
+ *
+ * @param cfg
+ */
+void gs_radiocfg_destroy(gs_radiocfg_t *cfg);
+
+/**
+ * @brief Reads the settings out of a configuration frame.
+ *
+ * @param config
+ * @param settings
+ */
+void gs_radiocfg_settings(const phy_config_t *config, radiocfg_settings_t *settings);
+
+/**
+ * @brief Applies the settings that differ from the applied configuration, rolling back on failure.
+ *
+ * @param cfg
+ * @param want
+ * @param ack Filled in for the ACK or NACK, apart from chain.
+ * @return int 1 if applied, 0 if nothing changed, negative on failure (-1 a write failed and was undone, -2 it could
+ * not be undone, -3 the filter could not be read or parsed, and nothing was written).
+ */
+int gs_radiocfg_apply(gs_radiocfg_t *cfg, const radiocfg_settings_t *want, phy_config_ack_t *ack);
+
+/**
+ * @brief Changes the LO and/or the manual RX gain of the configuration in effect, through gs_radiocfg_apply(...).
+ *
+ * @param cfg
+ * @param LO Hz, 0 to leave it.
+ * @param gain dB, NULL to leave it.
+ * @param ack
+ * @param applied Set to the settings now in effect, if not NULL.
+ * @return int As gs_radiocfg_apply(...); -4 if no configuration has been applied to build on.
+ */
+int gs_radiocfg_retune(gs_radiocfg_t *cfg, int64_t LO, const double *gain, phy_config_ack_t *ack, radiocfg_settings_t *applied);
+
+/**
+ * @brief Copies out the configuration in effect.
+ *
+ * @param cfg
+ * @param applied
+ * @return bool Whether it is known.
+ */
+bool gs_radiocfg_applied(gs_radiocfg_t *cfg, radiocfg_settings_t *applied);
+
+#endif // GS_RADIOCFG_HPP
@@ -0,0 +1,186 @@
+/**
+ * @file gs_recorder.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Asynchronous raw-capture recorder, writing received frames to rolling capture segments.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The capture stage shares each received frame with the recorder through its own frame ring; the recorder thread
+ * batches frames and appends them to the current segment with a single writev(...) per batch. Segments roll over at a
+ * configurable size and are never overwritten: each is named after the wall-clock time the recorder started. With
+ * max_segments set, starting a segment first deletes the oldest ones in the directory, whichever recording they
+ * belong to, so that at most max_segments remain.
+ *
+ * Segment layout:
+ *  capture_segment_hdr_t
+ *  { capture_record_t, payload[length] } ...
+ *
+ * All fields are little-endian.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+// CHAINS_MAX. Outside the guard, since gs_config.hpp includes this header in turn and must get to define it first.
+#include "gs_config.hpp"
+
+#ifndef GS_RECORDER_HPP
+#define GS_RECORDER_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "frame_ring.hpp"
+
+#define CAPTURE_SEGMENT_MAGIC "HAYSTCAP"
+#define CAPTURE_SEGMENT_VERSION 1
+#define CAPTURE_RECORD_SYNC 0x43524853 // "SHRC"
+#define CAPTURE_GAIN_MANUAL 0xFF // capture_radio_t::gain_mode of a radio held at a manual RX gain.
+
+#define RECORDER_BATCH_MAX 128
+
+/**
+ * @brief Written once at the start of every segment.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    char magic[8];             // CAPTURE_SEGMENT_MAGIC, not NUL-terminated.
+    uint16_t version;          // CAPTURE_SEGMENT_VERSION
+    uint16_t header_size;      // sizeof(capture_segment_hdr_t)
+    uint16_t record_size;      // sizeof(capture_record_t)
+    uint16_t reserved;
+    uint32_t segment_index;    // Position of this segment within the recording.
+    uint64_t realtime_ns;      // CLOCK_REALTIME when the segment was opened,
+    uint64_t monotonic_ns;     // and CLOCK_MONOTONIC at the same instant, to map record timestamps to wall-clock time.
+} capture_segment_hdr_t;
+
+/**
+ * @brief Radio configuration in effect when a frame was captured.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    int64_t LO;        // Hz
+    int64_t samp;      // Samples per second
+    int64_t bw;        // Hz
+    int8_t mode;       // ensm_mode, -1 if never configured.
+    uint8_t gain_mode; // SLOW_ATTACK, FAST_ATTACK or CAPTURE_GAIN_MANUAL
+    uint8_t chain;     // Receive chain the frame came from.
+    uint8_t reserved;
+} capture_radio_t;
+
+/**
+ * @brief Precedes every frame in a segment.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t sync;       // CAPTURE_RECORD_SYNC, for resynchronizing on a damaged file.
+    uint32_t length;     // Payload bytes following this header.
+    uint64_t timestamp;  // CLOCK_MONOTONIC time of capture, in nanoseconds.
+    uint32_t seq;        // Record number within the recording; gaps mean frames the recorder dropped.
+    capture_radio_t radio;
+} capture_record_t;
+
+typedef enum
+{
+    FSYNC_NONE = 0,     // Leave it to the kernel.
+    FSYNC_SEGMENT = 1,  // fsync when a segment is closed.
+    FSYNC_INTERVAL = 2, // fsync at most every fsync_interval_ms, and when a segment is closed.
+    FSYNC_BATCH = 3,    // fsync after every batch.
+} fsync_policy;
+
+typedef struct
+{
+    frame_ring_t ring[1]; // Capture stage -> recorder.
+
+    // Settings, fixed after gs_recorder_init(...).
+    char directory[256];
+    char prefix[64];           // Segment file names are <directory>/<prefix>_<index>.hcap
+    uint64_t segment_size;     // Bytes after which a new segment is started.
+    uint32_t max_segments;     // Segments kept in the directory; 0 for all.
+    uint32_t batch_frames;     // Frames per writev(...), at most RECORDER_BATCH_MAX.
+    uint32_t batch_ms;         // Longest a frame waits for its batch to fill.
+    fsync_policy fsync;
+    uint32_t fsync_interval_ms;
+
+    // Owned by the recorder thread.
+    int fd;
+    uint32_t segment_index;
+    uint64_t segment_bytes;
+    uint64_t last_fsync;
+    uint32_t seq;
+
+    // The ring has one producer; with several receive chains their capture stages take turns under submit_lock.
+    bool shared;
+    pthread_mutex_t submit_lock;
+
+    // Radio configuration of each chain, tagged onto its records, set by whoever applies a configuration.
+    pthread_mutex_t radio_lock;
+    capture_radio_t radio[CHAINS_MAX];
+
+    // Counters, read by the network loop for status frames.
+    std::atomic<uint32_t> records;
+    std::atomic<uint32_t> write_errors;
+} gs_recorder_t;
+
+/**
+ * @brief Sets up a recorder. No file is opened until the first frame arrives.
+ *
+ * @param rec
+ * @param pool Pool the recorded frames come from.
+ * @param ring_slots Frames the recorder may fall behind by before frames are dropped from the recording.
+ * @param directory
+ * @param segment_size
+ * @param max_segments Segments kept in the directory, the oldest deleted first; 0 for all.
+ * @param batch_frames
+ * @param batch_ms
+ * @param fsync
+ * @param fsync_interval_ms
+ * @param producers Capture stages that will submit frames.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_recorder_init(gs_recorder_t *rec, buffer_pool_t *pool, uint32_t ring_slots, const char *directory, uint64_t segment_size, uint32_t max_segments, uint32_t batch_frames, uint32_t batch_ms, fsync_policy fsync, uint32_t fsync_interval_ms, uint32_t producers);
+
+/**
+ * @brief Closes the current segment and frees the recorder. The recorder thread must have exited.
+ *
+ * @param rec
+ */
+void gs_recorder_destroy(gs_recorder_t *rec);
+
+/**
+ * @brief Capture stage: queues a frame for recording. Never blocks; drops the frame from the recording if the recorder has fallen behind.
+ *
+ * @param rec
+ * @param frame A shared handle (PoolBuffer::share()), emptied by this call.
+ */
+void gs_recorder_submit(gs_recorder_t *rec, PoolBuffer &frame);
+
+/**
+ * @brief Updates the radio configuration tagged onto subsequent records of one chain.
+ *
+ * @param rec
+ * @param radio Its 'chain' says which.
+ */
+void gs_recorder_set_radio(gs_recorder_t *rec, const capture_radio_t *radio);
+
+/**
+ * @brief Recorder thread. Runs until thread_status drops, flushing whatever it holds before returning.
+ *
+ * @param args global_data_t
+ * @return void*
+ */
+void *gs_recorder_thread(void *args);
+
+/**
+ * @brief Parses "none", "segment", "interval" or "batch".
+ *
+ * @param name
+ * @param policy Set on success.
+ * @return int 1 on success, -1 if the name is not recognized.
+ */
+int gs_recorder_fsync_from_string(const char *name, fsync_policy *policy);
+
+#endif // GS_RECORDER_HPP
@@ -0,0 +1,104 @@
+/**
+ * @file gs_replay.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Replays captured frames into the receive chains in place of the capture stages, for regression and load
+ * testing.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * With [replay] files set, haystack starts the replay thread instead of the capture stages. The thread memory-maps
+ * each file in turn and hands its frames to the chains' receive rings as a capture stage would (pool buffer, rx_ring,
+ * the rx_* counters), so that everything from the forwarding stages on runs as it does live, whether the radios are
+ * there or not. Arm and disarm commands are refused (NACK), since there is no capture stage to start or stop. Nothing
+ * is recorded while replaying: the frames are recordings already, and the recorder's max_segments could delete the
+ * very files being replayed.
+ *
+ * Files are replayed in version order (rxdata2.bin before rxdata10.bin, _0002.hcap before _0010.hcap) and may be of
+ * either kind:
+ *  - capture segments (gs_recorder.hpp): each record goes to the chain it was captured on, folded onto the chains
+ *    configured, at its recorded time. A record whose sync word is wrong is skipped by scanning for the next one; a
+ *    truncated last record ends the file.
+ *  - anything else, e.g. rxdata*.bin: the whole file is one frame, for chain 0. These carry no time, so they are spaced
+ *    1 / rate_fps apart.
+ *
+ * Timing: with speed 1, frames are released as far apart as they were captured; with speed N, N times faster; with
+ * speed 0, as fast as the receive rings take them (with [rx] ring_policy = block, that is as fast as the forwarding
+ * stages can send, the forwarding path's sustainable rate). Gaps longer than max_gap_ms, such as between two
+ * recordings, are cut down to it. jitter_us moves every release by a random amount within +/- jitter_us, never before
+ * the frame ahead of it. With burst_frames N, frames are released N at a time, back to back, at the time the first of
+ * them is due, keeping the average rate but arriving in bursts. Runs with the same files, settings and seed release
+ * the same frames in the same pattern.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_REPLAY_HPP
+#define GS_REPLAY_HPP
+
+#include <stdint.h>
+#include <glob.h>
+#include <atomic>
+#include "buffer_pool.hpp"
+
+#define REPLAY_SPEED_DEFAULT 1.0
+#define REPLAY_RATE_FPS_DEFAULT 1000  // Frames per second of files that carry no time.
+#define REPLAY_MAX_GAP_MS_DEFAULT 1000
+#define REPLAY_LOOPS_DEFAULT 1
+#define REPLAY_IDLE_MS 1000 // Longest the thread sleeps at a time, so that it notices thread_status.
+
+typedef struct
+{
+    // Settings, fixed after gs_replay_init(...).
+    bool enabled; // Some files matched.
+    glob_t files; // Sorted.
+    double speed; // 1 as captured, N times faster, 0 as fast as possible.
+    uint32_t rate_fps;
+    uint32_t max_gap_ms;
+    uint32_t jitter_us;
+    uint32_t burst_frames; // 0 or 1 for none.
+    uint32_t loops;        // Passes over the files; 0 for as long as haystack runs.
+    uint32_t seed;
+
+    // Counters, read by the metrics thread.
+    std::atomic<uint64_t> frames;       // Handed to the receive rings.
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> dropped;      // Not handed on: the pool was exhausted, or a frame was larger than the MTU.
+    std::atomic<uint64_t> skipped;      // Bytes of capture segments skipped to find the next record.
+    std::atomic<uint32_t> worst_late_us; // Largest delay of a release past its time, e.g. behind a full receive ring.
+    std::atomic<bool> done;             // Every pass has been made.
+} gs_replay_t;
+
+/**
+ * @brief Finds the files to replay. With an empty pattern, nothing else is set up and enabled is false.
+ *
+ * @param replay
+ * @param pattern A glob.
+ * @param speed
+ * @param rate_fps Of files that carry no time.
+ * @param max_gap_ms
+ * @param jitter_us
+ * @param burst_frames
+ * @param loops
+ * @param seed
+ * @return int 1 on success, -1 if the pattern matches no file.
+ */
+int gs_replay_init(gs_replay_t *replay, const char *pattern, double speed, uint32_t rate_fps, uint32_t max_gap_ms, uint32_t jitter_us, uint32_t burst_frames, uint32_t loops, uint32_t seed);
+
+/**
+ * @brief Frees what gs_replay_init(...) set up. The replay thread must have returned.
+ *
+ * @param replay
+ */
+void gs_replay_destroy(gs_replay_t *replay);
+
+/**
+ * @brief Replays the files into the receive chains, then returns; or returns once thread_status drops. The capture
+ * stages must not be running.
+ *
+ * @param args global_data_t
+ * @return void*
+ */
+void *gs_replay_thread(void *args);
+
+#endif // GS_REPLAY_HPP
@@ -0,0 +1,96 @@
+/**
+ * @file gs_rxdma.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Keeps pool buffers posted to a chain's modem, so that its DMA engine is never waiting on the capture stage.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * With rxmodem_receive(...) and rxmodem_read(...), the modem transfers a frame only when asked to, and is idle while
+ * the capture stage hands the previous one on. Instead, the capture stage keeps [rx] dma_depth pool buffers posted
+ * to the modem's descriptor queue (rxmodem_queue.h). When the oldest is filled it takes it back, posts a fresh buffer
+ * in its place, and only then hands the filled one on: the frame is received straight into the buffer the rest of
+ * the pipeline gets, and the next transfers are already under way.
+ *
+ * A buffer is posted for every descriptor even when the pool is empty: the chain's drain buffer stands in, and the
+ * frame it receives is dropped, as it would have been read into the drain buffer and dropped before.
+ *
+ * The buffers stay posted while the chain is disarmed (the modem is stopped, so nothing is written to them, and
+ * rxmodem_start(...) discards what they held) and are taken back when the capture stage returns. A dma_depth of 0 or
+ * 1, or a modem without a queue, keeps the blocking receive.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_RXDMA_HPP
+#define GS_RXDMA_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include "rxmodem.h"
+#include "rxmodem_queue.h"
+#include "buffer_pool.hpp"
+
+#define RX_DMA_DEPTH_DEFAULT 2
+
+/**
+ * @brief One chain's posted buffers. Capture stage only, apart from the counters.
+ *
+ */
+typedef struct
+{
+    rxmodem *modem;
+    buffer_pool_t *pool;
+    uint8_t *drain; // Posted in place of a pool buffer when the pool is empty.
+    uint32_t mtu;
+    uint32_t depth;  // Buffers to keep posted; decided against the modem on the first gs_rxdma_fill(...).
+    bool probed;
+    uint32_t posted; // Buffers the modem holds.
+    bool busy[RXMODEM_QUEUE_MAX];      // Slot holds a posted buffer; its tag is the slot index + 1.
+    uint32_t frames[RXMODEM_QUEUE_MAX]; // Pool index of the posted buffer (detached), POOL_INDEX_NONE for the drain buffer.
+
+    // Counters, read by the network loop for status frames.
+    std::atomic<uint32_t> active_depth; // Buffers kept posted, 0 while receiving blocking.
+    std::atomic<uint32_t> starved;      // Posts of the drain buffer for want of a pool buffer.
+} gs_rxdma_t;
+
+/**
+ * @brief Sets up a chain's posted buffers; none are posted until the capture stage first receives.
+ *
+ * @param dma
+ * @param modem
+ * @param pool
+ * @param drain MTU-sized.
+ * @param mtu
+ * @param depth Buffers to keep posted, up to RXMODEM_QUEUE_MAX; 0 or 1 for blocking receives.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_rxdma_init(gs_rxdma_t *dma, rxmodem *modem, buffer_pool_t *pool, uint8_t *drain, uint32_t mtu, uint32_t depth);
+
+/**
+ * @brief Capture stage, before each frame: tops up the posted buffers.
+ *
+ * @param dma
+ * @return bool Whether to take the frame with gs_rxdma_next(...); false to receive it blocking.
+ */
+bool gs_rxdma_fill(gs_rxdma_t *dma);
+
+/**
+ * @brief Capture stage: waits for the oldest posted buffer to be filled and takes it, posting another in its place.
+ *
+ * @param dma
+ * @param frame Set to the filled buffer, its size not yet set; empty if the frame was received into the drain buffer.
+ * @param frame_size Set to the size of the frame received, as rxmodem_receive(...) would have returned it.
+ * @param read_size Set to the bytes received into the buffer, as rxmodem_read(...) would have returned it.
+ * @return bool Whether a buffer was filled; false if the wait ran out (the modem is stopped, for instance).
+ */
+bool gs_rxdma_next(gs_rxdma_t *dma, PoolBuffer &frame, ssize_t *frame_size, ssize_t *read_size);
+
+/**
+ * @brief Capture stage, when it returns: takes every posted buffer back from the modem, and returns them to the pool.
+ *
+ * @param dma
+ */
+void gs_rxdma_release(gs_rxdma_t *dma);
+
+#endif // GS_RXDMA_HPP
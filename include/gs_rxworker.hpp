@@ -0,0 +1,136 @@
+/**
+ * @file gs_rxworker.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Arm/disarm state machine for the persistent X-Band capture thread.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The capture thread is started once and lives until shutdown. Arming and disarming only change its state, which it
+ * checks once per frame:
+ *
+ *  IDLE ---arm---> ARMED ---disarm---> DRAINING ---(worker finishes its frame)---> IDLE
+ *  any ---stop---> STOPPED (the worker returns)
+ *
+ * While IDLE the worker is parked on a condition variable, so re-arming costs one wake-up rather than a thread
+ * creation. Disarming never cancels the worker: the controller stops the modem so that a receive in progress returns,
+ * and waits (for at most a timeout) for the worker to hand its last frame on and report IDLE. A frame is therefore
+ * never abandoned half-read, with its pool buffer or the uplink in an unknown state.
+ *
+ * The time from each request to the worker acting on it is kept for status frames.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_RXWORKER_HPP
+#define GS_RXWORKER_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+
+#define RX_DISARM_TIMEOUT_MS_DEFAULT 500
+
+typedef enum
+{
+    RX_IDLE = 0,     // Parked; not touching the modem.
+    RX_ARMED = 1,    // Receiving.
+    RX_DRAINING = 2, // Disarm requested; finishing the frame in progress.
+    RX_STOPPED = 3,  // Shutting down.
+} rx_state;
+
+typedef struct
+{
+    std::atomic<int> state; // rx_state. The controller moves it to ARMED, DRAINING or STOPPED; the worker to IDLE.
+    pthread_mutex_t lock;   // Only for waiting on 'changed'.
+    pthread_cond_t changed; // CLOCK_MONOTONIC. Broadcast on every transition.
+    std::atomic<uint64_t> requested_at; // gs_monotonic_ns() of the latest arm or disarm.
+
+    // Counters, read by the network loop for status frames.
+    std::atomic<uint32_t> arms;
+    std::atomic<uint32_t> disarms;
+    std::atomic<uint32_t> arm_us;       // Latest arm, from the request to the worker receiving.
+    std::atomic<uint32_t> disarm_us;    // Latest disarm, from the request to the worker idle.
+    std::atomic<uint32_t> slow_disarms; // Disarms the controller stopped waiting for.
+} gs_rxworker_t;
+
+/**
+ * @brief Sets up the state machine, IDLE.
+ *
+ * @param worker
+ * @return int 1 on success, negative on failure.
+ */
+int gs_rxworker_init(gs_rxworker_t *worker);
+
+/**
+ * @brief Frees the state machine. The worker must have returned.
+ *
+ * @param worker
+ */
+void gs_rxworker_destroy(gs_rxworker_t *worker);
+
+/**
+ * @brief Controller: IDLE (or DRAINING, if the worker has not got there yet) -> ARMED. Does not wait.
+ *
+ * @param worker
+ * @return int 1 if armed, 0 if it already was, negative if stopped.
+ */
+int gs_rxworker_arm(gs_rxworker_t *worker);
+
+/**
+ * @brief Controller: ARMED -> DRAINING. Does not wait.
+ *
+ * @param worker
+ * @return int 1 on success, -1 if it was not armed.
+ */
+int gs_rxworker_drain(gs_rxworker_t *worker);
+
+/**
+ * @brief Controller: waits for a drained worker to go IDLE. Whatever blocks the worker (the modem) must have been told
+ * to return first.
+ *
+ * @param worker
+ * @param timeout_ms Longest to wait for the worker.
+ * @return int 1 once IDLE (or re-armed), 0 if the worker is still finishing its frame after timeout_ms (it will go
+ * IDLE when it does).
+ */
+int gs_rxworker_wait_idle(gs_rxworker_t *worker, uint32_t timeout_ms);
+
+/**
+ * @brief Controller: gs_rxworker_drain(...), then gs_rxworker_wait_idle(...).
+ *
+ * @param worker
+ * @param timeout_ms Longest to wait for the worker.
+ * @return int 1 once IDLE, 0 if the worker is still finishing its frame after timeout_ms (it will go IDLE when it
+ * does), -1 if it was not armed.
+ */
+int gs_rxworker_disarm(gs_rxworker_t *worker, uint32_t timeout_ms);
+
+/**
+ * @brief Controller: any -> STOPPED, waking the worker so that it returns.
+ *
+ * @param worker
+ */
+void gs_rxworker_stop(gs_rxworker_t *worker);
+
+/**
+ * @brief Worker: called before each frame. Returns at once while ARMED; otherwise reports IDLE and parks until armed
+ * or stopped.
+ *
+ * @param worker
+ * @return rx_state RX_ARMED to receive a frame, RX_STOPPED to return.
+ */
+rx_state gs_rxworker_wait(gs_rxworker_t *worker);
+
+/**
+ * @brief Whether the worker is armed (and not being disarmed).
+ *
+ * @param worker
+ * @return bool
+ */
+static inline bool gs_rxworker_armed(gs_rxworker_t *worker)
+{
+    return worker->state.load(std::memory_order_acquire) == RX_ARMED;
+}
+
+#endif // GS_RXWORKER_HPP
@@ -0,0 +1,118 @@
+/**
+ * @file gs_sched.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Real-time scheduling, core affinity and memory locking for haystack's threads, and capture deadline accounting.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Each thread applies its role's settings to itself when it starts: a core to pin to and a SCHED_FIFO priority (0
+ * leaves it under SCHED_OTHER). The capture and forwarding stages take their cores from their chain's section, the
+ * others from [sched]. The status engine runs in the network loop and has no thread of its own, so it is scheduled as
+ * the network role.
+ *
+ * main() touches every page of the spool and the scratch buffers once everything is allocated (the buffer pool is
+ * touched as it is allocated), so that the first frames through them do not take page faults, then locks the receive
+ * path's memory (mlock(...)): the buffer pool, the frame rings, the RAM spool and the scratch buffers. Nothing else is
+ * locked; in particular the disk spool and replayed capture segments are file mappings, and stay pageable.
+ *
+ * The capture stage has a deadline: from a receive returning to the next receive starting, it must read the frame and
+ * hand it on within [sched] capture_deadline_us, or the modem's FIFO fills behind it. Turnarounds over the deadline
+ * are counted per chain, with the worst one, and logged at most once a second.
+ *
+ * Failing to apply any of this (usually for want of CAP_SYS_NICE or CAP_IPC_LOCK) is logged and otherwise ignored.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_SCHED_HPP
+#define GS_SCHED_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define SCHED_CAPTURE_DEADLINE_US_DEFAULT 1000
+#define SCHED_DEADLINE_LOG_MS 1000 // Shortest time between deadline warnings from one chain.
+
+/**
+ * @brief Capture stage deadline, one per chain. Written by the capture stage, read by the network loop for status frames.
+ *
+ */
+typedef struct
+{
+    uint64_t budget_ns; // 0 for no deadline.
+    uint64_t logged_at; // Capture stage only.
+
+    std::atomic<uint32_t> missed;   // Turnarounds longer than budget_ns.
+    std::atomic<uint32_t> worst_us; // Longest turnaround seen.
+} gs_deadline_t;
+
+/**
+ * @brief Applies a role's core and priority to the calling thread.
+ *
+ * @param cpu Core to pin to, -1 for none.
+ * @param priority SCHED_FIFO priority, 1 to 99; 0 for SCHED_OTHER.
+ * @param name For the log, e.g. "capture stage of chain 0".
+ * @return int 1 if everything asked for was applied, negative otherwise.
+ */
+int gs_sched_apply(int cpu, int priority, const char *name);
+
+/**
+ * @brief Writes to every page of a region so that it is backed by memory before it is needed.
+ *
+ * @param base
+ * @param size
+ */
+void gs_sched_prefault(void *base, size_t size);
+
+/**
+ * @brief Keeps a region resident (mlock(...)).
+ *
+ * @param base NULL for nothing.
+ * @param size
+ * @param name For the log, e.g. "buffer pool".
+ * @return int 1 on success, negative on failure.
+ */
+int gs_sched_lock(const void *base, size_t size, const char *name);
+
+/**
+ * @brief Sets up a deadline.
+ *
+ * @param deadline
+ * @param budget_us 0 for none.
+ */
+void gs_deadline_init(gs_deadline_t *deadline, uint32_t budget_us);
+
+/**
+ * @brief Slow path of gs_deadline_check(...): counts and logs a missed deadline.
+ *
+ * @param deadline
+ * @param chain
+ * @param turnaround_ns
+ * @param now
+ */
+void gs_deadline_missed(gs_deadline_t *deadline, uint8_t chain, uint64_t turnaround_ns, uint64_t now);
+
+/**
+ * @brief Capture stage: counts one turnaround against the deadline.
+ *
+ * @param deadline
+ * @param chain For the log.
+ * @param turnaround_ns From the receive returning to the next receive starting.
+ * @param now gs_monotonic_ns()
+ */
+static inline void gs_deadline_check(gs_deadline_t *deadline, uint8_t chain, uint64_t turnaround_ns, uint64_t now)
+{
+    uint64_t us = turnaround_ns / 1000;
+    if (us > deadline->worst_us.load(std::memory_order_relaxed))
+    {
+        deadline->worst_us.store(us > UINT32_MAX ? UINT32_MAX : (uint32_t)us, std::memory_order_relaxed);
+    }
+    if (deadline->budget_ns > 0 && turnaround_ns > deadline->budget_ns)
+    {
+        gs_deadline_missed(deadline, chain, turnaround_ns, now);
+    }
+}
+
+#endif // GS_SCHED_HPP
@@ -0,0 +1,168 @@
+/**
+ * @file gs_schedule.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Time-tagged LO and RX gain schedules, e.g. Doppler tracking over a pass, applied to the radios on time.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The client computes a pass's Doppler curve beforehand and uploads it as a table of (time, LO, gain) entries, in one
+ * XBAND_COMMAND frame or, appended, in several (XBC_SCHEDULE_LOAD). The schedule thread then applies each entry at its
+ * time with gs_radiocfg_retune(...), which writes only the LO and/or the manual RX gain, and only if they differ from
+ * what is in effect; nothing goes over the network during the pass.
+ *
+ * Entry times are CLOCK_REALTIME (UTC), as the client computed them, so the host clock must be disciplined (NTP, PTP
+ * or GPS). The thread waits on a condition variable until SCHEDULE_SLACK_NS before an entry is due, so that a load or
+ * clear can wake it, then sleeps out the rest with clock_nanosleep(...) on an absolute time. Since retuning takes the
+ * AD9361 milliseconds of calibration, each chain's retune time is tracked (a moving average) and entries are started
+ * that much early, so that the retune completes at the entry's time.
+ *
+ * The timing error of each entry is the completion time less the entry's time. Its magnitude goes into the
+ * haystack_schedule_error_seconds histogram; the latest and the worst are reported in status frames. An entry whose
+ * successor is already due when the thread gets to it is not applied on its own: its LO and gain are merged into the
+ * latest due entry, and counted as skipped.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+// CHAINS_MAX. Outside the guard, since gs_config.hpp includes this header in turn and must get to define it first.
+#include "gs_config.hpp"
+
+#ifndef GS_SCHEDULE_HPP
+#define GS_SCHEDULE_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "buffer_pool.hpp"
+
+#define SCHEDULE_MAX_ENTRIES_DEFAULT 8192
+#define SCHEDULE_SLACK_NS 2000000ULL    // Left to clock_nanosleep(...) rather than the condition variable.
+#define SCHEDULE_IDLE_MS 1000           // Longest the thread waits, so that it notices thread_status.
+#define SCHEDULE_LEAD_MAX_NS 200000000LL // Entries are never started earlier than this.
+#define SCHEDULE_LEAD_WEIGHT 8          // Retune time average: each new retune counts for 1/SCHEDULE_LEAD_WEIGHT.
+#define SCHEDULE_LOG_MS 1000            // Shortest time between falling-behind warnings.
+
+#define SCHEDULE_GAIN_KEEP INT16_MIN // xband_schedule_entry_t::gain_cdb leaving the gain as it is.
+
+// xband_schedule_t::flags
+#define XBS_APPEND 0x01 // Add to the chain's schedule rather than replace it.
+
+/**
+ * @brief XBC_SCHEDULE_LOAD payload, followed by 'count' xband_schedule_entry_t. Little-endian.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    int32_t command;  // XBC_SCHEDULE_LOAD
+    uint8_t chain;
+    uint8_t flags;    // XBS_*
+    uint16_t count;   // Entries following.
+    int64_t epoch_ns; // CLOCK_REALTIME the entries' offsets count from, in ns since the Unix epoch.
+} xband_schedule_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t offset_us; // After epoch_ns; strictly increasing.
+    int64_t LO;         // Hz, 0 to leave it.
+    int16_t gain_cdb;   // Manual RX gain in hundredths of a dB, SCHEDULE_GAIN_KEEP to leave it.
+} xband_schedule_entry_t;
+
+/**
+ * @brief Sent back for XBC_SCHEDULE_LOAD and XBC_SCHEDULE_CLEAR, in an ACK if accepted and a NACK if not.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t chain;
+    int8_t result;    // 1 accepted; on a NACK: -1 malformed, -2 entry times not increasing or not after those already
+                      // loaded, -3 more entries than [schedule] max_entries, -4 no configuration applied to retune,
+                      // -8 the chain's hardware executor queue was full.
+    uint16_t reserved;
+    uint32_t pending; // Entries of the chain's schedule not yet applied.
+} xband_schedule_ack_t;
+
+typedef struct
+{
+    int64_t at_ns;    // CLOCK_REALTIME
+    int64_t LO;       // Hz, 0 to leave it.
+    int16_t gain_cdb; // SCHEDULE_GAIN_KEEP to leave it.
+} schedule_entry_t;
+
+/**
+ * @brief One chain's schedule. Everything but the counters is under gs_schedule_t::lock.
+ *
+ */
+typedef struct
+{
+    schedule_entry_t *entries; // capacity of them.
+    uint32_t capacity;
+    uint32_t count;            // Loaded.
+    uint32_t next;             // The first not yet applied.
+    uint64_t gen;              // Advanced by every load and clear, so that the thread drops an entry it was waiting for.
+    int64_t lead_ns;           // Average retune time; entries are started this early.
+
+    // Counters, read by the network loop for status frames.
+    std::atomic<uint32_t> pending;        // count - next
+    std::atomic<uint32_t> applied;        // Retunes made.
+    std::atomic<uint32_t> skipped;        // Entries merged into a later one that was already due.
+    std::atomic<uint32_t> failed;         // Retunes refused or failed.
+    std::atomic<int32_t> last_error_us;   // Latest retune's completion against its entry's time; negative if early.
+    std::atomic<uint32_t> worst_error_us; // Largest magnitude of it.
+} gs_schedule_table_t;
+
+typedef struct
+{
+    gs_schedule_table_t tables[CHAINS_MAX];
+    uint32_t chain_count;
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // CLOCK_MONOTONIC; signalled by every load and clear.
+} gs_schedule_t;
+
+/**
+ * @brief Allocates each chain's table.
+ *
+ * @param sched
+ * @param chain_count
+ * @param capacity Most entries per chain, [schedule] max_entries.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_schedule_init(gs_schedule_t *sched, uint32_t chain_count, uint32_t capacity);
+
+/**
+ * @brief Frees the tables. The schedule thread must have returned.
+ *
+ * @param sched
+ */
+void gs_schedule_destroy(gs_schedule_t *sched);
+
+/**
+ * @brief Loads entries into a chain's schedule, replacing it or appended to it. Nothing is changed on failure.
+ *
+ * @param sched
+ * @param chain
+ * @param epoch_ns CLOCK_REALTIME the offsets count from.
+ * @param entries Unaligned, as received.
+ * @param count
+ * @param append
+ * @return int 1 on success, negative as xband_schedule_ack_t::result.
+ */
+int gs_schedule_load(gs_schedule_t *sched, uint8_t chain, int64_t epoch_ns, const xband_schedule_entry_t *entries, uint32_t count, bool append);
+
+/**
+ * @brief Drops a chain's entries not yet applied. Leaves the radio as it is.
+ *
+ * @param sched
+ * @param chain
+ */
+void gs_schedule_clear(gs_schedule_t *sched, uint8_t chain);
+
+/**
+ * @brief Applies every chain's schedule as its entries come due. Returns once thread_status is -1.
+ *
+ * @param args global_data_t
+ * @return void*
+ */
+void *gs_schedule_thread(void *args);
+
+#endif // GS_SCHEDULE_HPP
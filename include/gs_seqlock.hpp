@@ -0,0 +1,120 @@
+/**
+ * @file gs_seqlock.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Single-writer sequence lock: publishes a small struct that readers copy out without blocking the writer.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The writer makes the sequence number odd, stores the value, and makes it even again; a reader copies the value
+ * between two loads of the sequence number and tries again if either was odd or they differ. The writer never waits
+ * and never takes a lock, so the capture stage can publish after every frame, and a reader costs it nothing beyond
+ * the cache line it shares with the value.
+ *
+ * The value is held as an array of std::atomic<uint64_t> words. A torn copy is thrown away, but it is never a data
+ * race. The words are stored with release and loaded with acquire, rather than ordered by standalone fences, which
+ * ThreadSanitizer does not understand; on x86 these cost nothing, on ARM a barrier per word.
+ *
+ * There must be only one writer at a time.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_SEQLOCK_HPP
+#define GS_SEQLOCK_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <atomic>
+#include <type_traits>
+#include "buffer_pool.hpp"
+
+template <typename T>
+struct gs_seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "gs_seqlock values are copied word by word");
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> seq; // Odd while a write is in progress.
+    std::atomic<uint64_t> words[(sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+
+    // Reader side, away from the writer's line.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> retries; // Copies thrown away because a write overlapped them.
+};
+
+/**
+ * @brief Publishes an all-zero value.
+ *
+ * @param lock
+ */
+template <typename T>
+static inline void gs_seqlock_init(gs_seqlock<T> *lock)
+{
+    lock->seq.store(0, std::memory_order_relaxed);
+    for (auto &word : lock->words)
+    {
+        word.store(0, std::memory_order_relaxed);
+    }
+    lock->retries.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writer: publishes a new value. Never blocks.
+ *
+ * @param lock
+ * @param value
+ */
+template <typename T>
+static inline void gs_seqlock_write(gs_seqlock<T> *lock, const T *value)
+{
+    uint64_t words[sizeof(lock->words) / sizeof(uint64_t)] = {0};
+    memcpy(words, value, sizeof(T));
+
+    uint32_t seq = lock->seq.load(std::memory_order_relaxed);
+    lock->seq.store(seq + 1, std::memory_order_relaxed);
+    for (size_t i = 0; i < sizeof(words) / sizeof(uint64_t); i++)
+    {
+        // Release: a reader that sees this word also sees the odd sequence number before it.
+        lock->words[i].store(words[i], std::memory_order_release);
+    }
+    lock->seq.store(seq + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Reader: copies out the latest complete value, retrying while a write overlaps. Any number of readers.
+ *
+ * @param lock
+ * @param value
+ * @return uint32_t The sequence number it was published with; changes with every write.
+ */
+template <typename T>
+static inline uint32_t gs_seqlock_read(gs_seqlock<T> *lock, T *value)
+{
+    uint64_t words[sizeof(lock->words) / sizeof(uint64_t)];
+
+    for (;;)
+    {
+        uint32_t before = lock->seq.load(std::memory_order_acquire);
+        if ((before & 1) == 0)
+        {
+            for (size_t i = 0; i < sizeof(words) / sizeof(uint64_t); i++)
+            {
+                // Acquire: keeps the second look at the sequence number below after this word.
+                words[i] = lock->words[i].load(std::memory_order_acquire);
+            }
+            if (lock->seq.load(std::memory_order_relaxed) == before)
+            {
+                memcpy(value, words, sizeof(T));
+                return before;
+            }
+        }
+        else
+        {
+            // The writer is part way through; let it finish rather than spin against it.
+            sched_yield();
+        }
+        lock->retries.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#endif // GS_SEQLOCK_HPP
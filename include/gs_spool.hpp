@@ -0,0 +1,193 @@
+/**
+ * @file gs_spool.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Outage spool: holds received frames while the server cannot take them, and gives them back in order.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Two byte rings of variable-length records: one in RAM, and one in a memory-mapped file that takes over when the RAM
+ * ring is full. New records go to the file while it holds anything, so that the RAM ring (always older) and then the
+ * file drain in the order the frames were received. The file's head and tail live in its first page, so frames still
+ * spooled when haystack stops are sent after it starts again.
+ *
+ * Only the forwarding stages use a spool, and they serialize on its lock; the spool functions do not take it.
+ *
+ * Every spooled frame carries its gs_seq_hdr_t, as sent: with spooling enabled, the forwarding stage puts one in front
+ * of every DATA item, live or replayed, so that the server can put them back in order and drop duplicates. Sequence
+ * numbers restart with every run of haystack, and each receive chain numbers its own frames; the session number tells
+ * runs and chains apart, and the chain number says which chain a frame came from.
+ *
+ * Spool file layout (little-endian):
+ *  spool_file_hdr_t, padded to SPOOL_FILE_HDR_SIZE
+ *  ring of { spool_record_t, gs_seq_hdr_t, payload, padding to SPOOL_ALIGN } ...
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_SPOOL_HPP
+#define GS_SPOOL_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <atomic>
+
+#define GS_SEQ_MAGIC 0x51455348 // "HSEQ"
+#define GS_SEQ_SPOOLED 0x0001   // gs_seq_hdr_t::flags: held back during an outage; later frames may already have arrived.
+#define GS_SEQ_COMPRESSED 0x0002 // gs_seq_hdr_t::flags: a gs_compress_hdr_t and the compressed frame follow (gs_compress.hpp).
+
+#define SPOOL_FILE_MAGIC "HAYSPOOL"
+#define SPOOL_FILE_VERSION 1
+#define SPOOL_FILE_HDR_SIZE 4096
+#define SPOOL_FILE_NAME "haystack_spool.bin"
+#define SPOOL_WRAP 0xFFFFFFFF // spool_record_t::length: the rest of the ring is unused, continue at its start.
+#define SPOOL_ALIGN 4         // Records start at multiples of this, so a spool_record_t never straddles the end.
+
+#define SPOOL_RAM_MB_DEFAULT 64
+#define SPOOL_DISK_MB_DEFAULT 2048
+#define SPOOL_DRAIN_BYTES_PER_SEC_DEFAULT 4194304
+
+typedef enum
+{
+    SPOOL_DRAIN_INTERLEAVED = 0, // Live frames go straight out; spooled frames fill the drain rate alongside them.
+    SPOOL_DRAIN_AHEAD = 1,       // Live frames join the back of the spool until it is empty, so the server sees them in order.
+} spool_drain_order;
+
+/**
+ * @brief Precedes a received frame in a sequenced DATA item.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;       // GS_SEQ_MAGIC
+    uint16_t flags;       // GS_SEQ_*
+    uint16_t header_size; // sizeof(gs_seq_hdr_t)
+    uint32_t session;     // Differs between runs of haystack.
+    uint64_t seq;         // Frame number within the session, from 0, with no gaps other than frames lost before the uplink.
+    uint64_t realtime_ns; // CLOCK_REALTIME time of capture.
+    uint8_t chain;        // Receive chain that captured it. Headers written before there were chains are 28 bytes and have none.
+    uint8_t reserved[3];
+} gs_seq_hdr_t;
+
+/**
+ * @brief Precedes every record in a spool ring.
+ *
+ */
+typedef struct
+{
+    uint32_t length; // Bytes of gs_seq_hdr_t and payload following, or SPOOL_WRAP.
+} spool_record_t;
+
+/**
+ * @brief First page of the spool file. Naturally aligned, so head and tail can be updated in place.
+ *
+ */
+typedef struct
+{
+    char magic[8];      // SPOOL_FILE_MAGIC, not NUL-terminated.
+    uint16_t version;   // SPOOL_FILE_VERSION
+    uint16_t reserved;
+    uint32_t reserved2;
+    uint64_t ring_size; // Bytes after SPOOL_FILE_HDR_SIZE.
+    uint64_t head;      // Bytes ever written; the write position is head % ring_size.
+    uint64_t tail;      // Bytes ever consumed; records in [tail, head) are pending.
+} spool_file_hdr_t;
+
+typedef struct
+{
+    uint8_t *base;
+    uint64_t size;  // A multiple of SPOOL_ALIGN; 0 if the ring is not in use.
+    uint64_t *head; // Into the file header for the spool file, to head_mem for the RAM ring.
+    uint64_t *tail;
+    uint64_t head_mem;
+    uint64_t tail_mem;
+} spool_ring_t;
+
+typedef struct
+{
+    bool enabled;
+    pthread_mutex_t lock; // Held by a forwarding stage from gs_spool_push(...) or gs_spool_peek(...) to the end of its use.
+    spool_ring_t ram[1];
+    spool_ring_t disk[1]; // size 0 if there is no spool file.
+    int disk_fd;
+    spool_file_hdr_t *disk_hdr;
+    size_t disk_map_size;
+
+    // Counters, read by the network loop for status frames.
+    std::atomic<uint32_t> spooled;   // Frames put in the spool.
+    std::atomic<uint32_t> spilled;   // Of those, frames that went to the file.
+    std::atomic<uint32_t> replayed;  // Frames sent from the spool.
+    std::atomic<uint32_t> dropped;   // Frames lost because the spool was full.
+    std::atomic<uint32_t> depth;     // Frames in the spool now.
+    std::atomic<uint64_t> depth_bytes;
+} gs_spool_t;
+
+/**
+ * @brief Allocates the RAM ring and opens (or creates) the spool file, picking up anything left in it.
+ *
+ * @param spool
+ * @param ram_mb RAM ring size, in MiB.
+ * @param disk_mb Spool file ring size, in MiB; 0 for none.
+ * @param directory Where the spool file lives.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_spool_init(gs_spool_t *spool, uint32_t ram_mb, uint32_t disk_mb, const char *directory);
+
+/**
+ * @brief Unmaps the spool file, leaving what it holds for the next run, and frees the RAM ring. Frames in the RAM
+ * ring are lost.
+ *
+ * @param spool
+ */
+void gs_spool_destroy(gs_spool_t *spool);
+
+/**
+ * @brief Appends a frame.
+ *
+ * @param spool
+ * @param seq Its sequence header; GS_SEQ_SPOOLED is set in the copy spooled.
+ * @param payload
+ * @param size
+ * @return int 1 if spooled, 0 if the spool is full and the frame was dropped.
+ */
+int gs_spool_push(gs_spool_t *spool, const gs_seq_hdr_t *seq, const uint8_t *payload, uint32_t size);
+
+/**
+ * @brief The oldest frame, as it should be sent: its gs_seq_hdr_t followed by the payload. Stays in the spool until
+ * gs_spool_pop(...).
+ *
+ * @param spool
+ * @param item Set to the frame.
+ * @return ssize_t Its size, 0 if the spool is empty.
+ */
+ssize_t gs_spool_peek(gs_spool_t *spool, const uint8_t **item);
+
+/**
+ * @brief Removes the frame gs_spool_peek(...) returned.
+ *
+ * @param spool
+ */
+void gs_spool_pop(gs_spool_t *spool);
+
+/**
+ * @brief Parses a drain order name: "interleaved" or "ahead".
+ *
+ * @param name
+ * @param order
+ * @return int 1 on success, -1 if the name is not known.
+ */
+int gs_spool_drain_order_from_string(const char *name, spool_drain_order *order);
+
+/**
+ * @brief Whether the spool holds anything.
+ *
+ * @param spool
+ * @return bool
+ */
+static inline bool gs_spool_empty(gs_spool_t *spool)
+{
+    return spool->depth.load(std::memory_order_relaxed) == 0;
+}
+
+#endif // GS_SPOOL_HPP
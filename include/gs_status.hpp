@@ -0,0 +1,180 @@
+/**
+ * @file gs_status.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Event-driven X-Band status: a cached radio state, and the decision of when a status frame is due.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The radio configuration is cached rather than read back from libiio for every status frame. It is updated directly
+ * when haystack applies a configuration, and re-read from libiio only every refresh_ms (to pick up temperature, RSSI,
+ * AGC gain, and anything changed behind our back), as one batched snapshot (gs_radio.hpp). The re-read is done by the
+ * chain's hardware executor, which owns the radio (gs_hwexec.hpp); the network loop only ever reads the cache.
+ *
+ * Status frames go out when something happens (a configuration applied, RX armed or disarmed, the PLL locked or shut
+ * down, receive starting or stopping to fail), with events arriving within coalesce_ms of each other sent as one frame,
+ * and otherwise every heartbeat_ms. Every frame is a complete phy_status_t, so the GUI needs no history; its 'events'
+ * and 'changed' fields say why it was sent and which groups of fields differ from the previous frame.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_STATUS_HPP
+#define GS_STATUS_HPP
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "libiio.h"
+#include "phy.hpp"
+#include "gs_radio.hpp"
+
+// phy_status_t::events, why a status frame was sent.
+#define STATUS_EVENT_CONFIG 0x01    // A configuration was applied.
+#define STATUS_EVENT_ARM 0x02       // RX was armed or disarmed.
+#define STATUS_EVENT_PLL 0x04       // The PLL was initialized or powered down.
+#define STATUS_EVENT_RX_ERROR 0x08  // Receive started failing, or recovered.
+#define STATUS_EVENT_REFRESH 0x10   // The radio was re-read from libiio.
+#define STATUS_EVENT_HEARTBEAT 0x20 // Nothing happened for heartbeat_ms.
+#define STATUS_EVENT_CONNECT 0x40   // The connection to the server was (re)established.
+
+// phy_status_t::changed, which fields differ from the previous frame.
+#define STATUS_CHANGED_RADIO 0x01   // mode, pll_freq, LO, samp, bw, ftr_name, gain, curr_gainmode
+#define STATUS_CHANGED_ENV 0x02     // temp, rssi
+#define STATUS_CHANGED_STATE 0x04   // pll_lock, modem_ready, PLL_ready, radio_ready, rx_armed
+#define STATUS_CHANGED_RX 0x08      // last_rx_status, last_read_status
+
+#define STATUS_REFRESH_MS_DEFAULT 10000
+#define STATUS_COALESCE_MS_DEFAULT 20
+#define STATUS_HEARTBEAT_MS_DEFAULT 5000
+
+/**
+ * @brief The radio's part of phy_status_t.
+ *
+ */
+typedef struct
+{
+    int mode; // ensm_mode, -1 if unknown.
+    int pll_freq;
+    int64_t LO;
+    int64_t samp;
+    int64_t bw;
+    char ftr_name[64];
+    int64_t temp;
+    double rssi;
+    double gain;
+    char curr_gainmode[16];
+    uint8_t pll_lock;
+} status_radio_t;
+
+typedef struct
+{
+    // Settings, fixed after gs_status_init(...).
+    uint32_t refresh_ms;
+    uint32_t coalesce_ms;
+    uint32_t heartbeat_ms;
+
+    pthread_mutex_t lock;
+    int wake_fd;         // eventfd, written on every notify; the network loop polls it.
+    uint32_t pending;    // STATUS_EVENT_* not yet sent.
+    uint64_t pending_since;
+    status_radio_t radio;
+
+    // Owned by the chain's hardware executor.
+    gs_radio_reader_t reader[1]; // Opened on the first refresh.
+    bool reader_opened;
+    uint64_t last_refresh;
+
+    // Owned by the network loop.
+    uint64_t last_sent;
+    bool sent_any;
+    phy_status_t previous;
+
+    // Counters.
+    std::atomic<uint32_t> iio_refreshes;
+    std::atomic<uint32_t> frames_sent;
+} gs_status_t;
+
+/**
+ * @brief Sets up the status engine. The radio state is unknown until the first refresh or configuration.
+ *
+ * @param st
+ * @param refresh_ms How often the radio is re-read from libiio.
+ * @param coalesce_ms How long an event waits for others to join it in one frame.
+ * @param heartbeat_ms Longest time between status frames.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_status_init(gs_status_t *st, uint32_t refresh_ms, uint32_t coalesce_ms, uint32_t heartbeat_ms);
+
+/**
+ * @brief Frees the status engine. The network loop must have exited.
+ *
+ * @param st
+ */
+void gs_status_destroy(gs_status_t *st);
+
+/**
+ * @brief Reports that something happened, waking the network loop; a status frame follows within coalesce_ms. Cheap
+ * enough for the capture stage, as long as it is only called on transitions.
+ *
+ * @param st
+ * @param events STATUS_EVENT_*
+ */
+void gs_status_notify(gs_status_t *st, uint32_t events);
+
+/**
+ * @brief Updates the cached radio state with a configuration haystack has just applied, and reports STATUS_EVENT_CONFIG.
+ *
+ * @param st
+ * @param config
+ */
+void gs_status_set_config(gs_status_t *st, const phy_config_t *config);
+
+/**
+ * @brief Network loop: takes the status events that are due, without waiting. Call when st->wake_fd is readable or
+ * the time last returned in next_at has come.
+ *
+ * @param st
+ * @param next_at Set to the CLOCK_MONOTONIC time, in nanoseconds, at which to call again if nothing is notified.
+ * @return uint32_t The STATUS_EVENT_* due, 0 if none.
+ */
+uint32_t gs_status_due(gs_status_t *st, uint64_t *next_at);
+
+/**
+ * @brief Hardware executor: re-reads the radio from libiio into the cache, and reports STATUS_EVENT_REFRESH.
+ *
+ * @param st
+ * @param radio
+ * @param radio_lock Held around the read if it has to go through adradio_get_*(...), whose radio the schedule thread
+ * retunes under this lock.
+ */
+void gs_status_refresh(gs_status_t *st, adradio_t *radio, pthread_mutex_t *radio_lock);
+
+/**
+ * @brief Hardware executor: when the radio is next due to be re-read.
+ *
+ * @param st
+ * @return uint64_t CLOCK_MONOTONIC, in nanoseconds.
+ */
+uint64_t gs_status_refresh_at(gs_status_t *st);
+
+/**
+ * @brief Network loop: copies the cached radio state into a status frame.
+ *
+ * @param st
+ * @param status
+ */
+void gs_status_fill(gs_status_t *st, phy_status_t *status);
+
+/**
+ * @brief Network loop: compares a filled-in frame with the previous one sent, and records it as sent if it should go out.
+ *
+ * @param st
+ * @param status Complete frame; its 'events' and 'changed' fields are set here.
+ * @param events What gs_status_due(...) returned.
+ * @return bool Whether the frame should be sent: always for events other than STATUS_EVENT_REFRESH, and for a
+ * refresh only if something changed.
+ */
+bool gs_status_commit(gs_status_t *st, phy_status_t *status, uint32_t events);
+
+#endif // GS_STATUS_HPP
@@ -0,0 +1,256 @@
+/**
+ * @file gs_uplink.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Sends received X-Band frames to the GS server, optionally without copying the payload.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * NetFrame copies its payload twice on the way out: into its own storage when constructed, and into a send buffer
+ * with the header and footer in sendFrame(...). The zero-copy path instead writes the header, the payload (straight
+ * out of its pool buffer) and the footer with a single sendmsg(...) of three iovecs.
+ *
+ * This requires haystack to produce NetFrame's wire format itself (netframe_wire_hdr_t, netframe_wire_ftr_t). So that a
+ * change to the network library cannot silently corrupt the uplink, gs_uplink_init(...) sends probe frames both ways
+ * over a socketpair and only enables the zero-copy path if the bytes match; otherwise it logs the mismatch and keeps
+ * using NetFrame. The zero-copy path writes to the socket directly, so it must not be enabled on an encrypted connection.
+ *
+ * In batched mode, several received frames go out as one DATA NetFrame whose payload is a gs_batch_hdr_t followed by
+ * 'count' items, each a uint32_t length and that many bytes (both little-endian). A batch is sent when it holds
+ * batch_frames frames or batch_bytes of payload, or when its first frame has waited batch_latency_us, whichever comes
+ * first. Every DATA frame is then a batch, even of one, so the server must be told to expect them; gs_batch_next(...)
+ * walks one.
+ *
+ * With the outage spool enabled, every DATA item (each frame, or each batch item) starts with a gs_seq_hdr_t
+ * (gs_spool.hpp); the zero-copy path sends it as one more iovec.
+ *
+ * Since batching bounds the added latency itself, gs_uplink_attach(...) turns off Nagle's algorithm (TCP_NODELAY) on the
+ * uplink socket, which would otherwise hold a batch sent on its deadline until the server's delayed ACK.
+ *
+ * Copies are counted as whole-payload copies in user space for each frame sent, including the modem read into its pool
+ * buffer (UPLINK_READ_COPIES); 'copies / frames' is the copies per forwarded frame.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_UPLINK_HPP
+#define GS_UPLINK_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <atomic>
+#include "network.hpp"
+#include "buffer_pool.hpp"
+#include "gs_spool.hpp"
+
+#define NETFRAME_GUID 0x1A1C
+#define NETFRAME_TERMINATOR 0xAAAA
+#define NETFRAME_COPIES 2 // Payload copies NetFrame makes: into the frame, then into the send buffer.
+#define UPLINK_READ_COPIES 1 // rxmodem_read(...) out of the DMA region into the pool buffer.
+#define UPLINK_SPOOL_COPIES 1 // gs_spool_push(...), for a frame sent from the outage spool.
+
+#define GS_BATCH_MAGIC 0x48424154 // "HBAT"
+#define GS_BATCH_VERSION 1
+#define UPLINK_BATCH_MAX 256 // Frames per batch; up to three iovecs each, under IOV_MAX.
+#define UPLINK_BATCH_FRAMES_DEFAULT 32
+#define UPLINK_BATCH_BYTES_DEFAULT 65536
+#define UPLINK_BATCH_LATENCY_US_DEFAULT 2000
+
+/**
+ * @brief Mirror of the header NetFrame::sendFrame(...) writes before the payload.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t guid;         // NETFRAME_GUID
+    uint16_t crc1;         // CRC-16/CCITT of the payload.
+    uint32_t type;         // NetType
+    uint32_t origin;       // NetVertex
+    uint32_t destination;  // NetVertex
+    int32_t payload_size;
+    uint8_t netstat;       // Set by the server; clients send 0.
+} netframe_wire_hdr_t;
+
+/**
+ * @brief Mirror of the footer NetFrame::sendFrame(...) writes after the payload.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t crc2;        // Same as crc1.
+    uint16_t termination; // NETFRAME_TERMINATOR
+} netframe_wire_ftr_t;
+
+/**
+ * @brief Start of a batched DATA payload.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;   // GS_BATCH_MAGIC
+    uint16_t version; // GS_BATCH_VERSION
+    uint16_t count;   // Items that follow.
+} gs_batch_hdr_t;
+
+typedef struct
+{
+    bool wire_verified; // NetFrame's encoding is netframe_wire_hdr_t, payload, netframe_wire_ftr_t.
+    bool zero_copy;     // Requested and wire_verified.
+
+    // Held for every write to the server socket, which the forwarding stage and the network loop share, and while the
+    // network loop replaces it. network_data->connection_ready is only touched under it. A send that fails or is cut
+    // short clears it and shuts the socket down, since the server may hold part of a frame; the network loop then
+    // detaches the connection and reconnects.
+    pthread_mutex_t send_lock;
+    std::atomic<bool> connected; // connection_ready, for readers that do not take send_lock.
+
+    // Batching, fixed after gs_uplink_init(...). batch_frames < 2 sends every frame on its own.
+    uint32_t batch_frames;
+    uint32_t batch_bytes;
+    uint32_t batch_latency_us;
+    uint8_t *batch_scratch; // Payload assembled for NetFrame when the zero-copy path is off and it has several parts.
+    size_t batch_scratch_size;
+    pthread_mutex_t scratch_lock; // Held while batch_scratch is filled and sent; each receive chain forwards on its own.
+
+    // Counters, read by the network loop for status frames. Written on every send, so kept off send_lock's line.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> frames; // DATA frames sent.
+    std::atomic<uint32_t> copies;      // User-space payload copies made for them, including the modem read.
+    std::atomic<uint32_t> send_errors; // Sends that failed or were cut short.
+    std::atomic<uint32_t> batches;     // Batched DATA frames sent; frames / batches is the mean batch size.
+} gs_uplink_t;
+
+/**
+ * @brief Sets up the uplink, checking whether haystack's encoding matches NetFrame's.
+ *
+ * @param uplink
+ * @param zero_copy
+ * @param batch_frames Most frames per batched DATA frame; below 2 disables batching.
+ * @param batch_bytes Payload size at which a batch is sent without waiting for more frames.
+ * @param batch_latency_us Longest a frame waits for others to join its batch.
+ * @return int 1 on success (uplink->zero_copy says which path is in use), negative on failure.
+ */
+int gs_uplink_init(gs_uplink_t *uplink, bool zero_copy, uint32_t batch_frames, uint32_t batch_bytes, uint32_t batch_latency_us);
+
+/**
+ * @brief Network loop: publishes a newly connected socket to the senders.
+ *
+ * @param uplink
+ * @param network_data
+ * @param fd Connected, blocking socket.
+ */
+void gs_uplink_attach(gs_uplink_t *uplink, NetData *network_data, int fd);
+
+/**
+ * @brief Network loop: closes the server socket, waiting for a send in progress to give up first.
+ *
+ * @param uplink
+ * @param network_data
+ * @param reason Stored in network_data->disconnect_reason.
+ */
+void gs_uplink_detach(gs_uplink_t *uplink, NetData *network_data, const char *reason);
+
+/**
+ * @brief Frees the uplink's batch buffer.
+ *
+ * @param uplink
+ */
+void gs_uplink_destroy(gs_uplink_t *uplink);
+
+/**
+ * @brief Whether received frames should be collected with gs_uplink_send_batch(...) instead of sent one at a time.
+ *
+ * @param uplink
+ * @return bool
+ */
+static inline bool gs_uplink_batching(gs_uplink_t *uplink)
+{
+    return uplink->batch_frames > 1;
+}
+
+/**
+ * @brief Whether the network loop has a connection attached. May change before the next send, which checks again.
+ *
+ * @param uplink
+ * @return bool
+ */
+static inline bool gs_uplink_connected(gs_uplink_t *uplink)
+{
+    return uplink->connected.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Sends one received frame to the server as a DATA frame, by sendmsg(...) if the zero-copy path is enabled, by
+ * NetFrame otherwise.
+ *
+ * @param uplink
+ * @param network_data
+ * @param destination
+ * @param seq Sequence header to put in front of the frame, NULL for none.
+ * @param payload Not copied on the zero-copy path; must stay valid until this returns.
+ * @param size
+ * @return ssize_t Bytes sent, negative on failure.
+ */
+ssize_t gs_uplink_send(gs_uplink_t *uplink, NetData *network_data, NetVertex destination, const gs_seq_hdr_t *seq, const uint8_t *payload, ssize_t size);
+
+/**
+ * @brief Sends a frame other than received data (status, polls, acknowledgements). Not counted in the uplink counters.
+ *
+ * @param uplink
+ * @param network_data
+ * @param type
+ * @param destination
+ * @param payload
+ * @param size
+ * @return ssize_t Bytes sent, negative on failure.
+ */
+ssize_t gs_uplink_send_control(gs_uplink_t *uplink, NetData *network_data, NetType type, NetVertex destination, const uint8_t *payload, ssize_t size);
+
+/**
+ * @brief Sends frames as one batched DATA frame, by sendmsg(...) if the zero-copy path is enabled, by NetFrame otherwise.
+ *
+ * @param uplink
+ * @param network_data
+ * @param destination
+ * @param frames Not copied on the zero-copy path; must stay valid until this returns.
+ * @param seqs Sequence header for each frame, NULL for none.
+ * @param count 1 to UPLINK_BATCH_MAX.
+ * @return ssize_t Bytes sent, negative on failure.
+ */
+ssize_t gs_uplink_send_batch(gs_uplink_t *uplink, NetData *network_data, NetVertex destination, const PoolBuffer *frames, const gs_seq_hdr_t *seqs, uint32_t count);
+
+/**
+ * @brief Sends a frame taken from the outage spool, which already carries its sequence header; as a batch of one when
+ * batching, so that the server sees the same encoding as for live frames.
+ *
+ * @param uplink
+ * @param network_data
+ * @param destination
+ * @param item From gs_spool_peek(...).
+ * @param size
+ * @return ssize_t Bytes sent, negative on failure.
+ */
+ssize_t gs_uplink_send_spooled(gs_uplink_t *uplink, NetData *network_data, NetVertex destination, const uint8_t *item, ssize_t size);
+
+/**
+ * @brief Server side: steps through the items of a batched DATA payload.
+ *
+ * @param payload
+ * @param size
+ * @param offset 0 for the first item; advanced past each item returned.
+ * @param item Set to the next item.
+ * @param item_size Set to its size.
+ * @return int 1 if an item was returned, 0 after the last, negative if the payload is not a well-formed batch.
+ */
+int gs_batch_next(const uint8_t *payload, ssize_t size, ssize_t *offset, const uint8_t **item, uint32_t *item_size);
+
+/**
+ * @brief CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF), as NetFrame computes it.
+ *
+ * @param data
+ * @param size
+ * @return uint16_t
+ */
+uint16_t gs_uplink_crc16(const uint8_t *data, ssize_t size);
+
+#endif // GS_UPLINK_HPP
@@ -0,0 +1,166 @@
+/**
+ * @file gs_validate.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief CRC check and duplicate filter between the capture and forwarding stages.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The modem hands over every frame it demodulates, corrupted or repeated. With [validate] set, each chain's
+ * forwarding stage checks a frame before it is sequenced and sent, and drops it if:
+ *
+ *  - its CRC does not match. The CRC is the frame's last bytes, computed over the rest: CRC-32C (Castagnoli,
+ *    reflected, stored little-endian), or CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, as CCSDS uses,
+ *    stored big-endian).
+ *  - it is identical to one of the chain's last dedupe_window forwarded frames. Frames are compared by size and
+ *    CRC-32C (of the body when that is the trailer, of the whole frame otherwise), kept in a linear-probing hash
+ *    table of the window; two different frames of the same size collide once in 2^32.
+ *
+ * Dropped frames are counted per chain for status frames. They are still recorded: the recording is of what the
+ * modem delivered.
+ *
+ * CRC-32C uses the CPU's CRC instructions where it has them (SSE4.2 on x86-64, the ARMv8 CRC extension on AArch64),
+ * chosen at startup, and a slicing-by-8 table otherwise; CRC-16 always uses a table. bench/crc_bench.cpp compares the
+ * implementations.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_VALIDATE_HPP
+#define GS_VALIDATE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define VALIDATE_DEDUPE_WINDOW_MAX 4096
+
+typedef enum
+{
+    CRC_NONE = 0,
+    CRC_32C = 1, // 4-byte trailer.
+    CRC_16 = 2,  // 2-byte trailer.
+} crc_kind;
+
+/**
+ * @brief One chain's validation state. Forwarding stage only, apart from the counters.
+ *
+ */
+typedef struct
+{
+    crc_kind crc;
+    uint32_t window;     // Frames remembered for the duplicate filter, 0 for none.
+    uint64_t *recent;    // The window's keys, oldest first from recent_at.
+    uint32_t recent_at;
+    uint32_t recent_count;
+    uint64_t *table;     // Open addressing, linear probing; 0 is empty.
+    uint32_t table_mask;
+
+    // Counters, read by the network loop for status frames.
+    std::atomic<uint32_t> checked;    // Frames validated.
+    std::atomic<uint32_t> crc_errors; // Dropped for a CRC mismatch (or too short to hold one).
+    std::atomic<uint32_t> duplicates; // Dropped as duplicates.
+} gs_validate_t;
+
+/**
+ * @brief Picks the fastest CRC-32C implementation this CPU supports. Called by gs_validate_init(...); until then the
+ * table is used.
+ *
+ */
+void gs_crc_init();
+
+/**
+ * @brief Name of the CRC-32C implementation in use: "sse4.2", "armv8" or "table".
+ *
+ * @return const char*
+ */
+const char *gs_crc32c_impl();
+
+/**
+ * @brief CRC-32C with the fastest implementation available.
+ *
+ * @param crc 0 to start, or a previous return to continue.
+ * @param data
+ * @param len
+ * @return uint32_t
+ */
+uint32_t gs_crc32c(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief CRC-32C by slicing-by-8 table, on any CPU.
+ *
+ * @param crc 0 to start, or a previous return to continue.
+ * @param data
+ * @param len
+ * @return uint32_t
+ */
+uint32_t gs_crc32c_table(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief CRC-32C by the CPU's CRC instructions.
+ *
+ * @param crc 0 to start, or a previous return to continue.
+ * @param data
+ * @param len
+ * @return uint32_t Same as gs_crc32c_table(...); only call if gs_crc32c_impl() is not "table".
+ */
+uint32_t gs_crc32c_hw(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief CRC-16/CCITT-FALSE by table.
+ *
+ * @param crc 0xFFFF to start, or a previous return to continue.
+ * @param data
+ * @param len
+ * @return uint16_t
+ */
+uint16_t gs_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Sets up a chain's validation.
+ *
+ * @param val
+ * @param crc
+ * @param window Frames for the duplicate filter to remember, up to VALIDATE_DEDUPE_WINDOW_MAX; 0 for none.
+ * @return int 1 on success, negative on failure.
+ */
+int gs_validate_init(gs_validate_t *val, crc_kind crc, uint32_t window);
+
+/**
+ * @brief Frees a chain's validation.
+ *
+ * @param val
+ */
+void gs_validate_destroy(gs_validate_t *val);
+
+/**
+ * @brief Whether validation would drop anything.
+ *
+ * @param val
+ * @return bool
+ */
+static inline bool gs_validate_enabled(const gs_validate_t *val)
+{
+    return val->crc != CRC_NONE || val->window > 0;
+}
+
+/**
+ * @brief Forwarding stage: checks a frame, counting it if dropped.
+ *
+ * @param val
+ * @param data
+ * @param size
+ * @return bool Whether to forward it.
+ */
+bool gs_validate_frame(gs_validate_t *val, const uint8_t *data, size_t size);
+
+/**
+ * @brief Parses a CRC name: none, crc32c or crc16.
+ *
+ * @param name
+ * @param crc
+ * @return int 1 on success, negative if unknown.
+ */
+int gs_validate_crc_from_string(const char *name, crc_kind *crc);
+
+#endif // GS_VALIDATE_HPP
@@ -0,0 +1,186 @@
+/**
+ * @file gs_wire.hpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Compact, versioned encoding of phy_status_t and phy_config_t, with status frames sent as deltas.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The raw structs are host-endian, their layout is the protocol, and most of their bytes are padding in the fixed
+ * ftr_name and curr_gainmode arrays. The compact encoding is explicit-endian and tagged, so that fields can be added
+ * without breaking peers:
+ *
+ *   magic (2 bytes, "HW")  version (1)  kind (1)  [seq (varint), status only]  field*  end (varint 0)
+ *
+ * Each field is a varint tag, (number << 2) | type, followed by its value: a varint (zigzagged if the member is
+ * signed), 8 little-endian bytes (a double), or a string. A decoder skips fields whose number it does not know, and
+ * leaves fields a frame does not carry at zero (a full frame) or as they were (a delta). Field numbers come from the
+ * tables in gs_wire.cpp, from which the encoders and decoders are generated; a number is never reused.
+ *
+ * Strings are interned per stream: a varint (index << 1) | 1 names one already in the table, and (length << 1)
+ * followed by the bytes sends it literally and adds it to the table, on both ends, until the table is full. The table
+ * starts with the gain mode names, and is reset by every full status frame.
+ *
+ * A status stream is a full frame (GS_WIRE_STATUS), then deltas (GS_WIRE_STATUS_DELTA) carrying only the fields that
+ * changed since the frame before, then another full frame every keyframe_every frames, or after a reconnect. Each
+ * frame carries a sequence number; a delta that does not follow the decoder's previous frame is refused, and the
+ * decoder waits for the next full frame. Configuration frames (GS_WIRE_CONFIG) are always complete, and carry no
+ * sequence number.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GS_WIRE_HPP
+#define GS_WIRE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "phy.hpp"
+
+#define GS_WIRE_MAGIC0 'H'
+#define GS_WIRE_MAGIC1 'W'
+#define GS_WIRE_VERSION 1
+#define GS_WIRE_STRINGS_MAX 32      // Interned strings per stream, the built-in ones included.
+#define GS_WIRE_STATUS_MAX 1024     // Largest encoded phy_status_t.
+#define GS_WIRE_KEYFRAME_EVERY_DEFAULT 32
+
+/**
+ * @brief Byte 3 of an encoded frame.
+ *
+ */
+typedef enum
+{
+    GS_WIRE_STATUS = 1,       // A complete phy_status_t.
+    GS_WIRE_STATUS_DELTA = 2, // The fields of a phy_status_t that changed since the previous frame.
+    GS_WIRE_CONFIG = 3,       // A complete phy_config_t.
+} gs_wire_kind;
+
+/**
+ * @brief How status frames are sent, [status] encoding.
+ *
+ */
+typedef enum
+{
+    WIRE_ENCODING_RAW = 0,     // The phy_status_t struct as it is in memory.
+    WIRE_ENCODING_COMPACT = 1, // gs_wire_encode_status(...)
+} wire_encoding;
+
+typedef struct
+{
+    char text[GS_WIRE_STRINGS_MAX][64];
+    uint32_t count;
+} gs_wire_strings_t;
+
+/**
+ * @brief One status stream's sending end. Network loop only.
+ *
+ */
+typedef struct
+{
+    uint32_t keyframe_every; // 0 or 1: every frame is full.
+    uint32_t seq;            // Of the latest frame.
+    uint32_t since_key;      // Deltas since the latest full frame.
+    bool have_base;          // False until the first frame, and after a reset.
+    phy_status_t base;       // The latest frame.
+    gs_wire_strings_t strings[1];
+} gs_wire_encoder_t;
+
+/**
+ * @brief One status stream's receiving end.
+ *
+ */
+typedef struct
+{
+    uint32_t seq;
+    bool have_base;
+    phy_status_t base;
+    gs_wire_strings_t strings[1];
+} gs_wire_decoder_t;
+
+/**
+ * @brief Sets up an encoder; its first frame is full.
+ *
+ * @param enc
+ * @param keyframe_every Frames from one full frame to the next.
+ */
+void gs_wire_encoder_init(gs_wire_encoder_t *enc, uint32_t keyframe_every);
+
+/**
+ * @brief Makes the next frame full, e.g. once the peer may have lost the stream.
+ *
+ * @param enc
+ */
+void gs_wire_encoder_reset(gs_wire_encoder_t *enc);
+
+/**
+ * @brief Encodes a status frame, as a delta against the previous one unless a full frame is due.
+ *
+ * @param enc
+ * @param status
+ * @param buf
+ * @param cap GS_WIRE_STATUS_MAX is always enough.
+ * @return ssize_t Bytes written, or negative if cap is too small (the encoder is then unchanged).
+ */
+ssize_t gs_wire_encode_status(gs_wire_encoder_t *enc, const phy_status_t *status, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Sets up a decoder; it accepts a full frame first.
+ *
+ * @param dec
+ */
+void gs_wire_decoder_init(gs_wire_decoder_t *dec);
+
+/**
+ * @brief Decodes and checks a status frame.
+ *
+ * @param dec
+ * @param buf
+ * @param len
+ * @param status Filled in on success.
+ * @param used Set to the encoded frame's length, if not NULL; anything after it is not part of it.
+ * @return int 1 on success; -1 truncated or malformed, -2 not an encoded status frame or a version not understood,
+ * -3 a delta whose base the decoder does not have, -4 a value out of its field's range. After a failure other than
+ * -2, the decoder waits for the next full frame.
+ */
+int gs_wire_decode_status(gs_wire_decoder_t *dec, const uint8_t *buf, size_t len, phy_status_t *status, size_t *used);
+
+/**
+ * @brief Encodes a configuration frame.
+ *
+ * @param config
+ * @param buf
+ * @param cap
+ * @return ssize_t Bytes written, or negative if cap is too small.
+ */
+ssize_t gs_wire_encode_config(const phy_config_t *config, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Decodes and checks a configuration frame.
+ *
+ * @param buf
+ * @param len
+ * @param config Filled in on success.
+ * @return int 1 on success, negative as gs_wire_decode_status(...).
+ */
+int gs_wire_decode_config(const uint8_t *buf, size_t len, phy_config_t *config);
+
+/**
+ * @brief Whether a payload is in the compact encoding rather than a raw struct: no raw struct starts with the magic.
+ *
+ * @param buf
+ * @param len
+ * @return bool
+ */
+bool gs_wire_is_encoded(const uint8_t *buf, size_t len);
+
+/**
+ * @brief Parses an encoding name: raw or compact.
+ *
+ * @param name
+ * @param encoding
+ * @return int 1 on success, -1 if the name is not known.
+ */
+int gs_wire_encoding_from_string(const char *name, wire_encoding *encoding);
+
+#endif // GS_WIRE_HPP
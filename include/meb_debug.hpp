@@ -4,32 +4,64 @@
  * @brief Contains debug-related macros and function-like macros.
  * @version 0.1
  * @date 2021.07.26
- * 
+ *
+ * Every macro has a level; messages above MEB_LOG_LEVEL compile to nothing (their arguments are still type-checked).
+ * Build with e.g. -DMEB_LOG_LEVEL=MEB_LOG_TRACE to see per-frame messages. Enabled messages go through gs_log_write(...).
+ *
  * @copyright Copyright (c) 2021
- * 
+ *
  */
 
 #ifndef MEB_DEBUG_HPP
 #define MEB_DEBUG_HPP
 
+#include <string.h>
+#include "gs_log.hpp"
+
+#define MEB_LOG_NONE 0
+#define MEB_LOG_ERROR 1 // erprintlf, ftprintlf
+#define MEB_LOG_INFO 2  // dbprintlf, dbprintf
+#define MEB_LOG_TRACE 3 // trprintlf: per-frame messages, off by default.
+
+#ifndef MEB_LOG_LEVEL
+#define MEB_LOG_LEVEL MEB_LOG_INFO
+#endif // MEB_LOG_LEVEL
+
+#define meb_log(level, format, ...)             \
+    do                                          \
+    {                                           \
+        if ((level) <= MEB_LOG_LEVEL)           \
+        {                                       \
+            gs_log_write(format, ##__VA_ARGS__); \
+        }                                       \
+    } while (0)
+
 #ifndef dbprintlf
-#define dbprintlf(format, ...)                                                                        \
-    fprintf(stderr, "[%s:%d | %s] " format "\x1b[0m\n", __FILE__, __LINE__, __func__, ##__VA_ARGS__); \
-    fflush(stderr);
+#define dbprintlf(format, ...) \
+    meb_log(MEB_LOG_INFO, "[%s:%d | %s] " format "\x1b[0m\n", __FILE__, __LINE__, __func__, ##__VA_ARGS__)
 #endif // dbprintlf
 
 #ifndef dbprintf
-#define dbprintf(format, ...)                                                                       \
-    fprintf(stderr, "[%s:%d | %s] " format "\x1b[0m", __FILE__, __LINE__, __func__, ##__VA_ARGS__); \
-    fflush(stderr);
+#define dbprintf(format, ...) \
+    meb_log(MEB_LOG_INFO, "[%s:%d | %s] " format "\x1b[0m", __FILE__, __LINE__, __func__, ##__VA_ARGS__)
 #endif // dbprintf
 
+#ifndef trprintlf
+#define trprintlf(format, ...) \
+    meb_log(MEB_LOG_TRACE, "[%s:%d | %s] " format "\x1b[0m\n", __FILE__, __LINE__, __func__, ##__VA_ARGS__)
+#endif // trprintlf
+
 #ifndef erprintlf
-#define erprintlf(error)                                                                                               \
-    fprintf(stderr, "[%s:%d | %s] \x1b[94m>>> %d: %s\x1b[0m\n", __FILE__, __LINE__, __func__, error, strerror(error)); \
-    fflush(stderr);
+#define erprintlf(error) \
+    meb_log(MEB_LOG_ERROR, "[%s:%d | %s] \x1b[94m>>> %d: %s\x1b[0m\n", __FILE__, __LINE__, __func__, error, strerror(error))
 #endif // erprintlf
 
+// Why haystack is about to exit; kept at every level but MEB_LOG_NONE.
+#ifndef ftprintlf
+#define ftprintlf(format, ...) \
+    meb_log(MEB_LOG_ERROR, "[%s:%d | %s] " FATAL format "\x1b[0m\n", __FILE__, __LINE__, __func__, ##__VA_ARGS__)
+#endif // ftprintlf
+
 #ifndef MEB_COLORS
 #define MEB_COLORS
 #define RESET_ALL "\x1b[0m"
@@ -52,4 +84,4 @@
 #define FATAL "\033[1m\x1b[107m\x1b[31m(FATAL) "
 #endif // MEB_CODES
 
-#endif // MEB_DEBUG_HPP
\ No newline at end of file
+#endif // MEB_DEBUG_HPP
@@ -33,8 +33,30 @@ typedef struct __attribute__((packed))
     char curr_gainmode[16]; // fast_attack or slow_attack
     uint8_t pll_lock;
     uint32_t MTU;
+    uint8_t chain;          // Receive chain to configure; a frame without this byte is for chain 0.
 } phy_config_t;
 
+/**
+ * @brief Sent back to the client for each XBAND_CONFIG frame, in an ACK if it was applied (or changed nothing) and in
+ * a NACK if not.
+ *
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t chain;
+    int8_t result;       // 1 applied, 0 nothing changed; on a NACK: -1 a write failed and was undone, -2 it could not
+                         // be undone, -3 bad filter file, -4 radio not ready, -5 sleep refused while RX is armed,
+                         // -6 a malformed compact frame (gs_wire.hpp), whose chain is then unknown and given as 0,
+                         // -7 superseded by a later configuration before it ran, -8 the chain's queue was full.
+    uint8_t rolled_back; // Whether the previous configuration was restored.
+    uint8_t changed;     // RADIOCFG_* settings (gs_radiocfg.hpp) that differed from the applied configuration.
+    uint8_t applied;     // Of those, the ones now in effect.
+    uint8_t failed;      // The RADIOCFG_* setting that failed, 0 if none.
+    uint32_t apply_us;   // Time spent writing to the radio, rollback included.
+    uint32_t queue_us;   // Time spent queued for the hardware executor (gs_hwexec.hpp).
+    uint32_t exec_us;    // Time the configuration took, checks and status updates included.
+} phy_config_ack_t;
+
 /**
  * @brief Sent to GUI client for status updates.
  * 
@@ -60,6 +82,48 @@ typedef struct __attribute__((packed))
     uint32_t MTU;
     int32_t last_rx_status;
     int32_t last_read_status;
+    uint32_t rx_ring_depth;     // Frames waiting between capture and forwarding.
+    uint32_t rx_dropped_oldest; // Queued frames discarded to make room (drop_oldest).
+    uint32_t rx_dropped_newest; // Captured frames discarded because the ring was full (drop_newest).
+    uint32_t rx_blocked;        // Times the capture stage waited on a full ring (block).
+    uint32_t pool_in_use;       // Frame buffers currently in use.
+    uint32_t pool_high_water;   // Most frame buffers ever in use at once.
+    uint32_t pool_exhausted;    // Buffer requests that found the pool empty.
+    uint32_t rec_records;       // Frames written to capture segments.
+    uint32_t rec_dropped;       // Frames left out of the recording because the recorder fell behind.
+    uint32_t rec_errors;        // Failed capture segment writes.
+    uint32_t events;            // STATUS_EVENT_* that caused this frame to be sent (gs_status.hpp).
+    uint32_t changed;           // STATUS_CHANGED_* groups of fields that differ from the previous frame.
+    uint32_t uplink_frames;     // Received frames sent to the server.
+    uint32_t uplink_copies;     // Payload copies made for them; uplink_copies / uplink_frames is the copies per frame.
+    uint32_t uplink_errors;     // Failed sends of received frames.
+    uint32_t uplink_batches;    // Batched DATA frames sent; uplink_frames / uplink_batches is the mean batch size.
+    uint32_t net_reconnects;    // Times the connection to the server was re-established.
+    uint32_t net_outage_ms;     // How long the latest reconnect took.
+    uint32_t net_bad_frames;    // Frames from the server discarded as malformed or too large.
+    uint32_t spool_frames;      // Received frames held back while the server was unreachable.
+    uint32_t spool_replayed;    // Of those, frames since sent.
+    uint32_t spool_dropped;     // Frames lost because the spool was full.
+    uint32_t spool_depth;       // Frames in the spool now.
+    uint32_t spool_depth_kb;    // Their size, in KiB.
+    uint32_t rx_arm_us;         // Latest arm, from the command to the capture stage receiving.
+    uint32_t rx_disarm_us;      // Latest disarm, from the command to the capture stage idle.
+    uint32_t rx_slow_disarms;   // Disarms that outlasted [rx] disarm_timeout_ms.
+    uint32_t rx_frames;         // Frames the capture stage read in full.
+    uint32_t rx_errors;         // Receives that returned no frame, and reads that came up short.
+    uint32_t chain;             // Receive chain this frame describes; each sends its own.
+    uint32_t rx_overruns;       // Capture stage turnarounds over [sched] capture_deadline_us.
+    uint32_t rx_worst_turn_us;  // Longest capture stage turnaround, from a receive returning to the next receive.
+    uint32_t rx_dma_depth;      // Buffers kept posted to the modem's DMA engine, 0 if receiving one frame at a time.
+    uint32_t rx_dma_starved;    // Buffers posted to it while the pool was empty, whose frames were dropped.
+    uint32_t rx_crc_errors;     // Frames dropped by [validate] for a CRC mismatch.
+    uint32_t rx_duplicates;     // Frames dropped by [validate] as duplicates of recent ones.
+    uint32_t sched_pending;     // Scheduled retunes not yet made (gs_schedule.hpp).
+    uint32_t sched_applied;     // Scheduled retunes made.
+    uint32_t sched_skipped;     // Scheduled entries merged into a later one that was already due.
+    uint32_t sched_failed;      // Scheduled retunes refused or failed.
+    int32_t sched_last_error_us;   // Latest scheduled retune's completion against its time; negative if early.
+    uint32_t sched_worst_error_us; // Largest magnitude of it.
 } phy_status_t;
 
 #endif // PHY_HPP
\ No newline at end of file
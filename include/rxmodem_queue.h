@@ -0,0 +1,85 @@
+/**
+ * @file rxmodem_queue.h
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Descriptor-queue receive for the X-Band modem: buffers posted to the DMA engine ahead of time, handed back filled.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * rxmodem_receive(...) and rxmodem_read(...) leave the DMA engine idle from the end of one transfer until the caller
+ * has processed that frame and asked for the next. With a queue, the caller keeps several buffers posted; the engine
+ * fills them in the order they were posted, one frame each, and the caller takes them back with rxmodem_complete(...)
+ * and posts a fresh one before processing the frame, so that a transfer is always armed. The frame lands directly in
+ * the posted buffer.
+ *
+ * A backend without a queue reports a depth of 0 and fails every other call; the caller then uses rxmodem_receive(...)
+ * and rxmodem_read(...). The simulated backend (sim/) has one; the adidma driver in modem/ does not yet.
+ *
+ * Frames the engine filled before rxmodem_stop(...) and that were not collected are discarded by rxmodem_start(...),
+ * as frames that arrived while stopped are, and their buffers filled again.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef RXMODEM_QUEUE_H
+#define RXMODEM_QUEUE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "rxmodem.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define RXMODEM_QUEUE_MAX 8 // Most descriptors any backend keeps in flight.
+
+/**
+ * @brief Descriptors the modem's backend can keep in flight.
+ *
+ * @param dev Initialized.
+ * @return int 0 if the backend has no queue.
+ */
+int rxmodem_queue_depth(rxmodem *dev);
+
+/**
+ * @brief Posts a buffer for the DMA engine to fill with the next frame. It must stay valid until it is completed or
+ * cancelled.
+ *
+ * @param dev
+ * @param buf
+ * @param capacity A longer frame is cut short at capacity bytes.
+ * @param tag Returned with the buffer; must not be NULL.
+ * @return int 1 on success, negative if the queue is full or the backend has none.
+ */
+int rxmodem_submit(rxmodem *dev, uint8_t *buf, uint32_t capacity, void *tag);
+
+/**
+ * @brief Waits for the oldest posted buffer to be filled, and takes it back.
+ *
+ * Gives up after 100 ms, at once if nothing is posted, or when rxmodem_stop(...) is called during the wait, leaving
+ * *tag NULL. Called while the modem is stopped, it waits out the 100 ms, as rxmodem_receive(...) does.
+ *
+ * @param dev
+ * @param tag Set to the completed buffer's tag, or NULL if none completed.
+ * @param frame_size Set to the size of the frame received, negative if the receive failed.
+ * @return ssize_t Bytes written into the buffer, negative if none (including when no buffer completed).
+ */
+ssize_t rxmodem_complete(rxmodem *dev, void **tag, ssize_t *frame_size);
+
+/**
+ * @brief Takes back every posted buffer, filled or not. The DMA engine no longer touches any of them once this returns.
+ *
+ * @param dev
+ * @param tags Set to the tags of the buffers taken back.
+ * @param max Room in tags; at least RXMODEM_QUEUE_MAX.
+ * @return int Buffers taken back, negative on failure.
+ */
+int rxmodem_cancel(rxmodem *dev, void **tags, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RXMODEM_QUEUE_H
@@ -0,0 +1,57 @@
+/**
+ * @file sim_adf4355.c
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Simulated ADF4355 PLL.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Programming the PLL takes sim_pll_lock_ms(), modelling the SPI sequence and lock wait of the real device.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <unistd.h>
+#include "adf4355.h"
+#include "sim_backend.h"
+
+static void sim_pll_wait(void)
+{
+    uint32_t lock_ms = sim_pll_lock_ms();
+    if (lock_ms > 0)
+    {
+        usleep(lock_ms * 1000);
+    }
+}
+
+int adf4355_init(adf4355 *dev)
+{
+    (void)dev;
+    sim_pll_wait();
+    return 1;
+}
+
+int adf4355_set_rx(adf4355 *dev)
+{
+    (void)dev;
+    sim_pll_wait();
+    return 1;
+}
+
+int adf4355_set_tx(adf4355 *dev)
+{
+    (void)dev;
+    sim_pll_wait();
+    return 1;
+}
+
+int adf4355_pw_down(adf4355 *dev)
+{
+    (void)dev;
+    return 1;
+}
+
+void adf4355_destroy(adf4355 *dev)
+{
+    (void)dev;
+}
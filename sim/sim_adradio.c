@@ -0,0 +1,451 @@
+/**
+ * @file sim_adradio.c
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Simulated AD9361 radio, standing in for the libiio-based adradio_* calls.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Attributes are held in memory and read back as written. Every access sleeps for sim_iio_latency_us(), to model the
+ * sysfs/iiod round trip of the real library, and every LO, sample rate, bandwidth or filter change for a further
+ * sim_retune_ms(), to model the AD9361's recalibration. Values outside the AD9361's ranges are refused, as the driver
+ * refuses them.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "libiio.h"
+#include "sim_backend.h"
+
+#define SIM_MAX_RADIOS 8
+#define SIM_GAIN_MANUAL 2     // gain_mode has no manual mode; it is set through the channel's gain_control_mode.
+#define SIM_RX_GAIN_MIN -3.0  // dB
+#define SIM_RX_GAIN_MAX 71.0
+
+typedef struct
+{
+    adradio_t *dev; // NULL if the entry is unused.
+    int ensm_mode;
+    long long rx_lo;
+    long long tx_lo;
+    long long samp;
+    long long rx_bw;
+    double tx_gain;
+    double rx_gain;
+    int gain_mode;
+    char fir[256];
+    int fir_enabled;
+} sim_radio_t;
+
+static pthread_mutex_t sim_radio_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_radio_t sim_radios[SIM_MAX_RADIOS];
+
+static uint64_t sim_iio_call_count = 0;
+
+void sim_iio_charge(void)
+{
+    __atomic_fetch_add(&sim_iio_call_count, 1, __ATOMIC_RELAXED);
+    uint32_t latency = sim_iio_latency_us();
+    if (latency > 0)
+    {
+        usleep(latency);
+    }
+}
+
+uint64_t sim_iio_calls(void)
+{
+    return __atomic_load_n(&sim_iio_call_count, __ATOMIC_RELAXED);
+}
+
+// Looks up a radio and charges the simulated libiio latency. Returns with sim_radio_lock held on success.
+static sim_radio_t *sim_radio_access(adradio_t *dev)
+{
+    sim_iio_charge();
+
+    pthread_mutex_lock(&sim_radio_lock);
+    for (int i = 0; i < SIM_MAX_RADIOS; i++)
+    {
+        if (sim_radios[i].dev == dev)
+        {
+            return &sim_radios[i];
+        }
+    }
+    pthread_mutex_unlock(&sim_radio_lock);
+    return NULL;
+}
+
+#define SIM_RADIO_TEMP 42000 // millidegrees C
+
+// Wanders a little, so that status consumers see changing values.
+static double sim_radio_rssi(void)
+{
+    return -60.0 + (rand() % 100) / 20.0;
+}
+
+#define SIM_RADIO_SET(field, value)          \
+    sim_radio_t *st = sim_radio_access(dev); \
+    if (st == NULL)                          \
+    {                                        \
+        return -1;                           \
+    }                                        \
+    st->field = value;                       \
+    pthread_mutex_unlock(&sim_radio_lock);   \
+    return 1;
+
+// AD9361 limits.
+#define SIM_LO_MIN 70000000LL
+#define SIM_LO_MAX 6000000000LL
+#define SIM_SAMP_MIN 520833LL
+#define SIM_SAMP_MAX 61440000LL
+#define SIM_BW_MIN 200000LL
+#define SIM_BW_MAX 56000000LL
+
+// Sleeps through the recalibration that follows a retune.
+static void sim_radio_retune(void)
+{
+    uint32_t ms = sim_retune_ms();
+    if (ms > 0)
+    {
+        usleep(ms * 1000);
+    }
+}
+
+#define SIM_RADIO_TUNE(field, value, min, max) \
+    if ((value) < (min) || (value) > (max))    \
+    {                                          \
+        sim_iio_charge();                      \
+        return -1;                             \
+    }                                          \
+    sim_radio_retune();                        \
+    SIM_RADIO_SET(field, value)
+
+#define SIM_RADIO_GET(field, out)            \
+    sim_radio_t *st = sim_radio_access(dev); \
+    if (st == NULL)                          \
+    {                                        \
+        return -1;                           \
+    }                                        \
+    *(out) = st->field;                      \
+    pthread_mutex_unlock(&sim_radio_lock);   \
+    return 1;
+
+int adradio_init(adradio_t *dev)
+{
+    pthread_mutex_lock(&sim_radio_lock);
+    for (int i = 0; i < SIM_MAX_RADIOS; i++)
+    {
+        if (sim_radios[i].dev == NULL)
+        {
+            sim_radio_t *st = &sim_radios[i];
+            memset(st, 0x0, sizeof(sim_radio_t));
+            st->dev = dev;
+            st->ensm_mode = SLEEP;
+            st->rx_lo = 2450000000LL;
+            st->tx_lo = 2450000000LL;
+            st->samp = 10000000LL;
+            st->rx_bw = 10000000LL;
+            st->rx_gain = 30.0;
+            st->gain_mode = SLOW_ATTACK;
+            pthread_mutex_unlock(&sim_radio_lock);
+            return 1;
+        }
+    }
+    pthread_mutex_unlock(&sim_radio_lock);
+    return -1;
+}
+
+int adradio_set_ensm_mode(adradio_t *dev, ensm_mode mode)
+{
+    if (mode < SLEEP || mode > TDD)
+    {
+        sim_iio_charge();
+        return -1;
+    }
+    SIM_RADIO_SET(ensm_mode, mode);
+}
+
+int adradio_get_ensm_mode(adradio_t *dev, char *buf, ssize_t len)
+{
+    static const char *names[] = {"sleep", "fdd", "tdd"};
+    sim_radio_t *st = sim_radio_access(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+    snprintf(buf, len, "%s", st->ensm_mode >= 0 && st->ensm_mode <= 2 ? names[st->ensm_mode] : "unknown");
+    pthread_mutex_unlock(&sim_radio_lock);
+    return 1;
+}
+
+int adradio_set_rx_lo(adradio_t *dev, long long freq)
+{
+    SIM_RADIO_TUNE(rx_lo, freq, SIM_LO_MIN, SIM_LO_MAX);
+}
+
+int adradio_get_rx_lo(adradio_t *dev, long long *freq)
+{
+    SIM_RADIO_GET(rx_lo, freq);
+}
+
+int adradio_set_tx_lo(adradio_t *dev, long long freq)
+{
+    SIM_RADIO_TUNE(tx_lo, freq, SIM_LO_MIN, SIM_LO_MAX);
+}
+
+int adradio_set_samp(adradio_t *dev, long long samp)
+{
+    SIM_RADIO_TUNE(samp, samp, SIM_SAMP_MIN, SIM_SAMP_MAX);
+}
+
+int adradio_get_samp(adradio_t *dev, long long *samp)
+{
+    SIM_RADIO_GET(samp, samp);
+}
+
+int adradio_set_rx_bw(adradio_t *dev, long long bw)
+{
+    SIM_RADIO_TUNE(rx_bw, bw, SIM_BW_MIN, SIM_BW_MAX);
+}
+
+int adradio_get_rx_bw(adradio_t *dev, long long *bw)
+{
+    SIM_RADIO_GET(rx_bw, bw);
+}
+
+int adradio_set_tx_hardwaregain(adradio_t *dev, double gain)
+{
+    SIM_RADIO_SET(tx_gain, gain);
+}
+
+int adradio_get_rx_hardwaregain(adradio_t *dev, double *gain)
+{
+    SIM_RADIO_GET(rx_gain, gain);
+}
+
+int adradio_set_rx_hardwaregainmode(adradio_t *dev, gain_mode mode)
+{
+    SIM_RADIO_SET(gain_mode, mode);
+}
+
+static const char *sim_gain_mode_name(int mode)
+{
+    return mode == SIM_GAIN_MANUAL ? "manual" : mode == FAST_ATTACK ? "fast_attack" : "slow_attack";
+}
+
+int adradio_get_rx_hardwaregainmode(adradio_t *dev, char *buf, ssize_t len)
+{
+    sim_radio_t *st = sim_radio_access(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+    snprintf(buf, len, "%s", sim_gain_mode_name(st->gain_mode));
+    pthread_mutex_unlock(&sim_radio_lock);
+    return 1;
+}
+
+int adradio_get_rssi(adradio_t *dev, double *rssi)
+{
+    sim_radio_t *st = sim_radio_access(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+    *rssi = sim_radio_rssi();
+    pthread_mutex_unlock(&sim_radio_lock);
+    return 1;
+}
+
+int adradio_get_temp(adradio_t *dev, long long *temp)
+{
+    sim_radio_t *st = sim_radio_access(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+    *temp = SIM_RADIO_TEMP;
+    pthread_mutex_unlock(&sim_radio_lock);
+    return 1;
+}
+
+int adradio_load_fir(adradio_t *dev, const char *fname)
+{
+    if (access(fname, R_OK) != 0)
+    {
+        return -1;
+    }
+    sim_radio_retune();
+    sim_radio_t *st = sim_radio_access(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+    snprintf(st->fir, sizeof(st->fir), "%s", fname);
+    st->fir_enabled = 1;
+    pthread_mutex_unlock(&sim_radio_lock);
+    return 1;
+}
+
+void adradio_destroy(adradio_t *dev)
+{
+    pthread_mutex_lock(&sim_radio_lock);
+    for (int i = 0; i < SIM_MAX_RADIOS; i++)
+    {
+        if (sim_radios[i].dev == dev)
+        {
+            memset(&sim_radios[i], 0x0, sizeof(sim_radio_t));
+        }
+    }
+    pthread_mutex_unlock(&sim_radio_lock);
+}
+
+int sim_radio_read_attrs(const char *channel, int output, int (*emit)(const char *attr, const char *value, void *data), void *data)
+{
+    static const char *names[] = {"sleep", "fdd", "tdd"};
+    char values[5][64];
+    const char *attrs[5];
+    int count = 0;
+
+    // One round trip for the whole set, however many attributes it holds.
+    sim_iio_charge();
+
+    pthread_mutex_lock(&sim_radio_lock);
+    sim_radio_t *st = NULL;
+    for (int i = 0; i < SIM_MAX_RADIOS && st == NULL; i++)
+    {
+        if (sim_radios[i].dev != NULL)
+        {
+            st = &sim_radios[i];
+        }
+    }
+    if (st == NULL)
+    {
+        pthread_mutex_unlock(&sim_radio_lock);
+        return -1;
+    }
+
+    if (channel == NULL)
+    {
+        attrs[count] = "ensm_mode";
+        snprintf(values[count++], 64, "%s", st->ensm_mode >= 0 && st->ensm_mode <= 2 ? names[st->ensm_mode] : "unknown");
+    }
+    else if (strcmp(channel, "voltage0") == 0 && !output)
+    {
+        attrs[count] = "hardwaregain";
+        snprintf(values[count++], 64, "%f dB", st->rx_gain);
+        attrs[count] = "gain_control_mode";
+        snprintf(values[count++], 64, "%s", sim_gain_mode_name(st->gain_mode));
+        attrs[count] = "rssi";
+        snprintf(values[count++], 64, "%.2f dB", sim_radio_rssi());
+        attrs[count] = "sampling_frequency";
+        snprintf(values[count++], 64, "%lld", st->samp);
+        attrs[count] = "rf_bandwidth";
+        snprintf(values[count++], 64, "%lld", st->rx_bw);
+    }
+    else if (strcmp(channel, "altvoltage0") == 0 && output)
+    {
+        attrs[count] = "frequency";
+        snprintf(values[count++], 64, "%lld", st->rx_lo);
+    }
+    else if (strcmp(channel, "temp0") == 0 && !output)
+    {
+        attrs[count] = "input";
+        snprintf(values[count++], 64, "%d", SIM_RADIO_TEMP);
+    }
+    pthread_mutex_unlock(&sim_radio_lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        int ret = emit(attrs[i], values[i], data);
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+    return count;
+}
+
+// The RX channel's gain attributes. Called with sim_radio_lock held.
+static int sim_radio_write_gain(sim_radio_t *st, const char *attr, const char *value)
+{
+    if (strcmp(attr, "gain_control_mode") == 0)
+    {
+        if (strcmp(value, "manual") == 0)
+        {
+            st->gain_mode = SIM_GAIN_MANUAL;
+        }
+        else if (strcmp(value, "slow_attack") == 0 || strcmp(value, "fast_attack") == 0)
+        {
+            st->gain_mode = value[0] == 'f' ? FAST_ATTACK : SLOW_ATTACK;
+        }
+        else
+        {
+            return -1;
+        }
+        return 1;
+    }
+    // The driver only takes a gain while the AGC is off.
+    double gain = atof(value);
+    if (strcmp(attr, "hardwaregain") != 0 || st->gain_mode != SIM_GAIN_MANUAL || gain < SIM_RX_GAIN_MIN || gain > SIM_RX_GAIN_MAX)
+    {
+        return -1;
+    }
+    st->rx_gain = gain;
+    return 1;
+}
+
+int sim_radio_write_attr(const char *channel, int output, const char *attr, const void *src, size_t len)
+{
+    int fir = channel == NULL && strcmp(attr, "filter_fir_config") == 0;
+    int gain = channel != NULL && strcmp(channel, "voltage0") == 0 && !output;
+    if (!fir && !gain && (channel != NULL || strcmp(attr, "in_out_voltage_filter_fir_en") != 0))
+    {
+        sim_iio_charge();
+        return -1;
+    }
+    if (fir)
+    {
+        sim_radio_retune();
+    }
+
+    sim_iio_charge();
+    pthread_mutex_lock(&sim_radio_lock);
+    sim_radio_t *st = NULL;
+    for (int i = 0; i < SIM_MAX_RADIOS && st == NULL; i++)
+    {
+        if (sim_radios[i].dev != NULL)
+        {
+            st = &sim_radios[i];
+        }
+    }
+    if (st == NULL)
+    {
+        pthread_mutex_unlock(&sim_radio_lock);
+        return -1;
+    }
+    if (gain)
+    {
+        char value[64];
+        snprintf(value, sizeof(value), "%.*s", (int)len, (const char *)src);
+        if (sim_radio_write_gain(st, attr, value) < 0)
+        {
+            pthread_mutex_unlock(&sim_radio_lock);
+            return -1;
+        }
+    }
+    else if (fir)
+    {
+        snprintf(st->fir, sizeof(st->fir), "(%zu bytes written)", len);
+    }
+    else
+    {
+        st->fir_enabled = len > 0 && ((const char *)src)[0] == '1';
+    }
+    pthread_mutex_unlock(&sim_radio_lock);
+    return (int)len;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file sim_backend.h
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Software stand-in for the rxmodem, adradio (libiio) and adf4355 drivers.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Linked in place of modem/, adf4355/, spibus/ and gpiodev/ by 'make haystack_sim', so that haystack can be run,
+ * profiled and regression-tested on a machine without the Zynq board or its UIO devices.
+ *
+ * The simulated modem either generates frames (configurable rate, size distribution and error rates) or replays
+ * captured rxdata*.bin files. Frames are scheduled at fixed instants; if the caller falls more than overflow_frames
+ * behind, the oldest pending frames are lost and counted as overflows, as the real DMA ring would lose them.
+ *
+ * The modem also has a descriptor queue (rxmodem_queue.h), served by a DMA engine thread per modem. A transfer moves
+ * the frame at dma_mb_per_s, one at a time, and completes dma_latency_us after that (descriptor write-back and the
+ * completion interrupt). rxmodem_read(...) waits out both for every frame; with a queue, the latency of one transfer
+ * overlaps the next.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef SIM_BACKEND_H
+#define SIM_BACKEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum
+{
+    SIM_SIZE_FIXED = 0,   // Every frame is size_min bytes.
+    SIM_SIZE_UNIFORM = 1, // Uniformly distributed in [size_min, size_max].
+} sim_size_dist;
+
+typedef struct
+{
+    double rate_fps;          // Frames per second; 0 delivers frames as fast as they are asked for.
+    sim_size_dist size_dist;
+    uint32_t size_min;
+    uint32_t size_max;
+    double error_rate;        // Fraction of rxmodem_receive(...) calls that fail.
+    double short_read_rate;   // Fraction of rxmodem_read(...) calls that return fewer bytes than received.
+    uint32_t overflow_frames; // Frames the modem can hold before it starts losing them.
+    char replay[256];         // If set, a glob of rxdata*.bin files to replay (in numeric order, looping) instead of generated frames.
+    uint32_t seed;            // Random seed, for repeatable runs.
+    uint32_t iio_latency_us;  // Added to every simulated libiio attribute access.
+    uint32_t pll_lock_ms;     // Time adf4355_init(...) and adf4355_set_rx(...) take to lock.
+    uint32_t retune_ms;       // Time the radio recalibrates for after an LO, sample rate, bandwidth or filter change.
+    uint32_t dma_latency_us;  // From a DMA transfer ending to its completion being seen.
+    uint32_t dma_mb_per_s;    // DMA transfer rate in MB/s; 0 for no per-byte cost.
+} sim_config_t;
+
+typedef struct
+{
+    uint64_t generated; // Frames the simulated modem produced.
+    uint64_t delivered; // Frames returned by rxmodem_receive(...).
+    uint64_t overflows; // Frames lost because the caller fell behind.
+    uint64_t errors;    // Receives and reads deliberately failed.
+    uint64_t iio_calls; // Simulated libiio attribute accesses.
+} sim_stats_t;
+
+/**
+ * @brief Fills a simulator configuration with defaults: 1000 fixed 1 KiB frames per second, no errors.
+ *
+ * @param config
+ */
+void sim_config_defaults(sim_config_t *config);
+
+/**
+ * @brief Applies a configuration to every simulated device, including ones already initialized.
+ *
+ * @param config
+ * @return int 1 on success, negative if replay files were requested but none could be loaded.
+ */
+int sim_configure(const sim_config_t *config);
+
+/**
+ * @brief Returns the simulator's counters, summed over all simulated modems.
+ *
+ * @param stats
+ */
+void sim_get_stats(sim_stats_t *stats);
+
+/**
+ * @brief Microseconds of simulated libiio latency, for use by the simulated radio.
+ *
+ * @return uint32_t
+ */
+uint32_t sim_iio_latency_us(void);
+
+/**
+ * @brief Milliseconds the simulated PLL takes to lock.
+ *
+ * @return uint32_t
+ */
+uint32_t sim_pll_lock_ms(void);
+
+/**
+ * @brief Milliseconds the simulated radio recalibrates for after a retune.
+ *
+ * @return uint32_t
+ */
+uint32_t sim_retune_ms(void);
+
+/**
+ * @brief Charges one simulated libiio round trip: counts it and sleeps for iio_latency_us.
+ *
+ */
+void sim_iio_charge(void);
+
+/**
+ * @brief Simulated libiio round trips so far.
+ *
+ * @return uint64_t
+ */
+uint64_t sim_iio_calls(void);
+
+/**
+ * @brief Backs the simulated libiio context (sim_iio.c): reads every attribute of one channel of the simulated radio
+ * for the price of a single round trip.
+ *
+ * @param channel "voltage0", "altvoltage0" or "temp0", or NULL for the device's own attributes.
+ * @param output Whether channel is an output channel.
+ * @param emit Called with each attribute and its value as text; a negative return stops the read.
+ * @param data Passed to emit.
+ * @return int Number of attributes read, or negative on failure.
+ */
+int sim_radio_read_attrs(const char *channel, int output, int (*emit)(const char *attr, const char *value, void *data), void *data);
+
+/**
+ * @brief Backs the simulated libiio context: writes one attribute of the simulated radio, the device's
+ * filter_fir_config or in_out_voltage_filter_fir_en, or the RX channel's gain_control_mode or hardwaregain.
+ *
+ * @param channel NULL for a device attribute.
+ * @param output Whether channel is an output channel.
+ * @param attr
+ * @param src
+ * @param len
+ * @return int len on success, negative if the attribute is unknown.
+ */
+int sim_radio_write_attr(const char *channel, int output, const char *attr, const void *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_BACKEND_H
@@ -0,0 +1,123 @@
+/**
+ * @file sim_iio.c
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief The subset of the libiio API (iio.h) haystack uses directly, implemented over the simulated radio.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The context holds one device, ad9361-phy, with the channels the radio status reads: voltage0 (input),
+ * altvoltage0 (output, the RX LO) and temp0 (input). Each *_attr_read_all(...) costs one simulated round trip, as
+ * does each attribute write. Of the attributes, only the filter's and the RX gain's can be written.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim_iio.h"
+#include "sim_backend.h"
+
+struct iio_channel
+{
+    const char *id;
+    bool output;
+};
+
+struct iio_device
+{
+    const char *name;
+    struct iio_channel channels[3];
+};
+
+struct iio_context
+{
+    struct iio_device phy;
+};
+
+typedef struct
+{
+    void *owner;
+    int (*dev_cb)(struct iio_device *dev, const char *attr, const char *value, size_t len, void *d);
+    int (*chn_cb)(struct iio_channel *chn, const char *attr, const char *val, size_t len, void *d);
+    void *data;
+} sim_iio_read_t;
+
+struct iio_context *iio_create_default_context(void)
+{
+    struct iio_context *ctx = (struct iio_context *)calloc(1, sizeof(struct iio_context));
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+    ctx->phy.name = "ad9361-phy";
+    ctx->phy.channels[0] = (struct iio_channel){"voltage0", false};
+    ctx->phy.channels[1] = (struct iio_channel){"altvoltage0", true};
+    ctx->phy.channels[2] = (struct iio_channel){"temp0", false};
+    return ctx;
+}
+
+void iio_context_destroy(struct iio_context *ctx)
+{
+    free(ctx);
+}
+
+struct iio_device *iio_context_find_device(const struct iio_context *ctx, const char *name)
+{
+    if (ctx == NULL || strcmp(name, ctx->phy.name) != 0)
+    {
+        return NULL;
+    }
+    return (struct iio_device *)&ctx->phy;
+}
+
+struct iio_channel *iio_device_find_channel(const struct iio_device *dev, const char *name, bool output)
+{
+    for (int i = 0; dev != NULL && i < 3; i++)
+    {
+        if (strcmp(dev->channels[i].id, name) == 0 && dev->channels[i].output == output)
+        {
+            return (struct iio_channel *)&dev->channels[i];
+        }
+    }
+    return NULL;
+}
+
+static int sim_iio_emit(const char *attr, const char *value, void *data)
+{
+    sim_iio_read_t *read = (sim_iio_read_t *)data;
+    if (read->dev_cb != NULL)
+    {
+        return read->dev_cb((struct iio_device *)read->owner, attr, value, strlen(value) + 1, read->data);
+    }
+    return read->chn_cb((struct iio_channel *)read->owner, attr, value, strlen(value) + 1, read->data);
+}
+
+int iio_device_attr_read_all(struct iio_device *dev,
+                             int (*cb)(struct iio_device *dev, const char *attr, const char *value, size_t len, void *d),
+                             void *data)
+{
+    sim_iio_read_t read = {dev, cb, NULL, data};
+    int ret = sim_radio_read_attrs(NULL, 0, sim_iio_emit, &read);
+    return ret < 0 ? ret : 0;
+}
+
+int iio_channel_attr_read_all(struct iio_channel *chn,
+                              int (*cb)(struct iio_channel *chn, const char *attr, const char *val, size_t len, void *d),
+                              void *data)
+{
+    sim_iio_read_t read = {chn, NULL, cb, data};
+    int ret = sim_radio_read_attrs(chn->id, chn->output, sim_iio_emit, &read);
+    return ret < 0 ? ret : 0;
+}
+
+ssize_t iio_device_attr_write_raw(const struct iio_device *dev, const char *attr, const void *src, size_t len)
+{
+    (void)dev;
+    return sim_radio_write_attr(NULL, 0, attr, src, len);
+}
+
+ssize_t iio_channel_attr_write_raw(const struct iio_channel *chn, const char *attr, const void *src, size_t len)
+{
+    return sim_radio_write_attr(chn->id, chn->output, attr, src, len);
+}
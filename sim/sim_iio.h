@@ -0,0 +1,48 @@
+/**
+ * @file sim_iio.h
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief The subset of the libiio API (iio.h) haystack uses directly, implemented over the simulated radio.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * Declarations match libiio's own, so code written against <iio.h> builds unchanged against the simulator.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef SIM_IIO_H
+#define SIM_IIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+struct iio_context;
+struct iio_device;
+struct iio_channel;
+
+struct iio_context *iio_create_default_context(void);
+void iio_context_destroy(struct iio_context *ctx);
+struct iio_device *iio_context_find_device(const struct iio_context *ctx, const char *name);
+struct iio_channel *iio_device_find_channel(const struct iio_device *dev, const char *name, bool output);
+
+int iio_device_attr_read_all(struct iio_device *dev,
+                             int (*cb)(struct iio_device *dev, const char *attr, const char *value, size_t len, void *d),
+                             void *data);
+int iio_channel_attr_read_all(struct iio_channel *chn,
+                              int (*cb)(struct iio_channel *chn, const char *attr, const char *val, size_t len, void *d),
+                              void *data);
+ssize_t iio_device_attr_write_raw(const struct iio_device *dev, const char *attr, const void *src, size_t len);
+ssize_t iio_channel_attr_write_raw(const struct iio_channel *chn, const char *attr, const void *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_IIO_H
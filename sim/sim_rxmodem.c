@@ -0,0 +1,720 @@
+/**
+ * @file sim_rxmodem.c
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Simulated rxmodem and UIO lookup.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <glob.h>
+#include <pthread.h>
+#include "rxmodem.h"
+#include "rxmodem_queue.h"
+#include "sim_backend.h"
+
+#define SIM_MAX_MODEMS 8
+#define SIM_COMPLETE_WAIT_NS 100000000ULL // Longest rxmodem_complete(...) waits, as rxmodem_receive(...) does while stopped.
+
+typedef struct
+{
+    uint8_t *data;
+    uint32_t size;
+} sim_replay_frame_t;
+
+typedef struct
+{
+    uint8_t *buf;
+    uint32_t capacity;
+    void *tag;
+    ssize_t frame_size; // Once filled: the frame's size, -1 for a failed receive.
+    ssize_t len;        // Once filled: bytes written into buf, -1 if none.
+    uint64_t done_ns;   // Once filled: when the transfer completes and the descriptor can be collected.
+} sim_desc_t;
+
+typedef struct
+{
+    rxmodem *dev; // NULL if the entry is unused. Written under sim_lock, read by sim_find(...) without it: __atomic only.
+    int running;  // Cleared by rxmodem_stop(...) while a receive may be in progress: __atomic only.
+    uint64_t rng;
+    uint64_t next_due; // CLOCK_MONOTONIC ns at which the next frame is ready.
+    uint64_t seq;
+    uint32_t replay_pos;
+    const uint8_t *pending; // The frame waiting to be read, in buffer or a replay frame.
+    uint32_t pending_size;
+    uint8_t *buffer; // Storage for generated frames.
+    uint32_t buffer_capacity;
+    sim_stats_t stats; // Read by sim_get_stats(...) from any thread: __atomic only.
+
+    // Descriptor queue. The DMA engine thread owns the frame schedule above while it is busy.
+    pthread_mutex_t q_lock;   // Guards everything below.
+    pthread_cond_t q_changed; // CLOCK_MONOTONIC. Broadcast on every change.
+    pthread_t engine;
+    int engine_started; // On the first rxmodem_submit(...).
+    int engine_busy;    // Working on the descriptor at q_head + q_filled.
+    uint64_t bus_free;  // When the transfer in progress ends.
+    int engine_quit;
+    int cancelling;     // rxmodem_cancel(...) is waiting for the engine to let go.
+    sim_desc_t q[RXMODEM_QUEUE_MAX];
+    uint32_t q_head;   // Oldest posted.
+    uint32_t q_count;  // Posted, from q_head.
+    uint32_t q_filled; // Filled, from q_head.
+} sim_modem_t;
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_config_t sim_config;
+static int sim_configured = 0;
+static sim_modem_t sim_modems[SIM_MAX_MODEMS];
+static sim_replay_frame_t *sim_replay = NULL;
+static uint32_t sim_replay_count = 0;
+
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// xorshift64*, plenty for picking sizes and errors.
+static uint64_t sim_rand(sim_modem_t *st)
+{
+    st->rng ^= st->rng >> 12;
+    st->rng ^= st->rng << 25;
+    st->rng ^= st->rng >> 27;
+    return st->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static double sim_rand_unit(sim_modem_t *st)
+{
+    return (sim_rand(st) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static sim_modem_t *sim_find(rxmodem *dev)
+{
+    for (int i = 0; i < SIM_MAX_MODEMS; i++)
+    {
+        if (__atomic_load_n(&sim_modems[i].dev, __ATOMIC_ACQUIRE) == dev)
+        {
+            return &sim_modems[i];
+        }
+    }
+    return NULL;
+}
+
+static int compare_versions(const void *a, const void *b)
+{
+    return strverscmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static void sim_free_replay(void)
+{
+    for (uint32_t i = 0; i < sim_replay_count; i++)
+    {
+        free(sim_replay[i].data);
+    }
+    free(sim_replay);
+    sim_replay = NULL;
+    sim_replay_count = 0;
+}
+
+static int sim_load_replay(const char *pattern)
+{
+    glob_t files;
+    if (glob(pattern, 0, NULL, &files) != 0 || files.gl_pathc == 0)
+    {
+        fprintf(stderr, "[sim] No replay files match '%s'.\n", pattern);
+        globfree(&files);
+        return -1;
+    }
+
+    // rxdata2.bin before rxdata10.bin.
+    qsort(files.gl_pathv, files.gl_pathc, sizeof(char *), compare_versions);
+
+    sim_replay = (sim_replay_frame_t *)calloc(files.gl_pathc, sizeof(sim_replay_frame_t));
+    for (size_t i = 0; i < files.gl_pathc; i++)
+    {
+        FILE *fp = fopen(files.gl_pathv[i], "rb");
+        if (fp == NULL)
+        {
+            continue;
+        }
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        if (size > 0)
+        {
+            sim_replay_frame_t *frame = &sim_replay[sim_replay_count];
+            frame->data = (uint8_t *)malloc(size);
+            frame->size = fread(frame->data, 1, size, fp);
+            sim_replay_count++;
+        }
+        fclose(fp);
+    }
+    globfree(&files);
+
+    fprintf(stderr, "[sim] Replaying %u frames from '%s'.\n", sim_replay_count, pattern);
+    return sim_replay_count > 0 ? 1 : -1;
+}
+
+void sim_config_defaults(sim_config_t *config)
+{
+    memset(config, 0x0, sizeof(sim_config_t));
+    config->rate_fps = 1000;
+    config->size_dist = SIM_SIZE_FIXED;
+    config->size_min = 1024;
+    config->size_max = 1024;
+    config->overflow_frames = 4;
+    config->seed = 1;
+}
+
+int sim_configure(const sim_config_t *config)
+{
+    int retval = 1;
+
+    pthread_mutex_lock(&sim_lock);
+    sim_config = *config;
+    sim_configured = 1;
+
+    sim_free_replay();
+    if (sim_config.replay[0] != '\0' && sim_load_replay(sim_config.replay) < 0)
+    {
+        retval = -1;
+    }
+
+    for (int i = 0; i < SIM_MAX_MODEMS; i++)
+    {
+        sim_modems[i].rng = ((uint64_t)sim_config.seed << 8) + i + 1;
+        sim_modems[i].next_due = 0;
+    }
+    pthread_mutex_unlock(&sim_lock);
+
+    return retval;
+}
+
+void sim_get_stats(sim_stats_t *stats)
+{
+    memset(stats, 0x0, sizeof(sim_stats_t));
+
+    pthread_mutex_lock(&sim_lock);
+    for (int i = 0; i < SIM_MAX_MODEMS; i++)
+    {
+        stats->generated += __atomic_load_n(&sim_modems[i].stats.generated, __ATOMIC_RELAXED);
+        stats->delivered += __atomic_load_n(&sim_modems[i].stats.delivered, __ATOMIC_RELAXED);
+        stats->overflows += __atomic_load_n(&sim_modems[i].stats.overflows, __ATOMIC_RELAXED);
+        stats->errors += __atomic_load_n(&sim_modems[i].stats.errors, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    stats->iio_calls = sim_iio_calls();
+}
+
+uint32_t sim_iio_latency_us(void)
+{
+    return sim_config.iio_latency_us;
+}
+
+uint32_t sim_pll_lock_ms(void)
+{
+    return sim_config.pll_lock_ms;
+}
+
+uint32_t sim_retune_ms(void)
+{
+    return sim_config.retune_ms;
+}
+
+// "rx_ipcore" and "rx_dma" are the first receive chain's; "rx_ipcoreN" and "rx_dmaN" the others'.
+int uio_get_id(const char *name)
+{
+    int chain = 0;
+    if (strncmp(name, "rx_ipcore", 9) == 0 && (name[9] == '\0' || sscanf(name + 9, "%d", &chain) == 1) && chain >= 0 && chain < SIM_MAX_MODEMS)
+    {
+        return 2 * chain;
+    }
+    else if (strncmp(name, "rx_dma", 6) == 0 && (name[6] == '\0' || sscanf(name + 6, "%d", &chain) == 1) && chain >= 0 && chain < SIM_MAX_MODEMS)
+    {
+        return 2 * chain + 1;
+    }
+    return -1;
+}
+
+// Stands in for the driver's interrupt thread, which haystack may pthread_cancel(...).
+static void *sim_irq_thread(void *args)
+{
+    (void)args;
+    while (1)
+    {
+        pause();
+    }
+    return NULL;
+}
+
+int rxmodem_init(rxmodem *dev, int uio_id, int dma_id)
+{
+    if (uio_id < 0 || dma_id < 0)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&sim_lock);
+    if (!sim_configured)
+    {
+        sim_config_defaults(&sim_config);
+        sim_configured = 1;
+    }
+
+    sim_modem_t *st = sim_find(NULL);
+    if (st == NULL)
+    {
+        pthread_mutex_unlock(&sim_lock);
+        return -1;
+    }
+
+    memset((uint8_t *)st + sizeof(st->dev), 0x0, sizeof(sim_modem_t) - sizeof(st->dev));
+    st->running = 1;
+    st->rng = ((uint64_t)sim_config.seed << 8) + (st - sim_modems) + 1;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&st->q_lock, NULL);
+    pthread_cond_init(&st->q_changed, &attr);
+    pthread_condattr_destroy(&attr);
+
+    __atomic_store_n(&st->dev, dev, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&sim_lock);
+
+    pthread_create(dev->thr, NULL, sim_irq_thread, NULL);
+    pthread_detach(*(dev->thr));
+
+    return 1;
+}
+
+int rxmodem_start(rxmodem *dev)
+{
+    sim_modem_t *st = sim_find(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&st->q_lock);
+    // Frames filled before the stop are as stale as those that arrived while stopped: their buffers are filled again.
+    st->q_filled = 0;
+    st->next_due = 0;
+    st->bus_free = 0;
+    __atomic_store_n(&st->running, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&st->q_changed);
+    pthread_mutex_unlock(&st->q_lock);
+    return 1;
+}
+
+int rxmodem_stop(rxmodem *dev)
+{
+    sim_modem_t *st = sim_find(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&st->q_lock);
+    __atomic_store_n(&st->running, 0, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&st->q_changed);
+    // The engine drops the frame it is waiting for, or finishes the transfer it is in.
+    while (st->engine_busy)
+    {
+        pthread_cond_wait(&st->q_changed, &st->q_lock);
+    }
+    pthread_mutex_unlock(&st->q_lock);
+    return 1;
+}
+
+static uint32_t sim_next_size(sim_modem_t *st)
+{
+    if (sim_config.size_dist == SIM_SIZE_UNIFORM && sim_config.size_max > sim_config.size_min)
+    {
+        return sim_config.size_min + sim_rand(st) % (sim_config.size_max - sim_config.size_min + 1);
+    }
+    return sim_config.size_min > 0 ? sim_config.size_min : 1;
+}
+
+// Generated frames start with the frame sequence number and the CLOCK_MONOTONIC time the frame became ready (both
+// little-endian uint64_t, as far as the frame is long enough), so that a receiver on the same host can check ordering
+// and measure latency. The rest is a pattern derived from the sequence number.
+static void sim_generate(sim_modem_t *st, uint64_t ready_ns)
+{
+    if (sim_replay_count > 0)
+    {
+        sim_replay_frame_t *frame = &sim_replay[st->replay_pos++ % sim_replay_count];
+        st->pending = frame->data;
+        st->pending_size = frame->size;
+        return;
+    }
+
+    uint32_t size = sim_next_size(st);
+    if (st->buffer_capacity < size)
+    {
+        free(st->buffer);
+        st->buffer = (uint8_t *)malloc(size);
+        st->buffer_capacity = size;
+    }
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        st->buffer[i] = (uint8_t)(st->seq + i);
+    }
+
+    uint64_t header[2] = {st->seq, ready_ns};
+    memcpy(st->buffer, header, size < sizeof(header) ? size : sizeof(header));
+
+    st->pending = st->buffer;
+    st->pending_size = size;
+}
+
+// Takes the next frame's place in the schedule and returns when it is ready. Frames that became ready while nobody
+// was receiving pile up in the modem; past its capacity they are lost.
+static uint64_t sim_schedule(sim_modem_t *st, uint64_t now)
+{
+    if (sim_config.rate_fps <= 0)
+    {
+        return now;
+    }
+
+    uint64_t period = (uint64_t)(1e9 / sim_config.rate_fps);
+    if (period < 1)
+    {
+        period = 1;
+    }
+
+    if (st->next_due == 0)
+    {
+        st->next_due = now;
+    }
+
+    if (now > st->next_due)
+    {
+        uint64_t backlog = (now - st->next_due) / period;
+        if (backlog > sim_config.overflow_frames)
+        {
+            uint64_t lost = backlog - sim_config.overflow_frames;
+            st->next_due += lost * period;
+            st->seq += lost;
+            __atomic_fetch_add(&st->stats.generated, lost, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&st->stats.overflows, lost, __ATOMIC_RELAXED);
+        }
+    }
+
+    uint64_t ready_ns = st->next_due;
+    st->next_due += period;
+    return ready_ns;
+}
+
+// The frame that became ready at ready_ns: fails it at error_rate, otherwise leaves it pending. Returns its size.
+static ssize_t sim_produce(sim_modem_t *st, uint64_t ready_ns)
+{
+    __atomic_fetch_add(&st->stats.generated, 1, __ATOMIC_RELAXED);
+
+    if (sim_config.error_rate > 0 && sim_rand_unit(st) < sim_config.error_rate)
+    {
+        st->seq++;
+        __atomic_fetch_add(&st->stats.errors, 1, __ATOMIC_RELAXED);
+        st->pending_size = 0;
+        return -1;
+    }
+
+    sim_generate(st, ready_ns);
+    st->seq++;
+    __atomic_fetch_add(&st->stats.delivered, 1, __ATOMIC_RELAXED);
+
+    return st->pending_size;
+}
+
+// Bytes of the pending frame a read of up to size bytes gets, short at short_read_rate.
+static ssize_t sim_read_len(sim_modem_t *st, ssize_t size)
+{
+    ssize_t len = size < (ssize_t)st->pending_size ? size : (ssize_t)st->pending_size;
+
+    if (sim_config.short_read_rate > 0 && sim_rand_unit(st) < sim_config.short_read_rate)
+    {
+        __atomic_fetch_add(&st->stats.errors, 1, __ATOMIC_RELAXED);
+        len /= 2;
+    }
+    return len;
+}
+
+// Time the DMA engine spends moving len bytes; only one transfer moves at a time.
+static uint64_t sim_bus_ns(ssize_t len)
+{
+    return sim_config.dma_mb_per_s > 0 && len > 0 ? (uint64_t)len * 1000 / sim_config.dma_mb_per_s : 0;
+}
+
+static void sim_sleep_until(uint64_t ns)
+{
+    struct timespec due = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) != 0)
+    {
+    }
+}
+
+ssize_t rxmodem_receive(rxmodem *dev)
+{
+    sim_modem_t *st = sim_find(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+
+    if (!__atomic_load_n(&st->running, __ATOMIC_ACQUIRE))
+    {
+        usleep(100000);
+        return -1;
+    }
+
+    uint64_t ready_ns = sim_schedule(st, mono_ns());
+    if (ready_ns > mono_ns())
+    {
+        sim_sleep_until(ready_ns);
+    }
+
+    return sim_produce(st, ready_ns);
+}
+
+ssize_t rxmodem_read(rxmodem *dev, uint8_t *buf, ssize_t size)
+{
+    sim_modem_t *st = sim_find(dev);
+    if (st == NULL || st->pending_size == 0)
+    {
+        return -1;
+    }
+
+    ssize_t len = sim_read_len(st, size);
+
+    // The read is a DMA transfer started now, which the caller waits out, latency and all.
+    uint64_t transfer_ns = sim_bus_ns(len) + (uint64_t)sim_config.dma_latency_us * 1000;
+    if (transfer_ns > 0)
+    {
+        sim_sleep_until(mono_ns() + transfer_ns);
+    }
+
+    memcpy(buf, st->pending, len);
+    st->pending_size = 0;
+    return len;
+}
+
+// Waits on q_changed until ns, or until woken. Returns 0 once ns has passed.
+static int sim_q_wait(sim_modem_t *st, uint64_t ns)
+{
+    struct timespec due = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+    return pthread_cond_timedwait(&st->q_changed, &st->q_lock, &due) == ETIMEDOUT ? 0 : 1;
+}
+
+// Whether the engine should let go of the descriptor it is working on.
+static int sim_q_abandon(sim_modem_t *st)
+{
+    return st->engine_quit || st->cancelling || !__atomic_load_n(&st->running, __ATOMIC_ACQUIRE);
+}
+
+// The DMA engine: fills posted descriptors in order, one frame each, as frames become ready. A frame's transfer starts
+// when it is ready and the previous transfer has ended, and takes sim_bus_ns(...); its descriptor can be collected
+// dma_latency_us after that (descriptor write-back and the completion interrupt), while the next transfer moves.
+static void *sim_dma_engine(void *args)
+{
+    sim_modem_t *st = (sim_modem_t *)args;
+
+    pthread_mutex_lock(&st->q_lock);
+    while (!st->engine_quit)
+    {
+        if (st->q_filled == st->q_count || sim_q_abandon(st))
+        {
+            pthread_cond_wait(&st->q_changed, &st->q_lock);
+            continue;
+        }
+
+        st->engine_busy = 1;
+        sim_desc_t *desc = &st->q[(st->q_head + st->q_filled) % RXMODEM_QUEUE_MAX];
+
+        // Frames pile up in the modem while the previous transfer is still moving.
+        while (!sim_q_abandon(st) && sim_q_wait(st, st->bus_free))
+        {
+        }
+        uint64_t ready_ns = sim_schedule(st, mono_ns());
+        while (!sim_q_abandon(st) && sim_q_wait(st, ready_ns))
+        {
+        }
+        if (sim_q_abandon(st))
+        {
+            st->engine_busy = 0;
+            pthread_cond_broadcast(&st->q_changed);
+            continue;
+        }
+
+        // The descriptor is the engine's until it is marked filled; cancel and stop wait for engine_busy to clear.
+        pthread_mutex_unlock(&st->q_lock);
+        ssize_t frame_size = sim_produce(st, ready_ns);
+        ssize_t len = -1;
+        if (frame_size > 0)
+        {
+            len = sim_read_len(st, desc->capacity);
+            memcpy(desc->buf, st->pending, len);
+            st->pending_size = 0;
+        }
+        uint64_t now = mono_ns();
+        pthread_mutex_lock(&st->q_lock);
+
+        st->bus_free = (now > ready_ns ? now : ready_ns) + sim_bus_ns(len);
+        desc->frame_size = frame_size;
+        desc->len = len;
+        desc->done_ns = st->bus_free + (uint64_t)sim_config.dma_latency_us * 1000;
+        st->q_filled++;
+        st->engine_busy = 0;
+        pthread_cond_broadcast(&st->q_changed);
+    }
+    pthread_mutex_unlock(&st->q_lock);
+
+    return NULL;
+}
+
+int rxmodem_queue_depth(rxmodem *dev)
+{
+    return sim_find(dev) != NULL ? RXMODEM_QUEUE_MAX : 0;
+}
+
+int rxmodem_submit(rxmodem *dev, uint8_t *buf, uint32_t capacity, void *tag)
+{
+    sim_modem_t *st = sim_find(dev);
+    if (st == NULL || buf == NULL || tag == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&st->q_lock);
+    if (st->q_count == RXMODEM_QUEUE_MAX)
+    {
+        pthread_mutex_unlock(&st->q_lock);
+        return -1;
+    }
+
+    if (!st->engine_started)
+    {
+        if (pthread_create(&st->engine, NULL, sim_dma_engine, st) != 0)
+        {
+            pthread_mutex_unlock(&st->q_lock);
+            return -1;
+        }
+        st->engine_started = 1;
+    }
+
+    sim_desc_t *desc = &st->q[(st->q_head + st->q_count) % RXMODEM_QUEUE_MAX];
+    desc->buf = buf;
+    desc->capacity = capacity;
+    desc->tag = tag;
+    desc->frame_size = -1;
+    desc->len = -1;
+    st->q_count++;
+    pthread_cond_broadcast(&st->q_changed);
+    pthread_mutex_unlock(&st->q_lock);
+
+    return 1;
+}
+
+ssize_t rxmodem_complete(rxmodem *dev, void **tag, ssize_t *frame_size)
+{
+    *tag = NULL;
+    *frame_size = -1;
+
+    sim_modem_t *st = sim_find(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&st->q_lock);
+    // A wait in progress returns at a stop, as a receive does; one begun while stopped waits out the timeout.
+    int running = __atomic_load_n(&st->running, __ATOMIC_ACQUIRE);
+    uint64_t deadline = mono_ns() + SIM_COMPLETE_WAIT_NS;
+    while (st->q_filled == 0 && st->q_count > 0 && (!running || __atomic_load_n(&st->running, __ATOMIC_ACQUIRE)) && sim_q_wait(st, deadline))
+    {
+    }
+    // Filled, but the transfer may not have completed yet.
+    while (st->q_filled > 0 && st->q[st->q_head].done_ns > mono_ns() && sim_q_wait(st, st->q[st->q_head].done_ns))
+    {
+    }
+
+    ssize_t len = -1;
+    if (st->q_filled > 0)
+    {
+        sim_desc_t *desc = &st->q[st->q_head];
+        *tag = desc->tag;
+        *frame_size = desc->frame_size;
+        len = desc->len;
+        st->q_head = (st->q_head + 1) % RXMODEM_QUEUE_MAX;
+        st->q_count--;
+        st->q_filled--;
+    }
+    pthread_mutex_unlock(&st->q_lock);
+
+    return len;
+}
+
+int rxmodem_cancel(rxmodem *dev, void **tags, int max)
+{
+    sim_modem_t *st = sim_find(dev);
+    if (st == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&st->q_lock);
+    st->cancelling = 1;
+    pthread_cond_broadcast(&st->q_changed);
+    while (st->engine_busy)
+    {
+        pthread_cond_wait(&st->q_changed, &st->q_lock);
+    }
+
+    int count = 0;
+    for (; st->q_count > 0 && count < max; count++)
+    {
+        tags[count] = st->q[st->q_head].tag;
+        st->q_head = (st->q_head + 1) % RXMODEM_QUEUE_MAX;
+        st->q_count--;
+    }
+    st->q_filled = 0;
+    st->q_count = 0;
+    st->cancelling = 0;
+    pthread_mutex_unlock(&st->q_lock);
+
+    return count;
+}
+
+void rxmodem_destroy(rxmodem *dev)
+{
+    pthread_mutex_lock(&sim_lock);
+    sim_modem_t *st = sim_find(dev);
+    if (st != NULL)
+    {
+        pthread_mutex_lock(&st->q_lock);
+        st->engine_quit = 1;
+        pthread_cond_broadcast(&st->q_changed);
+        pthread_mutex_unlock(&st->q_lock);
+        if (st->engine_started)
+        {
+            pthread_join(st->engine, NULL);
+        }
+        pthread_cond_destroy(&st->q_changed);
+        pthread_mutex_destroy(&st->q_lock);
+
+        free(st->buffer);
+        __atomic_store_n(&st->dev, NULL, __ATOMIC_RELEASE);
+        memset((uint8_t *)st + sizeof(st->dev), 0x0, sizeof(sim_modem_t) - sizeof(st->dev));
+    }
+    pthread_mutex_unlock(&sim_lock);
+}
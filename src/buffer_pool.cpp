@@ -0,0 +1,163 @@
+/**
+ * @file buffer_pool.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Fixed-capacity pool of preallocated frame buffers with RAII handles.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_pool.hpp"
+#include "meb_debug.hpp"
+
+#define TOP_INDEX(top) ((uint32_t)(top))
+#define TOP_TAG(top) ((uint32_t)((top) >> 32))
+#define MAKE_TOP(tag, index) (((uint64_t)(tag) << 32) | (uint32_t)(index))
+
+int buffer_pool_init(buffer_pool_t *pool, uint32_t count, uint32_t buffer_size)
+{
+    if (count < 1 || buffer_size < 1)
+    {
+        dbprintlf(RED_FG "Invalid pool geometry: %u buffers of %u bytes.", count, buffer_size);
+        return -1;
+    }
+
+    pool->count = count;
+    pool->next = new std::atomic<uint32_t>[count];
+    pool->refs = new std::atomic<uint32_t>[count];
+    pool->frames = (rx_frame_t *)calloc(count, sizeof(rx_frame_t));
+    pool->storage = (uint8_t *)malloc((size_t)count * buffer_size);
+
+    if (pool->frames == NULL || pool->storage == NULL)
+    {
+        dbprintlf(RED_FG "Failed to allocate %u buffers of %u bytes.", count, buffer_size);
+        free(pool->frames);
+        free(pool->storage);
+        delete[] pool->next;
+        delete[] pool->refs;
+        return -2;
+    }
+
+    // Touch every page now so that no stage takes a page fault on a fresh buffer.
+    memset(pool->storage, 0x0, (size_t)count * buffer_size);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pool->frames[i].data = pool->storage + (size_t)i * buffer_size;
+        pool->frames[i].capacity = buffer_size;
+        pool->next[i].store(i + 1 < count ? i + 1 : POOL_INDEX_NONE, std::memory_order_relaxed);
+        pool->refs[i].store(0, std::memory_order_relaxed);
+    }
+
+    pool->top.store(MAKE_TOP(0, 0), std::memory_order_relaxed);
+    pool->in_use.store(0, std::memory_order_relaxed);
+    pool->high_water.store(0, std::memory_order_relaxed);
+    pool->exhausted.store(0, std::memory_order_relaxed);
+
+    return 1;
+}
+
+void buffer_pool_destroy(buffer_pool_t *pool)
+{
+    if (pool->in_use.load(std::memory_order_relaxed) > 0)
+    {
+        dbprintlf(YELLOW_FG "Destroying buffer pool with %u buffers still in use.", pool->in_use.load(std::memory_order_relaxed));
+    }
+
+    delete[] pool->next;
+    delete[] pool->refs;
+    free(pool->frames);
+    free(pool->storage);
+    pool->next = NULL;
+    pool->refs = NULL;
+    pool->frames = NULL;
+    pool->storage = NULL;
+}
+
+PoolBuffer buffer_pool_acquire(buffer_pool_t *pool)
+{
+    uint64_t top = pool->top.load(std::memory_order_acquire);
+    uint32_t index;
+
+    do
+    {
+        index = TOP_INDEX(top);
+        if (index == POOL_INDEX_NONE)
+        {
+            pool->exhausted.fetch_add(1, std::memory_order_relaxed);
+            return PoolBuffer();
+        }
+    } while (!pool->top.compare_exchange_weak(top, MAKE_TOP(TOP_TAG(top) + 1, pool->next[index].load(std::memory_order_relaxed)), std::memory_order_acq_rel, std::memory_order_acquire));
+
+    uint32_t in_use = pool->in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t high_water = pool->high_water.load(std::memory_order_relaxed);
+    while (in_use > high_water && !pool->high_water.compare_exchange_weak(high_water, in_use, std::memory_order_relaxed))
+    {
+    }
+
+    pool->refs[index].store(1, std::memory_order_relaxed);
+    pool->frames[index].size = 0;
+    pool->frames[index].timestamp = 0;
+    pool->frames[index].chain = 0;
+    return PoolBuffer(pool, index);
+}
+
+void buffer_pool_release(buffer_pool_t *pool, uint32_t index)
+{
+    // acq_rel so that every holder's reads of the buffer happen before whoever acquires it next writes to it.
+    if (pool->refs[index].fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    uint64_t top = pool->top.load(std::memory_order_relaxed);
+    do
+    {
+        pool->next[index].store(TOP_INDEX(top), std::memory_order_relaxed);
+    } while (!pool->top.compare_exchange_weak(top, MAKE_TOP(TOP_TAG(top) + 1, index), std::memory_order_release, std::memory_order_relaxed));
+
+    pool->in_use.fetch_sub(1, std::memory_order_relaxed);
+}
+
+PoolBuffer &PoolBuffer::operator=(PoolBuffer &&other)
+{
+    if (this != &other)
+    {
+        reset();
+        pool = other.pool;
+        index = other.index;
+        other.index = POOL_INDEX_NONE;
+    }
+    return *this;
+}
+
+void PoolBuffer::reset()
+{
+    if (valid())
+    {
+        buffer_pool_release(pool, index);
+        index = POOL_INDEX_NONE;
+    }
+}
+
+PoolBuffer PoolBuffer::share() const
+{
+    if (!valid())
+    {
+        return PoolBuffer();
+    }
+    pool->refs[index].fetch_add(1, std::memory_order_relaxed);
+    return PoolBuffer(pool, index);
+}
+
+uint32_t PoolBuffer::detach()
+{
+    uint32_t ret = index;
+    index = POOL_INDEX_NONE;
+    return ret;
+}
@@ -0,0 +1,274 @@
+/**
+ * @file frame_ring.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Bounded lock-free single-producer/single-consumer ring of buffer pool indices.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "frame_ring.hpp"
+#include "meb_debug.hpp"
+
+static uint32_t round_up_pow2(uint32_t val)
+{
+    uint32_t ret = 1;
+    while (ret < val)
+    {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+// sem_timedwait(...) wants an absolute CLOCK_REALTIME deadline.
+static void deadline_from_now(struct timespec *ts, uint64_t timeout_us)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout_us / 1000000;
+    ts->tv_nsec += (long)(timeout_us % 1000000) * 1000L;
+    if (ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+int frame_ring_init(frame_ring_t *ring, buffer_pool_t *pool, uint32_t capacity, ring_policy policy)
+{
+    if (capacity < 1)
+    {
+        dbprintlf(RED_FG "Invalid ring capacity: %u.", capacity);
+        return -1;
+    }
+
+    ring->capacity = round_up_pow2(capacity);
+    ring->policy = policy;
+    ring->pool = pool;
+    ring->ready = new std::atomic<uint32_t>[ring->capacity];
+
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->dropped_oldest.store(0, std::memory_order_relaxed);
+    ring->dropped_newest.store(0, std::memory_order_relaxed);
+    ring->blocked.store(0, std::memory_order_relaxed);
+    ring->closed.store(false, std::memory_order_relaxed);
+    ring->consumer_waiting.store(false, std::memory_order_relaxed);
+    ring->producer_waiting.store(false, std::memory_order_relaxed);
+
+    sem_init(&ring->items, 0, 0);
+    sem_init(&ring->space, 0, 0);
+
+    return 1;
+}
+
+// Takes the oldest queued index. Used by the consumer, and by the producer when dropping the oldest frame, so tail is
+// claimed with a CAS. The index is read before the claim; if the claim succeeds the producer cannot have overwritten
+// that entry, since it only reuses an entry once tail has moved past it.
+static int ring_take(frame_ring_t *ring, uint32_t *index)
+{
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    while (tail != ring->head.load(std::memory_order_acquire))
+    {
+        uint32_t idx = ring->ready[tail & (ring->capacity - 1)].load(std::memory_order_relaxed);
+        // seq_cst, so that a producer waiting for space sees it or is woken (ring_wake(...)).
+        if (ring->tail.compare_exchange_weak(tail, tail + 1, std::memory_order_seq_cst, std::memory_order_acquire))
+        {
+            *index = idx;
+            return 1;
+        }
+        // tail was reloaded by the failed CAS.
+    }
+    return 0;
+}
+
+// The side that made progress, after its seq_cst update of head or tail: posts the other side's semaphore if, and
+// only if, it said it was waiting, so that a semaphore never holds more than the one post its waiter is owed. Either
+// the waiter sees the update when it looks again (ring_wait(...)), or this sees its flag.
+static void ring_wake(std::atomic<bool> *waiting, sem_t *sem)
+{
+    if (waiting->load(std::memory_order_seq_cst) && waiting->exchange(false, std::memory_order_seq_cst))
+    {
+        sem_post(sem);
+    }
+}
+
+// The side about to sleep: says so. It must then look at head or tail once more, seq_cst, before waiting.
+static void ring_wait(std::atomic<bool> *waiting)
+{
+    waiting->store(true, std::memory_order_seq_cst);
+}
+
+// The side that said it was waiting but stopped without being posted. If the other side cleared the flag first, its
+// post is on the way and is taken here, so that it does not wake a later wait for nothing.
+static void ring_unwait(std::atomic<bool> *waiting, sem_t *sem)
+{
+    if (!waiting->exchange(false, std::memory_order_relaxed))
+    {
+        while (sem_wait(sem) < 0 && errno == EINTR)
+        {
+        }
+    }
+}
+
+void frame_ring_destroy(frame_ring_t *ring)
+{
+    uint32_t idx;
+    while (ring_take(ring, &idx))
+    {
+        buffer_pool_release(ring->pool, idx);
+    }
+
+    sem_destroy(&ring->items);
+    sem_destroy(&ring->space);
+    delete[] ring->ready;
+    ring->ready = NULL;
+}
+
+int frame_ring_commit(frame_ring_t *ring, PoolBuffer &frame)
+{
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    bool waited = false;
+
+    while (head - ring->tail.load(std::memory_order_acquire) >= ring->capacity)
+    {
+        switch (ring->policy)
+        {
+        case RING_DROP_OLDEST:
+        {
+            uint32_t oldest;
+            if (ring_take(ring, &oldest))
+            {
+                ring->dropped_oldest.fetch_add(1, std::memory_order_relaxed);
+                buffer_pool_release(ring->pool, oldest);
+            }
+            // Otherwise the consumer emptied a slot in the meantime.
+            break;
+        }
+        case RING_DROP_NEWEST:
+        {
+            ring->dropped_newest.fetch_add(1, std::memory_order_relaxed);
+            frame.reset();
+            return 0;
+        }
+        case RING_BLOCK:
+        {
+            if (ring->closed.load(std::memory_order_acquire))
+            {
+                ring->dropped_newest.fetch_add(1, std::memory_order_relaxed);
+                frame.reset();
+                return 0;
+            }
+            if (!waited)
+            {
+                ring->blocked.fetch_add(1, std::memory_order_relaxed);
+                waited = true;
+            }
+            ring_wait(&ring->producer_waiting);
+            if (head - ring->tail.load(std::memory_order_seq_cst) < ring->capacity)
+            {
+                ring_unwait(&ring->producer_waiting, &ring->space);
+                break;
+            }
+            struct timespec deadline;
+            deadline_from_now(&deadline, 100000);
+            if (sem_timedwait(&ring->space, &deadline) < 0)
+            {
+                ring_unwait(&ring->producer_waiting, &ring->space);
+            }
+            break;
+        }
+        }
+    }
+
+    ring->ready[head & (ring->capacity - 1)].store(frame.detach(), std::memory_order_relaxed);
+    ring->head.store(head + 1, std::memory_order_seq_cst);
+    ring_wake(&ring->consumer_waiting, &ring->items);
+    return 1;
+}
+
+PoolBuffer frame_ring_pop(frame_ring_t *ring, int timeout_ms)
+{
+    return frame_ring_pop_us(ring, (uint64_t)timeout_ms * 1000);
+}
+
+PoolBuffer frame_ring_pop_us(frame_ring_t *ring, uint64_t timeout_us)
+{
+    uint32_t idx;
+    struct timespec deadline;
+    deadline_from_now(&deadline, timeout_us);
+
+    while (!ring_take(ring, &idx))
+    {
+        if (ring->closed.load(std::memory_order_acquire))
+        {
+            return PoolBuffer();
+        }
+        ring_wait(&ring->consumer_waiting);
+        if (ring->head.load(std::memory_order_seq_cst) != ring->tail.load(std::memory_order_relaxed))
+        {
+            ring_unwait(&ring->consumer_waiting, &ring->items);
+            continue;
+        }
+        if (sem_timedwait(&ring->items, &deadline) < 0)
+        {
+            int err = errno;
+            ring_unwait(&ring->consumer_waiting, &ring->items);
+            if (err == ETIMEDOUT)
+            {
+                if (!ring_take(ring, &idx))
+                {
+                    return PoolBuffer();
+                }
+                break;
+            }
+        }
+    }
+
+    if (ring->policy == RING_BLOCK)
+    {
+        ring_wake(&ring->producer_waiting, &ring->space);
+    }
+
+    return PoolBuffer(ring->pool, idx);
+}
+
+uint32_t frame_ring_depth(frame_ring_t *ring)
+{
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    return ring->head.load(std::memory_order_acquire) - tail;
+}
+
+void frame_ring_close(frame_ring_t *ring)
+{
+    ring->closed.store(true, std::memory_order_release);
+    sem_post(&ring->items);
+    sem_post(&ring->space);
+}
+
+int frame_ring_policy_from_string(const char *name, ring_policy *policy)
+{
+    if (strcmp(name, "drop_oldest") == 0)
+    {
+        *policy = RING_DROP_OLDEST;
+    }
+    else if (strcmp(name, "drop_newest") == 0)
+    {
+        *policy = RING_DROP_NEWEST;
+    }
+    else if (strcmp(name, "block") == 0)
+    {
+        *policy = RING_BLOCK;
+    }
+    else
+    {
+        return -1;
+    }
+    return 1;
+}
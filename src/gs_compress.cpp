@@ -0,0 +1,557 @@
+/**
+ * @file gs_compress.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Optional LZ4 or zstd compression of received frames on their way to the server, on a pool of worker threads.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#ifdef HAYSTACK_COMPRESS
+#include "lz4.h"
+#include "zstd.h"
+#endif
+#include "gs_compress.hpp"
+#include "meb_debug.hpp"
+
+#define LZ4_LEVEL_MAX 127 // Acceleration; gs_compress_hdr_t::level holds it.
+#define ZSTD_LEVEL_MIN -7
+#define ZSTD_LEVEL_MAX 19
+
+// Fastest first. [compress] level picks how far up a ladder the workers may go.
+static const int lz4_ladder[] = {64, 32, 16, 8, 4, 2, 1};
+static const int zstd_ladder[] = {-7, -5, -3, -1, 1, 2, 3, 4, 5, 6, 8, 10, 13, 16, 19};
+
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Whether level a compresses harder (and slower) than level b.
+static bool level_stronger(compress_codec codec, int a, int b)
+{
+    return codec == COMPRESS_LZ4 ? a < b : a > b;
+}
+
+int gs_compress_init(gs_compress_t *comp, buffer_pool_t *pool, compress_codec codec, uint32_t workers, int level, bool adaptive, uint32_t min_saving, uint32_t probe_every)
+{
+    comp->enabled = false;
+    comp->codec = codec;
+    comp->started = 0;
+    if (codec == COMPRESS_OFF)
+    {
+        return 1;
+    }
+#ifndef HAYSTACK_COMPRESS
+    dbprintlf(RED_FG "Built without the compression codecs (make COMPRESS=1); [compress] codec must be off.");
+    return -1;
+#endif
+
+    const int *ladder;
+    uint32_t rungs;
+    if (codec == COMPRESS_LZ4)
+    {
+        level = level == 0 ? 1 : level;
+        if (level < 1 || level > LZ4_LEVEL_MAX)
+        {
+            return -1;
+        }
+        ladder = lz4_ladder;
+        rungs = sizeof(lz4_ladder) / sizeof(lz4_ladder[0]);
+    }
+    else if (codec == COMPRESS_ZSTD)
+    {
+        level = level == 0 ? 3 : level;
+        if (level < ZSTD_LEVEL_MIN || level > ZSTD_LEVEL_MAX)
+        {
+            return -1;
+        }
+        ladder = zstd_ladder;
+        rungs = sizeof(zstd_ladder) / sizeof(zstd_ladder[0]);
+    }
+    else
+    {
+        return -1;
+    }
+
+    // The rungs no stronger than the level asked for, then that level; or only that level.
+    comp->level_count = 0;
+    for (uint32_t i = 0; adaptive && i < rungs; i++)
+    {
+        if (ladder[i] != level && !level_stronger(codec, ladder[i], level))
+        {
+            comp->levels[comp->level_count++] = ladder[i];
+        }
+    }
+    comp->levels[comp->level_count++] = level;
+    // Starts at the level asked for; a frame judged incompressible at a weaker one may not be.
+    comp->level_index.store(comp->level_count - 1, std::memory_order_relaxed);
+
+    comp->adaptive = adaptive;
+    comp->min_saving = min_saving;
+    comp->probe_every = probe_every;
+    comp->pool = pool;
+    comp->worker_count = workers < 1 ? 1 : workers > COMPRESS_WORKERS_MAX ? COMPRESS_WORKERS_MAX : workers;
+    comp->metrics = NULL;
+
+    pthread_mutex_init(&comp->lock, NULL);
+    pthread_cond_init(&comp->queued, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&comp->finished, &attr);
+    pthread_condattr_destroy(&attr);
+    comp->queue_head = 0;
+    comp->queue_count = 0;
+    comp->stopping = false;
+    comp->adapt_at = 0;
+    comp->adapt_busy_ns = 0;
+
+    for (uint32_t i = 0; i < CHAINS_MAX; i++)
+    {
+        gs_compress_stream_t *stream = &comp->streams[i];
+        stream->head = 0;
+        stream->tail = 0;
+        stream->bypass_left = 0;
+        for (uint32_t j = 0; j < COMPRESS_WINDOW; j++)
+        {
+            stream->jobs[j].done.store(false, std::memory_order_relaxed);
+        }
+        stream->frames.store(0, std::memory_order_relaxed);
+        stream->bypassed.store(0, std::memory_order_relaxed);
+        stream->bytes_in.store(0, std::memory_order_relaxed);
+        stream->bytes_out.store(0, std::memory_order_relaxed);
+        stream->busy_ns.store(0, std::memory_order_relaxed);
+    }
+
+    comp->enabled = true;
+    return 1;
+}
+
+void gs_compress_destroy(gs_compress_t *comp)
+{
+    if (!comp->enabled)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < CHAINS_MAX; i++)
+    {
+        for (uint32_t j = 0; j < COMPRESS_WINDOW; j++)
+        {
+            comp->streams[i].jobs[j].frame.reset();
+        }
+    }
+    pthread_cond_destroy(&comp->finished);
+    pthread_cond_destroy(&comp->queued);
+    pthread_mutex_destroy(&comp->lock);
+    comp->enabled = false;
+}
+
+#ifdef HAYSTACK_COMPRESS
+void *gs_compress_scratch(compress_codec codec)
+{
+    switch (codec)
+    {
+    case COMPRESS_LZ4:
+        return malloc(LZ4_sizeofState());
+    case COMPRESS_ZSTD:
+        return ZSTD_createCCtx();
+    default:
+        return NULL;
+    }
+}
+
+void gs_compress_scratch_free(compress_codec codec, void *scratch)
+{
+    if (codec == COMPRESS_ZSTD)
+    {
+        ZSTD_freeCCtx((ZSTD_CCtx *)scratch);
+    }
+    else
+    {
+        free(scratch);
+    }
+}
+
+ssize_t gs_compress_frame(compress_codec codec, int level, void *scratch, const uint8_t *in, size_t size, uint8_t *out, size_t cap)
+{
+    if (cap <= sizeof(gs_compress_hdr_t) || size > INT_MAX)
+    {
+        return 0;
+    }
+
+    gs_compress_hdr_t hdr;
+    hdr.codec = codec;
+    hdr.level = (int8_t)level;
+    hdr.reserved = 0;
+    hdr.raw_size = (uint32_t)size;
+    memcpy(out, &hdr, sizeof(hdr));
+
+    uint8_t *dst = out + sizeof(hdr);
+    size_t room = cap - sizeof(hdr);
+    room = room > INT_MAX ? INT_MAX : room;
+
+    switch (codec)
+    {
+    case COMPRESS_LZ4:
+    {
+        int len = LZ4_compress_fast_extState(scratch, (const char *)in, (char *)dst, (int)size, (int)room, level);
+        return len > 0 ? (ssize_t)(sizeof(hdr) + len) : 0;
+    }
+    case COMPRESS_ZSTD:
+    {
+        // Most often "destination too small": it did not compress well enough.
+        size_t len = ZSTD_compressCCtx((ZSTD_CCtx *)scratch, dst, room, in, size, level);
+        return ZSTD_isError(len) ? 0 : (ssize_t)(sizeof(hdr) + len);
+    }
+    default:
+        return -1;
+    }
+}
+
+ssize_t gs_compress_unpack(const uint8_t *item, size_t size, uint8_t *out, size_t cap)
+{
+    gs_compress_hdr_t hdr;
+    if (size < sizeof(hdr) || size - sizeof(hdr) > INT_MAX)
+    {
+        return -1;
+    }
+    memcpy(&hdr, item, sizeof(hdr));
+    if (hdr.raw_size > cap || hdr.raw_size > INT_MAX)
+    {
+        return -2;
+    }
+
+    const uint8_t *src = item + sizeof(hdr);
+    size_t len = size - sizeof(hdr);
+    switch (hdr.codec)
+    {
+    case COMPRESS_LZ4:
+    {
+        int got = LZ4_decompress_safe((const char *)src, (char *)out, (int)len, (int)hdr.raw_size);
+        return got == (int)hdr.raw_size ? got : -1;
+    }
+    case COMPRESS_ZSTD:
+    {
+        // One context per thread, kept for the thread's life.
+        static __thread ZSTD_DCtx *dctx = NULL;
+        if (dctx == NULL && (dctx = ZSTD_createDCtx()) == NULL)
+        {
+            return -1;
+        }
+        size_t got = ZSTD_decompressDCtx(dctx, out, hdr.raw_size, src, len);
+        return !ZSTD_isError(got) && got == hdr.raw_size ? (ssize_t)got : -1;
+    }
+    default:
+        return -1;
+    }
+}
+#else
+// Built without the codecs: gs_compress_init(...) refuses any but COMPRESS_OFF, so nothing is ever compressed, and
+// there is nothing to decompress.
+void *gs_compress_scratch(compress_codec codec)
+{
+    return NULL;
+}
+
+void gs_compress_scratch_free(compress_codec codec, void *scratch)
+{
+    free(scratch);
+}
+
+ssize_t gs_compress_frame(compress_codec codec, int level, void *scratch, const uint8_t *in, size_t size, uint8_t *out, size_t cap)
+{
+    return -1;
+}
+
+ssize_t gs_compress_unpack(const uint8_t *item, size_t size, uint8_t *out, size_t cap)
+{
+    return -1;
+}
+#endif
+
+// Compresses a job's frame into a pool buffer, if that saves at least min_saving percent.
+static void compress_job(gs_compress_t *comp, void *scratch, compress_job_t *job)
+{
+    size_t size = job->frame->size;
+    size_t limit = size - size * comp->min_saving / 100;
+    if (scratch == NULL || limit <= sizeof(gs_compress_hdr_t))
+    {
+        return;
+    }
+
+    PoolBuffer out = buffer_pool_acquire(comp->pool);
+    if (!out.valid())
+    {
+        return;
+    }
+
+    int level = comp->levels[comp->level_index.load(std::memory_order_relaxed)];
+    uint64_t start = monotonic_ns();
+    ssize_t len = gs_compress_frame(comp->codec, level, scratch, job->frame->data, size, out->data, limit < out->capacity ? limit : out->capacity);
+    job->busy_ns = monotonic_ns() - start;
+    gs_metrics_record(METRIC_COMPRESS_NS, job->busy_ns);
+    if (len <= 0)
+    {
+        return;
+    }
+
+    out->size = len;
+    out->timestamp = job->frame->timestamp;
+    out->chain = job->frame->chain;
+    job->frame = std::move(out);
+    job->seq.flags |= GS_SEQ_COMPRESSED;
+    job->compressed = true;
+}
+
+// One rung down the ladder while the workers cannot keep up, one up while they have time to spare. Called by a worker
+// with the lock held.
+static void compress_adapt(gs_compress_t *comp, uint64_t now)
+{
+    if (!comp->adaptive || now < comp->adapt_at)
+    {
+        return;
+    }
+
+    uint64_t span = now - comp->adapt_at + COMPRESS_ADAPT_MS * 1000000ULL;
+    uint64_t busy_pct = comp->adapt_busy_ns * 100 / (span * comp->worker_count);
+    uint32_t index = comp->level_index.load(std::memory_order_relaxed);
+    if ((busy_pct > COMPRESS_BUSY_HIGH || comp->queue_count > comp->worker_count) && index > 0)
+    {
+        index--;
+    }
+    else if (busy_pct < COMPRESS_BUSY_LOW && comp->queue_count == 0 && index + 1 < comp->level_count)
+    {
+        index++;
+    }
+    if (index != comp->level_index.load(std::memory_order_relaxed))
+    {
+        trprintlf(BLUE_FG "Compression level %d (workers %lu%% busy).", comp->levels[index], (unsigned long)busy_pct);
+        comp->level_index.store(index, std::memory_order_relaxed);
+    }
+
+    comp->adapt_at = now + COMPRESS_ADAPT_MS * 1000000ULL;
+    comp->adapt_busy_ns = 0;
+}
+
+static void *compress_worker(void *args)
+{
+    compress_worker_t *worker = (compress_worker_t *)args;
+    gs_compress_t *comp = worker->comp;
+
+    char name[METRICS_NAME_LEN];
+    snprintf(name, sizeof(name), "cmp%u", worker->id);
+    if (comp->metrics != NULL)
+    {
+        gs_metrics_register(comp->metrics, name);
+    }
+
+    // Without it, every frame this worker takes goes out as it came.
+    void *scratch = gs_compress_scratch(comp->codec);
+    if (scratch == NULL)
+    {
+        dbprintlf(RED_FG "Compression worker %u could not allocate its %s state.", worker->id, gs_compress_codec_name(comp->codec));
+    }
+
+    pthread_mutex_lock(&comp->lock);
+    while (true)
+    {
+        while (comp->queue_count == 0 && !comp->stopping)
+        {
+            pthread_cond_wait(&comp->queued, &comp->lock);
+        }
+        if (comp->queue_count == 0)
+        {
+            break;
+        }
+        compress_job_t *job = comp->queue[comp->queue_head];
+        comp->queue_head = (comp->queue_head + 1) % COMPRESS_QUEUE;
+        comp->queue_count--;
+        pthread_mutex_unlock(&comp->lock);
+
+        compress_job(comp, scratch, job);
+        // Once done, the job is the forwarding stage's again, and its slot may be reused at once.
+        uint64_t busy_ns = job->busy_ns;
+
+        pthread_mutex_lock(&comp->lock);
+        job->done.store(true, std::memory_order_release);
+        comp->adapt_busy_ns += busy_ns;
+        compress_adapt(comp, monotonic_ns());
+        pthread_cond_broadcast(&comp->finished);
+    }
+    pthread_mutex_unlock(&comp->lock);
+
+    gs_compress_scratch_free(comp->codec, scratch);
+    return NULL;
+}
+
+int gs_compress_start(gs_compress_t *comp, gs_metrics_t *metrics)
+{
+    if (!comp->enabled)
+    {
+        return 1;
+    }
+
+    comp->metrics = metrics;
+    comp->stopping = false;
+    comp->adapt_at = monotonic_ns() + COMPRESS_ADAPT_MS * 1000000ULL;
+    for (uint32_t i = 0; i < comp->worker_count; i++)
+    {
+        compress_worker_t *worker = &comp->workers[i];
+        worker->comp = comp;
+        worker->id = i;
+        if (pthread_create(&worker->tid, NULL, compress_worker, worker) != 0)
+        {
+            gs_compress_stop(comp);
+            return -1;
+        }
+        comp->started++;
+    }
+    return 1;
+}
+
+void gs_compress_stop(gs_compress_t *comp)
+{
+    if (!comp->enabled)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&comp->lock);
+    comp->stopping = true;
+    pthread_cond_broadcast(&comp->queued);
+    pthread_mutex_unlock(&comp->lock);
+
+    for (uint32_t i = 0; i < comp->started; i++)
+    {
+        pthread_join(comp->workers[i].tid, NULL);
+    }
+    comp->started = 0;
+}
+
+void gs_compress_submit(gs_compress_t *comp, gs_compress_stream_t *stream, PoolBuffer &frame, const gs_seq_hdr_t *seq)
+{
+    compress_job_t *job = &stream->jobs[stream->tail++ % COMPRESS_WINDOW];
+    job->raw_size = frame->size;
+    job->seq = *seq;
+    job->compressed = false;
+    job->busy_ns = 0;
+    job->frame = std::move(frame);
+
+    // After a frame that did not compress, the next probe_every skip the workers.
+    job->probe = stream->bypass_left == 0;
+    if (!job->probe)
+    {
+        stream->bypass_left--;
+        job->done.store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    job->done.store(false, std::memory_order_relaxed);
+    pthread_mutex_lock(&comp->lock);
+    comp->queue[(comp->queue_head + comp->queue_count) % COMPRESS_QUEUE] = job;
+    comp->queue_count++;
+    pthread_cond_signal(&comp->queued);
+    pthread_mutex_unlock(&comp->lock);
+}
+
+int gs_compress_reap(gs_compress_t *comp, gs_compress_stream_t *stream, PoolBuffer *frame, gs_seq_hdr_t *seq, uint64_t timeout_us)
+{
+    if (stream->head == stream->tail)
+    {
+        return 0;
+    }
+
+    compress_job_t *job = &stream->jobs[stream->head % COMPRESS_WINDOW];
+    if (!job->done.load(std::memory_order_acquire))
+    {
+        if (timeout_us == 0)
+        {
+            return 0;
+        }
+        uint64_t at = monotonic_ns() + timeout_us * 1000;
+        struct timespec deadline;
+        deadline.tv_sec = at / 1000000000ULL;
+        deadline.tv_nsec = at % 1000000000ULL;
+
+        pthread_mutex_lock(&comp->lock);
+        while (!job->done.load(std::memory_order_acquire) && pthread_cond_timedwait(&comp->finished, &comp->lock, &deadline) != ETIMEDOUT)
+        {
+        }
+        pthread_mutex_unlock(&comp->lock);
+        if (!job->done.load(std::memory_order_acquire))
+        {
+            return 0;
+        }
+    }
+
+    stream->head++;
+    if (job->probe && !job->compressed)
+    {
+        stream->bypass_left = comp->probe_every;
+    }
+    if (job->compressed)
+    {
+        stream->frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        stream->bypassed.fetch_add(1, std::memory_order_relaxed);
+    }
+    stream->bytes_in.fetch_add(job->raw_size, std::memory_order_relaxed);
+    stream->bytes_out.fetch_add(job->frame->size, std::memory_order_relaxed);
+    stream->busy_ns.fetch_add(job->busy_ns, std::memory_order_relaxed);
+
+    *seq = job->seq;
+    *frame = std::move(job->frame);
+    return 1;
+}
+
+int gs_compress_level(const gs_compress_t *comp)
+{
+    return comp->enabled ? comp->levels[comp->level_index.load(std::memory_order_relaxed)] : 0;
+}
+
+int gs_compress_codec_from_string(const char *name, compress_codec *codec)
+{
+    if (strcmp(name, "off") == 0)
+    {
+        *codec = COMPRESS_OFF;
+    }
+    else if (strcmp(name, "lz4") == 0)
+    {
+        *codec = COMPRESS_LZ4;
+    }
+    else if (strcmp(name, "zstd") == 0)
+    {
+        *codec = COMPRESS_ZSTD;
+    }
+    else
+    {
+        return -1;
+    }
+    return 1;
+}
+
+const char *gs_compress_codec_name(compress_codec codec)
+{
+    switch (codec)
+    {
+    case COMPRESS_LZ4:
+        return "lz4";
+    case COMPRESS_ZSTD:
+        return "zstd";
+    default:
+        return "off";
+    }
+}
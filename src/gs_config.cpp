@@ -0,0 +1,816 @@
+/**
+ * @file gs_config.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Runtime configuration for haystack, loaded from an INI-style file.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "gs_config.hpp"
+#include "gs_hwexec.hpp"
+#include "meb_debug.hpp"
+
+void gs_config_defaults(gs_config_t *config)
+{
+    memset(config, 0x0, sizeof(gs_config_t));
+
+    config->rx_chains = 1;
+    config->rx_ring_slots = RX_RING_SLOTS_DEFAULT;
+    config->rx_ring_policy = RING_DROP_OLDEST;
+    config->rx_mtu = RX_MTU_DEFAULT;
+    config->rx_disarm_timeout_ms = RX_DISARM_TIMEOUT_MS_DEFAULT;
+    config->rx_dma_depth = RX_DMA_DEPTH_DEFAULT;
+    config->pool_buffers = POOL_BUFFERS_DEFAULT;
+
+    // Chain 0 is the original single radio; the others follow its naming.
+    for (int i = 0; i < CHAINS_MAX; i++)
+    {
+        gs_chain_config_t *chain = &config->chain[i];
+        snprintf(chain->ipcore, sizeof(chain->ipcore), i == 0 ? "rx_ipcore" : "rx_ipcore%d", i);
+        snprintf(chain->dma, sizeof(chain->dma), i == 0 ? "rx_dma" : "rx_dma%d", i);
+        chain->pll_spi_bus = 0;
+        chain->pll_spi_cs = 1 + i;
+        chain->rx_cpu = -1;
+        chain->fwd_cpu = -1;
+    }
+
+    config->rec_enabled = true;
+    snprintf(config->rec_directory, sizeof(config->rec_directory), ".");
+    config->rec_ring_slots = RECORDER_RING_SLOTS_DEFAULT;
+    config->rec_segment_mb = RECORDER_SEGMENT_MB_DEFAULT;
+    config->rec_max_segments = RECORDER_MAX_SEGMENTS_DEFAULT;
+    config->rec_batch_frames = RECORDER_BATCH_FRAMES_DEFAULT;
+    config->rec_batch_ms = RECORDER_BATCH_MS_DEFAULT;
+    config->rec_fsync = FSYNC_SEGMENT;
+    config->rec_fsync_interval_ms = RECORDER_FSYNC_INTERVAL_MS_DEFAULT;
+
+    config->log_async = true;
+    config->log_hexdump_per_sec = 0;
+    config->log_hexdump_bytes = LOG_HEXDUMP_BYTES_DEFAULT;
+
+    config->status_refresh_ms = STATUS_REFRESH_MS_DEFAULT;
+    config->status_coalesce_ms = STATUS_COALESCE_MS_DEFAULT;
+    config->status_heartbeat_ms = STATUS_HEARTBEAT_MS_DEFAULT;
+    config->status_encoding = WIRE_ENCODING_RAW;
+    config->status_keyframe_every = GS_WIRE_KEYFRAME_EVERY_DEFAULT;
+
+    config->net_zero_copy = false;
+    config->net_batch_frames = 0;
+    config->net_batch_bytes = UPLINK_BATCH_BYTES_DEFAULT;
+    config->net_batch_latency_us = UPLINK_BATCH_LATENCY_US_DEFAULT;
+    config->net_poll_ms = NETLOOP_POLL_MS_DEFAULT;
+    config->net_timeout_ms = NETLOOP_TIMEOUT_MS_DEFAULT;
+    config->net_backoff_min_ms = NETLOOP_BACKOFF_MIN_MS_DEFAULT;
+    config->net_backoff_max_ms = NETLOOP_BACKOFF_MAX_MS_DEFAULT;
+
+    config->spool_enabled = false;
+    config->spool_ram_mb = SPOOL_RAM_MB_DEFAULT;
+    config->spool_disk_mb = SPOOL_DISK_MB_DEFAULT;
+    snprintf(config->spool_directory, sizeof(config->spool_directory), ".");
+    config->spool_drain_bytes_per_sec = SPOOL_DRAIN_BYTES_PER_SEC_DEFAULT;
+    config->spool_order = SPOOL_DRAIN_INTERLEAVED;
+
+    config->val_crc = CRC_NONE;
+    config->val_dedupe_window = 0;
+
+    config->compress_method = COMPRESS_OFF;
+    config->compress_workers = COMPRESS_WORKERS_DEFAULT;
+    config->compress_level = 0;
+    config->compress_adaptive = true;
+    config->compress_min_saving = COMPRESS_MIN_SAVING_DEFAULT;
+    config->compress_probe_every = COMPRESS_PROBE_EVERY_DEFAULT;
+
+    snprintf(config->radio_filter_dir, sizeof(config->radio_filter_dir), RADIOCFG_FILTER_DIR_DEFAULT);
+    config->radio_fir_cache = RADIOCFG_FIR_CACHE_DEFAULT;
+
+    config->schedule_max_entries = SCHEDULE_MAX_ENTRIES_DEFAULT;
+
+    config->replay_files[0] = '\0';
+    config->replay_speed = REPLAY_SPEED_DEFAULT;
+    config->replay_rate_fps = REPLAY_RATE_FPS_DEFAULT;
+    config->replay_max_gap_ms = REPLAY_MAX_GAP_MS_DEFAULT;
+    config->replay_jitter_us = 0;
+    config->replay_burst_frames = 0;
+    config->replay_loops = REPLAY_LOOPS_DEFAULT;
+    config->replay_seed = 1;
+
+    config->metrics_enabled = false;
+    config->metrics_port = METRICS_PORT_DEFAULT;
+    config->metrics_interval_ms = METRICS_INTERVAL_MS_DEFAULT;
+    config->metrics_sample_every = METRICS_SAMPLE_EVERY_DEFAULT;
+    config->metrics_status_summary = false;
+
+    config->sched_lock_memory = true;
+    config->sched_prefault = true;
+    config->sched_capture_priority = 0;
+    config->sched_forward_priority = 0;
+    config->sched_network_priority = 0;
+    config->sched_recorder_priority = 0;
+    config->sched_schedule_priority = 0;
+    config->sched_network_cpu = -1;
+    config->sched_recorder_cpu = -1;
+    config->sched_schedule_cpu = -1;
+    config->sched_capture_deadline_us = SCHED_CAPTURE_DEADLINE_US_DEFAULT;
+
+#ifdef HAYSTACK_SIM
+    sim_config_defaults(&config->sim);
+#endif
+}
+
+// Strips leading and trailing whitespace in place.
+static char *trim(char *str)
+{
+    while (isspace((unsigned char)*str))
+    {
+        str++;
+    }
+
+    char *end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1]))
+    {
+        end--;
+    }
+    *end = '\0';
+
+    return str;
+}
+
+static int parse_u32(const char *value, uint32_t *out)
+{
+    char *end = NULL;
+    unsigned long val = strtoul(value, &end, 0);
+    if (end == value || *end != '\0')
+    {
+        return -1;
+    }
+    *out = (uint32_t)val;
+    return 1;
+}
+
+static int parse_int(const char *value, int *out)
+{
+    char *end = NULL;
+    long val = strtol(value, &end, 0);
+    if (end == value || *end != '\0')
+    {
+        return -1;
+    }
+    *out = (int)val;
+    return 1;
+}
+
+static int parse_double(const char *value, double *out)
+{
+    char *end = NULL;
+    double val = strtod(value, &end);
+    if (end == value || *end != '\0')
+    {
+        return -1;
+    }
+    *out = val;
+    return 1;
+}
+
+static int parse_bool(const char *value, bool *out)
+{
+    if (strcmp(value, "true") == 0 || strcmp(value, "yes") == 0 || strcmp(value, "1") == 0)
+    {
+        *out = true;
+    }
+    else if (strcmp(value, "false") == 0 || strcmp(value, "no") == 0 || strcmp(value, "0") == 0)
+    {
+        *out = false;
+    }
+    else
+    {
+        return -1;
+    }
+    return 1;
+}
+
+static int parse_string(const char *value, char *out, size_t size)
+{
+    if (strlen(value) >= size)
+    {
+        return -1;
+    }
+    snprintf(out, size, "%s", value);
+    return 1;
+}
+
+// Applies one 'section.key = value' pair. Returns 1 if applied, 0 if the key is unknown, -1 if the value is invalid.
+static int apply_key(gs_config_t *config, const char *section, const char *key, const char *value)
+{
+    if (strcmp(section, "rx") == 0)
+    {
+        if (strcmp(key, "chains") == 0)
+        {
+            if (parse_u32(value, &config->rx_chains) < 0 || config->rx_chains < 1 || config->rx_chains > CHAINS_MAX)
+            {
+                return -1;
+            }
+            return 1;
+        }
+        else if (strcmp(key, "ring_slots") == 0)
+        {
+            return parse_u32(value, &config->rx_ring_slots);
+        }
+        else if (strcmp(key, "ring_policy") == 0)
+        {
+            return frame_ring_policy_from_string(value, &config->rx_ring_policy);
+        }
+        else if (strcmp(key, "mtu") == 0)
+        {
+            return parse_u32(value, &config->rx_mtu);
+        }
+        else if (strcmp(key, "disarm_timeout_ms") == 0)
+        {
+            return parse_u32(value, &config->rx_disarm_timeout_ms);
+        }
+        else if (strcmp(key, "dma_depth") == 0)
+        {
+            if (parse_u32(value, &config->rx_dma_depth) < 0 || config->rx_dma_depth > RXMODEM_QUEUE_MAX)
+            {
+                return -1;
+            }
+            return 1;
+        }
+    }
+    else if (strncmp(section, "chain", 5) == 0 && section[5] >= '0' && section[5] < '0' + CHAINS_MAX && section[6] == '\0')
+    {
+        gs_chain_config_t *chain = &config->chain[section[5] - '0'];
+        if (strcmp(key, "ipcore") == 0)
+        {
+            return parse_string(value, chain->ipcore, sizeof(chain->ipcore));
+        }
+        else if (strcmp(key, "dma") == 0)
+        {
+            return parse_string(value, chain->dma, sizeof(chain->dma));
+        }
+        else if (strcmp(key, "pll_spi_bus") == 0)
+        {
+            return parse_u32(value, &chain->pll_spi_bus);
+        }
+        else if (strcmp(key, "pll_spi_cs") == 0)
+        {
+            return parse_u32(value, &chain->pll_spi_cs);
+        }
+        else if (strcmp(key, "rx_cpu") == 0)
+        {
+            return parse_int(value, &chain->rx_cpu);
+        }
+        else if (strcmp(key, "fwd_cpu") == 0)
+        {
+            return parse_int(value, &chain->fwd_cpu);
+        }
+    }
+    else if (strcmp(section, "pool") == 0)
+    {
+        if (strcmp(key, "buffers") == 0)
+        {
+            return parse_u32(value, &config->pool_buffers);
+        }
+    }
+    else if (strcmp(section, "recorder") == 0)
+    {
+        if (strcmp(key, "enabled") == 0)
+        {
+            return parse_bool(value, &config->rec_enabled);
+        }
+        else if (strcmp(key, "directory") == 0)
+        {
+            return parse_string(value, config->rec_directory, sizeof(config->rec_directory));
+        }
+        else if (strcmp(key, "ring_slots") == 0)
+        {
+            return parse_u32(value, &config->rec_ring_slots);
+        }
+        else if (strcmp(key, "segment_mb") == 0)
+        {
+            return parse_u32(value, &config->rec_segment_mb);
+        }
+        else if (strcmp(key, "max_segments") == 0)
+        {
+            return parse_u32(value, &config->rec_max_segments);
+        }
+        else if (strcmp(key, "batch_frames") == 0)
+        {
+            return parse_u32(value, &config->rec_batch_frames);
+        }
+        else if (strcmp(key, "batch_ms") == 0)
+        {
+            return parse_u32(value, &config->rec_batch_ms);
+        }
+        else if (strcmp(key, "fsync") == 0)
+        {
+            return gs_recorder_fsync_from_string(value, &config->rec_fsync);
+        }
+        else if (strcmp(key, "fsync_interval_ms") == 0)
+        {
+            return parse_u32(value, &config->rec_fsync_interval_ms);
+        }
+    }
+    else if (strcmp(section, "log") == 0)
+    {
+        if (strcmp(key, "async") == 0)
+        {
+            return parse_bool(value, &config->log_async);
+        }
+        else if (strcmp(key, "hexdump_per_sec") == 0)
+        {
+            return parse_u32(value, &config->log_hexdump_per_sec);
+        }
+        else if (strcmp(key, "hexdump_bytes") == 0)
+        {
+            return parse_u32(value, &config->log_hexdump_bytes);
+        }
+    }
+    else if (strcmp(section, "status") == 0)
+    {
+        if (strcmp(key, "refresh_ms") == 0)
+        {
+            return parse_u32(value, &config->status_refresh_ms);
+        }
+        else if (strcmp(key, "coalesce_ms") == 0)
+        {
+            return parse_u32(value, &config->status_coalesce_ms);
+        }
+        else if (strcmp(key, "heartbeat_ms") == 0)
+        {
+            return parse_u32(value, &config->status_heartbeat_ms);
+        }
+        else if (strcmp(key, "encoding") == 0)
+        {
+            return gs_wire_encoding_from_string(value, &config->status_encoding);
+        }
+        else if (strcmp(key, "keyframe_every") == 0)
+        {
+            return parse_u32(value, &config->status_keyframe_every);
+        }
+    }
+    else if (strcmp(section, "net") == 0)
+    {
+        if (strcmp(key, "zero_copy") == 0)
+        {
+            return parse_bool(value, &config->net_zero_copy);
+        }
+        else if (strcmp(key, "batch_frames") == 0)
+        {
+            return parse_u32(value, &config->net_batch_frames);
+        }
+        else if (strcmp(key, "batch_bytes") == 0)
+        {
+            return parse_u32(value, &config->net_batch_bytes);
+        }
+        else if (strcmp(key, "batch_latency_us") == 0)
+        {
+            return parse_u32(value, &config->net_batch_latency_us);
+        }
+        else if (strcmp(key, "poll_ms") == 0)
+        {
+            return parse_u32(value, &config->net_poll_ms);
+        }
+        else if (strcmp(key, "timeout_ms") == 0)
+        {
+            return parse_u32(value, &config->net_timeout_ms);
+        }
+        else if (strcmp(key, "backoff_min_ms") == 0)
+        {
+            return parse_u32(value, &config->net_backoff_min_ms);
+        }
+        else if (strcmp(key, "backoff_max_ms") == 0)
+        {
+            return parse_u32(value, &config->net_backoff_max_ms);
+        }
+    }
+    else if (strcmp(section, "spool") == 0)
+    {
+        if (strcmp(key, "enabled") == 0)
+        {
+            return parse_bool(value, &config->spool_enabled);
+        }
+        else if (strcmp(key, "ram_mb") == 0)
+        {
+            return parse_u32(value, &config->spool_ram_mb);
+        }
+        else if (strcmp(key, "disk_mb") == 0)
+        {
+            return parse_u32(value, &config->spool_disk_mb);
+        }
+        else if (strcmp(key, "directory") == 0)
+        {
+            return parse_string(value, config->spool_directory, sizeof(config->spool_directory));
+        }
+        else if (strcmp(key, "drain_bytes_per_sec") == 0)
+        {
+            return parse_u32(value, &config->spool_drain_bytes_per_sec);
+        }
+        else if (strcmp(key, "drain_order") == 0)
+        {
+            return gs_spool_drain_order_from_string(value, &config->spool_order);
+        }
+    }
+    else if (strcmp(section, "validate") == 0)
+    {
+        if (strcmp(key, "crc") == 0)
+        {
+            return gs_validate_crc_from_string(value, &config->val_crc);
+        }
+        else if (strcmp(key, "dedupe_window") == 0)
+        {
+            if (parse_u32(value, &config->val_dedupe_window) < 0 || config->val_dedupe_window > VALIDATE_DEDUPE_WINDOW_MAX)
+            {
+                return -1;
+            }
+            return 1;
+        }
+    }
+    else if (strcmp(section, "compress") == 0)
+    {
+        if (strcmp(key, "codec") == 0)
+        {
+            return gs_compress_codec_from_string(value, &config->compress_method);
+        }
+        else if (strcmp(key, "workers") == 0)
+        {
+            if (parse_u32(value, &config->compress_workers) < 0 || config->compress_workers < 1 || config->compress_workers > COMPRESS_WORKERS_MAX)
+            {
+                return -1;
+            }
+            return 1;
+        }
+        else if (strcmp(key, "level") == 0)
+        {
+            return parse_int(value, &config->compress_level);
+        }
+        else if (strcmp(key, "adaptive") == 0)
+        {
+            return parse_bool(value, &config->compress_adaptive);
+        }
+        else if (strcmp(key, "min_saving") == 0)
+        {
+            if (parse_u32(value, &config->compress_min_saving) < 0 || config->compress_min_saving > 99)
+            {
+                return -1;
+            }
+            return 1;
+        }
+        else if (strcmp(key, "probe_every") == 0)
+        {
+            return parse_u32(value, &config->compress_probe_every);
+        }
+    }
+    else if (strcmp(section, "radio") == 0)
+    {
+        if (strcmp(key, "filter_dir") == 0)
+        {
+            return parse_string(value, config->radio_filter_dir, sizeof(config->radio_filter_dir));
+        }
+        else if (strcmp(key, "fir_cache") == 0)
+        {
+            if (parse_u32(value, &config->radio_fir_cache) < 0 || config->radio_fir_cache < 1 || config->radio_fir_cache > RADIOCFG_FIR_CACHE_MAX)
+            {
+                return -1;
+            }
+            return 1;
+        }
+    }
+    else if (strcmp(section, "schedule") == 0)
+    {
+        if (strcmp(key, "max_entries") == 0)
+        {
+            if (parse_u32(value, &config->schedule_max_entries) < 0 || config->schedule_max_entries < 1)
+            {
+                return -1;
+            }
+            return 1;
+        }
+    }
+    else if (strcmp(section, "replay") == 0)
+    {
+        if (strcmp(key, "files") == 0)
+        {
+            return parse_string(value, config->replay_files, sizeof(config->replay_files));
+        }
+        else if (strcmp(key, "speed") == 0)
+        {
+            if (parse_double(value, &config->replay_speed) < 0 || config->replay_speed < 0)
+            {
+                return -1;
+            }
+            return 1;
+        }
+        else if (strcmp(key, "rate_fps") == 0)
+        {
+            if (parse_u32(value, &config->replay_rate_fps) < 0 || config->replay_rate_fps < 1)
+            {
+                return -1;
+            }
+            return 1;
+        }
+        else if (strcmp(key, "max_gap_ms") == 0)
+        {
+            return parse_u32(value, &config->replay_max_gap_ms);
+        }
+        else if (strcmp(key, "jitter_us") == 0)
+        {
+            return parse_u32(value, &config->replay_jitter_us);
+        }
+        else if (strcmp(key, "burst_frames") == 0)
+        {
+            return parse_u32(value, &config->replay_burst_frames);
+        }
+        else if (strcmp(key, "loops") == 0)
+        {
+            return parse_u32(value, &config->replay_loops);
+        }
+        else if (strcmp(key, "seed") == 0)
+        {
+            return parse_u32(value, &config->replay_seed);
+        }
+    }
+    else if (strcmp(section, "metrics") == 0)
+    {
+        if (strcmp(key, "enabled") == 0)
+        {
+            return parse_bool(value, &config->metrics_enabled);
+        }
+        else if (strcmp(key, "port") == 0)
+        {
+            if (parse_u32(value, &config->metrics_port) < 0 || config->metrics_port > 65535)
+            {
+                return -1;
+            }
+            return 1;
+        }
+        else if (strcmp(key, "socket") == 0)
+        {
+            return parse_string(value, config->metrics_socket, sizeof(config->metrics_socket));
+        }
+        else if (strcmp(key, "interval_ms") == 0)
+        {
+            return parse_u32(value, &config->metrics_interval_ms);
+        }
+        else if (strcmp(key, "sample_every") == 0)
+        {
+            return parse_u32(value, &config->metrics_sample_every);
+        }
+        else if (strcmp(key, "status_summary") == 0)
+        {
+            return parse_bool(value, &config->metrics_status_summary);
+        }
+    }
+    else if (strcmp(section, "sched") == 0)
+    {
+        int *priority = NULL;
+        if (strcmp(key, "lock_memory") == 0)
+        {
+            return parse_bool(value, &config->sched_lock_memory);
+        }
+        else if (strcmp(key, "prefault") == 0)
+        {
+            return parse_bool(value, &config->sched_prefault);
+        }
+        else if (strcmp(key, "capture_priority") == 0)
+        {
+            priority = &config->sched_capture_priority;
+        }
+        else if (strcmp(key, "forward_priority") == 0)
+        {
+            priority = &config->sched_forward_priority;
+        }
+        else if (strcmp(key, "network_priority") == 0)
+        {
+            priority = &config->sched_network_priority;
+        }
+        else if (strcmp(key, "recorder_priority") == 0)
+        {
+            priority = &config->sched_recorder_priority;
+        }
+        else if (strcmp(key, "schedule_priority") == 0)
+        {
+            priority = &config->sched_schedule_priority;
+        }
+        else if (strcmp(key, "network_cpu") == 0)
+        {
+            return parse_int(value, &config->sched_network_cpu);
+        }
+        else if (strcmp(key, "recorder_cpu") == 0)
+        {
+            return parse_int(value, &config->sched_recorder_cpu);
+        }
+        else if (strcmp(key, "schedule_cpu") == 0)
+        {
+            return parse_int(value, &config->sched_schedule_cpu);
+        }
+        else if (strcmp(key, "capture_deadline_us") == 0)
+        {
+            return parse_u32(value, &config->sched_capture_deadline_us);
+        }
+
+        if (priority != NULL)
+        {
+            if (parse_int(value, priority) < 0 || *priority < 0 || *priority > 99)
+            {
+                return -1;
+            }
+            return 1;
+        }
+    }
+    else if (strcmp(section, "sim") == 0)
+    {
+#ifndef HAYSTACK_SIM
+        // Only meaningful to haystack_sim.out; the same file serves both builds.
+        return 1;
+#else
+        if (strcmp(key, "rate_fps") == 0)
+        {
+            return parse_double(value, &config->sim.rate_fps);
+        }
+        else if (strcmp(key, "size_dist") == 0)
+        {
+            if (strcmp(value, "fixed") == 0)
+            {
+                config->sim.size_dist = SIM_SIZE_FIXED;
+            }
+            else if (strcmp(value, "uniform") == 0)
+            {
+                config->sim.size_dist = SIM_SIZE_UNIFORM;
+            }
+            else
+            {
+                return -1;
+            }
+            return 1;
+        }
+        else if (strcmp(key, "size_min") == 0)
+        {
+            return parse_u32(value, &config->sim.size_min);
+        }
+        else if (strcmp(key, "size_max") == 0)
+        {
+            return parse_u32(value, &config->sim.size_max);
+        }
+        else if (strcmp(key, "error_rate") == 0)
+        {
+            return parse_double(value, &config->sim.error_rate);
+        }
+        else if (strcmp(key, "short_read_rate") == 0)
+        {
+            return parse_double(value, &config->sim.short_read_rate);
+        }
+        else if (strcmp(key, "overflow_frames") == 0)
+        {
+            return parse_u32(value, &config->sim.overflow_frames);
+        }
+        else if (strcmp(key, "replay") == 0)
+        {
+            return parse_string(value, config->sim.replay, sizeof(config->sim.replay));
+        }
+        else if (strcmp(key, "seed") == 0)
+        {
+            return parse_u32(value, &config->sim.seed);
+        }
+        else if (strcmp(key, "iio_latency_us") == 0)
+        {
+            return parse_u32(value, &config->sim.iio_latency_us);
+        }
+        else if (strcmp(key, "pll_lock_ms") == 0)
+        {
+            return parse_u32(value, &config->sim.pll_lock_ms);
+        }
+        else if (strcmp(key, "retune_ms") == 0)
+        {
+            return parse_u32(value, &config->sim.retune_ms);
+        }
+        else if (strcmp(key, "dma_latency_us") == 0)
+        {
+            return parse_u32(value, &config->sim.dma_latency_us);
+        }
+        else if (strcmp(key, "dma_mb_per_s") == 0)
+        {
+            return parse_u32(value, &config->sim.dma_mb_per_s);
+        }
+#endif
+    }
+
+    return 0;
+}
+
+int gs_config_load(gs_config_t *config, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    char line[512];
+    char section[64] = {0};
+    int line_num = 0;
+    int retval = 1;
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_num++;
+
+        char *comment = strpbrk(line, "#;");
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        char *entry = trim(line);
+        if (*entry == '\0')
+        {
+            continue;
+        }
+
+        if (*entry == '[')
+        {
+            char *close = strchr(entry, ']');
+            if (close == NULL)
+            {
+                dbprintlf(RED_FG "%s:%d: Unterminated section header.", path, line_num);
+                retval = -2;
+                continue;
+            }
+            *close = '\0';
+            snprintf(section, sizeof(section), "%s", trim(entry + 1));
+            continue;
+        }
+
+        char *equals = strchr(entry, '=');
+        if (equals == NULL)
+        {
+            dbprintlf(RED_FG "%s:%d: Expected 'key = value'.", path, line_num);
+            retval = -2;
+            continue;
+        }
+        *equals = '\0';
+
+        char *key = trim(entry);
+        char *value = trim(equals + 1);
+
+        int status = apply_key(config, section, key, value);
+        if (status == 0)
+        {
+            dbprintlf(YELLOW_FG "%s:%d: Ignoring unknown key '%s.%s'.", path, line_num, section, key);
+        }
+        else if (status < 0)
+        {
+            dbprintlf(RED_FG "%s:%d: Invalid value '%s' for '%s.%s'.", path, line_num, value, section, key);
+            retval = -2;
+        }
+    }
+
+    fclose(fp);
+    return retval;
+}
+
+// Frame rings round their capacity up to a power of two (frame_ring_init(...)).
+static uint32_t ring_capacity(uint32_t slots)
+{
+    uint32_t capacity = 1;
+    while (capacity < slots)
+    {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+uint32_t gs_config_pool_needed(const gs_config_t *config)
+{
+    // Each chain: its receive ring, the buffers posted to its modem, the frame its capture and forwarding stages each
+    // have in hand, its open batch, its compression window, and the payloads of its queued commands.
+    uint32_t per_chain = ring_capacity(config->rx_ring_slots) + config->rx_dma_depth + 2 + HWEXEC_QUEUE_DEPTH;
+    if (config->net_batch_frames > 1)
+    {
+        per_chain += config->net_batch_frames;
+    }
+    if (config->compress_method != COMPRESS_OFF)
+    {
+        per_chain += COMPRESS_WINDOW;
+    }
+
+    // Then one for the network loop's frame in hand, one per compression worker to compress into, and the recorder's
+    // ring and batch.
+    uint32_t needed = config->rx_chains * per_chain + 1;
+    if (config->compress_method != COMPRESS_OFF)
+    {
+        needed += config->compress_workers;
+    }
+    if (config->rec_enabled)
+    {
+        needed += ring_capacity(config->rec_ring_slots);
+        needed += config->rec_batch_frames < RECORDER_BATCH_MAX ? config->rec_batch_frames : RECORDER_BATCH_MAX;
+    }
+    return needed;
+}
@@ -15,505 +15,1157 @@
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <time.h>
+#include <stddef.h>
 #include "gs_haystack.hpp"
 #include "meb_debug.hpp"
 #include "phy.hpp"
 
-int gs_xband_init(global_data_t *global_data)
+int gs_chain_init(global_data_t *global, uint8_t id)
 {
-    if (global_data->rx_modem_ready && global_data->radio_ready)
+    gs_chain_t *chain = &global->chains[id];
+    gs_chain_config_t *chain_config = &global->config->chain[id];
+
+    chain->id = id;
+    chain->global = global;
+    chain->rx_modem_ready.store(false, std::memory_order_relaxed);
+    chain->PLL_ready.store(false, std::memory_order_relaxed);
+    chain->radio_ready.store(false, std::memory_order_relaxed);
+    chain->rx_modem_stopped = false;
+
+    chain->rx_drain = (uint8_t *)calloc(1, global->config->rx_mtu);
+    if (chain->rx_drain == NULL || frame_ring_init(chain->rx_ring, global->pool, global->config->rx_ring_slots, global->config->rx_ring_policy) < 0)
+    {
+        dbprintlf(RED_FG "Could not allocate the receive ring of chain %u.", id);
+        return -1;
+    }
+
+    if (gs_rxdma_init(chain->rx_dma, chain->rx_modem, global->pool, chain->rx_drain, global->config->rx_mtu, global->config->rx_dma_depth) < 0)
+    {
+        dbprintlf(RED_FG "Could not set up the receive buffers of chain %u.", id);
+        return -1;
+    }
+
+    if (gs_validate_init(chain->validate, global->config->val_crc, global->config->val_dedupe_window) < 0)
+    {
+        dbprintlf(RED_FG "Could not allocate the duplicate filter of chain %u.", id);
+        return -1;
+    }
+
+    if (gs_rxworker_init(chain->rx_worker) < 0)
+    {
+        dbprintlf(RED_FG "Could not set up the capture stage of chain %u.", id);
+        return -1;
+    }
+    gs_seqlock_init(chain->rx_stats);
+    gs_deadline_init(chain->rx_deadline, global->config->sched_capture_deadline_us);
+
+    if (gs_status_init(chain->status, global->config->status_refresh_ms, global->config->status_coalesce_ms, global->config->status_heartbeat_ms) < 0)
     {
-        dbprintlf(YELLOW_FG "RX modem and radio marked as ready, but gs_xband_init(...) was called anyway. Canceling redundant initialization.");
+        dbprintlf(RED_FG "Could not set up the status engine of chain %u.", id);
         return -1;
     }
+    gs_wire_encoder_init(chain->status_wire, global->config->status_keyframe_every);
 
-    if (!global_data->rx_modem_ready)
+    if (gs_radiocfg_init(chain->radio_config, chain->radio, global->config->radio_filter_dir, global->config->radio_fir_cache) < 0)
+    {
+        dbprintlf(RED_FG "Could not set up the configuration engine of chain %u.", id);
+        return -1;
+    }
+
+    // PLL initialization data.
+    chain->PLL->spi_bus = chain_config->pll_spi_bus;
+    chain->PLL->spi_cs = chain_config->pll_spi_cs;
+    chain->PLL->spi_cs_internal = 1;
+    chain->PLL->cs_gpio = -1;
+    chain->PLL->single = 1;
+    chain->PLL->muxval = 6;
+
+    return 1;
+}
+
+void gs_chain_destroy(gs_chain_t *chain)
+{
+    frame_ring_close(chain->rx_ring);
+    frame_ring_destroy(chain->rx_ring);
+    gs_rxworker_destroy(chain->rx_worker);
+    gs_status_destroy(chain->status);
+    gs_radiocfg_destroy(chain->radio_config);
+    gs_validate_destroy(chain->validate);
+    free(chain->rx_drain);
+    chain->rx_drain = NULL;
+}
+
+int gs_xband_init(gs_chain_t *chain)
+{
+    gs_chain_config_t *chain_config = &chain->global->config->chain[chain->id];
+
+    if (chain->rx_modem_ready.load(std::memory_order_acquire) && chain->radio_ready.load(std::memory_order_acquire))
+    {
+        dbprintlf(YELLOW_FG "RX modem and radio of chain %u marked as ready, but gs_xband_init(...) was called anyway. Canceling redundant initialization.", chain->id);
+        return -1;
+    }
+
+    if (!chain->rx_modem_ready.load(std::memory_order_acquire))
     {
         // Initialize.
-        if (rxmodem_init(global_data->rx_modem, uio_get_id("rx_ipcore"), uio_get_id("rx_dma")) < 0)
+        if (rxmodem_init(chain->rx_modem, uio_get_id(chain_config->ipcore), uio_get_id(chain_config->dma)) < 0)
         {
-            dbprintlf(RED_FG "RX modem initialization failure.");
+            dbprintlf(RED_FG "RX modem initialization failure (chain %u: %s, %s).", chain->id, chain_config->ipcore, chain_config->dma);
             return -1;
         }
-        dbprintlf(GREEN_FG "RX modem initialized.");
-        global_data->rx_modem_ready = true;
+        dbprintlf(GREEN_FG "RX modem of chain %u initialized.", chain->id);
+        chain->rx_modem_ready.store(true, std::memory_order_release);
     }
 
-    if (!global_data->radio_ready)
+    if (!chain->radio_ready.load(std::memory_order_acquire))
     {
-        if (adradio_init(global_data->radio) < 0)
+        if (adradio_init(chain->radio) < 0)
         {
-            dbprintlf(RED_FG "Radio initialization failure.");
+            dbprintlf(RED_FG "Radio initialization failure (chain %u).", chain->id);
             return -3;
         }
-        dbprintlf(GREEN_FG "Radio initialized.");
-        global_data->radio_ready = true;
+        dbprintlf(GREEN_FG "Radio of chain %u initialized.", chain->id);
+        chain->radio_ready.store(true, std::memory_order_release);
     }
 
-    dbprintlf(GREEN_FG "Automatic initialization complete.");
+    dbprintlf(GREEN_FG "Automatic initialization of chain %u complete.", chain->id);
     return 1;
 }
 
+// Counts the time since a receive returned against the capture stage's deadline.
+static inline void rx_turned_around(gs_chain_t *chain, uint64_t received_at)
+{
+    uint64_t now = gs_monotonic_ns();
+    gs_deadline_check(chain->rx_deadline, chain->id, now - received_at, now);
+}
+
 void *gs_xband_rx_thread(void *args)
 {
-    global_data_t *global = (global_data_t *)args;
+    gs_chain_t *chain = (gs_chain_t *)args;
+    global_data_t *global = chain->global;
+
+    bool rx_failing = false;
+    bool last_receive_successful = false;
+
+    char stage[48];
+    snprintf(stage, sizeof(stage), "capture stage of chain %u", chain->id);
+    gs_sched_apply(global->config->chain[chain->id].rx_cpu, global->config->sched_capture_priority, stage);
+
+    // Kept here and published whole after each receive, so that nothing the network loop reads is written per frame.
+    rx_snapshot_t stats[1];
+    gs_seqlock_read(chain->rx_stats, stats);
+    char name[METRICS_NAME_LEN];
+    snprintf(name, sizeof(name), "rx%u", chain->id);
+    gs_metrics_register(global->metrics, name);
 
-    while ((!global->rx_modem_ready || !global->radio_ready) && global->network_data->thread_status > 0)
+    // Parks here while disarmed; never cancelled, so a frame is always finished or discarded before it stops. However
+    // a receive ends, the turnaround is checked before the next one, and before parking.
+    uint64_t received_at = 0;
+    for (; gs_rxworker_wait(chain->rx_worker) == RX_ARMED; rx_turned_around(chain, received_at))
     {
-        // if (gs_xband_init(global) < 0)
+        if (!chain->PLL_ready.load(std::memory_order_relaxed))
         {
-            dbprintlf(RED_FG "Receive thread aborting, radio cannot initialize.");
-            usleep(5 SEC);
-            continue;
+            trprintlf(YELLOW_FG "PLL not initialized.");
         }
-    }
 
-    while (global->network_data->thread_status > 0 && global->rx_modem_ready && global->radio_ready)
-    {
-        static bool last_receive_successful = false;
-
-        if (!global->PLL_ready)
+        trprintlf(GREEN_FG "W A I T I N G   T O   R E C E I V E . . .");
+        PoolBuffer frame;
+        ssize_t buffer_size = -1;
+        ssize_t read_size = 0;
+        bool queued = gs_rxdma_fill(chain->rx_dma);
+        if (queued)
         {
-            dbprintlf(YELLOW_FG "PLL not initialized.");
+            // Received into a posted buffer, possibly while the previous frame was being handed on.
+            bool completed = gs_rxdma_next(chain->rx_dma, frame, &buffer_size, &read_size);
+            received_at = gs_monotonic_ns();
+            if (!completed)
+            {
+                continue;
+            }
         }
-
-        if (!global->rx_armed)
+        else
         {
-            dbprintlf(YELLOW_FG "RX IS NOT ARMED: CANNOT RECEIVE OR READ UNTIL ARMED!");
-            usleep(5 SEC);
-            continue;
+            buffer_size = rxmodem_receive(chain->rx_modem);
+            received_at = gs_monotonic_ns();
         }
+        trprintlf("Done receive.");
 
-        dbprintlf(GREEN_FG "W A I T I N G   T O   R E C E I V E . . .");
-        ssize_t buffer_size = rxmodem_receive(global->rx_modem);
-        dbprintlf("Done receive.");
+        // Report only the transitions; the status engine coalesces them.
+        if ((buffer_size <= 0) != rx_failing)
+        {
+            rx_failing = !rx_failing;
+            gs_status_notify(chain->status, STATUS_EVENT_RX_ERROR);
+        }
 
         // Store the rxmodem_receive return for our next status send.
         if (!last_receive_successful)
         {
-            global->last_rx_status = buffer_size;
+            stats->last_rx_status = buffer_size;
         }
 
         last_receive_successful = false;
         
         if (buffer_size > 0)
         {
-            global->last_rx_status = buffer_size;
+            stats->last_rx_status = buffer_size;
             last_receive_successful = true;
         }
 
         if (buffer_size <= 0)
         {
-            dbprintlf(YELLOW_FG "Bad receive, receive returned %d, ignoring (could be WiFi).", buffer_size);
+            trprintlf(YELLOW_FG "Bad receive, receive returned %zd, ignoring (could be WiFi).", buffer_size);
+            stats->rx_errors++;
+            gs_seqlock_write(chain->rx_stats, stats);
             continue;
         }
 
-        uint8_t *buffer = (uint8_t *)malloc(buffer_size * sizeof(char));
-        memset(buffer, 0x0, buffer_size);
+        uint64_t now = received_at;
+        if (buffer_size > global->config->rx_mtu)
+        {
+            // Still read what fits so that the modem is drained; the size check below discards it.
+            dbprintlf(RED_FG "Received %zd bytes, larger than the %u byte MTU.", buffer_size, global->config->rx_mtu);
+        }
+
+        if (!queued)
+        {
+            // Preallocated, returned to the pool automatically if this frame goes no further.
+            frame = buffer_pool_acquire(global->pool);
+            uint8_t *buffer = frame.valid() ? frame->data : chain->rx_drain;
 
-        ssize_t read_size = 0;
-        read_size = rxmodem_read(global->rx_modem, buffer, buffer_size);
+            if (!frame.valid())
+            {
+                // Still read the packet so that the modem is drained; it is discarded below.
+                // Counted in pool_exhausted; logging every one would only slow the capture stage further.
+                trprintlf(RED_FG "Buffer pool exhausted, dropping a %zd byte frame.", buffer_size);
+            }
+
+            uint64_t read_begin = gs_metrics_begin();
+            read_size = rxmodem_read(chain->rx_modem, buffer, buffer_size > global->config->rx_mtu ? global->config->rx_mtu : buffer_size);
+            now = gs_monotonic_ns();
+            gs_metrics_end_at(METRIC_RX_READ_NS, read_begin, now);
+        }
 
         // Store the rx_modem_read return for our next status send.
-        global->last_read_status = read_size;
+        stats->last_read_status = read_size;
 
         if (read_size != buffer_size)
         {
-            dbprintlf(RED_FG "Read %d of %d bytes.", read_size, buffer_size);
+            dbprintlf(RED_FG "Read %zd of %zd bytes.", read_size, buffer_size);
+            stats->read_errors++;
+            gs_seqlock_write(chain->rx_stats, stats);
             continue;
         }
 
-        // dbprintlf(GREEN_FG "Read in the following buffer and will send it to the Network's GUI Client.");
-        // for (int i = 0; i < buffer_size; i++)
-        // {
-        //     printf("%02x", buffer[i]);
-        // }
-        // printf("(END)\n");
+        stats->frames++;
+        stats->bytes += read_size;
+        stats->last_frame_ns = now;
+        gs_seqlock_write(chain->rx_stats, stats);
 
-        dbprintlf(GREEN_FG "Read in the following buffer and will send it to the Network's GUI Client.");
-        for (int i = 0; i < buffer_size; i++)
+        if (!frame.valid())
         {
-            printf("%c", buffer[i]);
+            continue;
         }
-        printf("(END)\n");
 
-        static int receive_fp_index = 0;
-        static char filename[256] = {0};
-        snprintf(filename, sizeof(filename), "rxdata%d.bin", receive_fp_index++);
-        FILE *fp = fopen(filename, "wb");
-        if (fp != NULL)
+        frame->size = read_size;
+        frame->timestamp = now;
+        frame->chain = chain->id;
+
+        if (global->config->rec_enabled)
         {
-            fwrite(buffer, 1, buffer_size, fp);
-            fclose(fp);
+            // The recorder gets the same buffer, not a copy.
+            PoolBuffer record = frame.share();
+            gs_recorder_submit(global->recorder, record);
         }
-        else
+
+        frame_ring_commit(chain->rx_ring, frame);
+    }
+
+    // Whatever is still posted to the modem goes back to the pool before it is destroyed.
+    gs_rxdma_release(chain->rx_dma);
+
+    return NULL;
+}
+
+int gs_xband_arm(gs_chain_t *chain)
+{
+    if (!chain->rx_modem_ready.load(std::memory_order_acquire) || !chain->radio_ready.load(std::memory_order_acquire))
+    {
+        dbprintlf(RED_FG "Cannot arm RX on chain %u, the modem and radio are not initialized.", chain->id);
+        return -1;
+    }
+
+    if (gs_rxworker_armed(chain->rx_worker))
+    {
+        return 0;
+    }
+
+    if (chain->rx_modem_stopped)
+    {
+        if (rxmodem_start(chain->rx_modem) < 0)
         {
-            dbprintlf(RED_FG "Failed to open file to log buffer.");
+            dbprintlf(RED_FG "Failed to restart the RX modem of chain %u.", chain->id);
+            return -1;
         }
+        chain->rx_modem_stopped = false;
+    }
+
+    return gs_rxworker_arm(chain->rx_worker);
+}
 
-        NetFrame *network_frame = new NetFrame((unsigned char *)buffer, buffer_size * sizeof(char), NetType::DATA, NetVertex::CLIENT);
-        network_frame->sendFrame(global->network_data);
-        delete network_frame;
+int gs_xband_disarm(gs_chain_t *chain)
+{
+    global_data_t *global = chain->global;
 
-        free(buffer);
+    // Draining first: once the stop returns the receive in progress, the capture stage parks rather than starting
+    // another on the stopped modem.
+    if (gs_rxworker_drain(chain->rx_worker) < 0)
+    {
+        return -1;
     }
 
-    if (global->network_data->thread_status > 0)
+    // Returns a receive in progress, so that the capture stage sees the disarm promptly.
+    if (rxmodem_stop(chain->rx_modem) < 0)
     {
-        global->network_data->thread_status = 0;
+        dbprintlf(RED_FG "Failed to stop the RX modem of chain %u.", chain->id);
     }
-    return NULL;
+    chain->rx_modem_stopped = true;
+
+    int retval = gs_rxworker_wait_idle(chain->rx_worker, global->config->rx_disarm_timeout_ms);
+    if (retval == 0)
+    {
+        dbprintlf(YELLOW_FG "Capture stage still finishing a frame after %u ms; it will stop when the modem returns.", global->config->rx_disarm_timeout_ms);
+    }
+    return retval;
+}
+
+#define FWD_DRAIN_BURST 64 // Most spooled frames sent between looks at the receive ring.
+
+// Stamps a received frame with the next sequence number of its chain.
+static void fwd_sequence(uint32_t session, uint64_t *next_seq, const PoolBuffer &frame, gs_seq_hdr_t *seq)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t age = gs_monotonic_ns() - frame->timestamp;
+
+    seq->magic = GS_SEQ_MAGIC;
+    seq->flags = 0;
+    seq->header_size = sizeof(gs_seq_hdr_t);
+    seq->session = session;
+    seq->seq = (*next_seq)++;
+    seq->realtime_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec - age;
+    seq->chain = frame->chain;
 }
 
-void *gs_network_rx_thread(void *args)
+static void fwd_spool(global_data_t *global, const gs_seq_hdr_t *seq, const uint8_t *payload, uint32_t size)
 {
-    global_data_t *global = (global_data_t *)args;
-    NetDataClient *network_data = global->network_data;
+    if (gs_spool_empty(global->spool))
+    {
+        dbprintlf(YELLOW_FG "Spooling received frames until the server can take them.");
+    }
+    pthread_mutex_lock(&global->spool->lock);
+    gs_spool_push(global->spool, seq, payload, size);
+    pthread_mutex_unlock(&global->spool->lock);
+}
 
-    // PLL initialization data.
-    global->PLL->spi_bus = 0;
-    global->PLL->spi_cs = 1;
-    global->PLL->spi_cs_internal = 1;
-    global->PLL->cs_gpio = -1;
-    global->PLL->single = 1;
-    global->PLL->muxval = 6;
+// Whether a received frame should go to the spool rather than the server.
+static bool fwd_hold(global_data_t *global)
+{
+    if (!global->spool->enabled)
+    {
+        return false;
+    }
+    return !gs_uplink_connected(global->uplink) || (global->config->spool_order == SPOOL_DRAIN_AHEAD && !gs_spool_empty(global->spool));
+}
 
-    // Haystack is a network client to the GS Server, and so should be very similar in socketry to ground_station.
+static bool fwd_draining(global_data_t *global)
+{
+    return global->spool->enabled && gs_uplink_connected(global->uplink) && !gs_spool_empty(global->spool);
+}
+
+// Sends spooled frames while the drain rate allows. drain_at is when the next may go. With several chains, whichever
+// forwarding stage gets to the spool first drains it, for all of them.
+static void fwd_drain(global_data_t *global, uint64_t *drain_at)
+{
+    uint32_t rate = global->config->spool_drain_bytes_per_sec;
+
+    if (!fwd_draining(global) || pthread_mutex_trylock(&global->spool->lock) != 0)
+    {
+        return;
+    }
 
-    while (network_data->recv_active && network_data->thread_status > 0)
+    for (int i = 0; i < FWD_DRAIN_BURST && fwd_draining(global); i++)
     {
-        if (!network_data->connection_ready)
+        uint64_t now = gs_monotonic_ns();
+        if (*drain_at > now)
         {
-            usleep(5 SEC);
-            continue;
+            break;
+        }
+
+        const uint8_t *item;
+        ssize_t size = gs_spool_peek(global->spool, &item);
+        if (gs_uplink_send_spooled(global->uplink, global->network_data, NetVertex::CLIENT, item, size) <= 0)
+        {
+            break; // Stays spooled; the network loop will notice the connection is gone.
+        }
+        gs_spool_pop(global->spool);
+
+        if (rate > 0)
+        {
+            // Paced from the previous frame, or from now after a pause, so that idle time does not build up into a burst.
+            *drain_at = (*drain_at > now - 1000000 ? *drain_at : now) + (uint64_t)size * 1000000000ULL / rate;
+        }
+
+        if (gs_spool_empty(global->spool))
+        {
+            dbprintlf(GREEN_FG "Spool drained; %u frames sent late, %u lost to a full spool so far.", global->spool->replayed.load(), global->spool->dropped.load());
+        }
+    }
+
+    pthread_mutex_unlock(&global->spool->lock);
+}
+
+// Whether DATA items carry a sequence header. With several chains, it is what tells the server which chain a frame
+// came from; a compressed frame is told apart by its flags.
+static bool fwd_sequenced(global_data_t *global)
+{
+    return global->spool->enabled || global->chain_count > 1 || global->compress->enabled;
+}
+
+// Sends the frames collected so far as one batch and returns them to the pool; spools them if it fails.
+static void fwd_flush(global_data_t *global, PoolBuffer *batch, gs_seq_hdr_t *seqs, uint32_t *count)
+{
+    bool sequenced = fwd_sequenced(global);
+
+    trprintlf(GREEN_FG "Forwarding a batch of %u frames to the server.", *count);
+    ssize_t sent = gs_uplink_send_batch(global->uplink, global->network_data, NetVertex::CLIENT, batch, sequenced ? seqs : NULL, *count);
+
+    for (uint32_t i = 0; i < *count; i++)
+    {
+        if (sent <= 0 && global->spool->enabled)
+        {
+            fwd_spool(global, &seqs[i], batch[i]->data, batch[i]->size);
+        }
+        batch[i].reset();
+    }
+    *count = 0;
+}
+
+// Sends a sequenced frame on: to the spool while holding, on its own, or into the open batch, which goes once full.
+static void fwd_forward(global_data_t *global, PoolBuffer &frame, const gs_seq_hdr_t *seq, PoolBuffer *batch, gs_seq_hdr_t *seqs, uint32_t *count, size_t *batch_size, uint64_t *deadline)
+{
+    gs_uplink_t *uplink = global->uplink;
+    bool sequenced = fwd_sequenced(global);
+    uint8_t *buffer = frame->data;
+    ssize_t buffer_size = frame->size;
+
+    if (fwd_hold(global))
+    {
+        // Anything older in the open batch goes first, to the server or, failing that, the spool.
+        if (*count > 0)
+        {
+            fwd_flush(global, batch, seqs, count);
+        }
+        fwd_spool(global, seq, buffer, buffer_size);
+    }
+    else if (!gs_uplink_batching(uplink))
+    {
+        if (gs_uplink_send(uplink, global->network_data, NetVertex::CLIENT, sequenced ? seq : NULL, buffer, buffer_size) <= 0 && global->spool->enabled)
+        {
+            fwd_spool(global, seq, buffer, buffer_size);
         }
+    }
+    else
+    {
+        size_t item_size = sizeof(uint32_t) + (sequenced ? sizeof(gs_seq_hdr_t) : 0) + buffer_size;
 
-        int read_size = 0;
+        // A frame that would take the batch past batch_bytes starts the next one.
+        if (*count > 0 && *batch_size + item_size > uplink->batch_bytes)
+        {
+            fwd_flush(global, batch, seqs, count);
+        }
+        if (*count == 0)
+        {
+            *deadline = gs_monotonic_ns() + uplink->batch_latency_us * 1000ULL;
+            *batch_size = sizeof(gs_batch_hdr_t);
+        }
+        *batch_size += item_size;
+        seqs[*count] = *seq;
+        batch[(*count)++] = std::move(frame);
 
-        while (read_size >= 0 && network_data->recv_active && network_data->thread_status > 0)
+        if (*count >= uplink->batch_frames || *batch_size >= uplink->batch_bytes)
         {
-            dbprintlf(BLUE_BG "Waiting to receive...");
+            fwd_flush(global, batch, seqs, count);
+        }
+    }
+    frame.reset();
+}
+
+void *gs_xband_fwd_thread(void *args)
+{
+    gs_chain_t *chain = (gs_chain_t *)args;
+    global_data_t *global = chain->global;
+    bool sequenced = fwd_sequenced(global);
+    gs_compress_t *comp = global->compress;
+    gs_compress_stream_t *stream = &comp->streams[chain->id];
 
-            NetFrame *netframe = new NetFrame();
-            read_size = netframe->recvFrame(network_data);
+    PoolBuffer batch[UPLINK_BATCH_MAX];
+    gs_seq_hdr_t seqs[UPLINK_BATCH_MAX];
+    uint32_t count = 0;
+    size_t batch_size = 0;
+    uint64_t deadline = 0;
 
-            dbprintlf("Read %d bytes.", read_size);
+    // Sequence numbers start again with each run, and each chain has its own; the session tells the server which run
+    // and chain they belong to.
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint32_t session = ((uint32_t)ts.tv_sec ^ ((uint32_t)ts.tv_nsec << 8) ^ (uint32_t)getpid()) + chain->id;
+    uint64_t next_seq = 0;
+    uint64_t drain_at = 0;
 
-            if (read_size >= 0)
+    char stage[48];
+    snprintf(stage, sizeof(stage), "forwarding stage of chain %u", chain->id);
+    gs_sched_apply(global->config->chain[chain->id].fwd_cpu, global->config->sched_forward_priority, stage);
+
+    char name[METRICS_NAME_LEN];
+    snprintf(name, sizeof(name), "fwd%u", chain->id);
+    gs_metrics_register(global->metrics, name);
+
+    while (global->thread_status.load(std::memory_order_acquire) > 0)
+    {
+        // With a batch open, wait no longer than its deadline; with frames spooled, no longer than the next may go.
+        uint64_t now = gs_monotonic_ns();
+        uint64_t timeout_us = 1000000;
+        if (count > 0)
+        {
+            timeout_us = deadline > now ? (deadline - now) / 1000 : 0;
+        }
+        if (fwd_draining(global))
+        {
+            uint64_t drain_us = drain_at > now ? (drain_at - now) / 1000 : 0;
+            timeout_us = drain_us < timeout_us ? drain_us : timeout_us;
+        }
+
+        // A batch past its deadline goes out before more frames are taken. With frames out at the compression workers,
+        // new ones are taken only while the window has room, and without waiting: it is their return that is waited on.
+        bool compressing = comp->enabled && gs_compress_in_flight(stream) > 0;
+        bool take = (count == 0 || deadline > now) && (!comp->enabled || gs_compress_room(stream));
+        PoolBuffer frame = take ? frame_ring_pop_us(chain->rx_ring, compressing ? 0 : timeout_us) : PoolBuffer();
+        bool taken = frame.valid();
+        if (frame.valid() && gs_validate_enabled(chain->validate) && !gs_validate_frame(chain->validate, frame->data, frame->size))
+        {
+            // Corrupt or repeated: dropped before it takes a sequence number. Counted; the recording still has it.
+            frame.reset();
+        }
+        if (frame.valid())
+        {
+            uint8_t *buffer = frame->data;
+            ssize_t buffer_size = frame->size;
+            // Against the time taken before the pop: exact for a frame that was waiting, 0 for one that arrived during it.
+            gs_metrics_record(METRIC_RX_QUEUE_NS, now > frame->timestamp ? now - frame->timestamp : 0);
+
+            trprintlf(GREEN_FG "Forwarding a %zd byte frame to the server.", buffer_size);
+            gs_log_hexdump("X-Band frame", buffer, buffer_size);
+
+            gs_seq_hdr_t seq = {0};
+            if (sequenced)
+            {
+                fwd_sequence(session, &next_seq, frame, &seq);
+            }
+
+            if (comp->enabled)
             {
-                dbprintlf("Received the following NetFrame:");
-                netframe->print();
-                netframe->printNetstat();
-
-                // Extract the payload into a buffer.
-                int payload_size = netframe->getPayloadSize();
-                unsigned char *payload = (unsigned char *)malloc(payload_size);
-                if (netframe->retrievePayload(payload, payload_size) < 0)
-                {
-                    dbprintlf(RED_FG "Error retrieving data.");
-                    continue;
-                }
-
-                switch (netframe->getType())
-                {
-                case NetType::XBAND_CONFIG:
-                {
-                    dbprintlf(BLUE_FG "Received an X-Band CONFIG frame!");
-                    if (!global->radio_ready)
-                    {
-                        // TODO: Send a packet indicating this.
-                        dbprintlf(RED_FG "Cannot configure radio: radio not ready, does not exist, or failed to initialize.");
-                        break;
-                    }
-
-                    if (netframe->getDestination() == NetVertex::HAYSTACK)
-                    {
-                        // xband_set_data_t *config = (xband_set_data_t *)payload;
-                        // adradio_set_tx_lo(global_data->tx_modem, config->LO);
-                        phy_config_t *config = (phy_config_t *)payload;
-
-                        if (global->rx_armed && config->mode == SLEEP)
-                        {
-                            dbprintlf(RED_BG "ATTENTION: CONFIGURATION ABORTED! CANNOT PUT RADIO TO SLEEP WHILE RX IS ARMED!");
-                            break;
-                        }
-
-                        // TODO: Figure out how to configure the X-Band radio.
-
-                        // RECONFIGURE XBAND
-                        adradio_set_ensm_mode(global->radio, (ensm_mode)config->mode);
-                        adradio_set_rx_lo(global->radio, config->LO);
-                        adradio_set_samp(global->radio, config->samp);
-                        adradio_set_rx_bw(global->radio, config->bw);
-                        char filter_name[256];
-                        // TODO: Keep track of the return value of the load filter thing in the status.
-                        snprintf(filter_name, sizeof(filter_name), "/home/sunip/%s.ftr", config->ftr_name);
-                        adradio_set_tx_hardwaregain(global->radio, -85);
-                        adradio_set_rx_hardwaregainmode(global->radio, strcmp("fast_attack", config->curr_gainmode) ? SLOW_ATTACK : FAST_ATTACK);
-                    }
-                    else
-                    {
-                        dbprintlf(YELLOW_FG "Incorrectly received a configuration for Roof X-Band.");
-                    }
-                    break;
-                }
-                case NetType::XBAND_COMMAND:
-                {
-                    dbprintlf(BLUE_FG "Received XBAND command.");
-                    XBAND_COMMAND *command = (XBAND_COMMAND *)payload;
-
-                    static pthread_t xband_rx_tid;
-
-                    switch (*command)
-                    {
-                    case XBC_INIT_PLL:
-                    {
-                        dbprintlf("Received PLL initialize command.");
-                        if (global->PLL_ready)
-                        {
-                            dbprintlf(YELLOW_FG "PLL already initialized, canceling.");
-                            break;
-                        }
-
-                        if (adf4355_init(global->PLL) < 0)
-                        {
-                            dbprintlf(RED_FG "PLL initialization failure.");
-                        }
-                        else if (adf4355_set_rx(global->PLL) < 0)
-                        {
-                            dbprintlf(RED_FG "PLL set RX failure.");
-                        }
-                        else
-                        {
-                            dbprintlf(GREEN_FG "PLL initialization success.");
-                            global->PLL_ready = true;
-                        }
-                        break;
-                    }
-                    case XBC_DISABLE_PLL:
-                    {
-                        dbprintlf("Received Disable PLL command.");
-                        if (!global->PLL_ready)
-                        {
-                            dbprintlf(YELLOW_FG "PLL already disabled, canceling.");
-                            break;
-                        }
-
-                        if (adf4355_pw_down(global->PLL) < 0)
-                        {
-                            dbprintlf(RED_FG "PLL shutdown failure.");
-                        }
-                        else
-                        {
-                            dbprintlf(GREEN_FG "PLL shutdown success.");
-                        }
-                        break;
-                    }
-                    case XBC_ARM_RX:
-                    {
-                        dbprintlf("Received Arm RX command.");
-                        if (global->rx_armed)
-                        {
-                            dbprintlf(YELLOW_FG "RX already armed, canceling.");
-                            break;
-                        }
-                        else
-                        {
-                            if (!pthread_create(&xband_rx_tid, NULL, gs_xband_rx_thread, global))
-                            {
-                                dbprintlf("Armed RX.");
-                                global->rx_armed = true;
-                            }
-                            else
-                            {
-                                dbprintlf(RED_FG "Failed to arm RX.");
-                            }
-                        }
-
-                        // if (rxmodem_start(global->rx_modem) < 0)
-                        // {
-                        //     dbprintlf(RED_FG "Failed to arm RX.");
-                        // }
-                        // else
-                        // {
-                        //     dbprintlf("Armed RX.");
-                        //     global->rx_armed = true;
-                        // }
-                        break;
-                    }
-                    case XBC_DISARM_RX:
-                    {
-                        dbprintlf("Received Disarm RX command.");
-                        if (!global->rx_armed)
-                        {
-                            dbprintlf(YELLOW_FG "RX already disarmed, canceling.");
-                            break;
-                        }
-
-                        if (rxmodem_stop(global->rx_modem) < 0)
-                        {
-                            dbprintlf(RED_FG "Failed to disable RX.");
-                        }
-
-                        pthread_cancel(*(global->rx_modem->thr));
-                        pthread_cancel(xband_rx_tid);
-                        usleep(100000);
-
-                        dbprintlf("Disarmed RX.");
-                        global->rx_armed = false;
-
-                        break;
-                    }
-                    }
-
-                    break;
-                }
-                case NetType::ACK:
-                {
-                    dbprintlf(BLUE_FG "Received an ACK frame!");
-                    break;
-                }
-                case NetType::NACK:
-                {
-                    dbprintlf(BLUE_FG "Received a NACK frame!");
-                    break;
-                }
-                default:
-                {
-                    break;
-                }
-                }
-                free(payload);
+                gs_compress_submit(comp, stream, frame, &seq);
             }
             else
             {
-                break;
+                fwd_forward(global, frame, &seq, batch, seqs, &count, &batch_size, &deadline);
             }
-
-            delete netframe;
         }
-        if (read_size == -404)
+
+        // Frames come back from the workers in the order they went; every one that is done goes on. Waits for the
+        // oldest only if there was nothing else to do.
+        if (comp->enabled)
         {
-            dbprintlf(RED_BG "Connection forcibly closed by the server.");
-            strcpy(network_data->disconnect_reason, "SERVER-FORCED");
-            network_data->connection_ready = false;
-            continue;
+            uint64_t reap_us = compressing && !taken ? timeout_us : 0;
+            gs_seq_hdr_t done_seq;
+            PoolBuffer done;
+            while (gs_compress_reap(comp, stream, &done, &done_seq, reap_us) > 0)
+            {
+                fwd_forward(global, done, &done_seq, batch, seqs, &count, &batch_size, &deadline);
+                reap_us = 0;
+            }
         }
-        else if (errno == EAGAIN)
+
+        // Its first frame has waited batch_latency_us.
+        if (count > 0 && gs_monotonic_ns() >= deadline)
         {
-            dbprintlf(YELLOW_BG "Active connection timed-out (%d).", read_size);
-            strcpy(network_data->disconnect_reason, "TIMED-OUT");
-            network_data->connection_ready = false;
-            continue;
+            fwd_flush(global, batch, seqs, &count);
         }
-        erprintlf(errno);
+
+        fwd_drain(global, &drain_at);
     }
 
-    network_data->recv_active = false;
-    dbprintlf(FATAL "DANGER! NETWORK RECEIVE THREAD IS RETURNING!");
+    // The workers are stopped only once every forwarding stage has returned; what they still have goes on first.
+    while (gs_compress_in_flight(stream) > 0)
+    {
+        gs_seq_hdr_t done_seq;
+        PoolBuffer done;
+        if (gs_compress_reap(comp, stream, &done, &done_seq, 1000000) > 0)
+        {
+            fwd_forward(global, done, &done_seq, batch, seqs, &count, &batch_size, &deadline);
+        }
+    }
 
-    if (global->network_data->thread_status > 0)
+    if (count > 0)
     {
-        global->network_data->thread_status = 0;
+        fwd_flush(global, batch, seqs, &count);
     }
+
+    // Stops the others, unless one of them already asked for worse.
+    int running = 1;
+    global->thread_status.compare_exchange_strong(running, 0, std::memory_order_acq_rel);
     return NULL;
 }
 
-void *xband_status_thread(void *args)
+// The chain with this id, or NULL if there is no such chain.
+static gs_chain_t *chain_by_id(global_data_t *global, uint8_t id)
+{
+    if (id >= global->chain_count)
+    {
+        dbprintlf(RED_FG "Received a frame for chain %u, but only %u are configured.", id, global->chain_count);
+        return NULL;
+    }
+    return &global->chains[id];
+}
+
+// The chain a command is for: the byte at 'offset', or chain 0 if the payload ends before it. NULL if there is no such
+// chain.
+static gs_chain_t *handle_chain(global_data_t *global, const PoolBuffer &payload_buffer, size_t offset)
+{
+    return chain_by_id(global, payload_buffer->size > (ssize_t)offset ? payload_buffer->data[offset] : 0);
+}
+
+// Answers an XBC_INIT_PLL, XBC_DISABLE_PLL, XBC_ARM_RX or XBC_DISARM_RX, or a command not known.
+static void command_answer(global_data_t *global, int32_t command, uint8_t chain, int result, uint32_t queue_us, uint32_t exec_us)
+{
+    xband_command_ack_t ack[1];
+    memset(ack, 0x0, sizeof(xband_command_ack_t));
+    ack->command = command;
+    ack->chain = chain;
+    ack->result = result;
+    ack->queue_us = queue_us;
+    ack->exec_us = exec_us;
+    gs_uplink_send_control(global->uplink, global->network_data, result >= 0 ? NetType::ACK : NetType::NACK, NetVertex::CLIENT, (const uint8_t *)ack, sizeof(xband_command_ack_t));
+}
+
+// Answers a configuration or command that will not run: superseded by a later one, or refused for a full queue.
+static void command_refuse(global_data_t *global, uint8_t chain, const hwexec_cmd_t *cmd, int result)
 {
-    global_data_t *global = (global_data_t *)args;
-    NetDataClient *network_data = global->network_data;
+    uint32_t queue_us = (uint32_t)((gs_monotonic_ns() - cmd->queued_ns) / 1000);
 
-    while ((!global->rx_modem_ready || !global->radio_ready) && global->network_data->thread_status > 0)
+    if (cmd->type == NetType::XBAND_CONFIG)
     {
-        if (gs_xband_init(global) < 0)
+        phy_config_ack_t nack[1];
+        memset(nack, 0x0, sizeof(phy_config_ack_t));
+        nack->chain = chain;
+        nack->result = result;
+        nack->queue_us = queue_us;
+        gs_uplink_send_control(global->uplink, global->network_data, NetType::NACK, NetVertex::CLIENT, (const uint8_t *)nack, sizeof(phy_config_ack_t));
+    }
+    else if (cmd->command == XBC_SCHEDULE_LOAD || cmd->command == XBC_SCHEDULE_CLEAR)
+    {
+        xband_schedule_ack_t nack[1];
+        memset(nack, 0x0, sizeof(xband_schedule_ack_t));
+        nack->chain = chain;
+        nack->result = result;
+        nack->pending = global->schedule->tables[chain].pending.load(std::memory_order_relaxed);
+        gs_uplink_send_control(global->uplink, global->network_data, NetType::NACK, NetVertex::CLIENT, (const uint8_t *)nack, sizeof(xband_schedule_ack_t));
+    }
+    else
+    {
+        command_answer(global, cmd->command, chain, result, queue_us, 0);
+    }
+}
+
+// Queues a checked configuration or command for the chain's hardware executor.
+static void command_submit(global_data_t *global, gs_chain_t *chain, hwexec_cmd_t *cmd)
+{
+    hwexec_cmd_t replaced[1];
+    int retval = gs_hwexec_submit(global->hwexec, chain->id, cmd, replaced);
+    if (retval < 0)
+    {
+        dbprintlf(RED_FG "Hardware queue of chain %u is full, refusing the command.", chain->id);
+        command_refuse(global, chain->id, cmd, HWEXEC_QUEUE_FULL);
+    }
+    else if (retval == 2)
+    {
+        dbprintlf(YELLOW_FG "Superseded a command still queued for chain %u.", chain->id);
+        command_refuse(global, chain->id, replaced, HWEXEC_SUPERSEDED);
+    }
+}
+
+void gs_network_handle(global_data_t *global, NetType type, NetVertex destination, PoolBuffer &payload_buffer)
+{
+    unsigned char *payload = payload_buffer->data;
+
+    switch (type)
+    {
+    case NetType::XBAND_CONFIG:
+    {
+        dbprintlf(BLUE_FG "Received an X-Band CONFIG frame!");
+
+        // Compact (gs_wire.hpp) or a raw struct; a raw one without the trailing chain byte is for chain 0.
+        hwexec_cmd_t cmd[1];
+        cmd->type = type;
+        cmd->command = 0;
+        phy_config_t *config = &cmd->config;
+        memset(config, 0x0, sizeof(phy_config_t));
+        ssize_t size = payload_buffer->size > 0 ? payload_buffer->size : 0;
+        if (gs_wire_is_encoded(payload, size))
         {
-            dbprintlf(RED_FG "Receive thread aborting, radio cannot initialize.");
-            usleep(5 SEC);
-            continue;
+            int retval = gs_wire_decode_config(payload, size, config);
+            if (retval < 0)
+            {
+                dbprintlf(RED_FG "Received a malformed X-Band CONFIG frame (%d).", retval);
+                phy_config_ack_t nack[1];
+                memset(nack, 0x0, sizeof(phy_config_ack_t));
+                nack->result = -6;
+                gs_uplink_send_control(global->uplink, global->network_data, NetType::NACK, NetVertex::CLIENT, (const uint8_t *)nack, sizeof(phy_config_ack_t));
+                break;
+            }
+        }
+        else
+        {
+            memcpy(config, payload, (size_t)size < sizeof(phy_config_t) ? (size_t)size : sizeof(phy_config_t));
         }
-    }
 
-    while (network_data->recv_active && network_data->thread_status > 0)
+        gs_chain_t *chain = chain_by_id(global, config->chain);
+        if (chain == NULL)
+        {
+            break;
+        }
+        if (destination != NetVertex::HAYSTACK)
+        {
+            dbprintlf(YELLOW_FG "Incorrectly received a configuration for Roof X-Band.");
+            break;
+        }
+
+        command_submit(global, chain, cmd);
+        break;
+    }
+    case NetType::XBAND_COMMAND:
     {
-        if (!global->radio_ready)
+        dbprintlf(BLUE_FG "Received XBAND command.");
+        gs_chain_t *chain = handle_chain(global, payload_buffer, offsetof(xband_command_t, chain));
+        if (chain == NULL)
         {
-            dbprintlf(RED_FG "Cannot send radio config: radio not ready, does not exist, or failed to initialize.");
-            usleep(2 SEC);
-            continue;
+            break;
+        }
+        if (payload_buffer->size < (ssize_t)sizeof(int32_t))
+        {
+            dbprintlf(RED_FG "Received an XBAND command frame too short to name a command.");
+            break;
         }
 
-        if (network_data->connection_ready)
+        hwexec_cmd_t cmd[1];
+        cmd->type = type;
+        memcpy(&cmd->command, payload, sizeof(int32_t));
+        if (cmd->command < XBC_INIT_PLL || cmd->command > XBC_SCHEDULE_CLEAR)
         {
-            phy_status_t status[1];
-            memset(status, 0x0, sizeof(phy_status_t));
+            dbprintlf(RED_FG "Received an unknown XBAND command (%d).", cmd->command);
+            command_answer(global, cmd->command, chain->id, -6, 0, 0);
+            break;
+        }
+        cmd->payload = std::move(payload_buffer);
 
-            adradio_get_rx_bw(global->radio, (long long *)&status->bw);
-            adradio_get_rx_hardwaregain(global->radio, &status->gain);
-            adradio_get_rx_hardwaregainmode(global->radio, status->curr_gainmode, sizeof(status->curr_gainmode));
-            adradio_get_rx_lo(global->radio, (long long *)&status->LO);
-            adradio_get_rssi(global->radio, &status->rssi);
-            adradio_get_samp(global->radio, (long long *)&status->samp);
-            adradio_get_temp(global->radio, (long long *)&status->temp);
+        command_submit(global, chain, cmd);
+        break;
+    }
+    case NetType::ACK:
+    {
+        dbprintlf(BLUE_FG "Received an ACK frame!");
+        break;
+    }
+    case NetType::NACK:
+    {
+        dbprintlf(BLUE_FG "Received a NACK frame!");
+        break;
+    }
+    default:
+    {
+        break;
+    }
+    }
+}
 
-            char buf[32];
-            memset(buf, 0x0, 32);
-            adradio_get_ensm_mode(global->radio, buf, sizeof(buf));
-            if (strcmp(buf, "sleep") == 0)
-            {
-                status->mode = 0;
-            }
-            else if (strcmp(buf, "fdd") == 0)
+// Applies a configuration to the chain's radio, filling in the ack.
+static void execute_config(gs_chain_t *chain, const phy_config_t *config, phy_config_ack_t *ack)
+{
+    memset(ack, 0x0, sizeof(phy_config_ack_t));
+
+    if (!chain->radio_ready.load(std::memory_order_acquire))
+    {
+        dbprintlf(RED_FG "Cannot configure radio: radio not ready, does not exist, or failed to initialize.");
+        ack->result = -4;
+    }
+    else if (gs_rxworker_armed(chain->rx_worker) && config->mode == SLEEP)
+    {
+        dbprintlf(RED_BG "ATTENTION: CONFIGURATION ABORTED! CANNOT PUT RADIO TO SLEEP WHILE RX IS ARMED!");
+        ack->result = -5;
+    }
+    else
+    {
+        // Only what differs from the configuration in effect is written.
+        radiocfg_settings_t want[1];
+        gs_radiocfg_settings(config, want);
+        int retval = gs_radiocfg_apply(chain->radio_config, want, ack);
+
+        if (retval > 0)
+        {
+            dbprintlf(GREEN_FG "Configured chain %u (settings 0x%02x) in %u us.", chain->id, ack->changed, ack->apply_us);
+
+            // A frame naming no filter kept the one loaded, and a schedule may since have moved the LO.
+            radiocfg_settings_t applied[1];
+            gs_radiocfg_applied(chain->radio_config, applied);
+            gs_xband_config_applied(chain, applied);
+        }
+        else if (retval == 0)
+        {
+            dbprintlf("Configuration of chain %u unchanged.", chain->id);
+        }
+        else if (retval == -1)
+        {
+            dbprintlf(RED_FG "Configuring chain %u failed at setting 0x%02x; the previous configuration was restored.", chain->id, ack->failed);
+        }
+        else if (retval == -2)
+        {
+            dbprintlf(RED_BG "Configuring chain %u failed at setting 0x%02x and could not be undone; the next configuration will be applied in full.", chain->id, ack->failed);
+        }
+    }
+
+    ack->chain = chain->id;
+}
+
+// Loads or clears the chain's schedule, filling in the ack.
+static void execute_schedule(gs_chain_t *chain, int32_t command, const PoolBuffer &payload_buffer, xband_schedule_ack_t *ack)
+{
+    global_data_t *global = chain->global;
+    const unsigned char *payload = payload_buffer->data;
+
+    memset(ack, 0x0, sizeof(xband_schedule_ack_t));
+    ack->chain = chain->id;
+
+    if (command == XBC_SCHEDULE_CLEAR)
+    {
+        dbprintlf("Received Clear Schedule command.");
+        gs_schedule_clear(global->schedule, chain->id);
+        ack->result = 1;
+    }
+    else
+    {
+        xband_schedule_t schedule[1];
+        radiocfg_settings_t applied[1];
+        size_t size = payload_buffer->size > 0 ? (size_t)payload_buffer->size : 0;
+        if (size < sizeof(xband_schedule_t))
+        {
+            ack->result = -1;
+        }
+        else
+        {
+            memcpy(schedule, payload, sizeof(xband_schedule_t));
+            if (size < sizeof(xband_schedule_t) + (size_t)schedule->count * sizeof(xband_schedule_entry_t))
             {
-                status->mode = 1;
+                ack->result = -1;
             }
-            else if (strcmp(buf, "tdd") == 0)
+            else if (!gs_radiocfg_applied(chain->radio_config, applied))
             {
-                status->mode = 2;
+                // Retunes change the configuration in effect; there has to be one.
+                ack->result = -4;
             }
             else
             {
-                status->mode = -1;
+                ack->result = gs_schedule_load(global->schedule, chain->id, schedule->epoch_ns, (const xband_schedule_entry_t *)(payload + sizeof(xband_schedule_t)), schedule->count, schedule->flags & XBS_APPEND);
             }
+        }
 
-            status->modem_ready = global->rx_modem_ready;
-            status->PLL_ready = global->PLL_ready;
-            status->radio_ready = global->radio_ready;
-            status->rx_armed = global->rx_armed;
-            status->last_rx_status = global->last_rx_status;
-            status->last_read_status = global->last_read_status;
-
-            // dbprintlf(GREEN_FG "Sending the following X-Band status data:");
-            // dbprintlf(GREEN_FG "mode %d", status->mode);
-            // dbprintlf(GREEN_FG "pll_freq %d", status->pll_freq);
-            // dbprintlf(GREEN_FG "LO %lld", status->LO);
-            // dbprintlf(GREEN_FG "samp %lld", status->samp);
-            // dbprintlf(GREEN_FG "bw %lld", status->bw);
-            // dbprintlf(GREEN_FG "ftr_name %s", status->ftr_name);
-            // dbprintlf(GREEN_FG "temp %lld", status->temp);
-            // dbprintlf(GREEN_FG "rssi %f", status->rssi);
-            // dbprintlf(GREEN_FG "gain %f", status->gain);
-            // dbprintlf(GREEN_FG "curr_gainmode %s", status->curr_gainmode);
-            // dbprintlf(GREEN_FG "pll_lock %d", status->pll_lock);
-            // dbprintlf(GREEN_FG "modem_ready %d", status->modem_ready);
-            // dbprintlf(GREEN_FG "PLL_ready %d", status->PLL_ready);
-            // dbprintlf(GREEN_FG "radio_ready %d", status->radio_ready);
-            // dbprintlf(GREEN_FG "rx_armed %d", status->rx_armed);
-            // dbprintlf(GREEN_FG "last_rx_status %d", status->last_rx_status);
-            // dbprintlf(GREEN_FG "MTU %d", status->MTU);
-
-            NetFrame *status_frame = new NetFrame((unsigned char *)status, sizeof(phy_status_t), NetType::XBAND_DATA, NetVertex::CLIENT);
-            status_frame->sendFrame(network_data);
-            delete status_frame;
-        }
-
-        usleep(network_data->polling_rate SEC);
-    }
-
-    dbprintlf(FATAL "XBAND_STATUS_THREAD IS EXITING (%d)!", network_data->thread_status);
-    if (network_data->thread_status > 0)
-    {
-        network_data->thread_status = 0;
+        if (ack->result > 0)
+        {
+            dbprintlf(GREEN_FG "Loaded %u schedule entries for chain %u.", schedule->count, chain->id);
+        }
+        else
+        {
+            dbprintlf(RED_FG "Refused a schedule for chain %u (%d).", chain->id, ack->result);
+        }
     }
-    return NULL;
-}
\ No newline at end of file
+
+    ack->pending = global->schedule->tables[chain->id].pending.load(std::memory_order_relaxed);
+}
+
+// Runs a PLL or arming command. Returns as xband_command_ack_t::result.
+static int execute_command(gs_chain_t *chain, int32_t command)
+{
+    // No capture stage runs while replaying; a disarm would wait out rx_disarm_timeout_ms for one.
+    if ((command == XBC_ARM_RX || command == XBC_DISARM_RX) && chain->global->replay->enabled)
+    {
+        dbprintlf(YELLOW_FG "Not arming or disarming RX while replaying captures.");
+        return -1;
+    }
+
+    switch (command)
+    {
+    case XBC_INIT_PLL:
+    {
+        dbprintlf("Received PLL initialize command.");
+        if (chain->PLL_ready.load(std::memory_order_acquire))
+        {
+            dbprintlf(YELLOW_FG "PLL already initialized, canceling.");
+            return 0;
+        }
+
+        if (adf4355_init(chain->PLL) < 0)
+        {
+            dbprintlf(RED_FG "PLL initialization failure.");
+            return -1;
+        }
+        if (adf4355_set_rx(chain->PLL) < 0)
+        {
+            dbprintlf(RED_FG "PLL set RX failure.");
+            return -1;
+        }
+
+        dbprintlf(GREEN_FG "PLL initialization success.");
+        chain->PLL_ready.store(true, std::memory_order_release);
+        gs_status_notify(chain->status, STATUS_EVENT_PLL);
+        return 1;
+    }
+    case XBC_DISABLE_PLL:
+    {
+        dbprintlf("Received Disable PLL command.");
+        if (!chain->PLL_ready.load(std::memory_order_acquire))
+        {
+            dbprintlf(YELLOW_FG "PLL already disabled, canceling.");
+            return 0;
+        }
+
+        if (adf4355_pw_down(chain->PLL) < 0)
+        {
+            dbprintlf(RED_FG "PLL shutdown failure.");
+            return -1;
+        }
+
+        dbprintlf(GREEN_FG "PLL shutdown success.");
+        chain->PLL_ready.store(false, std::memory_order_release);
+        gs_status_notify(chain->status, STATUS_EVENT_PLL);
+        return 1;
+    }
+    case XBC_ARM_RX:
+    {
+        dbprintlf("Received Arm RX command.");
+        int retval = gs_xband_arm(chain);
+        if (retval == 0)
+        {
+            dbprintlf(YELLOW_FG "RX already armed, canceling.");
+            return 0;
+        }
+        if (retval < 0)
+        {
+            dbprintlf(RED_FG "Failed to arm RX.");
+            return -1;
+        }
+
+        dbprintlf("Armed RX.");
+        gs_status_notify(chain->status, STATUS_EVENT_ARM);
+        return 1;
+    }
+    case XBC_DISARM_RX:
+    {
+        dbprintlf("Received Disarm RX command.");
+        if (gs_xband_disarm(chain) < 0)
+        {
+            dbprintlf(YELLOW_FG "RX already disarmed, canceling.");
+            return 0;
+        }
+
+        dbprintlf("Disarmed RX.");
+        gs_status_notify(chain->status, STATUS_EVENT_ARM);
+        return 1;
+    }
+    default:
+    {
+        return -6;
+    }
+    }
+}
+
+int gs_xband_execute(gs_chain_t *chain, hwexec_cmd_t *cmd, uint32_t queue_us, uint32_t *exec_us)
+{
+    global_data_t *global = chain->global;
+    uint64_t start = gs_monotonic_ns();
+    int result = 0;
+
+    if (cmd->type == NetType::XBAND_CONFIG)
+    {
+        phy_config_ack_t ack[1];
+        execute_config(chain, &cmd->config, ack);
+        result = ack->result;
+        *exec_us = (uint32_t)((gs_monotonic_ns() - start) / 1000);
+        ack->queue_us = queue_us;
+        ack->exec_us = *exec_us;
+        gs_uplink_send_control(global->uplink, global->network_data, result >= 0 ? NetType::ACK : NetType::NACK, NetVertex::CLIENT, (const uint8_t *)ack, sizeof(phy_config_ack_t));
+    }
+    else if (cmd->command == XBC_SCHEDULE_LOAD || cmd->command == XBC_SCHEDULE_CLEAR)
+    {
+        xband_schedule_ack_t ack[1];
+        execute_schedule(chain, cmd->command, cmd->payload, ack);
+        result = ack->result;
+        *exec_us = (uint32_t)((gs_monotonic_ns() - start) / 1000);
+        gs_uplink_send_control(global->uplink, global->network_data, result > 0 ? NetType::ACK : NetType::NACK, NetVertex::CLIENT, (const uint8_t *)ack, sizeof(xband_schedule_ack_t));
+    }
+    else
+    {
+        result = execute_command(chain, cmd->command);
+        *exec_us = (uint32_t)((gs_monotonic_ns() - start) / 1000);
+        command_answer(global, cmd->command, chain->id, result, queue_us, *exec_us);
+    }
+
+    return result;
+}
+
+void gs_xband_config_applied(gs_chain_t *chain, const radiocfg_settings_t *applied)
+{
+    capture_radio_t radio[1];
+    memset(radio, 0x0, sizeof(capture_radio_t));
+    radio->LO = applied->LO;
+    radio->samp = applied->samp;
+    radio->bw = applied->bw;
+    radio->mode = applied->mode;
+    radio->gain_mode = applied->manual_gain ? CAPTURE_GAIN_MANUAL : applied->gainmode;
+    radio->chain = chain->id;
+    gs_recorder_set_radio(chain->global->recorder, radio);
+
+    // Reported as applied, without reading it back from libiio.
+    phy_config_t config[1];
+    memset(config, 0x0, sizeof(phy_config_t));
+    config->mode = applied->mode;
+    config->LO = applied->LO;
+    config->samp = applied->samp;
+    config->bw = applied->bw;
+    memcpy(config->ftr_name, applied->ftr_name, sizeof(config->ftr_name));
+    snprintf(config->curr_gainmode, sizeof(config->curr_gainmode), "%s", applied->manual_gain ? "manual" : applied->gainmode == FAST_ATTACK ? "fast_attack" : "slow_attack");
+    gs_status_set_config(chain->status, config);
+}
+
+void gs_xband_send_status(gs_chain_t *chain, uint32_t events)
+{
+    global_data_t *global = chain->global;
+
+    phy_status_t status[1];
+    memset(status, 0x0, sizeof(phy_status_t));
+    gs_status_fill(chain->status, status);
+
+    rx_snapshot_t rx[1];
+    gs_seqlock_read(chain->rx_stats, rx);
+
+    status->modem_ready = chain->rx_modem_ready.load(std::memory_order_acquire);
+    status->PLL_ready = chain->PLL_ready.load(std::memory_order_acquire);
+    status->radio_ready = chain->radio_ready.load(std::memory_order_acquire);
+    status->rx_armed = gs_rxworker_armed(chain->rx_worker);
+    status->last_rx_status = rx->last_rx_status;
+    status->last_read_status = rx->last_read_status;
+    status->MTU = global->config->rx_mtu;
+    status->rx_ring_depth = frame_ring_depth(chain->rx_ring);
+    status->rx_dropped_oldest = chain->rx_ring->dropped_oldest.load(std::memory_order_relaxed);
+    status->rx_dropped_newest = chain->rx_ring->dropped_newest.load(std::memory_order_relaxed);
+    status->rx_blocked = chain->rx_ring->blocked.load(std::memory_order_relaxed);
+    status->pool_in_use = global->pool->in_use.load(std::memory_order_relaxed);
+    status->pool_high_water = global->pool->high_water.load(std::memory_order_relaxed);
+    status->pool_exhausted = global->pool->exhausted.load(std::memory_order_relaxed);
+    status->rec_records = global->recorder->records.load(std::memory_order_relaxed);
+    status->rec_dropped = global->recorder->ring->dropped_newest.load(std::memory_order_relaxed);
+    status->rec_errors = global->recorder->write_errors.load(std::memory_order_relaxed);
+    status->uplink_frames = global->uplink->frames.load(std::memory_order_relaxed);
+    status->uplink_copies = global->uplink->copies.load(std::memory_order_relaxed);
+    status->uplink_errors = global->uplink->send_errors.load(std::memory_order_relaxed);
+    status->uplink_batches = global->uplink->batches.load(std::memory_order_relaxed);
+    status->net_reconnects = global->netloop->reconnects.load(std::memory_order_relaxed);
+    status->net_outage_ms = global->netloop->last_outage_ms.load(std::memory_order_relaxed);
+    status->net_bad_frames = global->netloop->bad_frames.load(std::memory_order_relaxed);
+    status->spool_frames = global->spool->spooled.load(std::memory_order_relaxed);
+    status->spool_replayed = global->spool->replayed.load(std::memory_order_relaxed);
+    status->spool_dropped = global->spool->dropped.load(std::memory_order_relaxed);
+    status->spool_depth = global->spool->depth.load(std::memory_order_relaxed);
+    status->spool_depth_kb = (uint32_t)(global->spool->depth_bytes.load(std::memory_order_relaxed) >> 10);
+    status->rx_arm_us = chain->rx_worker->arm_us.load(std::memory_order_relaxed);
+    status->rx_disarm_us = chain->rx_worker->disarm_us.load(std::memory_order_relaxed);
+    status->rx_slow_disarms = chain->rx_worker->slow_disarms.load(std::memory_order_relaxed);
+    status->rx_frames = rx->frames;
+    status->rx_errors = rx->rx_errors + rx->read_errors;
+    status->chain = chain->id;
+    status->rx_overruns = chain->rx_deadline->missed.load(std::memory_order_relaxed);
+    status->rx_worst_turn_us = chain->rx_deadline->worst_us.load(std::memory_order_relaxed);
+    status->rx_dma_depth = chain->rx_dma->active_depth.load(std::memory_order_relaxed);
+    status->rx_dma_starved = chain->rx_dma->starved.load(std::memory_order_relaxed);
+    status->rx_crc_errors = chain->validate->crc_errors.load(std::memory_order_relaxed);
+    status->rx_duplicates = chain->validate->duplicates.load(std::memory_order_relaxed);
+    gs_schedule_table_t *schedule = &global->schedule->tables[chain->id];
+    status->sched_pending = schedule->pending.load(std::memory_order_relaxed);
+    status->sched_applied = schedule->applied.load(std::memory_order_relaxed);
+    status->sched_skipped = schedule->skipped.load(std::memory_order_relaxed);
+    status->sched_failed = schedule->failed.load(std::memory_order_relaxed);
+    status->sched_last_error_us = schedule->last_error_us.load(std::memory_order_relaxed);
+    status->sched_worst_error_us = schedule->worst_error_us.load(std::memory_order_relaxed);
+
+    // A refresh that found nothing new is not worth a frame.
+    if (!gs_status_commit(chain->status, status, events))
+    {
+        return;
+    }
+
+    trprintlf(GREEN_FG "Sending X-Band status of chain %u (events 0x%02x, changed 0x%02x).", chain->id, status->events, status->changed);
+
+    // A raw frame is followed by the summary or not, which the server tells apart by size; an encoded frame's end tag
+    // says where the summary starts.
+    static_assert(GS_WIRE_STATUS_MAX >= sizeof(phy_status_t), "a raw status frame must fit too");
+    uint8_t frame[GS_WIRE_STATUS_MAX + sizeof(gs_metrics_summary_t)];
+    size_t frame_size = sizeof(phy_status_t);
+    if (global->config->status_encoding == WIRE_ENCODING_COMPACT)
+    {
+        if (events & STATUS_EVENT_CONNECT)
+        {
+            // The server may have missed frames while the connection was down.
+            gs_wire_encoder_reset(chain->status_wire);
+        }
+        ssize_t encoded = gs_wire_encode_status(chain->status_wire, status, frame, GS_WIRE_STATUS_MAX);
+        if (encoded < 0)
+        {
+            dbprintlf(RED_FG "Could not encode the status of chain %u.", chain->id);
+            return;
+        }
+        frame_size = (size_t)encoded;
+    }
+    else
+    {
+        memcpy(frame, status, sizeof(phy_status_t));
+    }
+    gs_metrics_summary_t summary[1];
+    if (global->config->metrics_status_summary && gs_metrics_summary(global->metrics, summary))
+    {
+        memcpy(frame + frame_size, summary, sizeof(gs_metrics_summary_t));
+        frame_size += sizeof(gs_metrics_summary_t);
+    }
+
+    if (gs_uplink_send_control(global->uplink, global->network_data, NetType::XBAND_DATA, NetVertex::CLIENT, frame, frame_size) <= 0 &&
+        global->config->status_encoding == WIRE_ENCODING_COMPACT)
+    {
+        // The encoder has moved its base past a frame the server never got, so its next delta would be refused.
+        gs_wire_encoder_reset(chain->status_wire);
+    }
+}
+
+uint64_t gs_monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,242 @@
+/**
+ * @file gs_hwexec.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Per-chain queues and executor threads for the commands that drive the PLL, the radio and the modem.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "gs_hwexec.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+static uint64_t ms_to_ns(uint32_t ms)
+{
+    return (uint64_t)ms * 1000000ULL;
+}
+
+// Only the chain's executor sets the ready flags (gs_xband_init(...)); relaxed loads see its own stores.
+static bool radio_up(gs_chain_t *chain)
+{
+    return chain->rx_modem_ready.load(std::memory_order_relaxed) && chain->radio_ready.load(std::memory_order_relaxed);
+}
+
+// Commands that set the same thing, of which only the latest queued needs to run. 0 for those never merged.
+static int command_class(const hwexec_cmd_t *cmd)
+{
+    if (cmd->type == NetType::XBAND_CONFIG)
+    {
+        return 1;
+    }
+    switch (cmd->command)
+    {
+    case XBC_INIT_PLL:
+    case XBC_DISABLE_PLL:
+        return 2;
+    case XBC_ARM_RX:
+    case XBC_DISARM_RX:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+void gs_hwexec_init(gs_hwexec_t *exec, uint32_t chain_count)
+{
+    exec->chain_count = chain_count;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    for (uint32_t i = 0; i < CHAINS_MAX; i++)
+    {
+        gs_hwexec_queue_t *queue = &exec->queues[i];
+        queue->head = 0;
+        queue->count = 0;
+        queue->stopping = false;
+        pthread_mutex_init(&queue->lock, NULL);
+        pthread_cond_init(&queue->queued, &attr);
+        queue->executed.store(0, std::memory_order_relaxed);
+        queue->coalesced.store(0, std::memory_order_relaxed);
+        queue->refused.store(0, std::memory_order_relaxed);
+        queue->depth.store(0, std::memory_order_relaxed);
+        queue->last_exec_us.store(0, std::memory_order_relaxed);
+        queue->worst_queue_us.store(0, std::memory_order_relaxed);
+    }
+    pthread_condattr_destroy(&attr);
+}
+
+void gs_hwexec_stop(gs_hwexec_t *exec)
+{
+    for (uint32_t i = 0; i < exec->chain_count; i++)
+    {
+        gs_hwexec_queue_t *queue = &exec->queues[i];
+        pthread_mutex_lock(&queue->lock);
+        queue->stopping = true;
+        pthread_cond_broadcast(&queue->queued);
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+void gs_hwexec_destroy(gs_hwexec_t *exec)
+{
+    for (uint32_t i = 0; i < CHAINS_MAX; i++)
+    {
+        gs_hwexec_queue_t *queue = &exec->queues[i];
+        for (uint32_t j = 0; j < HWEXEC_QUEUE_DEPTH; j++)
+        {
+            queue->cmds[j].payload.reset();
+        }
+        queue->count = 0;
+        pthread_cond_destroy(&queue->queued);
+        pthread_mutex_destroy(&queue->lock);
+    }
+}
+
+int gs_hwexec_submit(gs_hwexec_t *exec, uint8_t chain, hwexec_cmd_t *cmd, hwexec_cmd_t *replaced)
+{
+    gs_hwexec_queue_t *queue = &exec->queues[chain];
+    int retval = 1;
+
+    cmd->queued_ns = gs_monotonic_ns();
+
+    pthread_mutex_lock(&queue->lock);
+    hwexec_cmd_t *tail = queue->count > 0 ? &queue->cmds[(queue->head + queue->count - 1) % HWEXEC_QUEUE_DEPTH] : NULL;
+    int cls = command_class(cmd);
+    if (tail != NULL && cls != 0 && command_class(tail) == cls)
+    {
+        // Takes the tail's place; it is answered by the caller, outside the lock.
+        replaced->type = tail->type;
+        replaced->command = tail->command;
+        replaced->config = tail->config;
+        replaced->payload = std::move(tail->payload);
+        replaced->queued_ns = tail->queued_ns;
+        retval = 2;
+    }
+    else if (queue->count == HWEXEC_QUEUE_DEPTH)
+    {
+        pthread_mutex_unlock(&queue->lock);
+        queue->refused.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    else
+    {
+        tail = &queue->cmds[(queue->head + queue->count) % HWEXEC_QUEUE_DEPTH];
+        queue->count++;
+        queue->depth.store(queue->count, std::memory_order_relaxed);
+    }
+
+    tail->type = cmd->type;
+    tail->command = cmd->command;
+    tail->config = cmd->config;
+    tail->payload = std::move(cmd->payload);
+    tail->queued_ns = cmd->queued_ns;
+    pthread_cond_signal(&queue->queued);
+    pthread_mutex_unlock(&queue->lock);
+
+    if (retval == 2)
+    {
+        queue->coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+    return retval;
+}
+
+// Waits on the queue, with its lock held, until 'until' (CLOCK_MONOTONIC) or a submit.
+static void queue_wait(gs_hwexec_queue_t *queue, uint64_t until)
+{
+    struct timespec at;
+    at.tv_sec = until / 1000000000ULL;
+    at.tv_nsec = until % 1000000000ULL;
+    pthread_cond_timedwait(&queue->queued, &queue->lock, &at);
+}
+
+void *gs_hwexec_thread(void *args)
+{
+    gs_chain_t *chain = (gs_chain_t *)args;
+    global_data_t *global = chain->global;
+    gs_hwexec_queue_t *queue = &global->hwexec->queues[chain->id];
+
+    char name[METRICS_NAME_LEN];
+    snprintf(name, sizeof(name), "hw%u", chain->id);
+    gs_metrics_register(global->metrics, name);
+
+    uint64_t init_at = 0;
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->stopping && global->thread_status.load(std::memory_order_acquire) > -1)
+    {
+        uint64_t now = gs_monotonic_ns();
+
+        // Before anything queued meanwhile, so that a configuration or an arm finds the radio up if it can be.
+        if (!radio_up(chain) && now >= init_at)
+        {
+            pthread_mutex_unlock(&queue->lock);
+            if (gs_xband_init(chain) < 0)
+            {
+                dbprintlf(RED_FG "Radio of chain %u cannot initialize, retrying in %d ms.", chain->id, HWEXEC_INIT_RETRY_MS);
+            }
+            init_at = gs_monotonic_ns() + ms_to_ns(HWEXEC_INIT_RETRY_MS);
+            pthread_mutex_lock(&queue->lock);
+            continue;
+        }
+
+        if (queue->count == 0)
+        {
+            // Between commands, so that a slow libiio read does not hold one up once it is queued.
+            uint64_t refresh_at = gs_status_refresh_at(chain->status);
+            if (radio_up(chain) && now >= refresh_at)
+            {
+                pthread_mutex_unlock(&queue->lock);
+                gs_status_refresh(chain->status, chain->radio, &chain->radio_config->lock);
+                pthread_mutex_lock(&queue->lock);
+                continue;
+            }
+
+            uint64_t until = now + ms_to_ns(HWEXEC_IDLE_MS);
+            if (!radio_up(chain) && init_at < until)
+            {
+                until = init_at;
+            }
+            if (radio_up(chain) && refresh_at < until)
+            {
+                until = refresh_at;
+            }
+            queue_wait(queue, until);
+            continue;
+        }
+
+        hwexec_cmd_t cmd;
+        hwexec_cmd_t *head = &queue->cmds[queue->head];
+        cmd.type = head->type;
+        cmd.command = head->command;
+        cmd.config = head->config;
+        cmd.payload = std::move(head->payload);
+        cmd.queued_ns = head->queued_ns;
+        queue->head = (queue->head + 1) % HWEXEC_QUEUE_DEPTH;
+        queue->count--;
+        queue->depth.store(queue->count, std::memory_order_relaxed);
+        pthread_mutex_unlock(&queue->lock);
+
+        uint32_t queue_us = (uint32_t)((gs_monotonic_ns() - cmd.queued_ns) / 1000);
+        uint32_t exec_us = 0;
+        gs_xband_execute(chain, &cmd, queue_us, &exec_us);
+        cmd.payload.reset();
+
+        queue->executed.fetch_add(1, std::memory_order_relaxed);
+        queue->last_exec_us.store(exec_us, std::memory_order_relaxed);
+        if (queue_us > queue->worst_queue_us.load(std::memory_order_relaxed))
+        {
+            queue->worst_queue_us.store(queue_us, std::memory_order_relaxed);
+        }
+
+        pthread_mutex_lock(&queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return NULL;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file gs_log.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Log sink behind the meb_debug.hpp macros: synchronous, or buffered per thread and written by a log thread.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <atomic>
+#include "gs_log.hpp"
+#include "buffer_pool.hpp"
+
+#define LOG_WRITEV_MAX 64
+
+typedef struct log_buffer
+{
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head; // Next line the owning thread writes.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail; // Next line the log thread writes out.
+    std::atomic<uint32_t> dropped;                        // Lines lost to a full buffer, not yet reported.
+    std::atomic<bool> orphaned;                           // The owning thread has exited; another may adopt the buffer.
+    struct log_buffer *next;
+    uint16_t length[LOG_THREAD_LINES];
+    char lines[LOG_THREAD_LINES][LOG_LINE_MAX];
+} log_buffer_t;
+
+// Buffers are never freed: a thread that exits leaves its buffer to the next thread that logs.
+static std::atomic<log_buffer_t *> log_buffers(NULL);
+static std::atomic<bool> log_async(false);
+static pthread_t log_tid;
+
+static std::atomic<uint32_t> hexdump_per_second(0);
+static uint32_t hexdump_max_bytes = 0;
+static std::atomic<uint64_t> hexdump_window(0);
+static std::atomic<uint32_t> hexdump_count(0);
+static std::atomic<uint32_t> hexdump_suppressed(0);
+
+struct log_owner
+{
+    log_buffer_t *buffer = NULL;
+
+    ~log_owner()
+    {
+        if (buffer != NULL)
+        {
+            buffer->orphaned.store(true, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local log_owner log_thread_owner;
+
+static log_buffer_t *log_thread_buffer()
+{
+    if (log_thread_owner.buffer != NULL)
+    {
+        return log_thread_owner.buffer;
+    }
+
+    for (log_buffer_t *buf = log_buffers.load(std::memory_order_acquire); buf != NULL; buf = buf->next)
+    {
+        bool orphaned = true;
+        if (buf->orphaned.compare_exchange_strong(orphaned, false, std::memory_order_acquire))
+        {
+            log_thread_owner.buffer = buf;
+            return buf;
+        }
+    }
+
+    log_buffer_t *buf = (log_buffer_t *)calloc(1, sizeof(log_buffer_t));
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    buf->next = log_buffers.load(std::memory_order_relaxed);
+    while (!log_buffers.compare_exchange_weak(buf->next, buf, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+
+    log_thread_owner.buffer = buf;
+    return buf;
+}
+
+void gs_log_write(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    log_buffer_t *buf = log_async.load(std::memory_order_acquire) ? log_thread_buffer() : NULL;
+    if (buf == NULL)
+    {
+        vfprintf(stderr, format, args);
+        fflush(stderr);
+        va_end(args);
+        return;
+    }
+
+    uint32_t head = buf->head.load(std::memory_order_relaxed);
+    if (head - buf->tail.load(std::memory_order_acquire) >= LOG_THREAD_LINES)
+    {
+        buf->dropped.fetch_add(1, std::memory_order_relaxed);
+        va_end(args);
+        return;
+    }
+
+    uint32_t slot = head % LOG_THREAD_LINES;
+    int len = vsnprintf(buf->lines[slot], LOG_LINE_MAX, format, args);
+    va_end(args);
+
+    if (len < 0)
+    {
+        return;
+    }
+    if (len >= LOG_LINE_MAX)
+    {
+        // Truncated; keep the line break so the next line does not run on.
+        len = LOG_LINE_MAX - 1;
+        buf->lines[slot][len - 1] = '\n';
+    }
+
+    buf->length[slot] = len;
+    buf->head.store(head + 1, std::memory_order_release);
+}
+
+static void writev_all(struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t written = writev(STDERR_FILENO, iov, iovcnt);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+// Writes out every line buffered so far. Only the log thread (or gs_log_stop(), once it has exited) calls this.
+static uint32_t log_drain()
+{
+    uint32_t total = 0;
+
+    for (log_buffer_t *buf = log_buffers.load(std::memory_order_acquire); buf != NULL; buf = buf->next)
+    {
+        uint32_t tail = buf->tail.load(std::memory_order_relaxed);
+        uint32_t head = buf->head.load(std::memory_order_acquire);
+
+        while (tail != head)
+        {
+            struct iovec iov[LOG_WRITEV_MAX];
+            int count = 0;
+            for (; tail != head && count < LOG_WRITEV_MAX; tail++, count++)
+            {
+                uint32_t slot = tail % LOG_THREAD_LINES;
+                iov[count].iov_base = buf->lines[slot];
+                iov[count].iov_len = buf->length[slot];
+            }
+            writev_all(iov, count);
+            buf->tail.store(tail, std::memory_order_release);
+            total += count;
+        }
+
+        uint32_t dropped = buf->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            fprintf(stderr, "\x1b[33m[log] %u lines dropped, a thread logged faster than they could be written.\x1b[0m\n", dropped);
+        }
+    }
+
+    return total;
+}
+
+static void *log_thread(void *args)
+{
+    (void)args;
+
+    while (log_async.load(std::memory_order_acquire))
+    {
+        if (log_drain() == 0)
+        {
+            usleep(LOG_FLUSH_MS * 1000);
+        }
+    }
+
+    return NULL;
+}
+
+int gs_log_start()
+{
+    if (log_async.load(std::memory_order_acquire))
+    {
+        return 1;
+    }
+
+    log_async.store(true, std::memory_order_release);
+    if (pthread_create(&log_tid, NULL, log_thread, NULL) != 0)
+    {
+        log_async.store(false, std::memory_order_release);
+        return -1;
+    }
+
+    // So that the last words of an early return(...) or exit(...) still make it out.
+    static bool registered = false;
+    if (!registered)
+    {
+        atexit(gs_log_stop);
+        registered = true;
+    }
+    return 1;
+}
+
+void gs_log_stop()
+{
+    if (!log_async.exchange(false, std::memory_order_acq_rel))
+    {
+        return;
+    }
+
+    pthread_join(log_tid, NULL);
+    log_drain();
+}
+
+void gs_log_hexdump_config(uint32_t per_second, uint32_t max_bytes)
+{
+    hexdump_max_bytes = max_bytes;
+    hexdump_per_second.store(per_second, std::memory_order_release);
+}
+
+// Fixed one-second windows; good enough to keep a flood of frames off the console.
+static bool hexdump_allowed()
+{
+    uint32_t limit = hexdump_per_second.load(std::memory_order_acquire);
+    if (limit == 0)
+    {
+        return false;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    uint64_t window = ts.tv_sec;
+    uint64_t current = hexdump_window.load(std::memory_order_relaxed);
+    if (window != current && hexdump_window.compare_exchange_strong(current, window, std::memory_order_relaxed))
+    {
+        hexdump_count.store(0, std::memory_order_relaxed);
+    }
+
+    if (hexdump_count.fetch_add(1, std::memory_order_relaxed) >= limit)
+    {
+        hexdump_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void gs_log_hexdump(const char *tag, const uint8_t *data, ssize_t size)
+{
+    if (!hexdump_allowed())
+    {
+        return;
+    }
+
+    ssize_t shown = size < (ssize_t)hexdump_max_bytes ? size : (ssize_t)hexdump_max_bytes;
+    uint32_t suppressed = hexdump_suppressed.exchange(0, std::memory_order_relaxed);
+
+    gs_log_write("%s: %zd bytes (%u dumps suppressed since the last)\n", tag, size, suppressed);
+
+    for (ssize_t offset = 0; offset < shown; offset += 16)
+    {
+        char hex[16 * 3 + 1] = {0};
+        char ascii[16 + 1] = {0};
+        for (ssize_t i = 0; i < 16 && offset + i < shown; i++)
+        {
+            uint8_t byte = data[offset + i];
+            snprintf(hex + 3 * i, 4, "%02x ", byte);
+            ascii[i] = (byte >= 0x20 && byte < 0x7f) ? byte : '.';
+        }
+        gs_log_write("  %04zx  %-48s |%s|\n", offset, hex, ascii);
+    }
+
+    if (shown < size)
+    {
+        gs_log_write("  ... %zd more bytes\n", size - shown);
+    }
+}
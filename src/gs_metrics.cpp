@@ -0,0 +1,629 @@
+/**
+ * @file gs_metrics.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Per-thread latency histograms and counters, aggregated in the background and served as text.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "gs_metrics.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+#define METRICS_RESPONSE_MAX 65536
+#define METRICS_REQUEST_WAIT_MS 100 // How long a client gets to send a GET before it is answered in bare text.
+
+__thread gs_metrics_shard_t *gs_metrics_local = NULL;
+__thread uint32_t gs_metrics_skip = 0;
+
+// Exposition name and help text of each gs_metric_hist.
+static const char *const hist_names[METRIC_HISTOGRAMS][2] = {
+    {"haystack_rx_read_seconds", "rxmodem_read() of a received frame."},
+    {"haystack_rx_queue_seconds", "Wait in the receive ring, from capture to the forwarding stage."},
+    {"haystack_uplink_send_seconds", "Sending one DATA frame (a frame or a batch) to the server."},
+    {"haystack_iio_read_seconds", "Reading the radio's status over libiio."},
+    {"haystack_iio_config_seconds", "Applying a configuration to the radio over libiio."},
+    {"haystack_schedule_error_seconds", "Difference between a scheduled retune's completion and its time, either way."},
+    {"haystack_compress_seconds", "Compressing one frame, whether that paid or not."},
+};
+
+// Exposition name and help text of each gs_metric_counter.
+static const char *const counter_names[METRIC_COUNTERS][2] = {
+    {"haystack_uplink_bytes_total", "DATA payload bytes sent to the server."},
+    {"haystack_iio_errors_total", "libiio reads or writes that failed."},
+};
+
+static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+// What the metrics thread keeps between intervals.
+typedef struct
+{
+    uint64_t counters[METRIC_COUNTERS];
+    uint64_t sums[METRIC_HISTOGRAMS];
+    uint64_t counts[METRIC_HISTOGRAMS];                  // Values recorded since startup.
+    uint32_t totals[METRIC_HISTOGRAMS][METRICS_BUCKETS]; // Summed over the shards; wraps, like the shards' buckets.
+    uint32_t current[METRIC_HISTOGRAMS][METRICS_BUCKETS]; // The same, being summed.
+    uint64_t deltas[METRIC_HISTOGRAMS][METRICS_BUCKETS]; // Recorded in the latest interval.
+    uint64_t interval_counts[METRIC_HISTOGRAMS];
+    uint32_t interval_ms;
+    char response[METRICS_RESPONSE_MAX];
+} metrics_agg_t;
+
+static int listen_tcp(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    // Loopback only: there is no authentication.
+    struct sockaddr_in addr;
+    memset(&addr, 0x0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int listen_unix(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0x0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    // Left behind by a previous run.
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int gs_metrics_init(gs_metrics_t *metrics, bool enabled, uint32_t interval_ms, uint32_t sample_every, uint16_t port, const char *unix_path)
+{
+    metrics->enabled = false;
+    metrics->interval_ms = interval_ms > 0 ? interval_ms : METRICS_INTERVAL_MS_DEFAULT;
+    metrics->sample_every = sample_every > 0 ? sample_every : 1;
+    metrics->shards = NULL;
+    metrics->registered.store(0, std::memory_order_relaxed);
+    metrics->tcp_fd = -1;
+    metrics->unix_fd = -1;
+    metrics->unix_path[0] = '\0';
+    metrics->scrapes.store(0, std::memory_order_relaxed);
+    gs_seqlock_init(metrics->summary);
+
+    if (!enabled)
+    {
+        return 1;
+    }
+
+    if (pthread_mutex_init(&metrics->register_lock, NULL) != 0)
+    {
+        return -1;
+    }
+
+    metrics->shards = (gs_metrics_shard_t *)aligned_alloc(CACHE_LINE_SIZE, METRICS_SHARDS_MAX * sizeof(gs_metrics_shard_t));
+    if (metrics->shards == NULL)
+    {
+        pthread_mutex_destroy(&metrics->register_lock);
+        return -1;
+    }
+    memset((void *)metrics->shards, 0x0, METRICS_SHARDS_MAX * sizeof(gs_metrics_shard_t));
+    metrics->enabled = true;
+
+    if (port > 0)
+    {
+        metrics->tcp_fd = listen_tcp(port);
+        if (metrics->tcp_fd < 0)
+        {
+            dbprintlf(RED_FG "Could not serve metrics on 127.0.0.1:%u.", port);
+            erprintlf(errno);
+            gs_metrics_destroy(metrics);
+            return -1;
+        }
+        dbprintlf(BLUE_FG "Serving metrics on 127.0.0.1:%u.", port);
+    }
+
+    if (unix_path != NULL && unix_path[0] != '\0')
+    {
+        metrics->unix_fd = listen_unix(unix_path);
+        if (metrics->unix_fd < 0)
+        {
+            dbprintlf(RED_FG "Could not serve metrics on %s.", unix_path);
+            erprintlf(errno);
+            gs_metrics_destroy(metrics);
+            return -1;
+        }
+        snprintf(metrics->unix_path, sizeof(metrics->unix_path), "%s", unix_path);
+        dbprintlf(BLUE_FG "Serving metrics on %s.", unix_path);
+    }
+
+    return 1;
+}
+
+void gs_metrics_destroy(gs_metrics_t *metrics)
+{
+    if (metrics->tcp_fd >= 0)
+    {
+        close(metrics->tcp_fd);
+        metrics->tcp_fd = -1;
+    }
+    if (metrics->unix_fd >= 0)
+    {
+        close(metrics->unix_fd);
+        unlink(metrics->unix_path);
+        metrics->unix_fd = -1;
+    }
+    if (metrics->enabled)
+    {
+        free(metrics->shards);
+        metrics->shards = NULL;
+        pthread_mutex_destroy(&metrics->register_lock);
+        metrics->enabled = false;
+    }
+}
+
+int gs_metrics_register(gs_metrics_t *metrics, const char *name)
+{
+    if (!metrics->enabled)
+    {
+        gs_metrics_local = NULL;
+        return 0;
+    }
+
+    pthread_mutex_lock(&metrics->register_lock);
+    uint32_t registered = metrics->registered.load(std::memory_order_relaxed);
+    gs_metrics_shard_t *shard = NULL;
+    for (uint32_t i = 0; i < registered; i++)
+    {
+        if (strncmp(metrics->shards[i].name, name, METRICS_NAME_LEN) == 0)
+        {
+            shard = &metrics->shards[i];
+            break;
+        }
+    }
+    if (shard == NULL && registered < METRICS_SHARDS_MAX)
+    {
+        shard = &metrics->shards[registered];
+        snprintf(shard->name, sizeof(shard->name), "%s", name);
+        shard->sample_every = metrics->sample_every;
+        // Named before the metrics thread can see it.
+        metrics->registered.store(registered + 1, std::memory_order_release);
+    }
+    pthread_mutex_unlock(&metrics->register_lock);
+
+    if (shard == NULL)
+    {
+        dbprintlf(RED_FG "No metrics shard left for thread '%s'; it will not be measured.", name);
+        return -1;
+    }
+    gs_metrics_local = shard;
+    gs_metrics_skip = 0;
+    return 1;
+}
+
+// Smallest bucket bound at or below which fraction q of the interval's values lie.
+static uint64_t interval_quantile(const metrics_agg_t *agg, int hist, double q)
+{
+    uint64_t count = agg->interval_counts[hist];
+    if (count == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * count);
+    rank = rank < 1 ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < METRICS_BUCKETS; b++)
+    {
+        seen += agg->deltas[hist][b];
+        if (seen >= rank)
+        {
+            return gs_metrics_bucket_max(b);
+        }
+    }
+    return gs_metrics_bucket_max(METRICS_BUCKETS - 1);
+}
+
+static uint64_t interval_max(const metrics_agg_t *agg, int hist)
+{
+    for (int b = METRICS_BUCKETS - 1; b >= 0; b--)
+    {
+        if (agg->deltas[hist][b] > 0)
+        {
+            return gs_metrics_bucket_max(b);
+        }
+    }
+    return 0;
+}
+
+static uint32_t ns_to_us(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+// Sums the shards, works out the latest interval, and publishes its summary.
+static void aggregate(gs_metrics_t *metrics, metrics_agg_t *agg, uint32_t interval_ms)
+{
+    uint32_t registered = metrics->registered.load(std::memory_order_acquire);
+
+    memset(agg->current, 0x0, sizeof(agg->current));
+    memset(agg->counters, 0x0, sizeof(agg->counters));
+    memset(agg->sums, 0x0, sizeof(agg->sums));
+
+    for (uint32_t i = 0; i < registered; i++)
+    {
+        gs_metrics_shard_t *shard = &metrics->shards[i];
+        for (int c = 0; c < METRIC_COUNTERS; c++)
+        {
+            agg->counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+        for (int h = 0; h < METRIC_HISTOGRAMS; h++)
+        {
+            agg->sums[h] += shard->sums[h].load(std::memory_order_relaxed);
+            for (uint32_t b = 0; b < METRICS_BUCKETS; b++)
+            {
+                agg->current[h][b] += shard->buckets[h][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    gs_metrics_summary_t summary[1];
+    memset(summary, 0x0, sizeof(gs_metrics_summary_t));
+    summary->magic = GS_METRICS_SUMMARY_MAGIC;
+    summary->version = GS_METRICS_SUMMARY_VERSION;
+    summary->count = METRIC_HISTOGRAMS;
+    summary->interval_ms = interval_ms;
+
+    for (int h = 0; h < METRIC_HISTOGRAMS; h++)
+    {
+        uint64_t interval = 0;
+        for (uint32_t b = 0; b < METRICS_BUCKETS; b++)
+        {
+            // Right across a wrap, as long as an interval sees fewer than 2^32 values in one bucket.
+            agg->deltas[h][b] = (uint32_t)(agg->current[h][b] - agg->totals[h][b]);
+            agg->totals[h][b] = agg->current[h][b];
+            interval += agg->deltas[h][b];
+        }
+        agg->counts[h] += interval;
+        agg->interval_counts[h] = interval;
+
+        summary->hist[h].id = h;
+        summary->hist[h].count = interval > UINT32_MAX ? UINT32_MAX : (uint32_t)interval;
+        summary->hist[h].p50_us = ns_to_us(interval_quantile(agg, h, 0.5));
+        summary->hist[h].p99_us = ns_to_us(interval_quantile(agg, h, 0.99));
+        summary->hist[h].max_us = ns_to_us(interval_max(agg, h));
+    }
+    agg->interval_ms = interval_ms;
+
+    gs_seqlock_write(metrics->summary, summary);
+}
+
+// Appends to the response, dropping whatever does not fit.
+static void out(metrics_agg_t *agg, size_t *len, const char *fmt, ...)
+{
+    if (*len >= sizeof(agg->response))
+    {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(agg->response + *len, sizeof(agg->response) - *len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+    {
+        *len += n;
+    }
+}
+
+static void out_value(metrics_agg_t *agg, size_t *len, const char *type, const char *name, const char *help, uint64_t value)
+{
+    out(agg, len, "# HELP %s %s\n# TYPE %s %s\n%s %lu\n", name, help, name, type, name, (unsigned long)value);
+}
+
+// One value per receive chain, labelled with its id.
+static void out_chains(metrics_agg_t *agg, size_t *len, const char *type, const char *name, const char *help, const uint64_t *values, uint32_t count)
+{
+    out(agg, len, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out(agg, len, "%s{chain=\"%u\"} %lu\n", name, i, (unsigned long)values[i]);
+    }
+}
+
+// The whole exposition, in the Prometheus text format.
+static size_t render(global_data_t *global, metrics_agg_t *agg)
+{
+    size_t len = 0;
+
+    uint32_t chains = global->chain_count;
+    uint64_t frames[CHAINS_MAX], bytes[CHAINS_MAX], read_errors[CHAINS_MAX], rx_errors[CHAINS_MAX];
+    uint64_t armed[CHAINS_MAX], ring_depth[CHAINS_MAX], ring_dropped[CHAINS_MAX], overruns[CHAINS_MAX], worst_turn[CHAINS_MAX];
+    uint64_t dma_depth[CHAINS_MAX], dma_starved[CHAINS_MAX], crc_errors[CHAINS_MAX], duplicates[CHAINS_MAX];
+    uint64_t cfg_applies[CHAINS_MAX], cfg_unchanged[CHAINS_MAX], cfg_failures[CHAINS_MAX], cfg_rollbacks[CHAINS_MAX], cfg_last_us[CHAINS_MAX];
+    uint64_t sched_pending[CHAINS_MAX], sched_applied[CHAINS_MAX], sched_skipped[CHAINS_MAX], sched_failed[CHAINS_MAX], sched_worst_us[CHAINS_MAX];
+    uint64_t cmp_frames[CHAINS_MAX], cmp_bypassed[CHAINS_MAX], cmp_bytes_in[CHAINS_MAX], cmp_bytes_out[CHAINS_MAX], cmp_cpu_us[CHAINS_MAX];
+    uint64_t hw_executed[CHAINS_MAX], hw_coalesced[CHAINS_MAX], hw_refused[CHAINS_MAX], hw_depth[CHAINS_MAX], hw_last_us[CHAINS_MAX], hw_worst_queue_us[CHAINS_MAX];
+    for (uint32_t i = 0; i < chains; i++)
+    {
+        gs_chain_t *chain = &global->chains[i];
+        rx_snapshot_t rx[1];
+        gs_seqlock_read(chain->rx_stats, rx);
+        frames[i] = rx->frames;
+        bytes[i] = rx->bytes;
+        read_errors[i] = rx->read_errors;
+        rx_errors[i] = rx->rx_errors;
+        armed[i] = gs_rxworker_armed(chain->rx_worker);
+        ring_depth[i] = frame_ring_depth(chain->rx_ring);
+        ring_dropped[i] = (uint64_t)chain->rx_ring->dropped_oldest.load(std::memory_order_relaxed) + chain->rx_ring->dropped_newest.load(std::memory_order_relaxed);
+        overruns[i] = chain->rx_deadline->missed.load(std::memory_order_relaxed);
+        worst_turn[i] = chain->rx_deadline->worst_us.load(std::memory_order_relaxed);
+        dma_depth[i] = chain->rx_dma->active_depth.load(std::memory_order_relaxed);
+        dma_starved[i] = chain->rx_dma->starved.load(std::memory_order_relaxed);
+        crc_errors[i] = chain->validate->crc_errors.load(std::memory_order_relaxed);
+        duplicates[i] = chain->validate->duplicates.load(std::memory_order_relaxed);
+        cfg_applies[i] = chain->radio_config->applies.load(std::memory_order_relaxed);
+        cfg_unchanged[i] = chain->radio_config->unchanged.load(std::memory_order_relaxed);
+        cfg_failures[i] = chain->radio_config->failures.load(std::memory_order_relaxed);
+        cfg_rollbacks[i] = chain->radio_config->rollbacks.load(std::memory_order_relaxed);
+        cfg_last_us[i] = chain->radio_config->last_apply_us.load(std::memory_order_relaxed);
+        gs_schedule_table_t *schedule = &global->schedule->tables[i];
+        sched_pending[i] = schedule->pending.load(std::memory_order_relaxed);
+        sched_applied[i] = schedule->applied.load(std::memory_order_relaxed);
+        sched_skipped[i] = schedule->skipped.load(std::memory_order_relaxed);
+        sched_failed[i] = schedule->failed.load(std::memory_order_relaxed);
+        sched_worst_us[i] = schedule->worst_error_us.load(std::memory_order_relaxed);
+        gs_compress_stream_t *stream = &global->compress->streams[i];
+        cmp_frames[i] = stream->frames.load(std::memory_order_relaxed);
+        cmp_bypassed[i] = stream->bypassed.load(std::memory_order_relaxed);
+        cmp_bytes_in[i] = stream->bytes_in.load(std::memory_order_relaxed);
+        cmp_bytes_out[i] = stream->bytes_out.load(std::memory_order_relaxed);
+        cmp_cpu_us[i] = stream->busy_ns.load(std::memory_order_relaxed) / 1000;
+        gs_hwexec_queue_t *hw = &global->hwexec->queues[i];
+        hw_executed[i] = hw->executed.load(std::memory_order_relaxed);
+        hw_coalesced[i] = hw->coalesced.load(std::memory_order_relaxed);
+        hw_refused[i] = hw->refused.load(std::memory_order_relaxed);
+        hw_depth[i] = hw->depth.load(std::memory_order_relaxed);
+        hw_last_us[i] = hw->last_exec_us.load(std::memory_order_relaxed);
+        hw_worst_queue_us[i] = hw->worst_queue_us.load(std::memory_order_relaxed);
+    }
+    out_chains(agg, &len, "counter", "haystack_rx_frames_total", "Frames the capture stage read in full.", frames, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_bytes_total", "Bytes of frames read in full.", bytes, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_read_mismatches_total", "Reads that returned fewer bytes than the receive announced.", read_errors, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_errors_total", "Receives that returned no frame.", rx_errors, chains);
+    out_chains(agg, &len, "gauge", "haystack_rx_armed", "1 while the capture stage is armed.", armed, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_deadline_misses_total", "Capture stage turnarounds over the configured deadline.", overruns, chains);
+    out_chains(agg, &len, "gauge", "haystack_rx_worst_turnaround_us", "Longest capture stage turnaround, from a receive returning to the next receive.", worst_turn, chains);
+    out_chains(agg, &len, "gauge", "haystack_rx_dma_depth", "Buffers kept posted to the modem's DMA engine, 0 if receiving one frame at a time.", dma_depth, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_dma_starved_total", "Buffers posted to the modem while the pool was empty; their frames were dropped.", dma_starved, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_crc_errors_total", "Frames dropped before forwarding for a CRC mismatch.", crc_errors, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_duplicates_total", "Frames dropped before forwarding as duplicates of recent ones.", duplicates, chains);
+    out_chains(agg, &len, "counter", "haystack_config_applies_total", "Radio configurations and scheduled retunes applied.", cfg_applies, chains);
+    out_chains(agg, &len, "counter", "haystack_config_unchanged_total", "Radio configurations that changed nothing, and were not written.", cfg_unchanged, chains);
+    out_chains(agg, &len, "counter", "haystack_config_failures_total", "Radio configurations refused or failed.", cfg_failures, chains);
+    out_chains(agg, &len, "counter", "haystack_config_rollbacks_total", "Failed radio configurations undone.", cfg_rollbacks, chains);
+    out_chains(agg, &len, "gauge", "haystack_config_last_apply_us", "Time the latest radio configuration took, rollback included.", cfg_last_us, chains);
+    out_chains(agg, &len, "gauge", "haystack_schedule_pending", "Scheduled retunes not yet made.", sched_pending, chains);
+    out_chains(agg, &len, "counter", "haystack_schedule_applied_total", "Scheduled retunes made.", sched_applied, chains);
+    out_chains(agg, &len, "counter", "haystack_schedule_skipped_total", "Scheduled entries merged into a later one that was already due.", sched_skipped, chains);
+    out_chains(agg, &len, "counter", "haystack_schedule_failed_total", "Scheduled retunes refused or failed.", sched_failed, chains);
+    out_chains(agg, &len, "gauge", "haystack_schedule_worst_error_us", "Largest difference between a scheduled retune's completion and its time.", sched_worst_us, chains);
+    out_chains(agg, &len, "counter", "haystack_hw_commands_total", "Configurations and commands run by the hardware executor.", hw_executed, chains);
+    out_chains(agg, &len, "counter", "haystack_hw_coalesced_total", "Configurations and commands superseded by a later one before they ran.", hw_coalesced, chains);
+    out_chains(agg, &len, "counter", "haystack_hw_refused_total", "Configurations and commands refused because the hardware queue was full.", hw_refused, chains);
+    out_chains(agg, &len, "gauge", "haystack_hw_queue_depth", "Configurations and commands waiting for the hardware executor.", hw_depth, chains);
+    out_chains(agg, &len, "gauge", "haystack_hw_last_exec_us", "Time the latest configuration or command took on the hardware.", hw_last_us, chains);
+    out_chains(agg, &len, "gauge", "haystack_hw_worst_queue_us", "Longest a configuration or command waited for the hardware executor.", hw_worst_queue_us, chains);
+    out_chains(agg, &len, "counter", "haystack_compress_frames_total", "Frames sent to the server compressed.", cmp_frames, chains);
+    out_chains(agg, &len, "counter", "haystack_compress_bypassed_total", "Frames sent uncompressed while compressing: incompressible, or not tried.", cmp_bypassed, chains);
+    out_chains(agg, &len, "counter", "haystack_compress_bytes_in_total", "Bytes of the frames given to compression.", cmp_bytes_in, chains);
+    out_chains(agg, &len, "counter", "haystack_compress_bytes_out_total", "Bytes of the same frames as sent, compressed or not.", cmp_bytes_out, chains);
+    out_chains(agg, &len, "counter", "haystack_compress_cpu_us_total", "Worker time spent compressing, in microseconds.", cmp_cpu_us, chains);
+    // zstd's fastest levels are negative.
+    out(agg, &len, "# HELP haystack_compress_level Level the compression workers use now.\n# TYPE haystack_compress_level gauge\nhaystack_compress_level %d\n", gs_compress_level(global->compress));
+
+    out_chains(agg, &len, "gauge", "haystack_rx_ring_depth", "Frames waiting between capture and forwarding.", ring_depth, chains);
+    out_chains(agg, &len, "counter", "haystack_rx_ring_dropped_total", "Frames the receive ring discarded because it was full.", ring_dropped, chains);
+    out_value(agg, &len, "gauge", "haystack_recorder_ring_depth", "Frames waiting to be recorded.", global->config->rec_enabled ? frame_ring_depth(global->recorder->ring) : 0);
+    out_value(agg, &len, "gauge", "haystack_pool_in_use", "Frame buffers in use.", global->pool->in_use.load(std::memory_order_relaxed));
+    out_value(agg, &len, "counter", "haystack_pool_exhausted_total", "Buffer requests that found the pool empty.", global->pool->exhausted.load(std::memory_order_relaxed));
+    out_value(agg, &len, "gauge", "haystack_spool_depth", "Frames held in the outage spool.", global->spool->depth.load(std::memory_order_relaxed));
+
+    out_value(agg, &len, "counter", "haystack_uplink_frames_total", "Received frames sent to the server.", global->uplink->frames.load(std::memory_order_relaxed));
+    out_value(agg, &len, "counter", "haystack_uplink_errors_total", "Failed sends of received frames.", global->uplink->send_errors.load(std::memory_order_relaxed));
+    out_value(agg, &len, "gauge", "haystack_net_connected", "1 while connected to the server.", gs_uplink_connected(global->uplink));
+    out_value(agg, &len, "counter", "haystack_net_reconnects_total", "Times the connection to the server was re-established.", global->netloop->reconnects.load(std::memory_order_relaxed));
+    out_value(agg, &len, "counter", "haystack_net_bad_frames_total", "Frames from the server discarded as malformed.", global->netloop->bad_frames.load(std::memory_order_relaxed));
+    if (global->replay->enabled)
+    {
+        out_value(agg, &len, "counter", "haystack_replay_frames_total", "Replayed frames handed to the receive rings.", global->replay->frames.load(std::memory_order_relaxed));
+        out_value(agg, &len, "counter", "haystack_replay_bytes_total", "Bytes of replayed frames handed to the receive rings.", global->replay->bytes.load(std::memory_order_relaxed));
+        out_value(agg, &len, "counter", "haystack_replay_dropped_total", "Replayed frames lost to an exhausted pool or an oversize frame.", global->replay->dropped.load(std::memory_order_relaxed));
+        out_value(agg, &len, "counter", "haystack_replay_skipped_bytes_total", "Bytes of capture segments skipped to find the next record.", global->replay->skipped.load(std::memory_order_relaxed));
+        out_value(agg, &len, "gauge", "haystack_replay_worst_late_us", "Longest a replayed frame was released past its time.", global->replay->worst_late_us.load(std::memory_order_relaxed));
+        out_value(agg, &len, "gauge", "haystack_replay_done", "1 once every pass over the files has been made.", global->replay->done.load(std::memory_order_relaxed));
+    }
+
+    for (int c = 0; c < METRIC_COUNTERS; c++)
+    {
+        out_value(agg, &len, "counter", counter_names[c][0], counter_names[c][1], agg->counters[c]);
+    }
+
+    for (int h = 0; h < METRIC_HISTOGRAMS; h++)
+    {
+        const char *name = hist_names[h][0];
+        out(agg, &len, "# HELP %s %s Quantiles over the latest %u ms; timed intervals are sampled 1 in %u.\n# TYPE %s summary\n", name, hist_names[h][1], agg->interval_ms, global->metrics->sample_every, name);
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+        {
+            out(agg, &len, "%s{quantile=\"%g\"} %.9f\n", name, quantiles[q], interval_quantile(agg, h, quantiles[q]) / 1e9);
+        }
+        out(agg, &len, "%s_sum %.9f\n%s_count %lu\n", name, agg->sums[h] / 1e9, name, (unsigned long)agg->counts[h]);
+    }
+
+    out_value(agg, &len, "counter", "haystack_metrics_scrapes_total", "Metrics responses served.", global->metrics->scrapes.load(std::memory_order_relaxed));
+    return len < sizeof(agg->response) ? len : sizeof(agg->response) - 1;
+}
+
+static void send_all(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return;
+        }
+        data += sent;
+        size -= sent;
+    }
+}
+
+// Answers one client on a listening socket, if there is one waiting.
+static void serve(global_data_t *global, metrics_agg_t *agg, int listen_fd)
+{
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    // A slow client may hold up the next aggregation, but not forever.
+    struct timeval tv = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char request[512];
+    ssize_t got = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, METRICS_REQUEST_WAIT_MS) > 0)
+    {
+        got = recv(fd, request, sizeof(request) - 1, MSG_DONTWAIT);
+    }
+    bool http = got >= 4 && memcmp(request, "GET ", 4) == 0;
+
+    size_t len = render(global, agg);
+    if (http)
+    {
+        char header[160];
+        int header_len = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", len);
+        send_all(fd, header, header_len);
+    }
+    send_all(fd, agg->response, len);
+    global->metrics->scrapes.fetch_add(1, std::memory_order_relaxed);
+    close(fd);
+}
+
+void *gs_metrics_thread(void *args)
+{
+    global_data_t *global = (global_data_t *)args;
+    gs_metrics_t *metrics = global->metrics;
+
+    if (!metrics->enabled)
+    {
+        return NULL;
+    }
+
+    // On Linux, this only lowers the calling thread.
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, 0);
+    if (errno == 0)
+    {
+        setpriority(PRIO_PROCESS, 0, nice + METRICS_NICE);
+    }
+
+    metrics_agg_t *agg = (metrics_agg_t *)calloc(1, sizeof(metrics_agg_t));
+    if (agg == NULL)
+    {
+        dbprintlf(RED_FG "Could not allocate the metrics thread's state.");
+        return NULL;
+    }
+
+    uint64_t last = gs_monotonic_ns();
+    uint64_t next = last + metrics->interval_ms * 1000000ULL;
+
+    while (global->thread_status.load(std::memory_order_acquire) > -1)
+    {
+        uint64_t now = gs_monotonic_ns();
+        if (now >= next)
+        {
+            aggregate(metrics, agg, (uint32_t)((now - last) / 1000000ULL));
+            last = now;
+            next += metrics->interval_ms * 1000000ULL;
+            next = next > now ? next : now + metrics->interval_ms * 1000000ULL;
+        }
+
+        // Wakes at least once a second, so that it notices thread_status.
+        uint64_t wait_ms = next > now ? (next - now) / 1000000ULL + 1 : 0;
+        wait_ms = wait_ms < 1000 ? wait_ms : 1000;
+
+        struct pollfd pfds[2];
+        nfds_t nfds = 0;
+        if (metrics->tcp_fd >= 0)
+        {
+            pfds[nfds].fd = metrics->tcp_fd;
+            pfds[nfds++].events = POLLIN;
+        }
+        if (metrics->unix_fd >= 0)
+        {
+            pfds[nfds].fd = metrics->unix_fd;
+            pfds[nfds++].events = POLLIN;
+        }
+
+        if (poll(pfds, nfds, (int)wait_ms) > 0)
+        {
+            for (nfds_t i = 0; i < nfds; i++)
+            {
+                if (pfds[i].revents & POLLIN)
+                {
+                    serve(global, agg, pfds[i].fd);
+                }
+            }
+        }
+    }
+
+    free(agg);
+    return NULL;
+}
+
+bool gs_metrics_summary(gs_metrics_t *metrics, gs_metrics_summary_t *summary)
+{
+    gs_seqlock_read(metrics->summary, summary);
+    return summary->magic == GS_METRICS_SUMMARY_MAGIC;
+}
@@ -0,0 +1,501 @@
+/**
+ * @file gs_netloop.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Single epoll-driven thread for everything haystack does with the GS server except sending received data.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "gs_netloop.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+// epoll_event::data.u32 tags.
+#define NETLOOP_TAG_TIMER 1
+#define NETLOOP_TAG_STATUS 2
+#define NETLOOP_TAG_SOCKET 3
+
+#define NETLOOP_READS_PER_WAKE 64 // So that a flood from the server cannot starve the timers.
+#define NETLOOP_IDLE_MS 1000      // Longest the loop sleeps, so that it notices thread_status.
+
+static uint64_t ms_to_ns(uint32_t ms)
+{
+    return (uint64_t)ms * 1000000ULL;
+}
+
+int gs_netloop_init(gs_netloop_t *loop, const int *status_fds, uint32_t status_count, uint32_t max_payload, uint32_t poll_ms, uint32_t timeout_ms, uint32_t backoff_min_ms, uint32_t backoff_max_ms)
+{
+    loop->poll_ms = poll_ms;
+    loop->timeout_ms = timeout_ms;
+    loop->backoff_min_ms = backoff_min_ms > 0 ? backoff_min_ms : 1;
+    loop->backoff_max_ms = backoff_max_ms > loop->backoff_min_ms ? backoff_max_ms : loop->backoff_min_ms;
+    loop->backoff_ms = loop->backoff_min_ms;
+
+    loop->fd = -1;
+    loop->state = NET_DISCONNECTED;
+    loop->reconnect_at = 0;
+    loop->connect_by = 0;
+    loop->poll_at = 0;
+    loop->last_heard = 0;
+    loop->disconnected_at = 0;
+    memset(loop->status_at, 0x0, sizeof(loop->status_at));
+    loop->rx_len = 0;
+    loop->rx_skip = 0;
+    loop->rx_cap = sizeof(netframe_wire_hdr_t) + max_payload + sizeof(netframe_wire_ftr_t);
+    loop->reconnects.store(0, std::memory_order_relaxed);
+    loop->last_outage_ms.store(0, std::memory_order_relaxed);
+    loop->bad_frames.store(0, std::memory_order_relaxed);
+
+    loop->rx_buf = (uint8_t *)malloc(loop->rx_cap);
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->rx_buf == NULL || loop->epfd < 0 || loop->timer_fd < 0)
+    {
+        gs_netloop_destroy(loop);
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0x0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = NETLOOP_TAG_TIMER;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->timer_fd, &ev) < 0)
+    {
+        gs_netloop_destroy(loop);
+        return -1;
+    }
+    ev.data.u32 = NETLOOP_TAG_STATUS;
+    for (uint32_t i = 0; i < status_count && i < CHAINS_MAX; i++)
+    {
+        if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, status_fds[i], &ev) < 0)
+        {
+            gs_netloop_destroy(loop);
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+void gs_netloop_destroy(gs_netloop_t *loop)
+{
+    if (loop->epfd >= 0)
+    {
+        close(loop->epfd);
+    }
+    if (loop->timer_fd >= 0)
+    {
+        close(loop->timer_fd);
+    }
+    free(loop->rx_buf);
+    loop->epfd = -1;
+    loop->timer_fd = -1;
+    loop->rx_buf = NULL;
+}
+
+static void arm_timer(gs_netloop_t *loop, uint64_t at)
+{
+    struct itimerspec its;
+    memset(&its, 0x0, sizeof(its));
+    // An all-zero it_value disarms the timer; a deadline already past must still fire.
+    at = at > 0 ? at : 1;
+    its.it_value.tv_sec = at / 1000000000ULL;
+    its.it_value.tv_nsec = at % 1000000000ULL;
+    timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void net_disconnect(global_data_t *global, gs_netloop_t *loop, const char *reason)
+{
+    uint64_t now = gs_monotonic_ns();
+
+    if (loop->fd >= 0)
+    {
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, loop->fd, NULL);
+        if (loop->state == NET_CONNECTED)
+        {
+            dbprintlf(RED_BG "Lost the connection to the server (%s), reconnecting in %u ms.", reason, loop->backoff_ms);
+            gs_uplink_detach(global->uplink, global->network_data, reason);
+            loop->disconnected_at = now;
+        }
+        else
+        {
+            trprintlf(YELLOW_FG "Could not connect to the server (%s), retrying in %u ms.", reason, loop->backoff_ms);
+            close(loop->fd);
+        }
+    }
+
+    loop->fd = -1;
+    loop->state = NET_DISCONNECTED;
+    loop->rx_len = 0;
+    loop->rx_skip = 0;
+    loop->reconnect_at = now + ms_to_ns(loop->backoff_ms);
+    loop->backoff_ms = loop->backoff_ms * 2 < loop->backoff_max_ms ? loop->backoff_ms * 2 : loop->backoff_max_ms;
+}
+
+static void net_established(global_data_t *global, gs_netloop_t *loop)
+{
+    // Sends from the forwarding stage block, but give up after timeout_ms rather than hold the send lock forever.
+    int flags = fcntl(loop->fd, F_GETFL);
+    fcntl(loop->fd, F_SETFL, flags & ~O_NONBLOCK);
+    struct timeval tv = {(time_t)(loop->timeout_ms / 1000), (suseconds_t)(loop->timeout_ms % 1000) * 1000};
+    setsockopt(loop->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (!global->uplink->wire_verified)
+    {
+        // NetFrame::recvFrame(...) reads until the whole frame is in.
+        setsockopt(loop->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0x0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u32 = NETLOOP_TAG_SOCKET;
+    epoll_ctl(loop->epfd, EPOLL_CTL_MOD, loop->fd, &ev);
+
+    gs_uplink_attach(global->uplink, global->network_data, loop->fd);
+
+    uint64_t now = gs_monotonic_ns();
+    loop->state = NET_CONNECTED;
+    loop->backoff_ms = loop->backoff_min_ms;
+    loop->poll_at = now;
+    loop->last_heard = now;
+
+    if (loop->disconnected_at != 0)
+    {
+        uint32_t outage_ms = (uint32_t)((now - loop->disconnected_at) / 1000000ULL);
+        loop->reconnects.fetch_add(1, std::memory_order_relaxed);
+        loop->last_outage_ms.store(outage_ms, std::memory_order_relaxed);
+        dbprintlf(GREEN_BG "Reconnected to the server after %u ms.", outage_ms);
+    }
+    else
+    {
+        dbprintlf(GREEN_FG "Connected to the server.");
+    }
+
+    // The server may have missed anything sent while disconnected.
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        gs_status_notify(global->chains[i].status, STATUS_EVENT_CONNECT);
+    }
+}
+
+static void net_connect(global_data_t *global, gs_netloop_t *loop)
+{
+    loop->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (loop->fd < 0)
+    {
+        net_disconnect(global, loop, "SOCKET");
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0x0, sizeof(ev));
+    ev.events = EPOLLOUT;
+    ev.data.u32 = NETLOOP_TAG_SOCKET;
+    epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->fd, &ev);
+
+    loop->state = NET_CONNECTING;
+    loop->connect_by = gs_monotonic_ns() + ms_to_ns(loop->timeout_ms);
+
+    if (connect(loop->fd, (struct sockaddr *)global->network_data->server_ip, sizeof(struct sockaddr_in)) == 0)
+    {
+        net_established(global, loop);
+    }
+    else if (errno != EINPROGRESS)
+    {
+        net_disconnect(global, loop, strerror(errno));
+    }
+}
+
+static void net_connect_done(global_data_t *global, gs_netloop_t *loop)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(loop->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+    {
+        err = errno;
+    }
+
+    if (err != 0)
+    {
+        net_disconnect(global, loop, strerror(err));
+        return;
+    }
+    net_established(global, loop);
+}
+
+// Hands a received frame to gs_network_handle(...) in a pool buffer.
+static void deliver(global_data_t *global, gs_netloop_t *loop, NetType type, NetVertex destination, const uint8_t *payload, ssize_t size)
+{
+    PoolBuffer payload_buffer = buffer_pool_acquire(global->pool);
+    if (!payload_buffer.valid() || size > (ssize_t)payload_buffer->capacity)
+    {
+        dbprintlf(RED_FG "No buffer for a %zd byte payload, discarding frame.", size);
+        loop->bad_frames.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    memcpy(payload_buffer->data, payload, size);
+    payload_buffer->size = size;
+
+    trprintlf(BLUE_FG "Received a type 0x%02x frame with a %zd byte payload.", (unsigned)type, size);
+    gs_network_handle(global, type, destination, payload_buffer);
+}
+
+// Decodes every complete frame in rx_buf. Returns -1 if the stream cannot be followed any further.
+static int decode_frames(global_data_t *global, gs_netloop_t *loop)
+{
+    size_t offset = 0;
+
+    while (offset < loop->rx_len)
+    {
+        size_t avail = loop->rx_len - offset;
+
+        if (loop->rx_skip > 0)
+        {
+            size_t skip = avail < loop->rx_skip ? avail : loop->rx_skip;
+            loop->rx_skip -= skip;
+            offset += skip;
+            continue;
+        }
+
+        netframe_wire_hdr_t hdr;
+        if (avail < sizeof(hdr))
+        {
+            break;
+        }
+        memcpy(&hdr, loop->rx_buf + offset, sizeof(hdr));
+
+        if (hdr.guid != NETFRAME_GUID || hdr.payload_size < 0)
+        {
+            return -1;
+        }
+
+        size_t total = sizeof(hdr) + hdr.payload_size + sizeof(netframe_wire_ftr_t);
+        if (total > loop->rx_cap)
+        {
+            dbprintlf(RED_FG "Discarding a %d byte frame from the server, larger than a buffer.", hdr.payload_size);
+            loop->bad_frames.fetch_add(1, std::memory_order_relaxed);
+            loop->rx_skip = total;
+            continue;
+        }
+        if (avail < total)
+        {
+            break;
+        }
+
+        const uint8_t *payload = loop->rx_buf + offset + sizeof(hdr);
+        netframe_wire_ftr_t ftr;
+        memcpy(&ftr, payload + hdr.payload_size, sizeof(ftr));
+        if (ftr.termination != NETFRAME_TERMINATOR)
+        {
+            return -1;
+        }
+
+        if (ftr.crc2 != hdr.crc1 || gs_uplink_crc16(payload, hdr.payload_size) != hdr.crc1)
+        {
+            dbprintlf(RED_FG "Discarding a frame from the server that failed its CRC.");
+            loop->bad_frames.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            global->network_data->netstat = hdr.netstat;
+            deliver(global, loop, (NetType)hdr.type, (NetVertex)hdr.destination, payload, hdr.payload_size);
+        }
+        offset += total;
+    }
+
+    loop->rx_len -= offset;
+    if (loop->rx_len > 0 && offset > 0)
+    {
+        memmove(loop->rx_buf, loop->rx_buf + offset, loop->rx_len);
+    }
+    return 1;
+}
+
+static void net_readable(global_data_t *global, gs_netloop_t *loop)
+{
+    if (!global->uplink->wire_verified)
+    {
+        NetFrame netframe[1];
+        int read_size = netframe->recvFrame(global->network_data);
+        if (read_size == -404)
+        {
+            net_disconnect(global, loop, "SERVER-FORCED");
+            return;
+        }
+        else if (read_size < 0)
+        {
+            net_disconnect(global, loop, errno == EAGAIN ? "TIMED-OUT" : "RECV-ERROR");
+            return;
+        }
+        loop->last_heard = gs_monotonic_ns();
+
+        int payload_size = netframe->getPayloadSize();
+        PoolBuffer payload_buffer = buffer_pool_acquire(global->pool);
+        if (!payload_buffer.valid() || payload_size > (int)payload_buffer->capacity || netframe->retrievePayload(payload_buffer->data, payload_size) < 0)
+        {
+            dbprintlf(RED_FG "No buffer for a %d byte payload, discarding frame.", payload_size);
+            loop->bad_frames.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        payload_buffer->size = payload_size;
+        gs_network_handle(global, netframe->getType(), netframe->getDestination(), payload_buffer);
+        return;
+    }
+
+    for (int i = 0; i < NETLOOP_READS_PER_WAKE && loop->state == NET_CONNECTED; i++)
+    {
+        ssize_t got = recv(loop->fd, loop->rx_buf + loop->rx_len, loop->rx_cap - loop->rx_len, MSG_DONTWAIT);
+        if (got == 0)
+        {
+            net_disconnect(global, loop, "SERVER-FORCED");
+            return;
+        }
+        else if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                net_disconnect(global, loop, "RECV-ERROR");
+            }
+            return;
+        }
+
+        loop->last_heard = gs_monotonic_ns();
+        loop->rx_len += got;
+        if (decode_frames(global, loop) < 0)
+        {
+            dbprintlf(RED_FG "Lost frame alignment with the server.");
+            loop->bad_frames.fetch_add(1, std::memory_order_relaxed);
+            net_disconnect(global, loop, "BAD-FRAME");
+            return;
+        }
+    }
+}
+
+void *gs_netloop_thread(void *args)
+{
+    global_data_t *global = (global_data_t *)args;
+    gs_netloop_t *loop = global->netloop;
+    NetDataClient *network_data = global->network_data;
+
+    gs_sched_apply(global->config->sched_network_cpu, global->config->sched_network_priority, "network loop");
+    gs_metrics_register(global->metrics, "net");
+
+    while (global->thread_status.load(std::memory_order_acquire) > -1)
+    {
+        uint64_t now = gs_monotonic_ns();
+
+        if (loop->state == NET_DISCONNECTED && now >= loop->reconnect_at)
+        {
+            net_connect(global, loop);
+        }
+        else if (loop->state == NET_CONNECTING && now >= loop->connect_by)
+        {
+            net_disconnect(global, loop, "CONNECT-TIMEOUT");
+        }
+        else if (loop->state == NET_CONNECTED && now >= loop->last_heard + ms_to_ns(loop->timeout_ms))
+        {
+            net_disconnect(global, loop, "TIMED-OUT");
+        }
+        else if (loop->state == NET_CONNECTED && now >= loop->poll_at)
+        {
+            gs_uplink_send_control(global->uplink, network_data, NetType::POLL, NetVertex::SERVER, NULL, 0);
+            loop->poll_at = now + ms_to_ns(loop->poll_ms);
+        }
+
+        // Events that come due while disconnected are dropped; reconnecting sends a complete frame.
+        for (uint32_t i = 0; i < global->chain_count; i++)
+        {
+            gs_chain_t *chain = &global->chains[i];
+            uint32_t events = gs_status_due(chain->status, &loop->status_at[i]);
+            if (events != 0 && loop->state == NET_CONNECTED && chain->radio_ready.load(std::memory_order_acquire))
+            {
+                gs_xband_send_status(chain, events);
+            }
+        }
+
+        now = gs_monotonic_ns();
+        uint64_t next = now + ms_to_ns(NETLOOP_IDLE_MS);
+        for (uint32_t i = 0; i < global->chain_count; i++)
+        {
+            next = loop->status_at[i] < next ? loop->status_at[i] : next;
+        }
+        switch (loop->state)
+        {
+        case NET_DISCONNECTED:
+            next = loop->reconnect_at < next ? loop->reconnect_at : next;
+            break;
+        case NET_CONNECTING:
+            next = loop->connect_by < next ? loop->connect_by : next;
+            break;
+        case NET_CONNECTED:
+        {
+            uint64_t silent_at = loop->last_heard + ms_to_ns(loop->timeout_ms);
+            next = loop->poll_at < next ? loop->poll_at : next;
+            next = silent_at < next ? silent_at : next;
+            break;
+        }
+        }
+        arm_timer(loop, next);
+
+        struct epoll_event evs[2 + CHAINS_MAX];
+        int count = epoll_wait(loop->epfd, evs, 2 + CHAINS_MAX, -1);
+        for (int i = 0; i < count; i++)
+        {
+            switch (evs[i].data.u32)
+            {
+            case NETLOOP_TAG_TIMER:
+            {
+                uint64_t expirations;
+                if (read(loop->timer_fd, &expirations, sizeof(expirations)) < 0)
+                {
+                    // Already cleared.
+                }
+                break;
+            }
+            case NETLOOP_TAG_STATUS:
+                // Drained by gs_status_due(...) at the top of the loop.
+                break;
+            case NETLOOP_TAG_SOCKET:
+                if (loop->state == NET_CONNECTING)
+                {
+                    net_connect_done(global, loop);
+                }
+                else if (loop->state == NET_CONNECTED && !gs_uplink_connected(global->uplink))
+                {
+                    // A send failed part way through a frame and shut the socket down (gs_uplink.hpp).
+                    net_disconnect(global, loop, "SEND-FAILED");
+                }
+                else if (loop->state == NET_CONNECTED)
+                {
+                    net_readable(global, loop);
+                }
+                break;
+            }
+        }
+    }
+
+    if (loop->fd >= 0)
+    {
+        net_disconnect(global, loop, "SHUTDOWN");
+    }
+
+    ftprintlf("Network loop exiting (%d).", global->thread_status.load());
+    return NULL;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file gs_radio.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Timestamped snapshots of the radio's status attributes, read in as few libiio operations as possible.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gs_radio.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+#ifdef HAYSTACK_SIM
+#include "sim_iio.h"
+#else
+#include <iio.h>
+#endif
+
+static int ensm_mode_from_string(const char *name)
+{
+    if (strcmp(name, "sleep") == 0)
+    {
+        return SLEEP;
+    }
+    else if (strcmp(name, "fdd") == 0)
+    {
+        return FDD;
+    }
+    else if (strcmp(name, "tdd") == 0)
+    {
+        return TDD;
+    }
+    return -1;
+}
+
+int gs_radio_reader_init(gs_radio_reader_t *reader)
+{
+    memset(reader, 0x0, sizeof(gs_radio_reader_t));
+
+    reader->ctx = iio_create_default_context();
+    if (reader->ctx == NULL)
+    {
+        dbprintlf(YELLOW_FG "No libiio context for batched radio reads, reading attributes one at a time.");
+        return -1;
+    }
+
+    reader->phy = iio_context_find_device(reader->ctx, "ad9361-phy");
+    if (reader->phy != NULL)
+    {
+        reader->rx = iio_device_find_channel(reader->phy, "voltage0", false);
+        reader->lo = iio_device_find_channel(reader->phy, "altvoltage0", true);
+        reader->temp = iio_device_find_channel(reader->phy, "temp0", false);
+    }
+
+    if (reader->phy == NULL || reader->rx == NULL || reader->lo == NULL || reader->temp == NULL)
+    {
+        dbprintlf(YELLOW_FG "AD9361 not found in the libiio context, reading attributes one at a time.");
+        gs_radio_reader_destroy(reader);
+        return -1;
+    }
+
+    return 1;
+}
+
+void gs_radio_reader_destroy(gs_radio_reader_t *reader)
+{
+    if (reader->ctx != NULL)
+    {
+        iio_context_destroy(reader->ctx);
+    }
+    memset(reader, 0x0, sizeof(gs_radio_reader_t));
+}
+
+// Parses one attribute into the snapshot. Unknown attributes are skipped; read_all(...) returns all of them.
+static void snapshot_attr(radio_snapshot_t *snap, const char *channel, const char *attr, const char *value)
+{
+    if (channel == NULL)
+    {
+        if (strcmp(attr, "ensm_mode") == 0)
+        {
+            snap->mode = ensm_mode_from_string(value);
+            snap->valid |= RADIO_ATTR_MODE;
+        }
+    }
+    else if (strcmp(channel, "voltage0") == 0)
+    {
+        if (strcmp(attr, "hardwaregain") == 0)
+        {
+            snap->gain = strtod(value, NULL);
+            snap->valid |= RADIO_ATTR_GAIN;
+        }
+        else if (strcmp(attr, "gain_control_mode") == 0)
+        {
+            snprintf(snap->gainmode, sizeof(snap->gainmode), "%s", value);
+            snap->valid |= RADIO_ATTR_GAINMODE;
+        }
+        else if (strcmp(attr, "rssi") == 0)
+        {
+            snap->rssi = strtod(value, NULL);
+            snap->valid |= RADIO_ATTR_RSSI;
+        }
+        else if (strcmp(attr, "sampling_frequency") == 0)
+        {
+            snap->samp = strtoll(value, NULL, 10);
+            snap->valid |= RADIO_ATTR_SAMP;
+        }
+        else if (strcmp(attr, "rf_bandwidth") == 0)
+        {
+            snap->bw = strtoll(value, NULL, 10);
+            snap->valid |= RADIO_ATTR_BW;
+        }
+    }
+    else if (strcmp(channel, "altvoltage0") == 0)
+    {
+        if (strcmp(attr, "frequency") == 0)
+        {
+            snap->LO = strtoll(value, NULL, 10);
+            snap->valid |= RADIO_ATTR_LO;
+        }
+    }
+    else if (strcmp(channel, "temp0") == 0)
+    {
+        if (strcmp(attr, "input") == 0)
+        {
+            snap->temp = strtoll(value, NULL, 10);
+            snap->valid |= RADIO_ATTR_TEMP;
+        }
+    }
+}
+
+typedef struct
+{
+    radio_snapshot_t *snap;
+    const char *channel;
+} snapshot_read_t;
+
+static int device_attr_cb(struct iio_device *dev, const char *attr, const char *value, size_t len, void *d)
+{
+    (void)dev;
+    (void)len;
+    snapshot_read_t *read = (snapshot_read_t *)d;
+    snapshot_attr(read->snap, read->channel, attr, value);
+    return 0;
+}
+
+static int channel_attr_cb(struct iio_channel *chn, const char *attr, const char *value, size_t len, void *d)
+{
+    (void)chn;
+    (void)len;
+    snapshot_read_t *read = (snapshot_read_t *)d;
+    snapshot_attr(read->snap, read->channel, attr, value);
+    return 0;
+}
+
+static void snapshot_begin(radio_snapshot_t *snap, uint64_t *start)
+{
+    memset(snap, 0x0, sizeof(radio_snapshot_t));
+    snap->mode = -1;
+    *start = gs_monotonic_ns();
+}
+
+static int snapshot_end(radio_snapshot_t *snap, uint64_t start)
+{
+    uint64_t end = gs_monotonic_ns();
+    snap->timestamp = start + (end - start) / 2;
+    snap->read_ns = (uint32_t)(end - start);
+    gs_metrics_record(METRIC_IIO_READ_NS, snap->read_ns);
+    if (snap->valid != RADIO_ATTR_ALL)
+    {
+        gs_metrics_count(METRIC_IIO_ERRORS, 1);
+        return -1;
+    }
+    return 1;
+}
+
+int gs_radio_snapshot(gs_radio_reader_t *reader, adradio_t *radio, radio_snapshot_t *snap)
+{
+    if (reader->ctx == NULL)
+    {
+        return gs_radio_snapshot_each(radio, snap);
+    }
+
+    uint64_t start;
+    snapshot_begin(snap, &start);
+
+    snapshot_read_t read = {snap, NULL};
+    iio_device_attr_read_all(reader->phy, device_attr_cb, &read);
+    read.channel = "voltage0";
+    iio_channel_attr_read_all(reader->rx, channel_attr_cb, &read);
+    read.channel = "altvoltage0";
+    iio_channel_attr_read_all(reader->lo, channel_attr_cb, &read);
+    read.channel = "temp0";
+    iio_channel_attr_read_all(reader->temp, channel_attr_cb, &read);
+
+    return snapshot_end(snap, start);
+}
+
+int gs_radio_snapshot_each(adradio_t *radio, radio_snapshot_t *snap)
+{
+    uint64_t start;
+    snapshot_begin(snap, &start);
+
+    long long val = 0;
+    if (adradio_get_rx_bw(radio, &val) >= 0)
+    {
+        snap->bw = val;
+        snap->valid |= RADIO_ATTR_BW;
+    }
+    if (adradio_get_rx_hardwaregain(radio, &snap->gain) >= 0)
+    {
+        snap->valid |= RADIO_ATTR_GAIN;
+    }
+    if (adradio_get_rx_hardwaregainmode(radio, snap->gainmode, sizeof(snap->gainmode)) >= 0)
+    {
+        snap->valid |= RADIO_ATTR_GAINMODE;
+    }
+    if (adradio_get_rx_lo(radio, &val) >= 0)
+    {
+        snap->LO = val;
+        snap->valid |= RADIO_ATTR_LO;
+    }
+    if (adradio_get_rssi(radio, &snap->rssi) >= 0)
+    {
+        snap->valid |= RADIO_ATTR_RSSI;
+    }
+    if (adradio_get_samp(radio, &val) >= 0)
+    {
+        snap->samp = val;
+        snap->valid |= RADIO_ATTR_SAMP;
+    }
+    if (adradio_get_temp(radio, &val) >= 0)
+    {
+        snap->temp = val;
+        snap->valid |= RADIO_ATTR_TEMP;
+    }
+
+    char buf[32];
+    memset(buf, 0x0, 32);
+    if (adradio_get_ensm_mode(radio, buf, sizeof(buf)) >= 0)
+    {
+        snap->mode = ensm_mode_from_string(buf);
+        snap->valid |= RADIO_ATTR_MODE;
+    }
+
+    return snapshot_end(snap, start);
+}
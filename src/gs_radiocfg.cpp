@@ -0,0 +1,514 @@
+/**
+ * @file gs_radiocfg.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Applies XBAND_CONFIG frames to a chain's radio: only what changed, in a fixed order, undone on failure.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "gs_radiocfg.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+#ifdef HAYSTACK_SIM
+#include "sim_iio.h"
+#else
+#include <iio.h>
+#endif
+
+#define FIR_FILE_MAX (64 * 1024) // The wizard writes about 3 KiB for 128 taps.
+#define FIR_TAPS_MAX 128
+
+int gs_radiocfg_init(gs_radiocfg_t *cfg, adradio_t *radio, const char *filter_dir, uint32_t fir_cache)
+{
+    cfg->radio = radio;
+    snprintf(cfg->filter_dir, sizeof(cfg->filter_dir), "%s", filter_dir);
+    pthread_mutex_init(&cfg->lock, NULL);
+    memset(cfg->applied, 0x0, sizeof(radiocfg_settings_t));
+    cfg->applied_valid = false;
+    cfg->applied_fir = 0;
+    cfg->fir_count = fir_cache < 1 ? 1 : fir_cache > RADIOCFG_FIR_CACHE_MAX ? RADIOCFG_FIR_CACHE_MAX : fir_cache;
+    cfg->fir_clock = 0;
+    cfg->ctx = NULL;
+    cfg->phy = NULL;
+    cfg->rx = NULL;
+    cfg->ctx_opened = false;
+    cfg->applies.store(0, std::memory_order_relaxed);
+    cfg->unchanged.store(0, std::memory_order_relaxed);
+    cfg->failures.store(0, std::memory_order_relaxed);
+    cfg->rollbacks.store(0, std::memory_order_relaxed);
+    cfg->fir_hits.store(0, std::memory_order_relaxed);
+    cfg->fir_parses.store(0, std::memory_order_relaxed);
+    cfg->last_apply_us.store(0, std::memory_order_relaxed);
+
+    cfg->fir = (radiocfg_fir_t *)calloc(cfg->fir_count, sizeof(radiocfg_fir_t));
+    if (cfg->fir == NULL)
+    {
+        return -1;
+    }
+    return 1;
+}
+
+void gs_radiocfg_destroy(gs_radiocfg_t *cfg)
+{
+    for (uint32_t i = 0; cfg->fir != NULL && i < cfg->fir_count; i++)
+    {
+        free(cfg->fir[i].text);
+    }
+    free(cfg->fir);
+    cfg->fir = NULL;
+    if (cfg->ctx != NULL)
+    {
+        iio_context_destroy(cfg->ctx);
+        cfg->ctx = NULL;
+    }
+    pthread_mutex_destroy(&cfg->lock);
+}
+
+void gs_radiocfg_settings(const phy_config_t *config, radiocfg_settings_t *settings)
+{
+    memset(settings, 0x0, sizeof(radiocfg_settings_t));
+    settings->mode = config->mode;
+    settings->gainmode = strcmp("fast_attack", config->curr_gainmode) ? SLOW_ATTACK : FAST_ATTACK;
+    memcpy(settings->ftr_name, config->ftr_name, sizeof(settings->ftr_name));
+    settings->ftr_name[sizeof(settings->ftr_name) - 1] = '\0';
+    settings->samp = config->samp;
+    settings->bw = config->bw;
+    settings->LO = config->LO;
+}
+
+// Checks a filter file the way the AD9361 driver reads it: optional TX and RX headers ("RX <channels> GAIN <dB> DEC
+// <n>"), optional rate and bandwidth lines, then one "<tx>,<rx>" or "<both>" coefficient line per tap. Comments
+// start with '#'.
+static int fir_parse(const char *text, size_t len, uint32_t *taps, int *decimation)
+{
+    bool have_rx = false;
+    *taps = 0;
+    *decimation = 1;
+
+    const char *end = text + len;
+    for (const char *line = text; line < end;)
+    {
+        const char *eol = (const char *)memchr(line, '\n', end - line);
+        size_t n = (eol != NULL ? eol : end) - line;
+        char buf[128];
+        if (n >= sizeof(buf))
+        {
+            return -1;
+        }
+        memcpy(buf, line, n);
+        buf[n] = '\0';
+        line += n + 1;
+
+        char *p = buf + strspn(buf, " \t\r");
+        if (*p == '\0' || *p == '#')
+        {
+            continue;
+        }
+
+        unsigned int channels;
+        int gain, factor;
+        long long a, b;
+        char extra;
+        int fields = sscanf(p, "%lld , %lld %c", &a, &b, &extra);
+        if (sscanf(p, "RX %u GAIN %d DEC %d", &channels, &gain, &factor) == 3)
+        {
+            if ((factor != 1 && factor != 2 && factor != 4) || (gain != -12 && gain != -6 && gain != 0 && gain != 6))
+            {
+                return -1;
+            }
+            have_rx = true;
+            *decimation = factor;
+        }
+        else if (sscanf(p, "TX %u GAIN %d INT %d", &channels, &gain, &factor) == 3)
+        {
+            if ((factor != 1 && factor != 2 && factor != 4) || (gain != -6 && gain != 0))
+            {
+                return -1;
+            }
+        }
+        else if (strncmp(p, "RTX", 3) == 0 || strncmp(p, "RRX", 3) == 0 || strncmp(p, "BWTX", 4) == 0 || strncmp(p, "BWRX", 4) == 0)
+        {
+            // The driver derives the clocks from these; nothing to check beyond their presence.
+        }
+        else if (fields == 2 || (fields == 1 && strchr(p, ',') == NULL && sscanf(p, "%lld %c", &a, &extra) == 1))
+        {
+            b = fields == 2 ? b : a;
+            if (a < INT16_MIN || a > INT16_MAX || b < INT16_MIN || b > INT16_MAX || ++*taps > FIR_TAPS_MAX)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    // The FIR runs 16 taps per clock.
+    if (!have_rx || *taps == 0 || *taps % 16 != 0)
+    {
+        return -1;
+    }
+    return 1;
+}
+
+// Finds a filter in the cache, parsing it again if the file changed since, or for the first time into the least
+// recently used entry. NULL if the file cannot be read or is not a valid filter.
+static radiocfg_fir_t *fir_lookup(gs_radiocfg_t *cfg, const char *name)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.ftr", cfg->filter_dir, name);
+
+    struct stat st;
+    if (stat(path, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || st.st_size > FIR_FILE_MAX)
+    {
+        dbprintlf(RED_FG "Cannot use filter %s.", path);
+        return NULL;
+    }
+
+    radiocfg_fir_t *entry = NULL;
+    for (uint32_t i = 0; i < cfg->fir_count; i++)
+    {
+        radiocfg_fir_t *fir = &cfg->fir[i];
+        if (fir->name[0] != '\0' && strcmp(fir->name, name) == 0)
+        {
+            if (fir->dev == st.st_dev && fir->ino == st.st_ino && fir->size == st.st_size && fir->mtime.tv_sec == st.st_mtim.tv_sec && fir->mtime.tv_nsec == st.st_mtim.tv_nsec)
+            {
+                fir->last_used = ++cfg->fir_clock;
+                cfg->fir_hits.fetch_add(1, std::memory_order_relaxed);
+                return fir;
+            }
+            entry = fir;
+            break;
+        }
+        if (entry == NULL || fir->last_used < entry->last_used)
+        {
+            entry = fir;
+        }
+    }
+
+    char *text = (char *)malloc(st.st_size);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t len = fd >= 0 ? read(fd, text, st.st_size) : -1;
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    uint32_t taps;
+    int decimation;
+    if (text == NULL || len != st.st_size || fir_parse(text, len, &taps, &decimation) < 0)
+    {
+        dbprintlf(RED_FG "Filter %s is unreadable or malformed.", path);
+        free(text);
+        return NULL;
+    }
+    cfg->fir_parses.fetch_add(1, std::memory_order_relaxed);
+
+    free(entry->text);
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->dev = st.st_dev;
+    entry->ino = st.st_ino;
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtim;
+    entry->text = text;
+    entry->len = len;
+    entry->taps = taps;
+    entry->decimation = decimation;
+    entry->gen = ++cfg->fir_clock;
+    entry->last_used = entry->gen;
+    dbprintlf(BLUE_FG "Parsed filter %s: %u taps, decimation %d.", path, taps, decimation);
+    return entry;
+}
+
+// Opens the engine's libiio context the first time it is needed. Returns whether it has one.
+static bool ctx_open(gs_radiocfg_t *cfg)
+{
+    if (!cfg->ctx_opened)
+    {
+        cfg->ctx_opened = true;
+        cfg->ctx = iio_create_default_context();
+        cfg->phy = cfg->ctx != NULL ? iio_context_find_device(cfg->ctx, "ad9361-phy") : NULL;
+        cfg->rx = cfg->phy != NULL ? iio_device_find_channel(cfg->phy, "voltage0", false) : NULL;
+        if (cfg->phy == NULL || cfg->rx == NULL)
+        {
+            dbprintlf(YELLOW_FG "No libiio context for configuration, loading filters by file name; manual gain is unavailable.");
+            cfg->phy = NULL;
+            cfg->rx = NULL;
+        }
+    }
+    return cfg->phy != NULL;
+}
+
+static int fir_load(gs_radiocfg_t *cfg, const radiocfg_fir_t *fir)
+{
+    if (!ctx_open(cfg))
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s.ftr", cfg->filter_dir, fir->name);
+        return adradio_load_fir(cfg->radio, path);
+    }
+
+    if (iio_device_attr_write_raw(cfg->phy, "filter_fir_config", fir->text, fir->len) < 0)
+    {
+        return -1;
+    }
+    return iio_device_attr_write_raw(cfg->phy, "in_out_voltage_filter_fir_en", "1", 1) < 0 ? -1 : 1;
+}
+
+// The AGC mode, or a manual gain. Either one replaces the other.
+static int gain_write(gs_radiocfg_t *cfg, const radiocfg_settings_t *s)
+{
+    if (!s->manual_gain)
+    {
+        return adradio_set_rx_hardwaregainmode(cfg->radio, s->gainmode);
+    }
+    if (!ctx_open(cfg))
+    {
+        return -1;
+    }
+
+    char value[32];
+    int len = snprintf(value, sizeof(value), "%.2f", s->rx_gain);
+    if (iio_channel_attr_write_raw(cfg->rx, "gain_control_mode", "manual", 6) < 0)
+    {
+        return -1;
+    }
+    return iio_channel_attr_write_raw(cfg->rx, "hardwaregain", value, len) < 0 ? -1 : 1;
+}
+
+// Writes one setting. 'fir' is the filter to load for RADIOCFG_FIR.
+static int write_setting(gs_radiocfg_t *cfg, uint32_t setting, const radiocfg_settings_t *s, const radiocfg_fir_t *fir)
+{
+    switch (setting)
+    {
+    case RADIOCFG_MODE:
+        return adradio_set_ensm_mode(cfg->radio, (ensm_mode)s->mode);
+    case RADIOCFG_GAINMODE:
+    case RADIOCFG_RXGAIN:
+        return gain_write(cfg, s);
+    case RADIOCFG_TXGAIN:
+        return adradio_set_tx_hardwaregain(cfg->radio, RADIOCFG_TX_GAIN_DB);
+    case RADIOCFG_FIR:
+        return fir != NULL ? fir_load(cfg, fir) : -1;
+    case RADIOCFG_SAMP:
+        return adradio_set_samp(cfg->radio, s->samp);
+    case RADIOCFG_BW:
+        return adradio_set_rx_bw(cfg->radio, s->bw);
+    case RADIOCFG_LO:
+        return adradio_set_rx_lo(cfg->radio, s->LO);
+    }
+    return -1;
+}
+
+// The settings in 'want' that differ from what is applied; every one if that is unknown.
+static uint32_t diff(gs_radiocfg_t *cfg, const radiocfg_settings_t *want, uint64_t want_fir)
+{
+    uint32_t changed = 0;
+    const radiocfg_settings_t *have = cfg->applied;
+    bool known = cfg->applied_valid;
+
+    changed |= !known || want->mode != have->mode ? RADIOCFG_MODE : 0;
+    if (want->manual_gain)
+    {
+        changed |= !known || !have->manual_gain || want->rx_gain != have->rx_gain ? RADIOCFG_RXGAIN : 0;
+    }
+    else
+    {
+        changed |= !known || have->manual_gain || want->gainmode != have->gainmode ? RADIOCFG_GAINMODE : 0;
+    }
+    changed |= !known ? RADIOCFG_TXGAIN : 0;
+    // No filter named keeps whatever is loaded.
+    changed |= want_fir != 0 && (!known || want_fir != cfg->applied_fir) ? RADIOCFG_FIR : 0;
+    changed |= !known || want->samp != have->samp ? RADIOCFG_SAMP : 0;
+    changed |= !known || want->bw != have->bw ? RADIOCFG_BW : 0;
+    changed |= !known || want->LO != have->LO ? RADIOCFG_LO : 0;
+    return changed;
+}
+
+static int apply_locked(gs_radiocfg_t *cfg, const radiocfg_settings_t *want, phy_config_ack_t *ack)
+{
+    memset(ack, 0x0, sizeof(phy_config_ack_t));
+    uint64_t begin = gs_monotonic_ns();
+
+    // Parsed before anything is written, so that a bad filter fails the frame with the radio untouched.
+    const radiocfg_fir_t *fir = NULL;
+    if (want->ftr_name[0] != '\0')
+    {
+        fir = fir_lookup(cfg, want->ftr_name);
+        if (fir == NULL)
+        {
+            cfg->failures.fetch_add(1, std::memory_order_relaxed);
+            ack->result = -3;
+            ack->failed = RADIOCFG_FIR;
+            return -3;
+        }
+    }
+
+    uint32_t changed = diff(cfg, want, fir != NULL ? fir->gen : 0);
+    ack->changed = changed;
+    if (changed == 0)
+    {
+        cfg->unchanged.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    static const uint32_t steps[] = {RADIOCFG_GAINMODE, RADIOCFG_RXGAIN, RADIOCFG_TXGAIN, RADIOCFG_FIR, RADIOCFG_SAMP, RADIOCFG_BW, RADIOCFG_LO};
+    uint32_t order[8];
+    uint32_t count = 0;
+    bool sleeping = want->mode == SLEEP;
+    if ((changed & RADIOCFG_MODE) && sleeping)
+    {
+        order[count++] = RADIOCFG_MODE;
+    }
+    for (uint32_t step : steps)
+    {
+        if (changed & step)
+        {
+            order[count++] = step;
+        }
+    }
+    if ((changed & RADIOCFG_MODE) && !sleeping)
+    {
+        order[count++] = RADIOCFG_MODE;
+    }
+
+    uint32_t done = 0;
+    int iio_errors = 0;
+    for (; done < count; done++)
+    {
+        if (write_setting(cfg, order[done], want, fir) < 0)
+        {
+            iio_errors++;
+            ack->failed = order[done];
+            break;
+        }
+        ack->applied |= order[done];
+    }
+
+    int retval = 1;
+    if (done < count)
+    {
+        retval = -1;
+        const radiocfg_fir_t *prev_fir = NULL;
+        if (!cfg->applied_valid)
+        {
+            // Nothing to go back to.
+            retval = -2;
+        }
+        else
+        {
+            // Undone newest first, so that each write is made against the state it was first made in.
+            if (cfg->applied->ftr_name[0] != '\0' && (ack->applied & RADIOCFG_FIR))
+            {
+                prev_fir = fir_lookup(cfg, cfg->applied->ftr_name);
+            }
+            while (done-- > 0)
+            {
+                if (write_setting(cfg, order[done], cfg->applied, prev_fir) < 0)
+                {
+                    iio_errors++;
+                    retval = -2;
+                    break;
+                }
+                ack->applied &= ~order[done];
+            }
+        }
+
+        cfg->failures.fetch_add(1, std::memory_order_relaxed);
+        if (retval == -1)
+        {
+            if (prev_fir != NULL)
+            {
+                // Its file may have changed since it was first loaded.
+                cfg->applied_fir = prev_fir->gen;
+            }
+            ack->rolled_back = 1;
+            cfg->rollbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            cfg->applied_valid = false;
+        }
+    }
+    else
+    {
+        radiocfg_settings_t next = *want;
+        if (fir == NULL)
+        {
+            memcpy(next.ftr_name, cfg->applied->ftr_name, sizeof(next.ftr_name));
+        }
+        else
+        {
+            cfg->applied_fir = fir->gen;
+        }
+        *cfg->applied = next;
+        cfg->applied_valid = true;
+        cfg->applies.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t elapsed = gs_monotonic_ns() - begin;
+    ack->result = retval;
+    ack->apply_us = (uint32_t)(elapsed / 1000);
+    cfg->last_apply_us.store(ack->apply_us, std::memory_order_relaxed);
+    gs_metrics_record(METRIC_IIO_CONFIG_NS, elapsed);
+    gs_metrics_count(METRIC_IIO_ERRORS, iio_errors);
+    return retval;
+}
+
+int gs_radiocfg_apply(gs_radiocfg_t *cfg, const radiocfg_settings_t *want, phy_config_ack_t *ack)
+{
+    pthread_mutex_lock(&cfg->lock);
+    int retval = apply_locked(cfg, want, ack);
+    pthread_mutex_unlock(&cfg->lock);
+    return retval;
+}
+
+int gs_radiocfg_retune(gs_radiocfg_t *cfg, int64_t LO, const double *gain, phy_config_ack_t *ack, radiocfg_settings_t *applied)
+{
+    pthread_mutex_lock(&cfg->lock);
+    int retval = -4;
+    if (!cfg->applied_valid)
+    {
+        memset(ack, 0x0, sizeof(phy_config_ack_t));
+        ack->result = retval;
+    }
+    else
+    {
+        radiocfg_settings_t want = *cfg->applied;
+        want.LO = LO != 0 ? LO : want.LO;
+        if (gain != NULL)
+        {
+            want.manual_gain = true;
+            want.rx_gain = *gain;
+        }
+        // The filter in effect is already loaded; naming none leaves it be without looking it up again.
+        want.ftr_name[0] = '\0';
+        retval = apply_locked(cfg, &want, ack);
+    }
+    if (applied != NULL)
+    {
+        *applied = *cfg->applied;
+    }
+    pthread_mutex_unlock(&cfg->lock);
+    return retval;
+}
+
+bool gs_radiocfg_applied(gs_radiocfg_t *cfg, radiocfg_settings_t *applied)
+{
+    pthread_mutex_lock(&cfg->lock);
+    *applied = *cfg->applied;
+    bool valid = cfg->applied_valid;
+    pthread_mutex_unlock(&cfg->lock);
+    return valid;
+}
@@ -0,0 +1,361 @@
+/**
+ * @file gs_recorder.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Asynchronous raw-capture recorder, writing received frames to rolling capture segments.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <glob.h>
+#include <sys/uio.h>
+#include "gs_recorder.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+int gs_recorder_init(gs_recorder_t *rec, buffer_pool_t *pool, uint32_t ring_slots, const char *directory, uint64_t segment_size, uint32_t max_segments, uint32_t batch_frames, uint32_t batch_ms, fsync_policy fsync, uint32_t fsync_interval_ms, uint32_t producers)
+{
+    // The recorder must never hold up the capture stage.
+    if (frame_ring_init(rec->ring, pool, ring_slots, RING_DROP_NEWEST) < 0)
+    {
+        return -1;
+    }
+
+    snprintf(rec->directory, sizeof(rec->directory), "%s", directory);
+
+    // Name the recording after the time it started, so that a restart never overwrites an earlier one.
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(rec->prefix, sizeof(rec->prefix), "haystack_%Y%m%d_%H%M%S", &tm_now);
+
+    rec->segment_size = segment_size;
+    rec->max_segments = max_segments;
+    rec->batch_frames = batch_frames < 1 ? 1 : (batch_frames > RECORDER_BATCH_MAX ? RECORDER_BATCH_MAX : batch_frames);
+    rec->batch_ms = batch_ms;
+    rec->fsync = fsync;
+    rec->fsync_interval_ms = fsync_interval_ms;
+
+    rec->fd = -1;
+    rec->segment_index = 0;
+    rec->segment_bytes = 0;
+    rec->last_fsync = 0;
+    rec->seq = 0;
+
+    rec->shared = producers > 1;
+    pthread_mutex_init(&rec->submit_lock, NULL);
+    pthread_mutex_init(&rec->radio_lock, NULL);
+    memset(rec->radio, 0x0, sizeof(rec->radio));
+    for (int i = 0; i < CHAINS_MAX; i++)
+    {
+        rec->radio[i].mode = -1;
+        rec->radio[i].chain = i;
+    }
+
+    rec->records.store(0, std::memory_order_relaxed);
+    rec->write_errors.store(0, std::memory_order_relaxed);
+
+    return 1;
+}
+
+static void close_segment(gs_recorder_t *rec)
+{
+    if (rec->fd < 0)
+    {
+        return;
+    }
+
+    if (rec->fsync != FSYNC_NONE)
+    {
+        fsync(rec->fd);
+    }
+    close(rec->fd);
+    rec->fd = -1;
+}
+
+void gs_recorder_destroy(gs_recorder_t *rec)
+{
+    close_segment(rec);
+    frame_ring_destroy(rec->ring);
+    pthread_mutex_destroy(&rec->radio_lock);
+    pthread_mutex_destroy(&rec->submit_lock);
+}
+
+void gs_recorder_submit(gs_recorder_t *rec, PoolBuffer &frame)
+{
+    if (!rec->shared)
+    {
+        frame_ring_commit(rec->ring, frame);
+        return;
+    }
+    pthread_mutex_lock(&rec->submit_lock);
+    frame_ring_commit(rec->ring, frame);
+    pthread_mutex_unlock(&rec->submit_lock);
+}
+
+void gs_recorder_set_radio(gs_recorder_t *rec, const capture_radio_t *radio)
+{
+    if (radio->chain >= CHAINS_MAX)
+    {
+        return;
+    }
+    pthread_mutex_lock(&rec->radio_lock);
+    rec->radio[radio->chain] = *radio;
+    pthread_mutex_unlock(&rec->radio_lock);
+}
+
+int gs_recorder_fsync_from_string(const char *name, fsync_policy *policy)
+{
+    if (strcmp(name, "none") == 0)
+    {
+        *policy = FSYNC_NONE;
+    }
+    else if (strcmp(name, "segment") == 0)
+    {
+        *policy = FSYNC_SEGMENT;
+    }
+    else if (strcmp(name, "interval") == 0)
+    {
+        *policy = FSYNC_INTERVAL;
+    }
+    else if (strcmp(name, "batch") == 0)
+    {
+        *policy = FSYNC_BATCH;
+    }
+    else
+    {
+        return -1;
+    }
+    return 1;
+}
+
+// Writes every iovec, resuming after short writes.
+static int writev_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t written = writev(fd, iov, iovcnt);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return 1;
+}
+
+// Deletes the oldest segments in the directory, so that the one about to be opened makes max_segments. The names sort
+// in the order the segments were started.
+static void prune_segments(gs_recorder_t *rec)
+{
+    char pattern[sizeof(rec->directory) + 32];
+    snprintf(pattern, sizeof(pattern), "%s/haystack_*.hcap", rec->directory);
+
+    glob_t found;
+    if (glob(pattern, 0, NULL, &found) != 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i + rec->max_segments <= found.gl_pathc; i++)
+    {
+        if (unlink(found.gl_pathv[i]) < 0)
+        {
+            dbprintlf(RED_FG "Failed to delete capture segment %s.", found.gl_pathv[i]);
+            erprintlf(errno);
+        }
+        else
+        {
+            dbprintlf(YELLOW_FG "Deleted capture segment %s to stay within %u segments.", found.gl_pathv[i], rec->max_segments);
+        }
+    }
+    globfree(&found);
+}
+
+static int open_segment(gs_recorder_t *rec)
+{
+    char path[sizeof(rec->directory) + sizeof(rec->prefix) + 32];
+
+    if (rec->max_segments > 0)
+    {
+        prune_segments(rec);
+    }
+
+    // O_EXCL: never overwrite an existing capture, skip past it instead.
+    do
+    {
+        snprintf(path, sizeof(path), "%s/%s_%04u.hcap", rec->directory, rec->prefix, rec->segment_index);
+        rec->fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    } while (rec->fd < 0 && errno == EEXIST && ++rec->segment_index < 10000);
+
+    if (rec->fd < 0)
+    {
+        dbprintlf(RED_FG "Failed to open capture segment %s.", path);
+        erprintlf(errno);
+        return -1;
+    }
+
+    capture_segment_hdr_t hdr[1];
+    memset(hdr, 0x0, sizeof(capture_segment_hdr_t));
+    memcpy(hdr->magic, CAPTURE_SEGMENT_MAGIC, sizeof(hdr->magic));
+    hdr->version = CAPTURE_SEGMENT_VERSION;
+    hdr->header_size = sizeof(capture_segment_hdr_t);
+    hdr->record_size = sizeof(capture_record_t);
+    hdr->segment_index = rec->segment_index;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    hdr->realtime_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    hdr->monotonic_ns = gs_monotonic_ns();
+
+    struct iovec iov[1] = {{hdr, sizeof(capture_segment_hdr_t)}};
+    if (writev_all(rec->fd, iov, 1) < 0)
+    {
+        erprintlf(errno);
+        close(rec->fd);
+        rec->fd = -1;
+        return -1;
+    }
+
+    dbprintlf(GREEN_FG "Recording to %s.", path);
+    rec->segment_index++;
+    rec->segment_bytes = sizeof(capture_segment_hdr_t);
+    return 1;
+}
+
+// Writes a batch of frames to the current segment in one writev(...), then releases them.
+static void flush_batch(gs_recorder_t *rec, PoolBuffer *batch, uint32_t count)
+{
+    capture_record_t records[RECORDER_BATCH_MAX];
+    struct iovec iov[RECORDER_BATCH_MAX * 2];
+    uint64_t batch_bytes = 0;
+
+    // The radio configuration only changes on operator command; one snapshot per batch is close enough.
+    capture_radio_t radio[CHAINS_MAX];
+    pthread_mutex_lock(&rec->radio_lock);
+    memcpy(radio, rec->radio, sizeof(radio));
+    pthread_mutex_unlock(&rec->radio_lock);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        records[i].sync = CAPTURE_RECORD_SYNC;
+        records[i].length = batch[i]->size;
+        records[i].timestamp = batch[i]->timestamp;
+        records[i].seq = rec->seq++;
+        records[i].radio = radio[batch[i]->chain < CHAINS_MAX ? batch[i]->chain : 0];
+
+        iov[2 * i].iov_base = &records[i];
+        iov[2 * i].iov_len = sizeof(capture_record_t);
+        iov[2 * i + 1].iov_base = batch[i]->data;
+        iov[2 * i + 1].iov_len = batch[i]->size;
+        batch_bytes += sizeof(capture_record_t) + batch[i]->size;
+    }
+
+    if (rec->fd >= 0 && rec->segment_bytes + batch_bytes > rec->segment_size)
+    {
+        close_segment(rec);
+    }
+
+    if (rec->fd < 0 && open_segment(rec) < 0)
+    {
+        rec->write_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (writev_all(rec->fd, iov, count * 2) < 0)
+    {
+        dbprintlf(RED_FG "Failed to write %u records to capture segment.", count);
+        erprintlf(errno);
+        rec->write_errors.fetch_add(1, std::memory_order_relaxed);
+        // Start a fresh segment next time rather than appending after a partial record.
+        close_segment(rec);
+    }
+    else
+    {
+        rec->segment_bytes += batch_bytes;
+        rec->records.fetch_add(count, std::memory_order_relaxed);
+
+        uint64_t now = gs_monotonic_ns();
+        if (rec->fsync == FSYNC_BATCH || (rec->fsync == FSYNC_INTERVAL && now - rec->last_fsync >= (uint64_t)rec->fsync_interval_ms * 1000000ULL))
+        {
+            fdatasync(rec->fd);
+            rec->last_fsync = now;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        batch[i].reset();
+    }
+}
+
+void *gs_recorder_thread(void *args)
+{
+    global_data_t *global = (global_data_t *)args;
+    gs_recorder_t *rec = global->recorder;
+
+    PoolBuffer batch[RECORDER_BATCH_MAX];
+    uint32_t count = 0;
+    uint64_t batch_start = 0;
+
+    gs_sched_apply(global->config->sched_recorder_cpu, global->config->sched_recorder_priority, "recorder");
+
+    while (global->thread_status.load(std::memory_order_acquire) > 0)
+    {
+        int timeout_ms = 1000;
+        if (count > 0)
+        {
+            uint64_t waited_ms = (gs_monotonic_ns() - batch_start) / 1000000ULL;
+            timeout_ms = waited_ms >= rec->batch_ms ? 0 : rec->batch_ms - waited_ms;
+        }
+
+        PoolBuffer frame = frame_ring_pop(rec->ring, timeout_ms);
+        bool timed_out = !frame.valid();
+        if (!timed_out)
+        {
+            if (count == 0)
+            {
+                batch_start = gs_monotonic_ns();
+            }
+            batch[count++] = std::move(frame);
+        }
+
+        if (count > 0 && (count >= rec->batch_frames || timed_out || (gs_monotonic_ns() - batch_start) / 1000000ULL >= rec->batch_ms))
+        {
+            flush_batch(rec, batch, count);
+            count = 0;
+        }
+    }
+
+    if (count > 0)
+    {
+        flush_batch(rec, batch, count);
+    }
+    if (rec->fd >= 0 && rec->fsync != FSYNC_NONE)
+    {
+        fdatasync(rec->fd);
+    }
+
+    return NULL;
+}
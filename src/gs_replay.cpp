@@ -0,0 +1,372 @@
+/**
+ * @file gs_replay.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Replays captured frames into the receive chains in place of the capture stages, for regression and load
+ * testing.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gs_replay.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+// One mapped file, walked frame by frame.
+typedef struct
+{
+    const uint8_t *base;
+    size_t size;
+    size_t offset;
+    bool segment;       // A capture segment; otherwise the whole file is one frame.
+    uint16_t record_size;
+} replay_cursor_t;
+
+// Where the replay is up to across files and passes.
+typedef struct
+{
+    uint64_t start;     // CLOCK_MONOTONIC of the first release.
+    uint64_t elapsed;   // Capture time since the first frame, gaps cut down to max_gap_ms.
+    uint64_t last_time; // Capture time of the previous frame.
+    bool have_last;
+    uint64_t last_due;  // Release time of the previous frame.
+    uint32_t in_burst;  // Frames released since the start of the burst.
+    uint32_t rng;
+} replay_clock_t;
+
+static int compare_versions(const void *a, const void *b)
+{
+    return strverscmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// xorshift32, so that a seed repeats a run's jitter.
+static uint32_t next_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+int gs_replay_init(gs_replay_t *replay, const char *pattern, double speed, uint32_t rate_fps, uint32_t max_gap_ms, uint32_t jitter_us, uint32_t burst_frames, uint32_t loops, uint32_t seed)
+{
+    replay->enabled = false;
+    memset(&replay->files, 0x0, sizeof(glob_t));
+    replay->speed = speed > 0 ? speed : 0;
+    replay->rate_fps = rate_fps > 0 ? rate_fps : REPLAY_RATE_FPS_DEFAULT;
+    replay->max_gap_ms = max_gap_ms;
+    replay->jitter_us = jitter_us;
+    replay->burst_frames = burst_frames;
+    replay->loops = loops;
+    replay->seed = seed != 0 ? seed : 1;
+    replay->frames.store(0, std::memory_order_relaxed);
+    replay->bytes.store(0, std::memory_order_relaxed);
+    replay->dropped.store(0, std::memory_order_relaxed);
+    replay->skipped.store(0, std::memory_order_relaxed);
+    replay->worst_late_us.store(0, std::memory_order_relaxed);
+    replay->done.store(false, std::memory_order_relaxed);
+
+    if (pattern == NULL || pattern[0] == '\0')
+    {
+        return 1;
+    }
+
+    if (glob(pattern, 0, NULL, &replay->files) != 0 || replay->files.gl_pathc == 0)
+    {
+        globfree(&replay->files);
+        memset(&replay->files, 0x0, sizeof(glob_t));
+        return -1;
+    }
+    qsort(replay->files.gl_pathv, replay->files.gl_pathc, sizeof(char *), compare_versions);
+
+    replay->enabled = true;
+    return 1;
+}
+
+void gs_replay_destroy(gs_replay_t *replay)
+{
+    if (replay->enabled)
+    {
+        globfree(&replay->files);
+        replay->enabled = false;
+    }
+}
+
+static void cursor_close(replay_cursor_t *cursor)
+{
+    if (cursor->base != NULL)
+    {
+        munmap((void *)cursor->base, cursor->size);
+        cursor->base = NULL;
+    }
+}
+
+// Maps a file and works out its kind. Returns 1 on success, negative if it cannot be read or is empty.
+static int cursor_open(replay_cursor_t *cursor, const char *path)
+{
+    memset(cursor, 0x0, sizeof(replay_cursor_t));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        dbprintlf(RED_FG "Cannot open %s to replay (%s).", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        dbprintlf(RED_FG "Cannot map %s to replay (%s).", path, strerror(errno));
+        return -1;
+    }
+    madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+    cursor->base = (const uint8_t *)base;
+    cursor->size = st.st_size;
+
+    capture_segment_hdr_t hdr[1];
+    if (cursor->size >= sizeof(capture_segment_hdr_t))
+    {
+        memcpy(hdr, cursor->base, sizeof(capture_segment_hdr_t));
+        if (memcmp(hdr->magic, CAPTURE_SEGMENT_MAGIC, sizeof(hdr->magic)) == 0 && hdr->header_size >= sizeof(capture_segment_hdr_t) && hdr->record_size >= sizeof(capture_record_t))
+        {
+            if (hdr->header_size > cursor->size)
+            {
+                dbprintlf(RED_FG "Capture segment %s is shorter than its header, not replayed.", path);
+                cursor_close(cursor);
+                return -1;
+            }
+            // Later versions may add to the headers; their sizes are given, so they are skipped.
+            cursor->segment = true;
+            cursor->record_size = hdr->record_size;
+            cursor->offset = hdr->header_size;
+        }
+    }
+    return 1;
+}
+
+// The next frame of the file. Returns 1 if there is one, 0 at the end of the file.
+static int cursor_next(gs_replay_t *replay, replay_cursor_t *cursor, const uint8_t **payload, uint32_t *length, capture_record_t *record)
+{
+    if (!cursor->segment)
+    {
+        if (cursor->offset > 0)
+        {
+            return 0;
+        }
+        cursor->offset = cursor->size;
+        *payload = cursor->base;
+        *length = cursor->size;
+        memset(record, 0x0, sizeof(capture_record_t));
+        return 1;
+    }
+
+    uint64_t skipped = 0;
+    while (cursor->offset <= cursor->size && cursor->size - cursor->offset >= cursor->record_size)
+    {
+        memcpy(record, cursor->base + cursor->offset, sizeof(capture_record_t));
+        if (record->sync != CAPTURE_RECORD_SYNC)
+        {
+            // A damaged record: look for the next one a byte further on.
+            cursor->offset++;
+            skipped++;
+            continue;
+        }
+        if (record->length > cursor->size - cursor->offset - cursor->record_size)
+        {
+            // Cut short, as the last record of a recording that was not closed may be.
+            break;
+        }
+
+        *payload = cursor->base + cursor->offset + cursor->record_size;
+        *length = record->length;
+        cursor->offset += cursor->record_size + record->length;
+        if (skipped > 0)
+        {
+            replay->skipped.fetch_add(skipped, std::memory_order_relaxed);
+        }
+        return 1;
+    }
+
+    if (cursor->offset < cursor->size)
+    {
+        skipped += cursor->size - cursor->offset;
+    }
+    replay->skipped.fetch_add(skipped, std::memory_order_relaxed);
+    cursor->offset = cursor->size;
+    return 0;
+}
+
+// When the frame captured at 'captured' (ns, on the capture's clock) is to be released. 0 for now.
+static uint64_t release_time(gs_replay_t *replay, replay_clock_t *clock, uint64_t captured)
+{
+    if (clock->have_last)
+    {
+        uint64_t gap = captured > clock->last_time ? captured - clock->last_time : 0;
+        uint64_t max_gap = (uint64_t)replay->max_gap_ms * 1000000ULL;
+        clock->elapsed += gap < max_gap ? gap : max_gap;
+    }
+    clock->last_time = captured;
+    clock->have_last = true;
+
+    // Only the first frame of a burst waits; the rest follow it back to back.
+    bool bursting = replay->burst_frames > 1 && clock->in_burst++ % replay->burst_frames != 0;
+    if (replay->speed <= 0 || bursting)
+    {
+        return 0;
+    }
+
+    uint64_t due = clock->start + (uint64_t)(clock->elapsed / replay->speed);
+    if (replay->jitter_us > 0)
+    {
+        int64_t jitter = (int64_t)(next_random(&clock->rng) % (2 * replay->jitter_us + 1)) - (int64_t)replay->jitter_us;
+        due = jitter < 0 && (uint64_t)-jitter * 1000 > due ? 0 : due + jitter * 1000;
+    }
+    due = due > clock->last_due ? due : clock->last_due;
+    clock->last_due = due;
+    return due;
+}
+
+// Sleeps until 'due' (CLOCK_MONOTONIC), in pieces so that a stop is noticed. Returns false if haystack is stopping.
+static bool wait_until(global_data_t *global, uint64_t due)
+{
+    while (global->thread_status.load(std::memory_order_acquire) > 0)
+    {
+        uint64_t now = gs_monotonic_ns();
+        if (now >= due)
+        {
+            return true;
+        }
+        uint64_t until = due - now > REPLAY_IDLE_MS * 1000000ULL ? now + REPLAY_IDLE_MS * 1000000ULL : due;
+        struct timespec at;
+        at.tv_sec = until / 1000000000ULL;
+        at.tv_nsec = until % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+    }
+    return false;
+}
+
+// Hands one frame to its chain, as the capture stage does with one it received.
+static void inject(global_data_t *global, gs_chain_t *chain, rx_snapshot_t *stats, const uint8_t *payload, uint32_t length)
+{
+    gs_replay_t *replay = global->replay;
+    uint64_t now = gs_monotonic_ns();
+
+    stats->frames++;
+    stats->bytes += length;
+    stats->last_frame_ns = now;
+    gs_seqlock_write(chain->rx_stats, stats);
+
+    PoolBuffer frame = length <= global->config->rx_mtu ? buffer_pool_acquire(global->pool) : PoolBuffer();
+    if (!frame.valid())
+    {
+        replay->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    memcpy(frame->data, payload, length);
+    frame->size = length;
+    frame->timestamp = now;
+    frame->chain = chain->id;
+
+    frame_ring_commit(chain->rx_ring, frame);
+    replay->frames.fetch_add(1, std::memory_order_relaxed);
+    replay->bytes.fetch_add(length, std::memory_order_relaxed);
+}
+
+void *gs_replay_thread(void *args)
+{
+    global_data_t *global = (global_data_t *)args;
+    gs_replay_t *replay = global->replay;
+
+    // The capture stages are not running; this thread publishes their counters instead.
+    rx_snapshot_t stats[CHAINS_MAX];
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        gs_seqlock_read(global->chains[i].rx_stats, &stats[i]);
+    }
+
+    replay_clock_t clock[1];
+    memset(clock, 0x0, sizeof(replay_clock_t));
+    clock->start = gs_monotonic_ns();
+    clock->rng = replay->seed;
+
+    // Files that carry no time are given one, rate_fps apart, continuing from the frame before.
+    uint64_t untimed_step = 1000000000ULL / replay->rate_fps;
+
+    uint64_t started = clock->start;
+    bool running = true;
+    for (uint32_t pass = 0; running && (replay->loops == 0 || pass < replay->loops); pass++)
+    {
+        uint64_t released = 0;
+        for (size_t i = 0; running && i < replay->files.gl_pathc; i++)
+        {
+            replay_cursor_t cursor[1];
+            if (cursor_open(cursor, replay->files.gl_pathv[i]) < 0)
+            {
+                continue;
+            }
+
+            const uint8_t *payload = NULL;
+            uint32_t length = 0;
+            capture_record_t record[1];
+            while (running && cursor_next(replay, cursor, &payload, &length, record) > 0)
+            {
+                uint64_t captured = cursor->segment ? record->timestamp : clock->last_time + (clock->have_last ? untimed_step : 0);
+                uint64_t due = release_time(replay, clock, captured);
+                running = due > 0 ? wait_until(global, due) : global->thread_status.load(std::memory_order_acquire) > 0;
+                if (running)
+                {
+                    if (due > 0)
+                    {
+                        uint64_t late_us = (gs_monotonic_ns() - due) / 1000;
+                        late_us = late_us < UINT32_MAX ? late_us : UINT32_MAX;
+                        if (late_us > replay->worst_late_us.load(std::memory_order_relaxed))
+                        {
+                            replay->worst_late_us.store((uint32_t)late_us, std::memory_order_relaxed);
+                        }
+                    }
+                    uint8_t id = cursor->segment ? record->radio.chain % global->chain_count : 0;
+                    inject(global, &global->chains[id], &stats[id], payload, length);
+                    released++;
+                }
+            }
+            cursor_close(cursor);
+        }
+
+        // Every file is empty or gone, so another pass would release nothing either.
+        if (running && released == 0)
+        {
+            dbprintlf(RED_FG "Replay pass %u released no frames; ending the replay.", pass + 1);
+            break;
+        }
+    }
+
+    replay->done.store(true, std::memory_order_release);
+    double seconds = (gs_monotonic_ns() - started) / 1e9;
+    uint64_t frames = replay->frames.load(std::memory_order_relaxed);
+    dbprintlf(GREEN_FG "Replay %s: %lu frames (%lu MB) in %.3f s, %.0f frames/s; %lu dropped, %lu bytes skipped, worst %u us late.",
+              running ? "finished" : "stopped", (unsigned long)frames, (unsigned long)(replay->bytes.load(std::memory_order_relaxed) >> 20), seconds,
+              seconds > 0 ? frames / seconds : 0.0, (unsigned long)replay->dropped.load(std::memory_order_relaxed),
+              (unsigned long)replay->skipped.load(std::memory_order_relaxed), replay->worst_late_us.load(std::memory_order_relaxed));
+    return NULL;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file gs_rxdma.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Keeps pool buffers posted to a chain's modem, so that its DMA engine is never waiting on the capture stage.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdint.h>
+#include "gs_rxdma.hpp"
+#include "meb_debug.hpp"
+
+int gs_rxdma_init(gs_rxdma_t *dma, rxmodem *modem, buffer_pool_t *pool, uint8_t *drain, uint32_t mtu, uint32_t depth)
+{
+    if (modem == NULL || pool == NULL || drain == NULL)
+    {
+        return -1;
+    }
+
+    dma->modem = modem;
+    dma->pool = pool;
+    dma->drain = drain;
+    dma->mtu = mtu;
+    dma->depth = depth > RXMODEM_QUEUE_MAX ? RXMODEM_QUEUE_MAX : depth;
+    dma->probed = false;
+    dma->posted = 0;
+    for (int i = 0; i < RXMODEM_QUEUE_MAX; i++)
+    {
+        dma->busy[i] = false;
+        dma->frames[i] = POOL_INDEX_NONE;
+    }
+    dma->active_depth.store(0, std::memory_order_relaxed);
+    dma->starved.store(0, std::memory_order_relaxed);
+
+    return 1;
+}
+
+// Posts a fresh buffer in a free slot. Returns 1 on success, negative on failure.
+static int rxdma_post(gs_rxdma_t *dma, uint32_t slot)
+{
+    PoolBuffer frame = buffer_pool_acquire(dma->pool);
+    uint8_t *buf = dma->drain;
+    uint32_t capacity = dma->mtu;
+    if (frame.valid())
+    {
+        buf = frame->data;
+        capacity = frame->capacity;
+    }
+    else
+    {
+        // Counted in pool_exhausted too; logging every one would only slow the capture stage further.
+        dma->starved.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (rxmodem_submit(dma->modem, buf, capacity, (void *)(uintptr_t)(slot + 1)) < 0)
+    {
+        return -1;
+    }
+
+    // Held by index until the modem hands it back.
+    dma->frames[slot] = frame.valid() ? frame.detach() : POOL_INDEX_NONE;
+    dma->busy[slot] = true;
+    dma->posted++;
+    return 1;
+}
+
+bool gs_rxdma_fill(gs_rxdma_t *dma)
+{
+    // The modem is initialized by the time the chain is armed.
+    if (!dma->probed)
+    {
+        dma->probed = true;
+        int queue = rxmodem_queue_depth(dma->modem);
+        if (dma->depth < 2)
+        {
+            dma->depth = 0;
+        }
+        else if (queue < 2)
+        {
+            dbprintlf(YELLOW_FG "The modem has no DMA descriptor queue; receiving one frame at a time.");
+            dma->depth = 0;
+        }
+        else if (dma->depth > (uint32_t)queue)
+        {
+            dbprintlf(YELLOW_FG "The modem keeps at most %d DMA transfers in flight, not %u.", queue, dma->depth);
+            dma->depth = queue;
+        }
+        dma->active_depth.store(dma->depth, std::memory_order_relaxed);
+    }
+
+    for (uint32_t slot = 0; slot < dma->depth && dma->posted < dma->depth; slot++)
+    {
+        if (!dma->busy[slot] && rxdma_post(dma, slot) < 0)
+        {
+            dbprintlf(RED_FG "Could not post a receive buffer to the modem.");
+            break;
+        }
+    }
+
+    // Nothing posted means nothing to wait for: receive this frame blocking instead.
+    return dma->posted > 0;
+}
+
+bool gs_rxdma_next(gs_rxdma_t *dma, PoolBuffer &frame, ssize_t *frame_size, ssize_t *read_size)
+{
+    void *tag = NULL;
+    *read_size = rxmodem_complete(dma->modem, &tag, frame_size);
+    if (tag == NULL)
+    {
+        return false;
+    }
+
+    uint32_t slot = (uint32_t)((uintptr_t)tag - 1);
+    frame = dma->frames[slot] != POOL_INDEX_NONE ? PoolBuffer(dma->pool, dma->frames[slot]) : PoolBuffer();
+    dma->frames[slot] = POOL_INDEX_NONE;
+    dma->busy[slot] = false;
+    dma->posted--;
+
+    // Keep the engine fed before the frame is handed on.
+    if (rxdma_post(dma, slot) < 0)
+    {
+        dbprintlf(RED_FG "Could not post a receive buffer to the modem.");
+    }
+    return true;
+}
+
+void gs_rxdma_release(gs_rxdma_t *dma)
+{
+    if (dma->posted == 0)
+    {
+        return;
+    }
+
+    void *tags[RXMODEM_QUEUE_MAX];
+    if (rxmodem_cancel(dma->modem, tags, RXMODEM_QUEUE_MAX) < 0)
+    {
+        dbprintlf(RED_FG "Could not take the receive buffers back from the modem.");
+    }
+
+    for (int i = 0; i < RXMODEM_QUEUE_MAX; i++)
+    {
+        if (dma->frames[i] != POOL_INDEX_NONE)
+        {
+            PoolBuffer(dma->pool, dma->frames[i]).reset();
+            dma->frames[i] = POOL_INDEX_NONE;
+        }
+        dma->busy[i] = false;
+    }
+    dma->posted = 0;
+}
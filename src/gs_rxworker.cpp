@@ -0,0 +1,177 @@
+/**
+ * @file gs_rxworker.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Arm/disarm state machine for the persistent X-Band capture thread.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <time.h>
+#include <errno.h>
+#include "gs_rxworker.hpp"
+#include "gs_haystack.hpp"
+
+static uint32_t elapsed_us(uint64_t since)
+{
+    uint64_t us = (gs_monotonic_ns() - since) / 1000;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+// Sets a new state and wakes everyone waiting on it. Returns false if the state was not 'from'.
+static bool transition(gs_rxworker_t *worker, int from, int to)
+{
+    pthread_mutex_lock(&worker->lock);
+    bool moved = worker->state.compare_exchange_strong(from, to, std::memory_order_acq_rel);
+    if (moved)
+    {
+        pthread_cond_broadcast(&worker->changed);
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return moved;
+}
+
+int gs_rxworker_init(gs_rxworker_t *worker)
+{
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0)
+    {
+        return -1;
+    }
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    if (pthread_mutex_init(&worker->lock, NULL) != 0)
+    {
+        pthread_condattr_destroy(&attr);
+        return -1;
+    }
+    if (pthread_cond_init(&worker->changed, &attr) != 0)
+    {
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_destroy(&worker->lock);
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+
+    worker->state.store(RX_IDLE, std::memory_order_relaxed);
+    worker->requested_at.store(0, std::memory_order_relaxed);
+    worker->arms.store(0, std::memory_order_relaxed);
+    worker->disarms.store(0, std::memory_order_relaxed);
+    worker->arm_us.store(0, std::memory_order_relaxed);
+    worker->disarm_us.store(0, std::memory_order_relaxed);
+    worker->slow_disarms.store(0, std::memory_order_relaxed);
+    return 1;
+}
+
+void gs_rxworker_destroy(gs_rxworker_t *worker)
+{
+    pthread_cond_destroy(&worker->changed);
+    pthread_mutex_destroy(&worker->lock);
+}
+
+int gs_rxworker_arm(gs_rxworker_t *worker)
+{
+    worker->requested_at.store(gs_monotonic_ns(), std::memory_order_relaxed);
+
+    if (transition(worker, RX_IDLE, RX_ARMED) || transition(worker, RX_DRAINING, RX_ARMED))
+    {
+        worker->arms.fetch_add(1, std::memory_order_relaxed);
+        return 1;
+    }
+    return worker->state.load(std::memory_order_acquire) == RX_STOPPED ? -1 : 0;
+}
+
+int gs_rxworker_drain(gs_rxworker_t *worker)
+{
+    worker->requested_at.store(gs_monotonic_ns(), std::memory_order_relaxed);
+
+    if (!transition(worker, RX_ARMED, RX_DRAINING))
+    {
+        return -1;
+    }
+    worker->disarms.fetch_add(1, std::memory_order_relaxed);
+    return 1;
+}
+
+int gs_rxworker_disarm(gs_rxworker_t *worker, uint32_t timeout_ms)
+{
+    if (gs_rxworker_drain(worker) < 0)
+    {
+        return -1;
+    }
+    return gs_rxworker_wait_idle(worker, timeout_ms);
+}
+
+int gs_rxworker_wait_idle(gs_rxworker_t *worker, uint32_t timeout_ms)
+{
+    uint64_t deadline = gs_monotonic_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    struct timespec ts = {(time_t)(deadline / 1000000000ULL), (long)(deadline % 1000000000ULL)};
+
+    pthread_mutex_lock(&worker->lock);
+    while (worker->state.load(std::memory_order_acquire) == RX_DRAINING)
+    {
+        if (pthread_cond_timedwait(&worker->changed, &worker->lock, &ts) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+    bool idle = worker->state.load(std::memory_order_acquire) != RX_DRAINING;
+    pthread_mutex_unlock(&worker->lock);
+
+    if (!idle)
+    {
+        worker->slow_disarms.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    return 1;
+}
+
+void gs_rxworker_stop(gs_rxworker_t *worker)
+{
+    pthread_mutex_lock(&worker->lock);
+    worker->state.store(RX_STOPPED, std::memory_order_release);
+    pthread_cond_broadcast(&worker->changed);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+rx_state gs_rxworker_wait(gs_rxworker_t *worker)
+{
+    bool was_idle = false;
+
+    for (;;)
+    {
+        // The per-frame cost while armed: one load. A disarm undone by an arm before the worker saw it never stops it.
+        int state = worker->state.load(std::memory_order_acquire);
+        if (state == RX_ARMED)
+        {
+            if (was_idle)
+            {
+                worker->arm_us.store(elapsed_us(worker->requested_at.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+            }
+            return RX_ARMED;
+        }
+        else if (state == RX_STOPPED)
+        {
+            return RX_STOPPED;
+        }
+        else if (state == RX_DRAINING)
+        {
+            if (transition(worker, RX_DRAINING, RX_IDLE))
+            {
+                worker->disarm_us.store(elapsed_us(worker->requested_at.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+                was_idle = true;
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&worker->lock);
+        while (worker->state.load(std::memory_order_acquire) == RX_IDLE)
+        {
+            pthread_cond_wait(&worker->changed, &worker->lock);
+        }
+        pthread_mutex_unlock(&worker->lock);
+        was_idle = true;
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file gs_sched.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Real-time scheduling, core affinity and memory locking for haystack's threads, and capture deadline accounting.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "gs_sched.hpp"
+#include "meb_debug.hpp"
+
+int gs_sched_apply(int cpu, int priority, const char *name)
+{
+    int retval = 1;
+
+    if (cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0)
+        {
+            dbprintlf(YELLOW_FG "Could not pin the %s to core %d (%s).", name, cpu, strerror(err));
+            retval = -1;
+        }
+        else
+        {
+            dbprintlf(BLUE_FG "Pinned the %s to core %d.", name, cpu);
+        }
+    }
+
+    if (priority > 0)
+    {
+        struct sched_param param;
+        memset(&param, 0x0, sizeof(param));
+        int max = sched_get_priority_max(SCHED_FIFO);
+        param.sched_priority = priority > max ? max : priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0)
+        {
+            dbprintlf(YELLOW_FG "Could not run the %s under SCHED_FIFO at priority %d (%s).", name, param.sched_priority, strerror(err));
+            retval = -1;
+        }
+        else
+        {
+            dbprintlf(BLUE_FG "Running the %s under SCHED_FIFO at priority %d.", name, param.sched_priority);
+        }
+    }
+
+    return retval;
+}
+
+void gs_sched_prefault(void *base, size_t size)
+{
+    if (base == NULL)
+    {
+        return;
+    }
+
+    // Writing a byte back to itself faults the page in without changing what it holds.
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    volatile uint8_t *bytes = (volatile uint8_t *)base;
+    for (size_t offset = 0; offset < size; offset += page)
+    {
+        bytes[offset] = bytes[offset];
+    }
+    if (size > 0)
+    {
+        bytes[size - 1] = bytes[size - 1];
+    }
+}
+
+int gs_sched_lock(const void *base, size_t size, const char *name)
+{
+    if (base == NULL || size == 0)
+    {
+        return 1;
+    }
+
+    if (mlock(base, size) < 0)
+    {
+        dbprintlf(YELLOW_FG "Could not lock the %s in memory (%s); page faults may delay the capture stage.", name, strerror(errno));
+        return -1;
+    }
+    return 1;
+}
+
+void gs_deadline_init(gs_deadline_t *deadline, uint32_t budget_us)
+{
+    deadline->budget_ns = (uint64_t)budget_us * 1000ULL;
+    deadline->logged_at = 0;
+    deadline->missed.store(0, std::memory_order_relaxed);
+    deadline->worst_us.store(0, std::memory_order_relaxed);
+}
+
+void gs_deadline_missed(gs_deadline_t *deadline, uint8_t chain, uint64_t turnaround_ns, uint64_t now)
+{
+    uint32_t missed = deadline->missed.load(std::memory_order_relaxed) + 1;
+    deadline->missed.store(missed, std::memory_order_relaxed);
+
+    if (now - deadline->logged_at >= SCHED_DEADLINE_LOG_MS * 1000000ULL)
+    {
+        deadline->logged_at = now;
+        dbprintlf(YELLOW_FG "Capture stage of chain %u took %lu us to turn around, over its %lu us deadline (%u missed).",
+                  chain, (unsigned long)(turnaround_ns / 1000), (unsigned long)(deadline->budget_ns / 1000), missed);
+    }
+}
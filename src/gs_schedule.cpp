@@ -0,0 +1,312 @@
+/**
+ * @file gs_schedule.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Time-tagged LO and RX gain schedules, e.g. Doppler tracking over a pass, applied to the radios on time.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "gs_schedule.hpp"
+#include "gs_haystack.hpp"
+#include "meb_debug.hpp"
+
+static int64_t realtime_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static struct timespec to_timespec(int64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    return ts;
+}
+
+int gs_schedule_init(gs_schedule_t *sched, uint32_t chain_count, uint32_t capacity)
+{
+    sched->chain_count = chain_count;
+    pthread_mutex_init(&sched->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sched->changed, &attr);
+    pthread_condattr_destroy(&attr);
+
+    for (uint32_t i = 0; i < CHAINS_MAX; i++)
+    {
+        gs_schedule_table_t *table = &sched->tables[i];
+        table->entries = NULL;
+        table->capacity = 0;
+        table->count = 0;
+        table->next = 0;
+        table->gen = 0;
+        table->lead_ns = 0;
+        table->pending.store(0, std::memory_order_relaxed);
+        table->applied.store(0, std::memory_order_relaxed);
+        table->skipped.store(0, std::memory_order_relaxed);
+        table->failed.store(0, std::memory_order_relaxed);
+        table->last_error_us.store(0, std::memory_order_relaxed);
+        table->worst_error_us.store(0, std::memory_order_relaxed);
+    }
+
+    for (uint32_t i = 0; i < chain_count; i++)
+    {
+        gs_schedule_table_t *table = &sched->tables[i];
+        table->entries = (schedule_entry_t *)calloc(capacity, sizeof(schedule_entry_t));
+        if (table->entries == NULL)
+        {
+            gs_schedule_destroy(sched);
+            return -1;
+        }
+        table->capacity = capacity;
+    }
+
+    return 1;
+}
+
+void gs_schedule_destroy(gs_schedule_t *sched)
+{
+    for (uint32_t i = 0; i < CHAINS_MAX; i++)
+    {
+        free(sched->tables[i].entries);
+        sched->tables[i].entries = NULL;
+        sched->tables[i].capacity = 0;
+    }
+    pthread_cond_destroy(&sched->changed);
+    pthread_mutex_destroy(&sched->lock);
+}
+
+int gs_schedule_load(gs_schedule_t *sched, uint8_t chain, int64_t epoch_ns, const xband_schedule_entry_t *entries, uint32_t count, bool append)
+{
+    if (chain >= sched->chain_count || epoch_ns <= 0)
+    {
+        return -1;
+    }
+    gs_schedule_table_t *table = &sched->tables[chain];
+
+    pthread_mutex_lock(&sched->lock);
+    uint32_t base = append ? table->count : 0;
+    if ((uint64_t)base + count > table->capacity)
+    {
+        pthread_mutex_unlock(&sched->lock);
+        return -3;
+    }
+
+    // Checked in full before the table is touched.
+    int64_t prev = base > 0 ? table->entries[base - 1].at_ns : INT64_MIN;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        xband_schedule_entry_t entry;
+        memcpy(&entry, &entries[i], sizeof(entry));
+        int64_t at = epoch_ns + (int64_t)entry.offset_us * 1000;
+        if (entry.LO < 0)
+        {
+            pthread_mutex_unlock(&sched->lock);
+            return -1;
+        }
+        if (at <= prev)
+        {
+            pthread_mutex_unlock(&sched->lock);
+            return -2;
+        }
+        prev = at;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        xband_schedule_entry_t entry;
+        memcpy(&entry, &entries[i], sizeof(entry));
+        schedule_entry_t *e = &table->entries[base + i];
+        e->at_ns = epoch_ns + (int64_t)entry.offset_us * 1000;
+        e->LO = entry.LO;
+        e->gain_cdb = entry.gain_cdb;
+    }
+    table->count = base + count;
+    if (!append)
+    {
+        table->next = 0;
+    }
+    table->gen++;
+    table->pending.store(table->count - table->next, std::memory_order_relaxed);
+    pthread_cond_signal(&sched->changed);
+    pthread_mutex_unlock(&sched->lock);
+
+    return 1;
+}
+
+void gs_schedule_clear(gs_schedule_t *sched, uint8_t chain)
+{
+    if (chain >= sched->chain_count)
+    {
+        return;
+    }
+    gs_schedule_table_t *table = &sched->tables[chain];
+
+    pthread_mutex_lock(&sched->lock);
+    table->count = 0;
+    table->next = 0;
+    table->gen++;
+    table->pending.store(0, std::memory_order_relaxed);
+    pthread_cond_signal(&sched->changed);
+    pthread_mutex_unlock(&sched->lock);
+}
+
+// Waits on the condition variable for up to 'ns', and no longer than SCHEDULE_IDLE_MS. Called with the lock held.
+static void schedule_wait(gs_schedule_t *sched, int64_t ns)
+{
+    if (ns > SCHEDULE_IDLE_MS * 1000000LL)
+    {
+        ns = SCHEDULE_IDLE_MS * 1000000LL;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    int64_t at = (int64_t)deadline.tv_sec * 1000000000LL + deadline.tv_nsec + ns;
+    deadline = to_timespec(at);
+    pthread_cond_timedwait(&sched->changed, &sched->lock, &deadline);
+}
+
+// Reports a retune's timing error against its entry's time.
+static void schedule_error(gs_schedule_table_t *table, int64_t error_ns)
+{
+    int64_t us = error_ns / 1000;
+    us = us > INT32_MAX ? INT32_MAX : us < -INT32_MAX ? -INT32_MAX : us;
+    uint32_t magnitude = (uint32_t)(us < 0 ? -us : us);
+    table->last_error_us.store((int32_t)us, std::memory_order_relaxed);
+    if (magnitude > table->worst_error_us.load(std::memory_order_relaxed))
+    {
+        table->worst_error_us.store(magnitude, std::memory_order_relaxed);
+    }
+    gs_metrics_record(METRIC_SCHEDULE_ERROR_NS, (uint64_t)(error_ns < 0 ? -error_ns : error_ns));
+}
+
+void *gs_schedule_thread(void *args)
+{
+    global_data_t *global = (global_data_t *)args;
+    gs_schedule_t *sched = global->schedule;
+
+    gs_sched_apply(global->config->sched_schedule_cpu, global->config->sched_schedule_priority, "schedule");
+    gs_metrics_register(global->metrics, "schedule");
+
+    uint64_t logged_at = 0;
+    pthread_mutex_lock(&sched->lock);
+    while (global->thread_status.load(std::memory_order_acquire) > -1)
+    {
+        // The chain whose next entry is to be started first.
+        gs_schedule_table_t *table = NULL;
+        uint32_t id = 0;
+        int64_t start = INT64_MAX;
+        for (uint32_t i = 0; i < sched->chain_count; i++)
+        {
+            gs_schedule_table_t *t = &sched->tables[i];
+            if (t->next < t->count && t->entries[t->next].at_ns - t->lead_ns < start)
+            {
+                table = t;
+                id = i;
+                start = t->entries[t->next].at_ns - t->lead_ns;
+            }
+        }
+
+        if (table == NULL)
+        {
+            schedule_wait(sched, INT64_MAX);
+            continue;
+        }
+        int64_t now = realtime_ns();
+        if (start - now > (int64_t)SCHEDULE_SLACK_NS)
+        {
+            schedule_wait(sched, start - now - SCHEDULE_SLACK_NS);
+            continue;
+        }
+
+        // The rest is slept out without the lock; a load or clear meanwhile makes the entry stale.
+        uint64_t gen = table->gen;
+        pthread_mutex_unlock(&sched->lock);
+        if (start > now)
+        {
+            struct timespec at = to_timespec(start);
+            while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &at, NULL) == EINTR)
+            {
+            }
+        }
+        pthread_mutex_lock(&sched->lock);
+        if (table->gen != gen)
+        {
+            continue;
+        }
+
+        // Entries whose successors are already due are merged into them rather than applied late one after another.
+        now = realtime_ns();
+        schedule_entry_t entry = table->entries[table->next++];
+        uint32_t skipped = 0;
+        while (table->next < table->count && table->entries[table->next].at_ns - table->lead_ns <= now)
+        {
+            const schedule_entry_t *later = &table->entries[table->next++];
+            entry.at_ns = later->at_ns;
+            entry.LO = later->LO != 0 ? later->LO : entry.LO;
+            entry.gain_cdb = later->gain_cdb != SCHEDULE_GAIN_KEEP ? later->gain_cdb : entry.gain_cdb;
+            skipped++;
+        }
+        table->pending.store(table->count - table->next, std::memory_order_relaxed);
+        pthread_mutex_unlock(&sched->lock);
+
+        if (skipped > 0)
+        {
+            table->skipped.fetch_add(skipped, std::memory_order_relaxed);
+            uint64_t mono = gs_monotonic_ns();
+            if (mono - logged_at >= SCHEDULE_LOG_MS * 1000000ULL)
+            {
+                logged_at = mono;
+                dbprintlf(YELLOW_FG "Schedule of chain %u fell behind; merged %u entries into the one due.", id, skipped);
+            }
+        }
+
+        gs_chain_t *chain = &global->chains[id];
+        double gain = entry.gain_cdb / 100.0;
+        phy_config_ack_t ack[1];
+        radiocfg_settings_t applied[1];
+        int retval = -4;
+        int64_t begin = realtime_ns();
+        if (chain->radio_ready.load(std::memory_order_acquire))
+        {
+            retval = gs_radiocfg_retune(chain->radio_config, entry.LO, entry.gain_cdb != SCHEDULE_GAIN_KEEP ? &gain : NULL, ack, applied);
+        }
+        int64_t end = realtime_ns();
+
+        if (retval < 0)
+        {
+            table->failed.fetch_add(1, std::memory_order_relaxed);
+            dbprintlf(RED_FG "Scheduled retune of chain %u failed (%d, setting 0x%02x).", id, retval, retval == -4 ? 0 : ack->failed);
+        }
+        else
+        {
+            table->applied.fetch_add(1, std::memory_order_relaxed);
+            schedule_error(table, end - entry.at_ns);
+            if (retval > 0)
+            {
+                gs_xband_config_applied(chain, applied);
+            }
+        }
+
+        pthread_mutex_lock(&sched->lock);
+        if (retval > 0)
+        {
+            // Only retunes that wrote something say how long the next one will take.
+            int64_t took = end - begin;
+            took = took > SCHEDULE_LEAD_MAX_NS ? SCHEDULE_LEAD_MAX_NS : took;
+            table->lead_ns = table->lead_ns == 0 ? took : table->lead_ns + (took - table->lead_ns) / SCHEDULE_LEAD_WEIGHT;
+        }
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return NULL;
+}
@@ -0,0 +1,339 @@
+/**
+ * @file gs_spool.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Outage spool: holds received frames while the server cannot take them, and gives them back in order.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gs_spool.hpp"
+#include "meb_debug.hpp"
+
+static uint64_t spool_align(uint64_t size)
+{
+    return (size + SPOOL_ALIGN - 1) & ~(uint64_t)(SPOOL_ALIGN - 1);
+}
+
+static void ring_setup(spool_ring_t *ring, uint8_t *base, uint64_t size, uint64_t *head, uint64_t *tail)
+{
+    ring->base = base;
+    ring->size = size & ~(uint64_t)(SPOOL_ALIGN - 1);
+    ring->head = head;
+    ring->tail = tail;
+}
+
+static uint64_t ring_used(const spool_ring_t *ring)
+{
+    return ring->size == 0 ? 0 : *ring->head - *ring->tail;
+}
+
+// Appends a record if it fits, placing a wrap marker instead of splitting it across the end of the ring.
+static bool ring_push(spool_ring_t *ring, const gs_seq_hdr_t *seq, const uint8_t *payload, uint32_t size)
+{
+    if (ring->size == 0)
+    {
+        return false;
+    }
+
+    spool_record_t record;
+    record.length = sizeof(gs_seq_hdr_t) + size;
+    uint64_t need = spool_align(sizeof(record) + record.length);
+
+    uint64_t head = *ring->head;
+    uint64_t pos = head % ring->size;
+    uint64_t skip = ring->size - pos < need ? ring->size - pos : 0;
+    if (skip + need > ring->size - ring_used(ring))
+    {
+        return false;
+    }
+
+    if (skip > 0)
+    {
+        spool_record_t wrap;
+        wrap.length = SPOOL_WRAP;
+        memcpy(ring->base + pos, &wrap, sizeof(wrap));
+        head += skip;
+        pos = 0;
+    }
+
+    uint8_t *out = ring->base + pos;
+    memcpy(out, &record, sizeof(record));
+    memcpy(out + sizeof(record), seq, sizeof(gs_seq_hdr_t));
+    memcpy(out + sizeof(record) + sizeof(gs_seq_hdr_t), payload, size);
+
+    // The record is complete before head says so, should haystack die between the two.
+    __atomic_store_n(ring->head, head + need, __ATOMIC_RELEASE);
+    return true;
+}
+
+// The record at the tail, skipping a wrap marker. Returns its length, 0 if the ring is empty.
+static uint32_t ring_peek(spool_ring_t *ring, const uint8_t **item)
+{
+    if (ring_used(ring) == 0)
+    {
+        return 0;
+    }
+
+    uint64_t pos = *ring->tail % ring->size;
+    spool_record_t record;
+    memcpy(&record, ring->base + pos, sizeof(record));
+    if (record.length == SPOOL_WRAP)
+    {
+        *ring->tail += ring->size - pos;
+        pos = 0;
+        memcpy(&record, ring->base, sizeof(record));
+    }
+
+    *item = ring->base + pos + sizeof(record);
+    return record.length;
+}
+
+static void ring_pop(spool_ring_t *ring, uint32_t length)
+{
+    __atomic_store_n(ring->tail, *ring->tail + spool_align(sizeof(spool_record_t) + length), __ATOMIC_RELEASE);
+}
+
+// Walks the records a previous run left in the spool file. Returns false if they do not add up.
+static bool ring_scan(spool_ring_t *ring, uint32_t *frames, uint64_t *bytes)
+{
+    uint64_t at = *ring->tail;
+    *frames = 0;
+    *bytes = 0;
+
+    while (at != *ring->head)
+    {
+        uint64_t pos = at % ring->size;
+        spool_record_t record;
+        memcpy(&record, ring->base + pos, sizeof(record));
+        if (record.length == SPOOL_WRAP)
+        {
+            at += ring->size - pos;
+            continue;
+        }
+
+        uint64_t need = spool_align(sizeof(record) + record.length);
+        if (record.length < sizeof(gs_seq_hdr_t) || pos + need > ring->size || at + need > *ring->head)
+        {
+            return false;
+        }
+        (*frames)++;
+        *bytes += record.length;
+        at += need;
+    }
+    return true;
+}
+
+// Maps the spool file, keeping what it holds if it was written with the same ring size.
+static int open_spool_file(gs_spool_t *spool, uint64_t ring_size, const char *directory)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", directory, SPOOL_FILE_NAME);
+
+    spool->disk_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (spool->disk_fd < 0)
+    {
+        dbprintlf(RED_FG "Failed to open spool file %s.", path);
+        erprintlf(errno);
+        return -1;
+    }
+
+    struct stat st;
+    bool fresh = fstat(spool->disk_fd, &st) < 0 || (uint64_t)st.st_size != SPOOL_FILE_HDR_SIZE + ring_size;
+    spool->disk_map_size = SPOOL_FILE_HDR_SIZE + ring_size;
+
+    // Reserve the blocks now: running out of disk under a mapping would be SIGBUS in the middle of an outage.
+    int err = posix_fallocate(spool->disk_fd, 0, spool->disk_map_size);
+    if (err != 0)
+    {
+        dbprintlf(RED_FG "Could not reserve %lu bytes for spool file %s.", (unsigned long)spool->disk_map_size, path);
+        erprintlf(err);
+        close(spool->disk_fd);
+        spool->disk_fd = -1;
+        return -1;
+    }
+
+    void *map = mmap(NULL, spool->disk_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, spool->disk_fd, 0);
+    if (map == MAP_FAILED)
+    {
+        dbprintlf(RED_FG "Failed to map spool file %s.", path);
+        erprintlf(errno);
+        close(spool->disk_fd);
+        spool->disk_fd = -1;
+        return -1;
+    }
+    spool->disk_hdr = (spool_file_hdr_t *)map;
+    spool_file_hdr_t *hdr = spool->disk_hdr;
+
+    if (fresh || memcmp(hdr->magic, SPOOL_FILE_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != SPOOL_FILE_VERSION || hdr->ring_size != ring_size || hdr->head - hdr->tail > ring_size)
+    {
+        if (!fresh && memcmp(hdr->magic, SPOOL_FILE_MAGIC, sizeof(hdr->magic)) == 0 && hdr->head != hdr->tail)
+        {
+            dbprintlf(YELLOW_FG "Spool file %s was written with a different size or version; discarding the frames in it.", path);
+        }
+        memset(hdr, 0x0, sizeof(*hdr));
+        memcpy(hdr->magic, SPOOL_FILE_MAGIC, sizeof(hdr->magic));
+        hdr->version = SPOOL_FILE_VERSION;
+        hdr->ring_size = ring_size;
+    }
+
+    ring_setup(spool->disk, (uint8_t *)map + SPOOL_FILE_HDR_SIZE, ring_size, &hdr->head, &hdr->tail);
+
+    uint32_t frames;
+    uint64_t bytes;
+    if (!ring_scan(spool->disk, &frames, &bytes))
+    {
+        dbprintlf(RED_FG "Spool file %s is damaged; discarding the frames in it.", path);
+        hdr->tail = hdr->head;
+        frames = 0;
+        bytes = 0;
+    }
+    else if (frames > 0)
+    {
+        dbprintlf(BLUE_FG "Spool file %s holds %u frames (%lu bytes) from a previous run; they will be sent.", path, frames, (unsigned long)bytes);
+    }
+
+    spool->depth.store(frames, std::memory_order_relaxed);
+    spool->depth_bytes.store(bytes, std::memory_order_relaxed);
+    return 1;
+}
+
+int gs_spool_init(gs_spool_t *spool, uint32_t ram_mb, uint32_t disk_mb, const char *directory)
+{
+    spool->enabled = false;
+    spool->disk_fd = -1;
+    spool->disk_hdr = NULL;
+    spool->disk_map_size = 0;
+    spool->spooled.store(0, std::memory_order_relaxed);
+    spool->spilled.store(0, std::memory_order_relaxed);
+    spool->replayed.store(0, std::memory_order_relaxed);
+    spool->dropped.store(0, std::memory_order_relaxed);
+    spool->depth.store(0, std::memory_order_relaxed);
+    spool->depth_bytes.store(0, std::memory_order_relaxed);
+
+    uint64_t ram_size = (uint64_t)ram_mb << 20;
+    uint8_t *ram = ram_size > 0 ? (uint8_t *)malloc(ram_size) : NULL;
+    if (ram_size > 0 && ram == NULL)
+    {
+        dbprintlf(RED_FG "Could not allocate a %u MiB spool.", ram_mb);
+        return -1;
+    }
+    spool->ram->head_mem = 0;
+    spool->ram->tail_mem = 0;
+    ring_setup(spool->ram, ram, ram_size, &spool->ram->head_mem, &spool->ram->tail_mem);
+
+    spool->disk->head_mem = 0;
+    spool->disk->tail_mem = 0;
+    ring_setup(spool->disk, NULL, 0, &spool->disk->head_mem, &spool->disk->tail_mem);
+    if (disk_mb > 0 && open_spool_file(spool, (uint64_t)disk_mb << 20, directory) < 0)
+    {
+        free(ram);
+        spool->ram->base = NULL;
+        return -1;
+    }
+
+    pthread_mutex_init(&spool->lock, NULL);
+    spool->enabled = true;
+    dbprintlf(BLUE_FG "Spooling up to %u MiB in memory and %u MiB on disk while the server is unreachable.", ram_mb, disk_mb);
+    return 1;
+}
+
+void gs_spool_destroy(gs_spool_t *spool)
+{
+    if (spool->disk_hdr != NULL)
+    {
+        msync(spool->disk_hdr, spool->disk_map_size, MS_SYNC);
+        munmap(spool->disk_hdr, spool->disk_map_size);
+        spool->disk_hdr = NULL;
+    }
+    if (spool->disk_fd >= 0)
+    {
+        close(spool->disk_fd);
+        spool->disk_fd = -1;
+    }
+    free(spool->ram->base);
+    spool->ram->base = NULL;
+    if (spool->enabled)
+    {
+        pthread_mutex_destroy(&spool->lock);
+    }
+    spool->enabled = false;
+}
+
+int gs_spool_push(gs_spool_t *spool, const gs_seq_hdr_t *seq, const uint8_t *payload, uint32_t size)
+{
+    gs_seq_hdr_t spooled = *seq;
+    spooled.flags |= GS_SEQ_SPOOLED;
+
+    // Into RAM only while nothing is waiting on disk, which would otherwise be overtaken.
+    bool stored = ring_used(spool->disk) == 0 && ring_push(spool->ram, &spooled, payload, size);
+    if (!stored)
+    {
+        stored = ring_push(spool->disk, &spooled, payload, size);
+        if (!stored)
+        {
+            spool->dropped.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        spool->spilled.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    spool->spooled.fetch_add(1, std::memory_order_relaxed);
+    spool->depth.fetch_add(1, std::memory_order_relaxed);
+    spool->depth_bytes.fetch_add(sizeof(gs_seq_hdr_t) + size, std::memory_order_relaxed);
+    return 1;
+}
+
+ssize_t gs_spool_peek(gs_spool_t *spool, const uint8_t **item)
+{
+    // RAM first: anything on disk arrived after it.
+    uint32_t length = ring_peek(spool->ram, item);
+    if (length == 0)
+    {
+        length = ring_peek(spool->disk, item);
+    }
+    return length;
+}
+
+void gs_spool_pop(gs_spool_t *spool)
+{
+    const uint8_t *item;
+    spool_ring_t *ring = ring_used(spool->ram) > 0 ? spool->ram : spool->disk;
+    uint32_t length = ring_peek(ring, &item);
+    if (length == 0)
+    {
+        return;
+    }
+
+    ring_pop(ring, length);
+    spool->replayed.fetch_add(1, std::memory_order_relaxed);
+    spool->depth.fetch_sub(1, std::memory_order_relaxed);
+    spool->depth_bytes.fetch_sub(length, std::memory_order_relaxed);
+}
+
+int gs_spool_drain_order_from_string(const char *name, spool_drain_order *order)
+{
+    if (strcmp(name, "interleaved") == 0)
+    {
+        *order = SPOOL_DRAIN_INTERLEAVED;
+    }
+    else if (strcmp(name, "ahead") == 0)
+    {
+        *order = SPOOL_DRAIN_AHEAD;
+    }
+    else
+    {
+        return -1;
+    }
+    return 1;
+}
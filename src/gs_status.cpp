@@ -0,0 +1,276 @@
+/**
+ * @file gs_status.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Event-driven X-Band status: a cached radio state, and the decision of when a status frame is due.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "gs_status.hpp"
+#include "gs_haystack.hpp"
+
+int gs_status_init(gs_status_t *st, uint32_t refresh_ms, uint32_t coalesce_ms, uint32_t heartbeat_ms)
+{
+    st->refresh_ms = refresh_ms;
+    st->coalesce_ms = coalesce_ms;
+    st->heartbeat_ms = heartbeat_ms;
+
+    if (pthread_mutex_init(&st->lock, NULL) != 0)
+    {
+        return -1;
+    }
+
+    st->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (st->wake_fd < 0)
+    {
+        pthread_mutex_destroy(&st->lock);
+        return -1;
+    }
+
+    st->pending = 0;
+    st->pending_since = 0;
+    memset(&st->radio, 0x0, sizeof(status_radio_t));
+    st->radio.mode = -1;
+
+    // Read the radio as soon as it is up.
+    st->last_refresh = 0;
+    st->last_sent = gs_monotonic_ns();
+    st->sent_any = false;
+    st->reader_opened = false;
+    memset(st->reader, 0x0, sizeof(gs_radio_reader_t));
+    memset(&st->previous, 0x0, sizeof(phy_status_t));
+
+    st->iio_refreshes.store(0, std::memory_order_relaxed);
+    st->frames_sent.store(0, std::memory_order_relaxed);
+
+    return 1;
+}
+
+void gs_status_destroy(gs_status_t *st)
+{
+    gs_radio_reader_destroy(st->reader);
+    close(st->wake_fd);
+    pthread_mutex_destroy(&st->lock);
+}
+
+void gs_status_notify(gs_status_t *st, uint32_t events)
+{
+    pthread_mutex_lock(&st->lock);
+    if (st->pending == 0)
+    {
+        st->pending_since = gs_monotonic_ns();
+    }
+    st->pending |= events;
+    pthread_mutex_unlock(&st->lock);
+
+    uint64_t one = 1;
+    if (write(st->wake_fd, &one, sizeof(one)) < 0)
+    {
+        // The counter is saturated, so the network loop is already due to wake.
+    }
+}
+
+void gs_status_set_config(gs_status_t *st, const phy_config_t *config)
+{
+    pthread_mutex_lock(&st->lock);
+    st->radio.mode = config->mode;
+    st->radio.LO = config->LO;
+    st->radio.samp = config->samp;
+    st->radio.bw = config->bw;
+    memcpy(st->radio.ftr_name, config->ftr_name, sizeof(st->radio.ftr_name));
+    st->radio.ftr_name[sizeof(st->radio.ftr_name) - 1] = '\0';
+    memcpy(st->radio.curr_gainmode, config->curr_gainmode, sizeof(st->radio.curr_gainmode));
+    st->radio.curr_gainmode[sizeof(st->radio.curr_gainmode) - 1] = '\0';
+    pthread_mutex_unlock(&st->lock);
+
+    gs_status_notify(st, STATUS_EVENT_CONFIG);
+}
+
+static uint64_t ms_to_ns(uint32_t ms)
+{
+    return (uint64_t)ms * 1000000ULL;
+}
+
+uint32_t gs_status_due(gs_status_t *st, uint64_t *next_at)
+{
+    uint64_t one;
+    while (read(st->wake_fd, &one, sizeof(one)) > 0)
+    {
+        // Consumed; the pending events are checked below.
+    }
+
+    uint64_t now = gs_monotonic_ns();
+    uint32_t due = 0;
+
+    pthread_mutex_lock(&st->lock);
+
+    uint64_t heartbeat_at = st->last_sent + ms_to_ns(st->heartbeat_ms);
+    uint64_t events_at = st->pending ? st->pending_since + ms_to_ns(st->coalesce_ms) : UINT64_MAX;
+
+    if (now >= events_at)
+    {
+        due |= st->pending;
+        st->pending = 0;
+        events_at = UINT64_MAX;
+    }
+    if (now >= heartbeat_at || (due & ~STATUS_EVENT_REFRESH))
+    {
+        // Any frame sent restarts the heartbeat; a refresh only sends one if something changed.
+        if (now >= heartbeat_at)
+        {
+            due |= STATUS_EVENT_HEARTBEAT;
+        }
+        st->last_sent = now;
+        heartbeat_at = now + ms_to_ns(st->heartbeat_ms);
+    }
+
+    *next_at = events_at < heartbeat_at ? events_at : heartbeat_at;
+
+    pthread_mutex_unlock(&st->lock);
+
+    return due;
+}
+
+void gs_status_refresh(gs_status_t *st, adradio_t *radio, pthread_mutex_t *radio_lock)
+{
+    if (!st->reader_opened)
+    {
+        gs_radio_reader_init(st->reader);
+        st->reader_opened = true;
+    }
+    st->last_refresh = gs_monotonic_ns();
+
+    // libiio is slow; read without holding the lock, then swap the result in. The batched reader has a context of its
+    // own; the per-attribute path shares the radio's.
+    bool shared = st->reader->ctx == NULL;
+    radio_snapshot_t snap[1];
+    if (shared)
+    {
+        pthread_mutex_lock(radio_lock);
+    }
+    gs_radio_snapshot(st->reader, radio, snap);
+    if (shared)
+    {
+        pthread_mutex_unlock(radio_lock);
+    }
+
+    pthread_mutex_lock(&st->lock);
+    // Keep the last known value of anything that could not be read. libiio has no notion of the filter file or PLL.
+    if (snap->valid & RADIO_ATTR_MODE)
+    {
+        st->radio.mode = snap->mode;
+    }
+    if (snap->valid & RADIO_ATTR_LO)
+    {
+        st->radio.LO = snap->LO;
+    }
+    if (snap->valid & RADIO_ATTR_SAMP)
+    {
+        st->radio.samp = snap->samp;
+    }
+    if (snap->valid & RADIO_ATTR_BW)
+    {
+        st->radio.bw = snap->bw;
+    }
+    if (snap->valid & RADIO_ATTR_GAIN)
+    {
+        st->radio.gain = snap->gain;
+    }
+    if (snap->valid & RADIO_ATTR_GAINMODE)
+    {
+        memcpy(st->radio.curr_gainmode, snap->gainmode, sizeof(st->radio.curr_gainmode));
+    }
+    if (snap->valid & RADIO_ATTR_RSSI)
+    {
+        st->radio.rssi = snap->rssi;
+    }
+    if (snap->valid & RADIO_ATTR_TEMP)
+    {
+        st->radio.temp = snap->temp;
+    }
+    pthread_mutex_unlock(&st->lock);
+
+    st->iio_refreshes.fetch_add(1, std::memory_order_relaxed);
+    gs_status_notify(st, STATUS_EVENT_REFRESH);
+}
+
+uint64_t gs_status_refresh_at(gs_status_t *st)
+{
+    return st->last_refresh + ms_to_ns(st->refresh_ms);
+}
+
+void gs_status_fill(gs_status_t *st, phy_status_t *status)
+{
+    pthread_mutex_lock(&st->lock);
+    status->mode = st->radio.mode;
+    status->pll_freq = st->radio.pll_freq;
+    status->LO = st->radio.LO;
+    status->samp = st->radio.samp;
+    status->bw = st->radio.bw;
+    memcpy(status->ftr_name, st->radio.ftr_name, sizeof(status->ftr_name));
+    status->temp = st->radio.temp;
+    status->rssi = st->radio.rssi;
+    status->gain = st->radio.gain;
+    memcpy(status->curr_gainmode, st->radio.curr_gainmode, sizeof(status->curr_gainmode));
+    status->pll_lock = st->radio.pll_lock;
+    pthread_mutex_unlock(&st->lock);
+}
+
+bool gs_status_commit(gs_status_t *st, phy_status_t *status, uint32_t events)
+{
+    const phy_status_t *prev = &st->previous;
+    uint32_t changed = 0;
+
+    if (!st->sent_any)
+    {
+        changed = STATUS_CHANGED_RADIO | STATUS_CHANGED_ENV | STATUS_CHANGED_STATE | STATUS_CHANGED_RX;
+    }
+    else
+    {
+        if (status->mode != prev->mode || status->pll_freq != prev->pll_freq || status->LO != prev->LO || status->samp != prev->samp || status->bw != prev->bw || status->gain != prev->gain || memcmp(status->ftr_name, prev->ftr_name, sizeof(status->ftr_name)) != 0 || memcmp(status->curr_gainmode, prev->curr_gainmode, sizeof(status->curr_gainmode)) != 0)
+        {
+            changed |= STATUS_CHANGED_RADIO;
+        }
+        if (status->temp != prev->temp || status->rssi != prev->rssi)
+        {
+            changed |= STATUS_CHANGED_ENV;
+        }
+        if (status->pll_lock != prev->pll_lock || status->modem_ready != prev->modem_ready || status->PLL_ready != prev->PLL_ready || status->radio_ready != prev->radio_ready || status->rx_armed != prev->rx_armed)
+        {
+            changed |= STATUS_CHANGED_STATE;
+        }
+        if (status->last_rx_status != prev->last_rx_status || status->last_read_status != prev->last_read_status)
+        {
+            changed |= STATUS_CHANGED_RX;
+        }
+    }
+
+    status->events = events;
+    status->changed = changed;
+
+    if (changed == 0 && (events & ~STATUS_EVENT_REFRESH) == 0)
+    {
+        return false;
+    }
+
+    if (events == STATUS_EVENT_REFRESH)
+    {
+        // Sent on account of the refresh alone, which restarts the heartbeat like any other frame.
+        pthread_mutex_lock(&st->lock);
+        st->last_sent = gs_monotonic_ns();
+        pthread_mutex_unlock(&st->lock);
+    }
+
+    st->previous = *status;
+    st->sent_any = true;
+    st->frames_sent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,544 @@
+/**
+ * @file gs_uplink.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Sends received X-Band frames to the GS server, optionally without copying the payload.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "gs_uplink.hpp"
+#include "gs_metrics.hpp"
+#include "meb_debug.hpp"
+
+#define UPLINK_PROBE_SIZE 300
+
+static uint16_t crc16_table[256];
+static bool crc16_ready = false;
+
+static void crc16_init()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint16_t crc = (uint16_t)(i << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        crc16_table[i] = crc;
+    }
+    crc16_ready = true;
+}
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = (uint16_t)((crc << 8) ^ crc16_table[((crc >> 8) ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+uint16_t gs_uplink_crc16(const uint8_t *data, ssize_t size)
+{
+    return crc16_update(0xFFFF, data, size);
+}
+
+// Writes every iovec with sendmsg(...), resuming after short writes.
+static ssize_t sendmsg_all(int fd, struct iovec *iov, int iovcnt)
+{
+    ssize_t total = 0;
+    while (iovcnt > 0)
+    {
+        struct msghdr msg;
+        memset(&msg, 0x0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        total += sent;
+
+        while (iovcnt > 0 && (size_t)sent >= iov->iov_len)
+        {
+            sent -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return total;
+}
+
+// Sends a NetFrame whose payload is iov[1] to iov[iovcnt - 2]; iov[0] and iov[iovcnt - 1] are filled in here.
+static ssize_t send_gather(int fd, NetType type, NetVertex destination, struct iovec *iov, int iovcnt)
+{
+    uint16_t crc = 0xFFFF;
+    ssize_t size = 0;
+    for (int i = 1; i < iovcnt - 1; i++)
+    {
+        crc = crc16_update(crc, (const uint8_t *)iov[i].iov_base, iov[i].iov_len);
+        size += iov[i].iov_len;
+    }
+
+    netframe_wire_hdr_t hdr;
+    hdr.guid = NETFRAME_GUID;
+    hdr.crc1 = crc;
+    hdr.type = (uint32_t)type;
+    hdr.origin = (uint32_t)NetVertex::HAYSTACK;
+    hdr.destination = (uint32_t)destination;
+    hdr.payload_size = (int32_t)size;
+    hdr.netstat = 0;
+
+    netframe_wire_ftr_t ftr;
+    ftr.crc2 = crc;
+    ftr.termination = NETFRAME_TERMINATOR;
+
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[iovcnt - 1].iov_base = &ftr;
+    iov[iovcnt - 1].iov_len = sizeof(ftr);
+    return sendmsg_all(fd, iov, iovcnt);
+}
+
+static ssize_t send_gather(int fd, NetType type, NetVertex destination, const uint8_t *payload, ssize_t size)
+{
+    struct iovec iov[3];
+    iov[1].iov_base = (void *)payload;
+    iov[1].iov_len = size;
+    return send_gather(fd, type, destination, iov, 3);
+}
+
+// Reads whatever is waiting on a socket without blocking.
+static ssize_t drain_socket(int fd, uint8_t *buf, size_t capacity)
+{
+    size_t len = 0;
+    while (len < capacity)
+    {
+        ssize_t got = recv(fd, buf + len, capacity - len, MSG_DONTWAIT);
+        if (got <= 0)
+        {
+            break;
+        }
+        len += got;
+    }
+    return len;
+}
+
+// Sends probe frames through NetFrame and through send_gather(...), and compares the bytes.
+static bool verify_wire_format()
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        return false;
+    }
+
+    NetDataClient *probe = new NetDataClient(NetPort::HAYSTACK, 1);
+    probe->socket = sv[0];
+    probe->connection_ready = true;
+
+    static uint8_t payload[UPLINK_PROBE_SIZE];
+    static uint8_t expected[UPLINK_PROBE_SIZE + 256];
+    static uint8_t actual[UPLINK_PROBE_SIZE + 256];
+    bool match = true;
+
+    // Two sizes and contents, so that a field derived from either is caught.
+    const ssize_t sizes[2] = {UPLINK_PROBE_SIZE, 17};
+    for (int round = 0; round < 2 && match; round++)
+    {
+        for (ssize_t i = 0; i < sizes[round]; i++)
+        {
+            payload[i] = (uint8_t)(i * 7 + round * 31);
+        }
+
+        NetFrame frame(payload, sizes[round], NetType::DATA, NetVertex::CLIENT);
+        frame.sendFrame(probe);
+        ssize_t expected_len = drain_socket(sv[1], expected, sizeof(expected));
+
+        send_gather(sv[0], NetType::DATA, NetVertex::CLIENT, payload, sizes[round]);
+        ssize_t actual_len = drain_socket(sv[1], actual, sizeof(actual));
+
+        if (expected_len <= 0 || expected_len != actual_len || memcmp(expected, actual, expected_len) != 0)
+        {
+            dbprintlf(YELLOW_FG "NetFrame wrote %zd bytes for a %zd byte probe, haystack's encoding %zd; they differ.", expected_len, sizes[round], actual_len);
+            match = false;
+        }
+    }
+
+    close(sv[0]);
+    close(sv[1]);
+    probe->socket = -1;
+    probe->connection_ready = false;
+    delete probe;
+
+    return match;
+}
+
+int gs_uplink_init(gs_uplink_t *uplink, bool zero_copy, uint32_t batch_frames, uint32_t batch_bytes, uint32_t batch_latency_us)
+{
+    if (!crc16_ready)
+    {
+        crc16_init();
+    }
+
+    if (pthread_mutex_init(&uplink->send_lock, NULL) != 0)
+    {
+        return -1;
+    }
+    if (pthread_mutex_init(&uplink->scratch_lock, NULL) != 0)
+    {
+        pthread_mutex_destroy(&uplink->send_lock);
+        return -1;
+    }
+
+    uplink->batch_frames = batch_frames > UPLINK_BATCH_MAX ? UPLINK_BATCH_MAX : batch_frames;
+    uplink->batch_bytes = batch_bytes;
+    uplink->batch_latency_us = batch_latency_us;
+    uplink->batch_scratch = NULL;
+    uplink->batch_scratch_size = 0;
+    uplink->frames.store(0, std::memory_order_relaxed);
+    uplink->copies.store(0, std::memory_order_relaxed);
+    uplink->send_errors.store(0, std::memory_order_relaxed);
+    uplink->batches.store(0, std::memory_order_relaxed);
+    uplink->connected.store(false, std::memory_order_relaxed);
+
+    if (gs_uplink_batching(uplink))
+    {
+        dbprintlf(BLUE_FG "Batching up to %u frames or %u bytes, waiting at most %u us.", uplink->batch_frames, uplink->batch_bytes, uplink->batch_latency_us);
+    }
+
+    uplink->wire_verified = verify_wire_format();
+    uplink->zero_copy = zero_copy && uplink->wire_verified;
+
+    if (uplink->zero_copy)
+    {
+        dbprintlf(GREEN_FG "Zero-copy uplink enabled.");
+    }
+    else if (zero_copy)
+    {
+        dbprintlf(RED_FG "Zero-copy uplink requested, but NetFrame's wire format is not the one haystack knows; sending through NetFrame.");
+    }
+
+    return 1;
+}
+
+void gs_uplink_destroy(gs_uplink_t *uplink)
+{
+    free(uplink->batch_scratch);
+    uplink->batch_scratch = NULL;
+    uplink->batch_scratch_size = 0;
+    pthread_mutex_destroy(&uplink->scratch_lock);
+    pthread_mutex_destroy(&uplink->send_lock);
+}
+
+void gs_uplink_attach(gs_uplink_t *uplink, NetData *network_data, int fd)
+{
+    if (gs_uplink_batching(uplink))
+    {
+        // Batching bounds the added latency itself; Nagle would hold a batch sent on its deadline for the server's ACK.
+        int one = 1;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0)
+        {
+            dbprintlf(YELLOW_FG "Could not set TCP_NODELAY on the uplink (%s); batches may be delayed.", strerror(errno));
+        }
+    }
+
+    pthread_mutex_lock(&uplink->send_lock);
+    network_data->socket = fd;
+    network_data->connection_ready = true;
+    uplink->connected.store(true, std::memory_order_release);
+    pthread_mutex_unlock(&uplink->send_lock);
+}
+
+void gs_uplink_detach(gs_uplink_t *uplink, NetData *network_data, const char *reason)
+{
+    // Wakes a send blocked on a dead connection, so that the lock is released promptly.
+    int fd = network_data->socket;
+    if (fd >= 0)
+    {
+        shutdown(fd, SHUT_RDWR);
+    }
+
+    pthread_mutex_lock(&uplink->send_lock);
+    uplink->connected.store(false, std::memory_order_release);
+    network_data->connection_ready = false;
+    network_data->socket = -1;
+    snprintf(network_data->disconnect_reason, sizeof(network_data->disconnect_reason), "%s", reason);
+    pthread_mutex_unlock(&uplink->send_lock);
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+// Send lock held: a send on the attached socket failed or was cut short. The server may hold part of a frame, so
+// nothing more can follow it on this connection; the senders see it as down from here, and the network loop, woken by
+// the shutdown, detaches it and reconnects.
+static void send_broken(gs_uplink_t *uplink, NetData *network_data)
+{
+    if (!network_data->connection_ready)
+    {
+        return;
+    }
+    network_data->connection_ready = false;
+    uplink->connected.store(false, std::memory_order_release);
+    shutdown(network_data->socket, SHUT_RDWR);
+}
+
+// Sends one frame under the send lock, by sendmsg(...) if the zero-copy path is enabled, by NetFrame otherwise.
+static ssize_t send_frame(gs_uplink_t *uplink, NetData *network_data, NetType type, NetVertex destination, const uint8_t *payload, ssize_t size)
+{
+    ssize_t sent = -1;
+
+    pthread_mutex_lock(&uplink->send_lock);
+    if (!network_data->connection_ready)
+    {
+        sent = -1;
+    }
+    else if (uplink->zero_copy)
+    {
+        sent = send_gather(network_data->socket, type, destination, payload, size);
+    }
+    else
+    {
+        NetFrame frame((unsigned char *)payload, size, type, destination);
+        sent = frame.sendFrame(network_data);
+    }
+    if (sent <= 0)
+    {
+        send_broken(uplink, network_data);
+    }
+    pthread_mutex_unlock(&uplink->send_lock);
+
+    return sent;
+}
+
+// Grows the buffer DATA payloads are assembled in for NetFrame to the largest seen, then it stays.
+static uint8_t *scratch_reserve(gs_uplink_t *uplink, size_t size)
+{
+    if (size > uplink->batch_scratch_size)
+    {
+        uint8_t *scratch = (uint8_t *)realloc(uplink->batch_scratch, size);
+        if (scratch == NULL)
+        {
+            return NULL;
+        }
+        uplink->batch_scratch = scratch;
+        uplink->batch_scratch_size = size;
+    }
+    return uplink->batch_scratch;
+}
+
+// Sends received frames as one DATA frame and counts them. Each item is two iovecs, a prefix (a gs_seq_hdr_t, or
+// empty) and the frame; 'batched' wraps them as a batch, otherwise there must be exactly one. 'item_copies' are the
+// copies each item has already been through, on top of those made here.
+static ssize_t send_data(gs_uplink_t *uplink, NetData *network_data, NetVertex destination, bool batched, const struct iovec *items, uint32_t count, uint32_t item_copies)
+{
+    uint64_t begin = gs_metrics_begin();
+
+    gs_batch_hdr_t batch;
+    batch.magic = GS_BATCH_MAGIC;
+    batch.version = GS_BATCH_VERSION;
+    batch.count = (uint16_t)count;
+
+    uint32_t lengths[UPLINK_BATCH_MAX];
+    size_t payload_size = batched ? sizeof(batch) : 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        lengths[i] = (uint32_t)(items[2 * i].iov_len + items[2 * i + 1].iov_len);
+        payload_size += (batched ? sizeof(uint32_t) : 0) + lengths[i];
+    }
+
+    ssize_t sent;
+    uint32_t copies = item_copies;
+
+    if (uplink->zero_copy)
+    {
+        // Header, batch header, per frame a length, prefix and payload, footer.
+        struct iovec iov[3 + 3 * UPLINK_BATCH_MAX];
+        int iovcnt = 1;
+        if (batched)
+        {
+            iov[iovcnt].iov_base = &batch;
+            iov[iovcnt++].iov_len = sizeof(batch);
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (batched)
+            {
+                iov[iovcnt].iov_base = &lengths[i];
+                iov[iovcnt++].iov_len = sizeof(uint32_t);
+            }
+            if (items[2 * i].iov_len > 0)
+            {
+                iov[iovcnt++] = items[2 * i];
+            }
+            iov[iovcnt++] = items[2 * i + 1];
+        }
+        iovcnt++;
+
+        pthread_mutex_lock(&uplink->send_lock);
+        sent = network_data->connection_ready ? send_gather(network_data->socket, NetType::DATA, destination, iov, iovcnt) : -1;
+        if (sent <= 0)
+        {
+            send_broken(uplink, network_data);
+        }
+        pthread_mutex_unlock(&uplink->send_lock);
+    }
+    else if (!batched && items[0].iov_len == 0)
+    {
+        sent = send_frame(uplink, network_data, NetType::DATA, destination, (const uint8_t *)items[1].iov_base, items[1].iov_len);
+        copies += NETFRAME_COPIES;
+    }
+    else
+    {
+        pthread_mutex_lock(&uplink->scratch_lock);
+        uint8_t *out = scratch_reserve(uplink, payload_size);
+        if (out == NULL)
+        {
+            pthread_mutex_unlock(&uplink->scratch_lock);
+            uplink->send_errors.fetch_add(count, std::memory_order_relaxed);
+            return -1;
+        }
+
+        if (batched)
+        {
+            memcpy(out, &batch, sizeof(batch));
+            out += sizeof(batch);
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (batched)
+            {
+                memcpy(out, &lengths[i], sizeof(uint32_t));
+                out += sizeof(uint32_t);
+            }
+            memcpy(out, items[2 * i].iov_base, items[2 * i].iov_len);
+            memcpy(out + items[2 * i].iov_len, items[2 * i + 1].iov_base, items[2 * i + 1].iov_len);
+            out += lengths[i];
+        }
+
+        sent = send_frame(uplink, network_data, NetType::DATA, destination, uplink->batch_scratch, payload_size);
+        pthread_mutex_unlock(&uplink->scratch_lock);
+        copies += 1 + NETFRAME_COPIES;
+    }
+
+    if (sent <= 0)
+    {
+        uplink->send_errors.fetch_add(count, std::memory_order_relaxed);
+    }
+    else
+    {
+        gs_metrics_end(METRIC_UPLINK_SEND_NS, begin);
+        gs_metrics_count(METRIC_UPLINK_BYTES, payload_size);
+        uplink->frames.fetch_add(count, std::memory_order_relaxed);
+        uplink->copies.fetch_add(copies * count, std::memory_order_relaxed);
+        if (batched)
+        {
+            uplink->batches.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    return sent;
+}
+
+ssize_t gs_uplink_send(gs_uplink_t *uplink, NetData *network_data, NetVertex destination, const gs_seq_hdr_t *seq, const uint8_t *payload, ssize_t size)
+{
+    struct iovec item[2];
+    item[0].iov_base = (void *)seq;
+    item[0].iov_len = seq != NULL ? sizeof(*seq) : 0;
+    item[1].iov_base = (void *)payload;
+    item[1].iov_len = size;
+    return send_data(uplink, network_data, destination, false, item, 1, UPLINK_READ_COPIES);
+}
+
+ssize_t gs_uplink_send_control(gs_uplink_t *uplink, NetData *network_data, NetType type, NetVertex destination, const uint8_t *payload, ssize_t size)
+{
+    return send_frame(uplink, network_data, type, destination, payload, size);
+}
+
+ssize_t gs_uplink_send_batch(gs_uplink_t *uplink, NetData *network_data, NetVertex destination, const PoolBuffer *frames, const gs_seq_hdr_t *seqs, uint32_t count)
+{
+    struct iovec items[2 * UPLINK_BATCH_MAX];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        items[2 * i].iov_base = seqs != NULL ? (void *)&seqs[i] : NULL;
+        items[2 * i].iov_len = seqs != NULL ? sizeof(gs_seq_hdr_t) : 0;
+        items[2 * i + 1].iov_base = frames[i]->data;
+        items[2 * i + 1].iov_len = frames[i]->size;
+    }
+    return send_data(uplink, network_data, destination, true, items, count, UPLINK_READ_COPIES);
+}
+
+ssize_t gs_uplink_send_spooled(gs_uplink_t *uplink, NetData *network_data, NetVertex destination, const uint8_t *item, ssize_t size)
+{
+    struct iovec parts[2];
+    parts[0].iov_base = NULL;
+    parts[0].iov_len = 0;
+    parts[1].iov_base = (void *)item;
+    parts[1].iov_len = size;
+    return send_data(uplink, network_data, destination, gs_uplink_batching(uplink), parts, 1, UPLINK_READ_COPIES + UPLINK_SPOOL_COPIES);
+}
+
+int gs_batch_next(const uint8_t *payload, ssize_t size, ssize_t *offset, const uint8_t **item, uint32_t *item_size)
+{
+    if (*offset == 0)
+    {
+        gs_batch_hdr_t batch;
+        if (size < (ssize_t)sizeof(batch))
+        {
+            return -1;
+        }
+        memcpy(&batch, payload, sizeof(batch));
+        if (batch.magic != GS_BATCH_MAGIC || batch.version != GS_BATCH_VERSION)
+        {
+            return -1;
+        }
+        *offset = sizeof(batch);
+    }
+
+    if (*offset == size)
+    {
+        return 0;
+    }
+
+    uint32_t length;
+    if (size - *offset < (ssize_t)sizeof(length))
+    {
+        return -1;
+    }
+    memcpy(&length, payload + *offset, sizeof(length));
+    if ((ssize_t)length > size - *offset - (ssize_t)sizeof(length))
+    {
+        return -1;
+    }
+
+    *item = payload + *offset + sizeof(length);
+    *item_size = length;
+    *offset += sizeof(length) + length;
+    return 1;
+}
@@ -0,0 +1,366 @@
+/**
+ * @file gs_validate.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief CRC check and duplicate filter between the capture and forwarding stages.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "gs_validate.hpp"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78 // Reflected.
+#define CRC16_POLY 0x1021
+
+typedef struct
+{
+    uint32_t c32[8][256]; // c32[k][b]: CRC-32C of byte b followed by k zero bytes.
+    uint16_t c16[256];
+} crc_tables_t;
+
+static constexpr crc_tables_t make_crc_tables()
+{
+    crc_tables_t t = {};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        uint16_t d = (uint16_t)(i << 8);
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+            d = (d & 0x8000) ? (uint16_t)((d << 1) ^ CRC16_POLY) : (uint16_t)(d << 1);
+        }
+        t.c32[0][i] = c;
+        t.c16[i] = d;
+    }
+    for (int k = 1; k < 8; k++)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            t.c32[k][i] = (t.c32[k - 1][i] >> 8) ^ t.c32[0][t.c32[k - 1][i] & 0xFF];
+        }
+    }
+    return t;
+}
+
+static constexpr crc_tables_t crc_tables = make_crc_tables();
+
+// Set once by gs_crc_init(...), before the forwarding stages start.
+static uint32_t (*crc32c_fn)(uint32_t, const uint8_t *, size_t) = gs_crc32c_table;
+static const char *crc32c_name = "table";
+
+uint32_t gs_crc32c_table(uint32_t crc, const uint8_t *data, size_t len)
+{
+    const uint32_t (*t)[256] = crc_tables.c32;
+    crc = ~crc;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Eight bytes per step, one lookup each, none depending on another.
+    while (len >= 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, data, sizeof(lo));
+        memcpy(&hi, data + 4, sizeof(hi));
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        data += 8;
+        len -= 8;
+    }
+#endif
+
+    while (len-- > 0)
+    {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t gs_crc32c_hw(uint32_t crc, const uint8_t *data, size_t len)
+{
+    uint64_t c = ~crc;
+    while (len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        c = _mm_crc32_u64(c, word);
+        data += 8;
+        len -= 8;
+    }
+    uint32_t c32 = (uint32_t)c;
+    while (len-- > 0)
+    {
+        c32 = _mm_crc32_u8(c32, *data++);
+    }
+    return ~c32;
+}
+
+static bool crc32c_hw_supported()
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(__aarch64__)
+__attribute__((target("+crc"))) uint32_t gs_crc32c_hw(uint32_t crc, const uint8_t *data, size_t len)
+{
+    uint32_t c = ~crc;
+    while (len >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        c = __crc32cd(c, word);
+        data += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+    {
+        c = __crc32cb(c, *data++);
+    }
+    return ~c;
+}
+
+static bool crc32c_hw_supported()
+{
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+#else
+// No CRC instructions on this architecture (the Zynq-7000's Cortex-A9 included).
+uint32_t gs_crc32c_hw(uint32_t crc, const uint8_t *data, size_t len)
+{
+    return gs_crc32c_table(crc, data, len);
+}
+
+static bool crc32c_hw_supported()
+{
+    return false;
+}
+#endif
+
+void gs_crc_init()
+{
+    if (crc32c_hw_supported())
+    {
+        crc32c_fn = gs_crc32c_hw;
+#if defined(__x86_64__)
+        crc32c_name = "sse4.2";
+#else
+        crc32c_name = "armv8";
+#endif
+    }
+}
+
+const char *gs_crc32c_impl()
+{
+    return crc32c_name;
+}
+
+uint32_t gs_crc32c(uint32_t crc, const uint8_t *data, size_t len)
+{
+    return crc32c_fn(crc, data, len);
+}
+
+uint16_t gs_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    while (len-- > 0)
+    {
+        crc = (uint16_t)(crc << 8) ^ crc_tables.c16[(crc >> 8) ^ *data++];
+    }
+    return crc;
+}
+
+int gs_validate_init(gs_validate_t *val, crc_kind crc, uint32_t window)
+{
+    gs_crc_init();
+
+    val->crc = crc;
+    val->window = window > VALIDATE_DEDUPE_WINDOW_MAX ? VALIDATE_DEDUPE_WINDOW_MAX : window;
+    val->recent = NULL;
+    val->recent_at = 0;
+    val->recent_count = 0;
+    val->table = NULL;
+    val->table_mask = 0;
+    val->checked.store(0, std::memory_order_relaxed);
+    val->crc_errors.store(0, std::memory_order_relaxed);
+    val->duplicates.store(0, std::memory_order_relaxed);
+
+    if (val->window > 0)
+    {
+        // At most half full, so that probes stay short.
+        uint32_t slots = 2;
+        while (slots < 2 * val->window)
+        {
+            slots <<= 1;
+        }
+        val->recent = (uint64_t *)calloc(val->window, sizeof(uint64_t));
+        val->table = (uint64_t *)calloc(slots, sizeof(uint64_t));
+        val->table_mask = slots - 1;
+        if (val->recent == NULL || val->table == NULL)
+        {
+            gs_validate_destroy(val);
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+void gs_validate_destroy(gs_validate_t *val)
+{
+    free(val->recent);
+    free(val->table);
+    val->recent = NULL;
+    val->table = NULL;
+    val->window = 0;
+}
+
+static inline uint32_t dedupe_home(const gs_validate_t *val, uint64_t key)
+{
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & val->table_mask;
+}
+
+// Returns the slot holding key, or the empty slot where it would go.
+static uint32_t dedupe_find(const gs_validate_t *val, uint64_t key)
+{
+    uint32_t i = dedupe_home(val, key);
+    while (val->table[i] != 0 && val->table[i] != key)
+    {
+        i = (i + 1) & val->table_mask;
+    }
+    return i;
+}
+
+// Empties a slot, moving later entries of the same probe run back so that every entry stays reachable from its home.
+static void dedupe_remove(gs_validate_t *val, uint32_t i)
+{
+    uint32_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & val->table_mask;
+        if (val->table[j] == 0)
+        {
+            break;
+        }
+        uint32_t home = dedupe_home(val, val->table[j]);
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays)
+        {
+            val->table[i] = val->table[j];
+            i = j;
+        }
+    }
+    val->table[i] = 0;
+}
+
+// Remembers a forwarded frame, forgetting the oldest once the window is full.
+static void dedupe_insert(gs_validate_t *val, uint32_t slot, uint64_t key)
+{
+    if (val->recent_count == val->window)
+    {
+        dedupe_remove(val, dedupe_find(val, val->recent[val->recent_at]));
+        // The removal may have shifted entries back into the run the free slot for key was found at the end of.
+        slot = dedupe_find(val, key);
+    }
+    else
+    {
+        val->recent_count++;
+    }
+    val->table[slot] = key;
+    val->recent[val->recent_at] = key;
+    val->recent_at = (val->recent_at + 1) % val->window;
+}
+
+bool gs_validate_frame(gs_validate_t *val, const uint8_t *data, size_t size)
+{
+    val->checked.fetch_add(1, std::memory_order_relaxed);
+
+    // CRC-32C identifying the frame for the duplicate filter.
+    uint32_t ident = 0;
+    bool have_ident = false;
+
+    if (val->crc == CRC_32C)
+    {
+        if (size < sizeof(uint32_t))
+        {
+            val->crc_errors.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        size_t body = size - sizeof(uint32_t);
+        uint32_t crc = gs_crc32c(0, data, body);
+        const uint8_t *t = data + body;
+        if (crc != ((uint32_t)t[0] | (uint32_t)t[1] << 8 | (uint32_t)t[2] << 16 | (uint32_t)t[3] << 24))
+        {
+            val->crc_errors.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // The body's, since over a whole valid frame CRC-32C is the same constant for every frame.
+        ident = crc;
+        have_ident = true;
+    }
+    else if (val->crc == CRC_16)
+    {
+        if (size < sizeof(uint16_t))
+        {
+            val->crc_errors.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        size_t body = size - sizeof(uint16_t);
+        if (gs_crc16(0xFFFF, data, body) != (uint16_t)(data[body] << 8 | data[body + 1]))
+        {
+            val->crc_errors.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    if (val->window == 0)
+    {
+        return true;
+    }
+
+    if (!have_ident)
+    {
+        ident = gs_crc32c(0, data, size);
+    }
+    // Never 0 (empty): frames are not empty.
+    uint64_t key = (uint64_t)ident << 32 | (uint32_t)size;
+    uint32_t slot = dedupe_find(val, key);
+    if (val->table[slot] == key)
+    {
+        val->duplicates.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    dedupe_insert(val, slot, key);
+    return true;
+}
+
+int gs_validate_crc_from_string(const char *name, crc_kind *crc)
+{
+    if (strcmp(name, "none") == 0)
+    {
+        *crc = CRC_NONE;
+    }
+    else if (strcmp(name, "crc32c") == 0)
+    {
+        *crc = CRC_32C;
+    }
+    else if (strcmp(name, "crc16") == 0)
+    {
+        *crc = CRC_16;
+    }
+    else
+    {
+        return -1;
+    }
+    return 1;
+}
@@ -0,0 +1,634 @@
+/**
+ * @file gs_wire.cpp
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Compact, versioned encoding of phy_status_t and phy_config_t, with status frames sent as deltas.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <string.h>
+#include <limits>
+#include <type_traits>
+#include "gs_wire.hpp"
+
+// Field value types, the low two bits of a tag.
+#define WIRE_VARINT 0
+#define WIRE_FIXED64 1
+#define WIRE_STRING 2
+
+// The fields of each struct: number, member, and NUM (an integer or a double) or STR (a char array). Numbers are the
+// protocol: new fields get new numbers, and a number is never reused or given to another member.
+#define WIRE_STATUS_FIELDS(X) \
+    X(1, mode, NUM) \
+    X(2, pll_freq, NUM) \
+    X(3, LO, NUM) \
+    X(4, samp, NUM) \
+    X(5, bw, NUM) \
+    X(6, ftr_name, STR) \
+    X(7, temp, NUM) \
+    X(8, rssi, NUM) \
+    X(9, gain, NUM) \
+    X(10, curr_gainmode, STR) \
+    X(11, pll_lock, NUM) \
+    X(12, modem_ready, NUM) \
+    X(13, PLL_ready, NUM) \
+    X(14, radio_ready, NUM) \
+    X(15, rx_armed, NUM) \
+    X(16, MTU, NUM) \
+    X(17, last_rx_status, NUM) \
+    X(18, last_read_status, NUM) \
+    X(19, rx_ring_depth, NUM) \
+    X(20, rx_dropped_oldest, NUM) \
+    X(21, rx_dropped_newest, NUM) \
+    X(22, rx_blocked, NUM) \
+    X(23, pool_in_use, NUM) \
+    X(24, pool_high_water, NUM) \
+    X(25, pool_exhausted, NUM) \
+    X(26, rec_records, NUM) \
+    X(27, rec_dropped, NUM) \
+    X(28, rec_errors, NUM) \
+    X(29, events, NUM) \
+    X(30, changed, NUM) \
+    X(31, uplink_frames, NUM) \
+    X(32, uplink_copies, NUM) \
+    X(33, uplink_errors, NUM) \
+    X(34, uplink_batches, NUM) \
+    X(35, net_reconnects, NUM) \
+    X(36, net_outage_ms, NUM) \
+    X(37, net_bad_frames, NUM) \
+    X(38, spool_frames, NUM) \
+    X(39, spool_replayed, NUM) \
+    X(40, spool_dropped, NUM) \
+    X(41, spool_depth, NUM) \
+    X(42, spool_depth_kb, NUM) \
+    X(43, rx_arm_us, NUM) \
+    X(44, rx_disarm_us, NUM) \
+    X(45, rx_slow_disarms, NUM) \
+    X(46, rx_frames, NUM) \
+    X(47, rx_errors, NUM) \
+    X(48, chain, NUM) \
+    X(49, rx_overruns, NUM) \
+    X(50, rx_worst_turn_us, NUM) \
+    X(51, rx_dma_depth, NUM) \
+    X(52, rx_dma_starved, NUM) \
+    X(53, rx_crc_errors, NUM) \
+    X(54, rx_duplicates, NUM) \
+    X(55, sched_pending, NUM) \
+    X(56, sched_applied, NUM) \
+    X(57, sched_skipped, NUM) \
+    X(58, sched_failed, NUM) \
+    X(59, sched_last_error_us, NUM) \
+    X(60, sched_worst_error_us, NUM)
+
+#define WIRE_CONFIG_FIELDS(X) \
+    X(1, mode, NUM) \
+    X(2, pll_freq, NUM) \
+    X(3, LO, NUM) \
+    X(4, samp, NUM) \
+    X(5, bw, NUM) \
+    X(6, ftr_name, STR) \
+    X(7, temp, NUM) \
+    X(8, rssi, NUM) \
+    X(9, gain, NUM) \
+    X(10, curr_gainmode, STR) \
+    X(11, pll_lock, NUM) \
+    X(12, MTU, NUM) \
+    X(13, chain, NUM)
+
+// Interned at the start of every stream, in this order.
+static const char *const builtin_strings[] = {"", "slow_attack", "fast_attack", "manual", "hybrid"};
+
+typedef struct
+{
+    uint8_t *at;
+    uint8_t *end;
+    bool overflow;
+    gs_wire_strings_t *strings;
+} wire_out_t;
+
+typedef struct
+{
+    const uint8_t *at;
+    const uint8_t *end;
+    int error; // The first failure, as gs_wire_decode_status(...) returns it.
+    gs_wire_strings_t *strings;
+} wire_in_t;
+
+static void strings_reset(gs_wire_strings_t *strings)
+{
+    strings->count = 0;
+    for (const char *text : builtin_strings)
+    {
+        memcpy(strings->text[strings->count++], text, strlen(text) + 1);
+    }
+}
+
+// Both ends add every literal to their tables the same way, so that indices agree.
+static void strings_add(gs_wire_strings_t *strings, const char *text, size_t len)
+{
+    if (strings->count < GS_WIRE_STRINGS_MAX && len < sizeof(strings->text[0]))
+    {
+        memcpy(strings->text[strings->count], text, len);
+        strings->text[strings->count][len] = '\0';
+        strings->count++;
+    }
+}
+
+static inline void put_byte(wire_out_t *out, uint8_t byte)
+{
+    if (out->at < out->end)
+    {
+        *out->at++ = byte;
+    }
+    else
+    {
+        out->overflow = true;
+    }
+}
+
+static inline void put_varint(wire_out_t *out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        put_byte(out, (uint8_t)value | 0x80);
+        value >>= 7;
+    }
+    put_byte(out, (uint8_t)value);
+}
+
+static inline void put_tag(wire_out_t *out, uint32_t number, uint32_t type)
+{
+    put_varint(out, (uint64_t)number << 2 | type);
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value>::type put_value(wire_out_t *out, uint32_t number, T value)
+{
+    put_tag(out, number, WIRE_VARINT);
+    if (std::is_signed<T>::value)
+    {
+        // Zigzag, so that small negative values stay short.
+        int64_t v = (int64_t)value;
+        put_varint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+    else
+    {
+        put_varint(out, (uint64_t)value);
+    }
+}
+
+static inline void put_value(wire_out_t *out, uint32_t number, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_tag(out, number, WIRE_FIXED64);
+    for (int i = 0; i < 8; i++)
+    {
+        put_byte(out, (uint8_t)(bits >> (8 * i)));
+    }
+}
+
+template <size_t N>
+static void put_string(wire_out_t *out, uint32_t number, const char (&value)[N])
+{
+    size_t len = strnlen(value, N - 1);
+    put_tag(out, number, WIRE_STRING);
+    for (uint32_t i = 0; i < out->strings->count; i++)
+    {
+        const char *text = out->strings->text[i];
+        if (memcmp(text, value, len) == 0 && text[len] == '\0')
+        {
+            put_varint(out, (uint64_t)i << 1 | 1);
+            return;
+        }
+    }
+    put_varint(out, (uint64_t)len << 1);
+    for (size_t i = 0; i < len; i++)
+    {
+        put_byte(out, (uint8_t)value[i]);
+    }
+    strings_add(out->strings, value, len);
+}
+
+template <typename T>
+static inline bool num_same(T a, T b)
+{
+    return a == b;
+}
+
+static inline bool num_same(double a, double b)
+{
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+template <typename T>
+static inline bool num_zero(T value)
+{
+    return num_same(value, (T)0); // -0.0 is not zero here, and is sent.
+}
+
+template <size_t N>
+static inline bool str_same(const char (&a)[N], const char (&b)[N])
+{
+    return strncmp(a, b, N) == 0;
+}
+
+template <size_t N>
+static inline bool str_zero(const char (&value)[N])
+{
+    return value[0] == '\0';
+}
+
+static inline void fail(wire_in_t *in, int error)
+{
+    if (in->error == 0)
+    {
+        in->error = error;
+    }
+}
+
+static inline uint64_t get_varint(wire_in_t *in)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (in->at >= in->end)
+        {
+            fail(in, -1);
+            return 0;
+        }
+        uint8_t byte = *in->at++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    fail(in, -1);
+    return 0;
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value>::type get_value(wire_in_t *in, uint32_t type, T *value)
+{
+    if (type != WIRE_VARINT)
+    {
+        fail(in, -1);
+        return;
+    }
+    uint64_t raw = get_varint(in);
+    if (std::is_signed<T>::value)
+    {
+        int64_t v = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+        if (v < (int64_t)std::numeric_limits<T>::min() || v > (int64_t)std::numeric_limits<T>::max())
+        {
+            fail(in, -4);
+            return;
+        }
+        *value = (T)v;
+    }
+    else
+    {
+        if (raw > (uint64_t)std::numeric_limits<T>::max())
+        {
+            fail(in, -4);
+            return;
+        }
+        *value = (T)raw;
+    }
+}
+
+static inline void get_value(wire_in_t *in, uint32_t type, double *value)
+{
+    if (type != WIRE_FIXED64 || in->end - in->at < 8)
+    {
+        fail(in, -1);
+        return;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        bits |= (uint64_t)in->at[i] << (8 * i);
+    }
+    in->at += 8;
+    memcpy(value, &bits, sizeof(bits));
+}
+
+// Reads a string into 'value' (cap bytes, NUL included), or past it if value is NULL.
+static void get_string(wire_in_t *in, uint32_t type, char *value, size_t cap)
+{
+    if (type != WIRE_STRING)
+    {
+        fail(in, -1);
+        return;
+    }
+    uint64_t ref = get_varint(in);
+    if (in->error != 0)
+    {
+        return;
+    }
+
+    const char *text;
+    size_t len;
+    if (ref & 1)
+    {
+        if ((ref >> 1) >= in->strings->count)
+        {
+            fail(in, -1);
+            return;
+        }
+        text = in->strings->text[ref >> 1];
+        len = strlen(text);
+    }
+    else
+    {
+        if ((ref >> 1) > (uint64_t)(in->end - in->at))
+        {
+            fail(in, -1);
+            return;
+        }
+        text = (const char *)in->at;
+        len = ref >> 1;
+        in->at += len;
+        if (memchr(text, '\0', len) != NULL)
+        {
+            fail(in, -1);
+            return;
+        }
+        strings_add(in->strings, text, len);
+    }
+
+    if (value != NULL)
+    {
+        if (len >= cap)
+        {
+            fail(in, -4);
+            return;
+        }
+        memcpy(value, text, len);
+        memset(value + len, 0x0, cap - len);
+    }
+}
+
+// A field this decoder does not know, from a newer peer.
+static void skip_field(wire_in_t *in, uint32_t type)
+{
+    switch (type)
+    {
+    case WIRE_VARINT:
+        get_varint(in);
+        break;
+    case WIRE_FIXED64:
+    {
+        double ignored;
+        get_value(in, type, &ignored);
+        break;
+    }
+    case WIRE_STRING:
+        get_string(in, type, NULL, 0);
+        break;
+    default:
+        fail(in, -1);
+        break;
+    }
+}
+
+// Every field of 's' that differs from 'base', or that is not zero if there is no base.
+#define WIRE_ENCODE_NUM(number, field)                                                        \
+    if (base == NULL ? !num_zero(s->field) : !num_same(s->field, base->field))                \
+    {                                                                                         \
+        put_value(out, number, s->field);                                                     \
+    }
+#define WIRE_ENCODE_STR(number, field)                                                        \
+    if (base == NULL ? !str_zero(s->field) : !str_same(s->field, base->field))                \
+    {                                                                                         \
+        put_string(out, number, s->field);                                                    \
+    }
+#define WIRE_ENCODE(number, field, kind) WIRE_ENCODE_##kind(number, field)
+
+// Packed members are copied through a local, since they may not be aligned.
+#define WIRE_DECODE_NUM(number, field)       \
+    case number:                             \
+    {                                        \
+        decltype(s->field) value = s->field; \
+        get_value(in, type, &value);         \
+        s->field = value;                    \
+        break;                               \
+    }
+#define WIRE_DECODE_STR(number, field)                          \
+    case number:                                                \
+        get_string(in, type, s->field, sizeof(s->field));       \
+        break;
+#define WIRE_DECODE(number, field, kind) WIRE_DECODE_##kind(number, field)
+
+static void encode_status_fields(wire_out_t *out, const phy_status_t *s, const phy_status_t *base)
+{
+    WIRE_STATUS_FIELDS(WIRE_ENCODE)
+    put_varint(out, 0);
+}
+
+static void encode_config_fields(wire_out_t *out, const phy_config_t *s)
+{
+    const phy_config_t *base = NULL;
+    WIRE_CONFIG_FIELDS(WIRE_ENCODE)
+    put_varint(out, 0);
+}
+
+static void decode_status_fields(wire_in_t *in, phy_status_t *s)
+{
+    while (in->error == 0)
+    {
+        uint64_t tag = get_varint(in);
+        if (tag == 0 || in->error != 0)
+        {
+            return;
+        }
+        uint32_t type = tag & 3;
+        switch (tag >> 2)
+        {
+            WIRE_STATUS_FIELDS(WIRE_DECODE)
+        default:
+            skip_field(in, type);
+            break;
+        }
+    }
+}
+
+static void decode_config_fields(wire_in_t *in, phy_config_t *s)
+{
+    while (in->error == 0)
+    {
+        uint64_t tag = get_varint(in);
+        if (tag == 0 || in->error != 0)
+        {
+            return;
+        }
+        uint32_t type = tag & 3;
+        switch (tag >> 2)
+        {
+            WIRE_CONFIG_FIELDS(WIRE_DECODE)
+        default:
+            skip_field(in, type);
+            break;
+        }
+    }
+}
+
+static void put_header(wire_out_t *out, gs_wire_kind kind)
+{
+    put_byte(out, GS_WIRE_MAGIC0);
+    put_byte(out, GS_WIRE_MAGIC1);
+    put_byte(out, GS_WIRE_VERSION);
+    put_byte(out, (uint8_t)kind);
+}
+
+void gs_wire_encoder_init(gs_wire_encoder_t *enc, uint32_t keyframe_every)
+{
+    enc->keyframe_every = keyframe_every;
+    enc->seq = 0;
+    enc->since_key = 0;
+    enc->have_base = false;
+    memset(&enc->base, 0x0, sizeof(phy_status_t));
+    strings_reset(enc->strings);
+}
+
+void gs_wire_encoder_reset(gs_wire_encoder_t *enc)
+{
+    enc->have_base = false;
+}
+
+ssize_t gs_wire_encode_status(gs_wire_encoder_t *enc, const phy_status_t *status, uint8_t *buf, size_t cap)
+{
+    bool full = !enc->have_base || enc->keyframe_every <= 1 || enc->since_key + 1 >= enc->keyframe_every;
+    uint32_t strings = enc->strings->count;
+    if (full)
+    {
+        strings_reset(enc->strings);
+    }
+
+    wire_out_t out[1] = {{buf, buf + cap, false, enc->strings}};
+    put_header(out, full ? GS_WIRE_STATUS : GS_WIRE_STATUS_DELTA);
+    put_varint(out, enc->seq + 1);
+    encode_status_fields(out, status, full ? NULL : &enc->base);
+
+    if (out->overflow)
+    {
+        // A delta only added strings; a full frame replaced them, and is sent again next time.
+        enc->strings->count = full ? enc->strings->count : strings;
+        enc->have_base = enc->have_base && !full;
+        return -1;
+    }
+
+    enc->seq++;
+    enc->since_key = full ? 0 : enc->since_key + 1;
+    enc->base = *status;
+    enc->have_base = true;
+    return out->at - buf;
+}
+
+void gs_wire_decoder_init(gs_wire_decoder_t *dec)
+{
+    dec->seq = 0;
+    dec->have_base = false;
+    memset(&dec->base, 0x0, sizeof(phy_status_t));
+    strings_reset(dec->strings);
+}
+
+bool gs_wire_is_encoded(const uint8_t *buf, size_t len)
+{
+    return len >= 4 && buf[0] == GS_WIRE_MAGIC0 && buf[1] == GS_WIRE_MAGIC1;
+}
+
+int gs_wire_decode_status(gs_wire_decoder_t *dec, const uint8_t *buf, size_t len, phy_status_t *status, size_t *used)
+{
+    if (!gs_wire_is_encoded(buf, len) || buf[2] != GS_WIRE_VERSION || (buf[3] != GS_WIRE_STATUS && buf[3] != GS_WIRE_STATUS_DELTA))
+    {
+        return -2;
+    }
+    bool full = buf[3] == GS_WIRE_STATUS;
+
+    wire_in_t in[1] = {{buf + 4, buf + len, 0, dec->strings}};
+    uint64_t seq = get_varint(in);
+    if (in->error != 0 || seq > UINT32_MAX)
+    {
+        dec->have_base = false;
+        return -1;
+    }
+
+    if (full)
+    {
+        strings_reset(dec->strings);
+        memset(status, 0x0, sizeof(phy_status_t));
+    }
+    else if (!dec->have_base || (uint32_t)seq != dec->seq + 1)
+    {
+        dec->have_base = false;
+        return -3;
+    }
+    else
+    {
+        *status = dec->base;
+    }
+
+    decode_status_fields(in, status);
+    if (in->error != 0)
+    {
+        dec->have_base = false;
+        return in->error;
+    }
+
+    dec->seq = (uint32_t)seq;
+    dec->base = *status;
+    dec->have_base = true;
+    if (used != NULL)
+    {
+        *used = in->at - buf;
+    }
+    return 1;
+}
+
+ssize_t gs_wire_encode_config(const phy_config_t *config, uint8_t *buf, size_t cap)
+{
+    gs_wire_strings_t strings[1];
+    strings_reset(strings);
+
+    wire_out_t out[1] = {{buf, buf + cap, false, strings}};
+    put_header(out, GS_WIRE_CONFIG);
+    encode_config_fields(out, config);
+    return out->overflow ? -1 : out->at - buf;
+}
+
+int gs_wire_decode_config(const uint8_t *buf, size_t len, phy_config_t *config)
+{
+    if (!gs_wire_is_encoded(buf, len) || buf[2] != GS_WIRE_VERSION || buf[3] != GS_WIRE_CONFIG)
+    {
+        return -2;
+    }
+
+    gs_wire_strings_t strings[1];
+    strings_reset(strings);
+    wire_in_t in[1] = {{buf + 4, buf + len, 0, strings}};
+    memset(config, 0x0, sizeof(phy_config_t));
+    decode_config_fields(in, config);
+    return in->error != 0 ? in->error : 1;
+}
+
+int gs_wire_encoding_from_string(const char *name, wire_encoding *encoding)
+{
+    if (strcmp(name, "raw") == 0)
+    {
+        *encoding = WIRE_ENCODING_RAW;
+    }
+    else if (strcmp(name, "compact") == 0)
+    {
+        *encoding = WIRE_ENCODING_COMPACT;
+    }
+    else
+    {
+        return -1;
+    }
+    return 1;
+}
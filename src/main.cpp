@@ -12,6 +12,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <signal.h>
+#include <stdlib.h>
 #include "rxmodem.h"
 #include "meb_debug.hpp"
 #include "gs_haystack.hpp"
@@ -28,61 +29,290 @@ int main(int argc, char **argv)
 
     // Set up global data.
     global_data_t global[1] = {0};
-    global->network_data = new NetDataClient(NetPort::HAYSTACK, SERVER_POLL_RATE);
 
-    // Create Ground Station Network thread IDs.
-    pthread_t net_polling_tid, net_rx_tid, xband_rx_tid, xband_status_tid;
+    // Load the configuration: compiled-in defaults, overlaid with the file given by -c (or ./haystack.conf, if present).
+    const char *config_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            config_path = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-c config_file]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    gs_config_defaults(global->config);
+    if (config_path != NULL)
+    {
+        if (gs_config_load(global->config, config_path) < 0)
+        {
+            ftprintlf("Could not load configuration file %s.", config_path);
+            return -1;
+        }
+    }
+    else if (gs_config_load(global->config, GS_CONFIG_DEFAULT_PATH) == -2)
+    {
+        ftprintlf("Could not parse configuration file %s.", GS_CONFIG_DEFAULT_PATH);
+        return -1;
+    }
+
+    gs_log_hexdump_config(global->config->log_hexdump_per_sec, global->config->log_hexdump_bytes);
+    if (global->config->log_async && gs_log_start() < 0)
+    {
+        dbprintlf(RED_FG "Could not start the log thread, logging synchronously.");
+    }
+
+#ifdef HAYSTACK_SIM
+    if (sim_configure(&global->config->sim) < 0)
+    {
+        ftprintlf("Could not configure the simulated radio.");
+        return -1;
+    }
+    dbprintlf(YELLOW_BG "Running against the SIMULATED modem, radio and PLL.");
+#endif
+
+    // Replayed frames are recordings already; recording them again could also prune the very segments being replayed.
+    if (global->config->replay_files[0] != '\0' && global->config->rec_enabled)
+    {
+        dbprintlf(YELLOW_FG "Not recording while replaying captures.");
+        global->config->rec_enabled = false;
+    }
+
+    // Enough buffers for every frame the configuration can hold at once, unless [pool] buffers says how many.
+    uint32_t pool_needed = gs_config_pool_needed(global->config);
+    if (global->config->pool_buffers == 0)
+    {
+        global->config->pool_buffers = pool_needed;
+    }
+    else if (global->config->pool_buffers < pool_needed)
+    {
+        ftprintlf("[pool] buffers = %u is too few: this configuration can hold %u frames at once.", global->config->pool_buffers, pool_needed);
+        return -1;
+    }
+
+    // All frame buffers are allocated here, once; the receive paths never touch the heap after this.
+    if (buffer_pool_init(global->pool, global->config->pool_buffers, global->config->rx_mtu) < 0)
+    {
+        ftprintlf("Could not allocate the buffer pool.");
+        return -1;
+    }
+
+    // Each receive chain has its own modem, radio, PLL, capture stage and forwarding stage.
+    global->chain_count = global->config->rx_chains;
+    int status_fds[CHAINS_MAX];
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        if (gs_chain_init(global, i) < 0)
+        {
+            ftprintlf("Could not set up receive chain %u.", i);
+            return -1;
+        }
+        status_fds[i] = global->chains[i].status->wake_fd;
+    }
+
+    if (gs_recorder_init(global->recorder, global->pool, global->config->rec_ring_slots, global->config->rec_directory, (uint64_t)global->config->rec_segment_mb << 20, global->config->rec_max_segments, global->config->rec_batch_frames, global->config->rec_batch_ms, global->config->rec_fsync, global->config->rec_fsync_interval_ms, global->chain_count) < 0)
+    {
+        ftprintlf("Could not set up the capture recorder.");
+        return -1;
+    }
+
+    if (gs_uplink_init(global->uplink, global->config->net_zero_copy, global->config->net_batch_frames, global->config->net_batch_bytes, global->config->net_batch_latency_us) < 0)
+    {
+        ftprintlf("Could not set up the uplink.");
+        return -1;
+    }
+
+    // Picks up any frames a previous run left in the spool file.
+    if (global->config->spool_enabled && gs_spool_init(global->spool, global->config->spool_ram_mb, global->config->spool_disk_mb, global->config->spool_directory) < 0)
+    {
+        ftprintlf("Could not set up the outage spool.");
+        return -1;
+    }
+
+    if (gs_metrics_init(global->metrics, global->config->metrics_enabled, global->config->metrics_interval_ms, global->config->metrics_sample_every, global->config->metrics_port, global->config->metrics_socket) < 0)
+    {
+        ftprintlf("Could not set up metrics.");
+        return -1;
+    }
+
+    if (gs_schedule_init(global->schedule, global->chain_count, global->config->schedule_max_entries) < 0)
+    {
+        ftprintlf("Could not allocate the retune schedules.");
+        return -1;
+    }
+
+    if (gs_compress_init(global->compress, global->pool, global->config->compress_method, global->config->compress_workers, global->config->compress_level, global->config->compress_adaptive, global->config->compress_min_saving, global->config->compress_probe_every) < 0)
+    {
+        ftprintlf("Cannot compress with %s at level %d.", gs_compress_codec_name(global->config->compress_method), global->config->compress_level);
+        return -1;
+    }
 
-    // Start the RX threads, and restart them should it be necessary.
-    // Only gets-out if a thread declares an unrecoverable emergency and sets its status to -1.
-    while (global->network_data->thread_status > -1)
+    gs_hwexec_init(global->hwexec, global->chain_count);
+
+    if (gs_replay_init(global->replay, global->config->replay_files, global->config->replay_speed, global->config->replay_rate_fps, global->config->replay_max_gap_ms, global->config->replay_jitter_us, global->config->replay_burst_frames, global->config->replay_loops, global->config->replay_seed) < 0)
     {
-        // 1 = All good, 0 = recoverable failure, -1 = fatal failure (close program)
-        global->network_data->thread_status = 1;
-        global->network_data->recv_active = true;
+        ftprintlf("No files match [replay] files %s.", global->config->replay_files);
+        return -1;
+    }
 
-        // Initialize and begin socket communication to the server.
-        if (!global->network_data->connection_ready)
+    global->network_data = new NetDataClient(NetPort::HAYSTACK, SERVER_POLL_RATE);
+
+    if (gs_netloop_init(global->netloop, status_fds, global->chain_count, global->config->rx_mtu, global->config->net_poll_ms, global->config->net_timeout_ms, global->config->net_backoff_min_ms, global->config->net_backoff_max_ms) < 0)
+    {
+        ftprintlf("Could not set up the network loop.");
+        return -1;
+    }
+
+    // Everything the receive path uses is allocated by now. The buffer pool was touched as it was allocated; the rest
+    // is touched here, so that no stage takes a page fault on first use, then all of it is kept resident.
+    if (global->config->sched_prefault)
+    {
+        for (uint32_t i = 0; i < global->chain_count; i++)
+        {
+            gs_sched_prefault(global->chains[i].rx_drain, global->config->rx_mtu);
+        }
+        gs_sched_prefault(global->netloop->rx_buf, global->netloop->rx_cap);
+        if (global->spool->enabled)
+        {
+            gs_sched_prefault(global->spool->ram->base, global->spool->ram->size);
+        }
+    }
+    if (global->config->sched_lock_memory)
+    {
+        // Only the receive path: the disk spool is a file mapping as large as the disk ring, and must stay pageable.
+        bool locked = true;
+        locked &= gs_sched_lock(global->pool->storage, (size_t)global->pool->count * global->config->rx_mtu, "buffer pool") > 0;
+        locked &= gs_sched_lock(global->pool->frames, (size_t)global->pool->count * sizeof(rx_frame_t), "buffer pool") > 0;
+        locked &= gs_sched_lock(global->pool->next, (size_t)global->pool->count * sizeof(std::atomic<uint32_t>), "buffer pool") > 0;
+        locked &= gs_sched_lock(global->pool->refs, (size_t)global->pool->count * sizeof(std::atomic<uint32_t>), "buffer pool") > 0;
+        for (uint32_t i = 0; i < global->chain_count; i++)
+        {
+            frame_ring_t *ring = global->chains[i].rx_ring;
+            locked &= gs_sched_lock(ring->ready, (size_t)ring->capacity * sizeof(std::atomic<uint32_t>), "frame rings") > 0;
+            locked &= gs_sched_lock(global->chains[i].rx_drain, global->config->rx_mtu, "scratch buffers") > 0;
+        }
+        frame_ring_t *ring = global->recorder->ring;
+        locked &= gs_sched_lock(ring->ready, (size_t)ring->capacity * sizeof(std::atomic<uint32_t>), "frame rings") > 0;
+        locked &= gs_sched_lock(global->netloop->rx_buf, global->netloop->rx_cap, "scratch buffers") > 0;
+        if (global->spool->enabled)
+        {
+            locked &= gs_sched_lock(global->spool->ram->base, global->spool->ram->size, "RAM spool") > 0;
+        }
+        if (locked)
         {
-            // TODO: Check if this is the desired functionality.
-            // Currently, the program will not proceed past this point if it cannot connect to the server.
-            // NOTE: Loss of connection to server is regained via gs_polling_thread's constant connection_ready check.
-            while (gs_connect_to_server(global->network_data) != 1)
-            {
-                dbprintlf(RED_FG "Failed to establish connection to server.");
-                usleep(5 SEC);
-            }
+            dbprintlf(BLUE_FG "Locked the receive path's memory.");
         }
+    }
 
-        // Start the threads.
-        pthread_create(&net_polling_tid, NULL, gs_polling_thread, global->network_data);
-        pthread_create(&net_rx_tid, NULL, gs_network_rx_thread, global);
-        // pthread_create(&xband_rx_tid, NULL, gs_xband_rx_thread, global);
-        pthread_create(&xband_status_tid, NULL, xband_status_thread, global);
+    // Create Ground Station Network thread IDs.
+    pthread_t netloop_tid, xband_rx_tid[CHAINS_MAX], xband_fwd_tid[CHAINS_MAX], hwexec_tid[CHAINS_MAX], recorder_tid, metrics_tid, schedule_tid, replay_tid;
 
-        void *thread_return;
-        pthread_join(net_polling_tid, &thread_return);
-        pthread_join(net_rx_tid, &thread_return);
-        // pthread_join(xband_rx_tid, &thread_return);
-        pthread_join(xband_status_tid, &thread_return);
+    // 1 = All good, -1 = fatal failure (close program)
+    global->thread_status.store(1, std::memory_order_release);
+    global->network_data->recv_active = true;
 
-        dbprintlf(RED_BG "thread_status: %d, recv_active: %d", global->network_data->thread_status, global->network_data->recv_active);
+    // Start the threads once. The network loop connects to the server, and reconnects in place should the connection
+    // be lost, without disturbing the radio side. The capture stage idles until armed; when replaying, the replay thread
+    // feeds the chains instead. Only returns if a thread declares an unrecoverable emergency and sets thread_status to -1.
+    if (gs_compress_start(global->compress, global->metrics) < 0)
+    {
+        ftprintlf("Could not start the compression workers.");
+        return -1;
+    }
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        if (!global->replay->enabled)
+        {
+            pthread_create(&xband_rx_tid[i], NULL, gs_xband_rx_thread, &global->chains[i]);
+        }
+        pthread_create(&xband_fwd_tid[i], NULL, gs_xband_fwd_thread, &global->chains[i]);
+        pthread_create(&hwexec_tid[i], NULL, gs_hwexec_thread, &global->chains[i]);
+    }
+    if (global->config->rec_enabled)
+    {
+        pthread_create(&recorder_tid, NULL, gs_recorder_thread, global);
+    }
+    if (global->replay->enabled)
+    {
+        pthread_create(&replay_tid, NULL, gs_replay_thread, global);
+    }
+    pthread_create(&netloop_tid, NULL, gs_netloop_thread, global);
+    pthread_create(&schedule_tid, NULL, gs_schedule_thread, global);
+    if (global->metrics->enabled)
+    {
+        pthread_create(&metrics_tid, NULL, gs_metrics_thread, global);
+    }
 
-        usleep(5 SEC);
-        // Loop will begin again, restarting the threads.
+    void *thread_return;
+    pthread_join(netloop_tid, &thread_return);
+    pthread_join(schedule_tid, &thread_return);
+    // Nothing queues commands once the network loop has returned; the one in hand is finished before the radios go.
+    gs_hwexec_stop(global->hwexec);
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        pthread_join(hwexec_tid[i], &thread_return);
+    }
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        pthread_join(xband_fwd_tid[i], &thread_return);
+    }
+    if (global->replay->enabled)
+    {
+        // Nothing drains the receive rings any more; a replay blocked on a full one is let go.
+        for (uint32_t i = 0; i < global->chain_count; i++)
+        {
+            frame_ring_close(global->chains[i].rx_ring);
+        }
+        pthread_join(replay_tid, &thread_return);
+    }
+    gs_compress_stop(global->compress);
+    if (global->config->rec_enabled)
+    {
+        pthread_join(recorder_tid, &thread_return);
+    }
+    if (global->metrics->enabled)
+    {
+        pthread_join(metrics_tid, &thread_return);
     }
 
-    // Shutdown the X-Band radio.
-    rxmodem_stop(global->rx_modem);
-    rxmodem_destroy(global->rx_modem);
-    adf4355_pw_down(global->PLL);
-    adf4355_destroy(global->PLL);
-    adradio_destroy(global->radio);
+    // Shutdown the X-Band radios, letting each capture stage finish its frame.
+    for (uint32_t i = 0; i < global->chain_count; i++)
+    {
+        gs_chain_t *chain = &global->chains[i];
+        gs_rxworker_stop(chain->rx_worker);
+        rxmodem_stop(chain->rx_modem);
+        if (!global->replay->enabled)
+        {
+            pthread_join(xband_rx_tid[i], &thread_return);
+        }
+        rxmodem_destroy(chain->rx_modem);
+        adf4355_pw_down(chain->PLL);
+        adf4355_destroy(chain->PLL);
+        adradio_destroy(chain->radio);
+        gs_chain_destroy(chain);
+    }
 
     // Destroy other things.
-    close(global->network_data->socket);
+    gs_recorder_destroy(global->recorder);
+    gs_uplink_destroy(global->uplink);
+    gs_netloop_destroy(global->netloop);
+    gs_metrics_destroy(global->metrics);
+    gs_schedule_destroy(global->schedule);
+    gs_compress_destroy(global->compress);
+    gs_hwexec_destroy(global->hwexec);
+    gs_replay_destroy(global->replay);
+    if (global->spool->enabled)
+    {
+        gs_spool_destroy(global->spool);
+    }
+    buffer_pool_destroy(global->pool);
 
-    int retval = global->network_data->thread_status;
+    int retval = global->thread_status.load();
     delete global->network_data;
     return retval;
 }
\ No newline at end of file
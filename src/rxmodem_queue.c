@@ -0,0 +1,48 @@
+/**
+ * @file rxmodem_queue.c
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Descriptor-queue receive for the X-Band modem, on the adidma driver.
+ * @version See Git tags for version information.
+ * @date 2026.10.16
+ *
+ * The adidma driver in modem/ programs a single transfer into one buffer and has no descriptor queue, so this
+ * reports a depth of 0 and haystack keeps the blocking rxmodem_receive(...) and rxmodem_read(...). The simulated
+ * backend (sim/sim_rxmodem.c) implements the queue in full; this is where a scatter-gather driver would plug in.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <stddef.h>
+#include "rxmodem_queue.h"
+
+int rxmodem_queue_depth(rxmodem *dev)
+{
+    (void)dev;
+    return 0;
+}
+
+int rxmodem_submit(rxmodem *dev, uint8_t *buf, uint32_t capacity, void *tag)
+{
+    (void)dev;
+    (void)buf;
+    (void)capacity;
+    (void)tag;
+    return -1;
+}
+
+ssize_t rxmodem_complete(rxmodem *dev, void **tag, ssize_t *frame_size)
+{
+    (void)dev;
+    *tag = NULL;
+    *frame_size = -1;
+    return -1;
+}
+
+int rxmodem_cancel(rxmodem *dev, void **tags, int max)
+{
+    (void)dev;
+    (void)tags;
+    (void)max;
+    return -1;
+}